@@ -0,0 +1,207 @@
+
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <math.h>
+    #include <string.h>
+    #include <stdbool.h>
+    #include <pthread.h>
+    #include <stdatomic.h>
+    #include "./headerfiles/idw_structs.h"
+    #include "./headerfiles/idw.h"
+    #include "./headerfiles/barnes.h"
+#endif
+
+
+/* ##########################################################################################
+
+Author: 	Schotte, Ilja
+Latest Update:	22.04.2023
+Compiled with:	gcc v7.5.0
+
+
+DESCRIPTION:
+Performs a Barnes analysis (successive correction with gaussian weights) on daily precipitation sums.
+It uses the same raster, input dataset and output files as the IDW interpolation (idw.c).
+The stations are distributed to the raster and convolved by box filters (approximation of the
+gaussian), so a pass takes O(raster points + stations) instead of O(raster points x stations).
+Fast first guess of the precipitation field (e.g. for nowcasting).
+
+ARGUMENTS:
+-o	...	This function shows no output during its calculations.
+		You can enable an extensive output by using this parameter
+-csv	...	the raster is written to csv files (values, "lat.csv" and "lon.csv")
+		instead of one binary file (header with the geometry + float32 values).
+-t <n>	...	number of threads used to write the csv files.
+		By default all available processors are used.
+-s <km>	...	smoothing length (standard deviation of the gaussian weights) of the first pass.
+		By default it follows out of the mean distance of the stations.
+-g <gamma>	...	factor (0 < gamma <= 1) of the smoothing of the correction passes (default 0.3).
+-p <n>	...	number of passes: first pass + correction passes (default 3).
+		
+Compile with:	gcc barnes.c -o barnes -lm -lpthread
+		
+###########################################################################################*/
+
+
+
+
+int main(int argc, char **argv){
+
+
+    int err;
+    
+    // ####################################################################################
+    // ############ declaration and initializing of object "Map" ############################
+    // use this section for configuration purposes:
+    
+    struct usr_map Map = {
+        .minLat = 47.000,					// minLat ("minimum latitude") : min. decimal degree (latitude) 
+        .maxLat = 55.000,					// maxLat ("maximum latitude") : max. decimal degree (latitude)
+        .minLon = 5.000,					// minLon ("minimum longitude") : min. decimal degree (longitude) 
+        .maxLon = 16.000,					// maxLon ("maximum longitude") : max. decimal degree (longitude)
+        .latRes = 0,						// 0,04545 => resolution of 5 km / 0,00909 => resolution of approx 1km
+        .lonRes = 0,						// 0,04545 => resolution of 5 km / 0,00909 => resolution of approx 1km
+        .latMetRes = 0,						// resolution between two points (geogr. latitude)
+        .lonMetRes = 0,						// resolution between two points (geogr. longitude)
+        .show_output = false,					// show output during calculations
+        .output_csv = false,					// output csv files instead of one binary file
+        .num_threads = 0,					// number of threads (0 => all available processors)
+        .rows = 900,						// 900 => resolution of 1 km in horizontal direction
+        .cols = 0,						// will be subsequently calculated 						
+        .config = {
+            .output_dir = {"./output/"},			// output directory 
+            .output_datafile = {"barnesRaster"}, 		// outputfile (without extension)
+            .csv_decimal_separator = '.',			// decimal separator of the csv files
+            .csv_field_separator = ';',				// field separator of the csv files
+            .input_dir = {"./input/"},				// input directory 			
+            .input_datafile = {"tagessummen_452.csv"},		// dataset of the sums of daily precipiation
+            ._exp = 2,						// exponent of the distance (IDW only, not used)
+        },
+        .arena = {.blocks = NULL, .block_size = ARENA_BLOCK_SIZE},	// buffers of the run (released at once in free_raster)
+        .input_data.data = NULL,
+        .raster = {.value = NULL, .stations = NULL},
+        .grid_distance = {.row_sin = NULL, .row_cos = NULL, .station_sin = NULL, .station_cos = NULL, .col_cos_dlon = NULL},
+        .station_index = {.cell_start = NULL, .stations = NULL, .unit_vectors = NULL},
+        .barnes = {
+            .smoothing_length = 0,				// smoothing length in km (0 => out of the mean distance of the stations)
+            .gamma = 0.3,					// factor of the smoothing of the correction passes
+            .passes = 3,					// first pass + 2 correction passes
+        },
+        };
+    
+    
+    // ####################################################################################    
+    // ####################################################################################
+    
+    // read the arguments of main and performs some calculations to get the number of columns of the raster.
+    err = set_config(&Map, argc, argv);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // arguments of the Barnes analysis:
+    err = set_barnes_config(&Map, argc, argv);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    
+    // initialize the raster of the map:
+    err = create_maps_raster(&(Map.arena), &(Map.raster), Map.rows, Map.cols);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+
+    // fill the raster with information:
+    // - geometry (coordinates of the raster points)
+    // - default values
+    err = fill_raster_with_default_data(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+   
+   
+    // Read the input dataset out of the given csv file:
+    err = input_csv_data(&Map, Map.config.input_datafile);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+                
+    // Ordne die Messpunkte den Rasterpunkten zu:
+    err = fill_raster_with_input_data(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // show the input dataset:
+    err = show_input_data(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;    
+
+    // Barnes analysis of the raster:
+    err = barnes_analysis(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+                  
+    // Bestimme Metadaten des Ausgabeprodukts:
+    err = get_output_information(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+                
+    // show information regarding to the interpolated raster if Map.show_output is set to true
+    err = show_map_info(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+       
+    // now output the raster (binary file or value, latitude and longitude csv files):
+    err = (Map.output_csv) ? outputRasterCSV(&(Map.raster), Map.config.output_dir, Map.config.output_datafile, Map.config.csv_decimal_separator, Map.config.csv_field_separator, Map.num_threads, Map.show_output)
+                           : outputRasterBinary(&(Map.raster), Map.config.output_dir, Map.config.output_datafile, Map.show_output);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    
+    // clean up:
+    free_raster(&Map);
+    free_vector(&Map);             
+                
+    return 0;
+}
+
+
+
+
+
+
+
+
+
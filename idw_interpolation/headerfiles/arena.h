@@ -0,0 +1,167 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <errno.h>
+#endif
+
+#define ARENA_ALIGN 64						// alignment (bytes) of every allocation of the arena
+#define ARENA_BLOCK_SIZE (1 << 20)				// minimum size (bytes) of a block of the arena
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+void *arena_alloc(struct usr_arena *arena, size_t size);
+struct usr_arena_mark arena_mark(struct usr_arena *arena);
+void arena_rewind(struct usr_arena *arena, struct usr_arena_mark mark);
+void show_arena_info(struct usr_arena *arena);
+void free_arena(struct usr_arena *arena);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void *arena_alloc(struct usr_arena *arena, size_t size){
+
+    /*
+        DESCRIPTION:
+        Takes a block of memory of at least "size" bytes out of the arena. The memory is aligned
+        to ARENA_ALIGN bytes and set to 0. It must not be freed, all the memory of the arena is released
+        at once by free_arena (or given back up to a mark by arena_rewind).
+
+        The arena bumps a pointer through blocks of at least "arena->block_size" bytes. A request that
+        does not fit into the current block gets a new block (of its own size, if it is larger).
+        The arena is not thread safe: only the main thread allocates, the threads get their buffers.
+
+        INPUT:
+        struct usr_arena *arena	...	pointer to the arena
+        size_t size			...	number of bytes
+
+        OUTPUT:
+        on success			...	pointer to the memory
+        on failure			...	NULL (errno is set)
+    */
+
+    void *zgr;
+    size_t block_size;
+    struct usr_arena_block *block = arena->blocks;
+
+    // every allocation starts at a multiple of ARENA_ALIGN bytes:
+    size = (size > 0) ? ((size + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN : ARENA_ALIGN;
+
+    if ((block == NULL) || (block->used + size > block->size)){
+
+        block_size = (arena->block_size > size) ? arena->block_size : size;
+
+        // the head of the block takes the first ARENA_ALIGN bytes:
+        if (posix_memalign(&zgr, ARENA_ALIGN, ARENA_ALIGN + block_size) != 0){
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        block = (struct usr_arena_block *) zgr;
+        block->data = (unsigned char *) zgr + ARENA_ALIGN;
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->blocks;
+
+        arena->blocks = block;
+        arena->reserved += block_size;
+        arena->num_blocks++;
+    }
+
+    zgr = block->data + block->used;
+    block->used += size;
+
+    arena->in_use += size;
+    arena->peak = (arena->in_use > arena->peak) ? arena->in_use : arena->peak;
+    arena->num_allocations++;
+
+    memset(zgr, 0, size);
+
+    return zgr;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+struct usr_arena_mark arena_mark(struct usr_arena *arena){
+
+    /*
+        DESCRIPTION:
+        Returns the current state of the arena. All the memory that is allocated afterwards can be
+        given back at once by arena_rewind (scratch buffers of a function).
+    */
+
+    struct usr_arena_mark mark = {.block = arena->blocks,
+                                  .used = (arena->blocks != NULL) ? arena->blocks->used : 0,
+                                  .in_use = arena->in_use};
+
+    return mark;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void arena_rewind(struct usr_arena *arena, struct usr_arena_mark mark){
+
+    /*
+        DESCRIPTION:
+        Gives back all the memory that was allocated after the mark (see arena_mark).
+        The blocks that were added after the mark are released.
+    */
+
+    struct usr_arena_block *block;
+
+    while ((arena->blocks != NULL) && (arena->blocks != mark.block)){
+
+        block = arena->blocks;
+        arena->blocks = block->next;
+        arena->reserved -= block->size;
+        arena->num_blocks--;
+        free(block);
+    }
+
+    if (arena->blocks != NULL){
+        arena->blocks->used = mark.used;
+    }
+    arena->in_use = mark.in_use;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void show_arena_info(struct usr_arena *arena){
+
+    /*
+        DESCRIPTION:
+        Shows the peak usage of the arena on stdout.
+    */
+
+    printf("%-40s %.2f MiB peak, %.2f MiB in %d blocks, %ld allocations\n", "memory arena (usage):",
+           arena->peak / (1024.0 * 1024.0),
+           arena->reserved / (1024.0 * 1024.0),
+           arena->num_blocks,
+           arena->num_allocations);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void free_arena(struct usr_arena *arena){
+
+    struct usr_arena_mark empty = {.block = NULL, .used = 0, .in_use = 0};
+
+    arena_rewind(arena, empty);
+}
@@ -0,0 +1,652 @@
+
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <stdbool.h>
+    #include <setjmp.h>
+    #include <errno.h>
+#endif
+
+#define BARNES_BOX_PASSES 4					// number of box filters per direction, that approximate the gaussian weights
+#define BARNES_MIN_WEIGHT 1.0E-3				// sums of the weights below this part of the peak weight of one station are out of reach
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int set_barnes_config(struct usr_map *Map, int argc, char **argv);
+int barnes_analysis(struct usr_map *Map);
+double barnes_smoothing_length(struct usr_map *Map);
+int box_filter_radius(double sigma, double spacing);
+double box_filter_peak(int radius);
+void barnes_convolve(double *grid, double *tmp, double *line, int rows, int cols, int radius_rows, const int *radius_cols);
+void box_filter_vertical(const double *src, double *dst, int rows, int cols, int radius, double *acc);
+void box_filter_horizontal(const double *src, double *dst, int rows, int cols, const int *radius);
+int raster_position(struct usr_raster *raster, double lat, double lon, int *row, int *col, double *weights);
+double sample_field(const double *field, struct usr_raster *raster, double lat, double lon);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int set_barnes_config(struct usr_map *Map, int argc, char **argv){
+
+    /*
+        DESCRIPTION:
+        Reads the arguments of the Barnes analysis (see barnes.c). The general arguments (-o, -csv, -t)
+        and the geometry of the raster are handled by set_config.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the "map" object of datatype "struct usr_map".
+
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        for (idx=0; idx<argc; idx++){
+
+            // smoothing length (km) of the first pass:
+            if (!strcmp(argv[idx],"-s")){
+                if ((idx+1 >= argc) || (atof(argv[idx+1]) <= 0)){
+                    longjmp(env, 1);
+                }
+                Map->barnes.smoothing_length = atof(argv[++idx]);
+            }
+
+            // factor of the smoothing of the correction passes:
+            if (!strcmp(argv[idx],"-g")){
+                if ((idx+1 >= argc) || (atof(argv[idx+1]) <= 0) || (atof(argv[idx+1]) > 1)){
+                    longjmp(env, 2);
+                }
+                Map->barnes.gamma = atof(argv[++idx]);
+            }
+
+            // number of passes:
+            if (!strcmp(argv[idx],"-p")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 3);
+                }
+                Map->barnes.passes = atoi(argv[++idx]);
+            }
+        }
+
+        if ((Map->barnes.passes <= 0) || (Map->barnes.gamma <= 0) || (Map->barnes.gamma > 1) || (Map->barnes.smoothing_length < 0)){
+            longjmp(env, 4);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-s\" requires a smoothing length (km) greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-g\" requires a factor greater then 0 and not greater then 1!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-p\" requires a number of passes greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\nThe Barnes analysis needs passes > 0, 0 < gamma <= 1 and a smoothing length >= 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\nWoops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int barnes_analysis(struct usr_map *Map){
+
+    /*
+
+        DESCRIPTION:
+        Barnes analysis (successive correction with gaussian weights) of the input dataset on the raster.
+        The first pass is the weighted average of the stations with the weights exp(-r² / (2 * sigma²)),
+        "sigma" is the smoothing length. Every further pass adds the weighted average of the residuals
+        of the stations (value - analysis at the station) with the smoothing length sigma * sqrt(gamma).
+
+        Instead of a sum over all stations for every raster point, the values (numerator) and the weights
+        (denominator) of the stations are distributed to their 4 surrounding raster points (bilinear) and
+        convolved with BARNES_BOX_PASSES box filters per direction, that approximate the gaussian
+        (see barnes_convolve). So the effort of a pass is O(raster points + stations) and does not depend
+        on the smoothing length. The analysis at a station is interpolated bilinear out of the raster.
+        The raster is extended by the reach of the box filters, so the stations just outside the raster
+        are taken into account. Raster points out of reach of any station get NO_VALUE.
+        The corrections overshoot near strong gradients, so the analysis is clipped to the minimum of the
+        input values (precipitation never falls below 0 and a value of -1 would read as NO_VALUE).
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+
+    */
+
+    int idx, pass;
+    int excno;
+    jmp_buf env;
+
+
+    if ((excno = setjmp(env)) == 0){
+
+        int row, col, corner;
+        int rows, cols;
+        int margin_rows, margin_cols;
+        int radius_rows;
+        int pos_row, pos_col;
+        size_t cell, num_cells;
+        int peak_radius;
+        double sigma, lat, peak_rows, peak_cols = 0, min_weight;
+        double min_value = INFINITY;
+        double weights[4];
+        double *field, *numerator, *denominator, *tmp, *line, *residuals;
+        int *radius_cols;
+        struct usr_raster work;
+        struct usr_data_point *data = Map->input_data.data;
+        struct usr_arena_mark scratch = arena_mark(&(Map->arena));	// buffers of the analysis, given back at the end
+
+        if (Map->input_data.length <= 0){
+            longjmp(env, 1);
+        }
+
+        // smoothing length out of the mean distance of the stations, if not given:
+        if (Map->barnes.smoothing_length <= 0){
+            Map->barnes.smoothing_length = barnes_smoothing_length(Map);
+        }
+
+        // the raster is extended by the reach of the box filters of the first pass (greatest smoothing length),
+        // so the stations outside the raster take part and the border has no edge effects:
+        radius_cols = (int *) arena_alloc(&(Map->arena), Map->rows * sizeof(int));
+        if (radius_cols == NULL){
+            longjmp(env, 2);
+        }
+
+        margin_rows = BARNES_BOX_PASSES * box_filter_radius(Map->barnes.smoothing_length, Map->latMetRes);
+        margin_rows = (int)fmin(margin_rows, fmin((90 - Map->maxLat) / Map->latRes, (90 + Map->minLat) / Map->latRes));
+        margin_cols = 0;
+        for (row=0; row<(int)Map->rows; row++){
+            lat = raster_lat(&(Map->raster), row);
+            radius_cols[row] = box_filter_radius(Map->barnes.smoothing_length, calc_distance(lat, Map->minLon, lat, Map->minLon + Map->lonRes));
+            margin_cols = (BARNES_BOX_PASSES * radius_cols[row] > margin_cols) ? BARNES_BOX_PASSES * radius_cols[row] : margin_cols;
+        }
+        arena_rewind(&(Map->arena), scratch);
+
+        work.rows = Map->rows + 2 * margin_rows;
+        work.cols = Map->cols + 2 * margin_cols;
+        work.maxLat = Map->maxLat + margin_rows * Map->latRes;
+        work.minLon = Map->minLon - margin_cols * Map->lonRes;
+        work.latRes = Map->latRes;
+        work.lonRes = Map->lonRes;
+        work.num_stations = 0;
+        work.stations = NULL;
+
+        rows = (int)work.rows;
+        cols = (int)work.cols;
+        num_cells = (size_t)rows * cols;
+
+        field = (double *) arena_alloc(&(Map->arena), num_cells * sizeof(double));
+        numerator = (double *) arena_alloc(&(Map->arena), num_cells * sizeof(double));
+        denominator = (double *) arena_alloc(&(Map->arena), num_cells * sizeof(double));
+        tmp = (double *) arena_alloc(&(Map->arena), num_cells * sizeof(double));
+        line = (double *) arena_alloc(&(Map->arena), ((cols > rows) ? cols : rows) * sizeof(double));
+        residuals = (double *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(double));
+        radius_cols = (int *) arena_alloc(&(Map->arena), rows * sizeof(int));
+
+        if ((field == NULL) || (numerator == NULL) || (denominator == NULL) || (tmp == NULL) ||
+            (line == NULL) || (residuals == NULL) || (radius_cols == NULL)){
+            arena_rewind(&(Map->arena), scratch);
+            longjmp(env, 2);
+        }
+        work.value = field;
+
+        if (Map->show_output){
+            printf("\nBarnes analysis: %d passes, smoothing length %.1f km, gamma %.2f (margin %d rows, %d columns)\n",
+                   Map->barnes.passes, Map->barnes.smoothing_length, Map->barnes.gamma, margin_rows, margin_cols);
+        }
+
+        // the first pass is the weighted average of the values:
+        for (idx=0; idx<Map->input_data.length; idx++){
+            residuals[idx] = data[idx].value;
+        }
+        for (cell=0; cell<num_cells; cell++){
+            field[cell] = 0;
+        }
+
+        for (pass=0; pass<Map->barnes.passes; pass++){
+
+            sigma = (pass == 0) ? Map->barnes.smoothing_length : Map->barnes.smoothing_length * sqrt(Map->barnes.gamma);
+
+            // radius of the box filters (rows: constant spacing, columns: spacing at the latitude of the row):
+            radius_rows = box_filter_radius(sigma, Map->latMetRes);
+            for (row=0; row<rows; row++){
+                lat = raster_lat(&work, row);
+                radius_cols[row] = box_filter_radius(sigma, calc_distance(lat, work.minLon, lat, work.minLon + work.lonRes));
+            }
+
+            // distribute the values and the weights of the stations to the raster:
+            for (cell=0; cell<num_cells; cell++){
+                numerator[cell] = 0;
+                denominator[cell] = 0;
+            }
+
+            for (idx=0; idx<Map->input_data.length; idx++){
+
+                // stations beyond the reach of the extended raster:
+                if ((isnan(residuals[idx])) || (raster_position(&work, data[idx].lat, data[idx].lon, &pos_row, &pos_col, weights) != 0)){
+                    continue;
+                }
+
+                for (corner=0; corner<4; corner++){
+                    cell = (size_t)(pos_row + corner / 2) * cols + (pos_col + corner % 2);
+                    numerator[cell] += weights[corner] * residuals[idx];
+                    denominator[cell] += weights[corner];
+                }
+            }
+
+            barnes_convolve(numerator, tmp, line, rows, cols, radius_rows, radius_cols);
+            barnes_convolve(denominator, tmp, line, rows, cols, radius_rows, radius_cols);
+
+            // first guess or correction of the raster: the raster points, whose sum of the weights is less then
+            // BARNES_MIN_WEIGHT of the peak weight of one station, are out of reach of the first pass ("NAN").
+            // The corrections fade out towards their reach (N / (D + min_weight)) instead of ending abruptly:
+            peak_rows = box_filter_peak(radius_rows);
+            peak_radius = -1;
+            
+            for (row=0; row<rows; row++){
+            
+                // the radius changes only slowly with the latitude:
+                if (radius_cols[row] != peak_radius){
+                    peak_radius = radius_cols[row];
+                    peak_cols = box_filter_peak(peak_radius);
+                }
+                min_weight = BARNES_MIN_WEIGHT * peak_rows * peak_cols;
+                
+                for (col=0; col<cols; col++){
+                
+                    cell = (size_t)row * cols + col;
+                    
+                    if (pass == 0){
+                        field[cell] = (denominator[cell] >= min_weight) ? (numerator[cell] / denominator[cell]) : NAN;
+                    }
+                    else{
+                        field[cell] += numerator[cell] / (denominator[cell] + min_weight);
+                    }
+                }
+            }
+
+            // residuals of the stations for the next pass:
+            for (idx=0; idx<Map->input_data.length; idx++){
+                residuals[idx] = data[idx].value - sample_field(field, &work, data[idx].lat, data[idx].lon);
+            }
+
+            if (Map->show_output){
+                printf("   pass %d: sigma %7.2f km, box radius %d rows / %d-%d columns\n",
+                       pass + 1, sigma, radius_rows, radius_cols[0], radius_cols[rows-1]);
+            }
+        }
+
+        // raster of the analysis (without the margin), not below the smallest value of the stations:
+        for (idx=0; idx<Map->input_data.length; idx++){
+            min_value = fmin(min_value, data[idx].value);
+        }
+
+        for (row=0; row<(int)Map->rows; row++){
+            for (col=0; col<(int)Map->cols; col++){
+                cell = (size_t)(row + margin_rows) * cols + (col + margin_cols);
+                Map->raster.value[(size_t)row * Map->cols + col] = (isnan(field[cell])) ? NO_VALUE : fmax(field[cell], min_value);
+            }
+        }
+
+        arena_rewind(&(Map->arena), scratch);
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length of the input dataset is 0!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double barnes_smoothing_length(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Smoothing length (km) of the first pass out of the mean distance of the stations
+        dn = sqrt(A) * (1 + sqrt(N)) / (N - 1) (Koch et al., 1983) within the area A of the raster:
+        kappa = 5.052 * (2 * dn / pi)², sigma = sqrt(kappa / 2).
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT:
+        smoothing length (km)
+    */
+
+    double n = (Map->input_data.length > 1) ? Map->input_data.length : 2;
+    double lat = (Map->minLat + Map->maxLat) / 2;
+    double height = calc_distance(Map->minLat, Map->minLon, Map->maxLat, Map->minLon);
+    double width = calc_distance(lat, Map->minLon, lat, Map->maxLon);
+    double dn = sqrt(height * width) * (1 + sqrt(n)) / (n - 1);
+    double kappa = 5.052 * (2 * dn / M_PI) * (2 * dn / M_PI);
+
+    return sqrt(kappa / 2);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int box_filter_radius(double sigma, double spacing){
+
+    /*
+        DESCRIPTION:
+        Radius (raster points) of a box filter, so that BARNES_BOX_PASSES box filters of the width
+        2 * radius + 1 have the variance of a gaussian with the standard deviation sigma:
+        BARNES_BOX_PASSES * ((2 * radius + 1)² - 1) / 12 * spacing² = sigma²
+
+        INPUT:
+        double sigma		...	standard deviation of the gaussian (km)
+        double spacing		...	distance (km) between two raster points
+
+        OUTPUT:
+        radius of the box filter (>= 0)
+    */
+
+    double width = sqrt(12.0 * sigma * sigma / (BARNES_BOX_PASSES * spacing * spacing) + 1.0);
+
+    return (int)round((width - 1.0) / 2.0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double box_filter_peak(int radius){
+
+    /*
+        DESCRIPTION:
+        Peak (center) of BARNES_BOX_PASSES box filters of the width 2 * radius + 1 applied to a single 1
+        (weight of a station at its own raster point, per direction). The box filters are not normalized,
+        the peak is the number of the paths of the box filters back to the center.
+
+        INPUT:
+        int radius		...	radius of the box filter
+
+        OUTPUT:
+        peak of the filtered impulse
+    */
+
+    int pass, idx, jdx;
+    int length = 2 * BARNES_BOX_PASSES * radius + 1;
+    double peak;
+    double *src = (double *) calloc(length, sizeof(double));
+    double *dst = (double *) calloc(length, sizeof(double));
+
+    // without memory the peak of the gaussian (variance BARNES_BOX_PASSES * ((2 * radius + 1)² - 1) / 12) is used:
+    if ((src == NULL) || (dst == NULL)){
+        free(src);
+        free(dst);
+        return pow(2 * radius + 1, BARNES_BOX_PASSES) / sqrt(2 * M_PI * BARNES_BOX_PASSES * ((2 * radius + 1) * (2 * radius + 1) - 1) / 12.0 + 1.0);
+    }
+
+    src[length / 2] = 1;
+    for (pass=0; pass<BARNES_BOX_PASSES; pass++){
+        for (idx=0; idx<length; idx++){
+            dst[idx] = 0;
+            for (jdx=idx-radius; jdx<=idx+radius; jdx++){
+                dst[idx] += ((jdx >= 0) && (jdx < length)) ? src[jdx] : 0;
+            }
+        }
+        memcpy(src, dst, length * sizeof(double));
+    }
+    peak = src[length / 2];
+
+    free(src);
+    free(dst);
+
+    return peak;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void barnes_convolve(double *grid, double *tmp, double *line, int rows, int cols, int radius_rows, const int *radius_cols){
+
+    /*
+        DESCRIPTION:
+        Convolves the raster with BARNES_BOX_PASSES box filters along the columns and along the rows.
+        The repeated box filter approximates the gaussian and is separable, the effort does not depend
+        on the radius (running sums). The result is written back to "grid".
+
+        INPUT:
+        double *grid			...	raster (rows x cols, row by row)
+        double *tmp			...	buffer of the same size
+        double *line			...	buffer of max(rows, cols) values
+        int rows, cols			...	dimensions of the raster
+        int radius_rows			...	radius of the box filter along a column (rows)
+        const int *radius_cols		...	radius of the box filter along every row (columns)
+    */
+
+    int pass;
+
+    for (pass=0; pass<BARNES_BOX_PASSES; pass++){
+        box_filter_vertical(grid, tmp, rows, cols, radius_rows, line);
+        box_filter_horizontal(tmp, grid, rows, cols, radius_cols);
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void box_filter_vertical(const double *src, double *dst, int rows, int cols, int radius, double *acc){
+
+    /*
+        DESCRIPTION:
+        Box filter along the columns: every raster point gets the sum of the raster points of the rows
+        row - radius ... row + radius (the raster is continued by 0). One running sum per column,
+        the rows are processed one after the other (contiguous memory).
+
+        INPUT:
+        const double *src	...	raster (rows x cols)
+        double *dst		...	filtered raster (rows x cols)
+        int rows, cols		...	dimensions of the raster
+        int radius		...	radius of the box filter (rows)
+        double *acc		...	buffer of the running sums (cols)
+    */
+
+    int row, col;
+    const double *add, *sub;
+    double *out;
+
+    for (col=0; col<cols; col++){
+        acc[col] = 0;
+    }
+    for (row=0; (row<radius) && (row<rows); row++){
+        add = &src[(size_t)row * cols];
+        for (col=0; col<cols; col++){
+            acc[col] += add[col];
+        }
+    }
+
+    for (row=0; row<rows; row++){
+
+        out = &dst[(size_t)row * cols];
+
+        if (row + radius < rows){
+            add = &src[(size_t)(row + radius) * cols];
+            for (col=0; col<cols; col++){
+                acc[col] += add[col];
+            }
+        }
+
+        for (col=0; col<cols; col++){
+            out[col] = acc[col];
+        }
+
+        if (row - radius >= 0){
+            sub = &src[(size_t)(row - radius) * cols];
+            for (col=0; col<cols; col++){
+                acc[col] -= sub[col];
+            }
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void box_filter_horizontal(const double *src, double *dst, int rows, int cols, const int *radius){
+
+    /*
+        DESCRIPTION:
+        Box filter along the rows: every raster point gets the sum of the raster points of the columns
+        col - radius ... col + radius of its row (the raster is continued by 0). The radius may differ
+        from row to row (distance of the columns at the latitude of the row).
+
+        INPUT:
+        const double *src	...	raster (rows x cols)
+        double *dst		...	filtered raster (rows x cols)
+        int rows, cols		...	dimensions of the raster
+        const int *radius	...	radius of the box filter (columns) of every row
+    */
+
+    int row, col, rad;
+    double acc;
+    const double *in;
+    double *out;
+
+    for (row=0; row<rows; row++){
+
+        in = &src[(size_t)row * cols];
+        out = &dst[(size_t)row * cols];
+        rad = radius[row];
+        acc = 0;
+
+        for (col=0; (col<rad) && (col<cols); col++){
+            acc += in[col];
+        }
+
+        for (col=0; col<cols; col++){
+
+            if (col + rad < cols){
+                acc += in[col + rad];
+            }
+            out[col] = acc;
+            if (col - rad >= 0){
+                acc -= in[col - rad];
+            }
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int raster_position(struct usr_raster *raster, double lat, double lon, int *row, int *col, double *weights){
+
+    /*
+        DESCRIPTION:
+        Position of a point within the raster: upper left raster point of the 4 surrounding raster points
+        and their bilinear weights (upper left, upper right, lower left, lower right).
+        Points outside the raster are moved to its border.
+
+        INPUT:
+        struct usr_raster *raster	...	pointer to the raster (rows, cols > 1)
+        double lat, lon			...	coordinates of the point
+        int *row, *col			...	upper left raster point
+        double *weights			...	bilinear weights of the 4 raster points
+
+        OUTPUT:
+        0, if the point lies within the raster, 1 otherwise (moved to the border)
+    */
+
+    int status = 0;
+    double frow = (raster->maxLat - lat) / raster->latRes;
+    double fcol = (lon - raster->minLon) / raster->lonRes;
+
+    if ((frow < 0) || (frow > raster->rows - 1) || (fcol < 0) || (fcol > raster->cols - 1)){
+        status = 1;
+        frow = (frow < 0) ? 0 : ((frow > raster->rows - 1) ? raster->rows - 1 : frow);
+        fcol = (fcol < 0) ? 0 : ((fcol > raster->cols - 1) ? raster->cols - 1 : fcol);
+    }
+
+    *row = ((int)frow < (int)raster->rows - 1) ? (int)frow : (int)raster->rows - 2;
+    *col = ((int)fcol < (int)raster->cols - 1) ? (int)fcol : (int)raster->cols - 2;
+
+    frow -= *row;
+    fcol -= *col;
+
+    weights[0] = (1 - frow) * (1 - fcol);
+    weights[1] = (1 - frow) * fcol;
+    weights[2] = frow * (1 - fcol);
+    weights[3] = frow * fcol;
+
+    return status;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double sample_field(const double *field, struct usr_raster *raster, double lat, double lon){
+
+    /*
+        DESCRIPTION:
+        Bilinear interpolation of the raster at a point. Raster points without a value ("NAN") are left out.
+
+        INPUT:
+        const double *field		...	values of the raster (rows x cols, "NAN" => no value)
+        struct usr_raster *raster	...	pointer to the raster (geometry)
+        double lat, lon			...	coordinates of the point
+
+        OUTPUT:
+        value at the point ("NAN", if none of the 4 raster points has a value)
+    */
+
+    int row, col, corner;
+    double weights[4];
+    double value, weight_sum = 0, value_sum = 0;
+
+    raster_position(raster, lat, lon, &row, &col, weights);
+
+    for (corner=0; corner<4; corner++){
+
+        value = field[(size_t)(row + corner / 2) * raster->cols + (col + corner % 2)];
+
+        if (!isnan(value)){
+            weight_sum += weights[corner];
+            value_sum += weights[corner] * value;
+        }
+    }
+
+    return (weight_sum > 0) ? (value_sum / weight_sum) : NAN;
+}
@@ -7,12 +7,52 @@
     #include <stdbool.h>
     #include <setjmp.h>
     #include <errno.h>
+    #include <stdint.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <stdatomic.h>
+    #include "arena.h"
+#endif
+
+#ifdef __AVX2__
+    #include <immintrin.h>
+    
+    // acos of 4 values at once (vector function of the glibc >= 2.35, libmvec is linked by -lm):
+    #if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 35))
+        #define ACOS_AVX2
+        __m256d _ZGVdN4v_acos(__m256d x);
+    #endif
+    
+    // exp and pow of 4 values at once (vector functions of the glibc >= 2.22):
+    #if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 22))
+        #define EXP_AVX2
+        __m256d _ZGVdN4v_exp(__m256d x);
+        __m256d _ZGVdN4vv_pow(__m256d x, __m256d y);
+    #endif
 #endif
 
 #define NO_VALUE -1.0
 #define M_PI 3.14159265358979323846
 #define EPS 1.0E-3
 #define RADIUS_EARTH 6365.265
+#define RASTER_MAGIC "RSTR"					// magic number of the binary raster file
+#define RASTER_VERSION 1					// version of the binary raster file
+#define RASTER_HEADER_SIZE 64					// size (bytes) of the header of the binary raster file
+#define RASTER_BIN_EXT ".bin"					// extension of the binary raster file
+#define RASTER_CSV_EXT ".csv"					// extension of the csv raster files
+#define CSV_FIELD_MAX 32					// maximum number of characters of a number in the csv files
+#define CSV_MAX_DECIMALS 9					// maximum number of decimals of the csv formatter
+#define CSV_VALUE_DECIMALS 3					// decimals of the values in the csv files
+#define CSV_COORD_DECIMALS 4					// decimals of the latitudes/longitudes in the csv files
+#define INPUT_DATA_CAPACITY 256					// initial number of stations of the input dataset (grows as needed)
+#define IDW_MAX_FIXED_EXP 4					// greatest exponent of the distance with its own kernel (others use pow)
+#define ROW_BLOCK 4						// number of raster rows a thread takes at once during the interpolation
+#define STATION_INDEX_FILL 2					// average number of stations per cell of the station index
+#define SEGMENT_COLS 16						// maximum number of raster points of a row, that share the candidates of the nearest stations
+#define SEGMENT_MIN_COLS 4					// minimum number of raster points to share the candidates (otherwise every point is searched)
 
 
 // Deklaration: Funktion
@@ -23,18 +63,68 @@ struct usr_data_point **create_2D_raster(int rows, int cols);
 
 
 int set_config(struct usr_map *Map, int argc, char **argv);					// performs some calculations regarding to the resolution
-int create_maps_raster(struct usr_data_point ***raster, int rows, int cols);
+int parse_exponents(const char *text, struct usr_config *config);
+struct usr_raster *exponent_raster(struct usr_map *Map, int idx);
+int create_maps_raster(struct usr_arena *arena, struct usr_raster *raster, int rows, int cols);
 int fill_raster_with_default_data(struct usr_map *Map);
 int input_csv_data(struct usr_map *Map, char *input_datafile);
+const char *parse_decimal(const char *text, const char *end, double *value);
+const char *skip_blanks(const char *text, const char *end);
 int show_input_data(struct usr_map *Map);
 int fill_raster_with_input_data(struct usr_map *Map);
+int snap_station_to_raster(struct usr_raster *raster, double lat, double lon, int *row_idx, int *col_idx);
+int compare_raster_stations(const void *a, const void *b);
+int report_station_collisions(struct usr_raster *raster, struct usr_dataset *input_data);
 int interpolate_raster(struct usr_map *Map);
+void *interpolate_raster_worker(void *arg);
+void interpolate_raster_point_local(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int col, bool use_candidates);
+double find_segment_candidates(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int first_col, int last_col);
+int find_stations_within(struct usr_station_index *index, double lat, double lon, double radius, struct usr_neighbourhood *nb);
+bool is_local_idw(struct usr_map *Map);
+int create_station_index(struct usr_arena *arena, struct usr_station_index *index, struct usr_dataset *input_data);
+int station_index_cell(struct usr_station_index *index, double lat, double lon);
+void unit_vector(double lat, double lon, double *vector);
+int find_nearest_stations(struct usr_station_index *index, struct usr_dataset *input_data, double lat, double lon,
+                          int k, double radius, int quadrant_min, struct usr_neighbourhood *quadrants, struct usr_neighbourhood *nb);
+int create_neighbourhood(struct usr_arena *arena, struct usr_neighbourhood *nb, int max_neighbours);
+int outputRasterCSV(struct usr_raster *raster, char *output_dir, char *filename, char decimal_separator, char field_separator, int max_threads, bool show_output);
+void *output_raster_csv_worker(void *arg);
+int format_fixed(char *text, double value, int decimals, char decimal_separator);
+int csv_buffer_reserve(struct usr_csv_buffer *buffer, size_t size);
+void free_csv_threads(struct usr_csv_thread *threads, int num_threads);
+int outputRasterBinary(struct usr_raster *raster, char *output_dir, char *filename, bool show_output);
+
+double raster_lat(struct usr_raster *raster, int row);
+double raster_lon(struct usr_raster *raster, int col);
+
+// kernels of the hot paths (no checks, see input_csv_data / set_config / row_is_finite):
+static inline double calc_distance(double latA, double lonA, double latB, double lonB);	// calculates the distance between two points on a sphere.
+static inline double clamp_unit(double value);
+static inline void grid_distances(struct usr_grid_distance *grid, int row, int col, double *distances);
+static inline double idw_point_exp1(const double *distances, const double *station_values, int length, double _exp);
+static inline double idw_point_exp2(const double *distances, const double *station_values, int length, double _exp);
+static inline double idw_point_exp3(const double *distances, const double *station_values, int length, double _exp);
+static inline double idw_point_exp4(const double *distances, const double *station_values, int length, double _exp);
+static inline double idw_point_pow(const double *distances, const double *station_values, int length, double _exp);
+static inline void idw_point_multi(const double *distances, const double *station_values, int length, 
+                                   const int *exponents, int num_exponents, double *results);
+static inline bool row_is_finite(const double *values, int length);
+static inline double loo_squared_error(const double *distances, const double *log_distances, const double *values, int length, double _exp, int *count);
+static inline double index_distance(struct usr_station_index *index, int station, const double *point);
+static inline void insert_neighbour(struct usr_neighbourhood *nb, int k, double distance, int station);
+#ifdef __AVX2__
+static inline double sum_vector_avx2(__m256d vector);
+#endif
+double idw_exact_hit(const double *distances, const double *station_values, int length);
 
-double calc_distance(double latA, double lonA, double latB, double lonB);			// calculates the distance between two points on a sphere.
+int create_grid_distance(struct usr_arena *arena, struct usr_grid_distance *grid, struct usr_raster *raster, struct usr_dataset *input_data);
 
 
 void free_raster(struct usr_map *Map);
 void free_vector(struct usr_map *Map);
+void apply_station_overlay(struct usr_raster *raster, struct usr_dataset *input_data);
+int tune_exponent(struct usr_map *Map);
+int compare_distances(const void *a, const void *b);
 
 
 // ##################################################################################################
@@ -70,11 +160,97 @@ int set_config(struct usr_map *Map, int argc, char **argv){
             // show output during calculations?
             if (!strcmp(argv[idx],"-o")){
                 Map->show_output = true;
-            }                    
+            }
+            
+            // output csv files instead of one binary file?
+            if (!strcmp(argv[idx],"-csv")){
+                Map->output_csv = true;
+            }
+            
+            // number of threads:
+            if (!strcmp(argv[idx],"-t")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 5);
+                }
+                Map->num_threads = atoi(argv[++idx]);
+            }
+            
+            // local IDW with the k nearest stations:
+            if (!strcmp(argv[idx],"-k")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 7);
+                }
+                Map->num_neighbours = atoi(argv[++idx]);
+            }
+            
+            // local IDW with the stations within a radius (km):
+            if (!strcmp(argv[idx],"-r")){
+                if ((idx+1 >= argc) || (atof(argv[idx+1]) <= 0)){
+                    longjmp(env, 8);
+                }
+                Map->search_radius = atof(argv[++idx]);
+            }
+            
+            // local IDW with a minimum number of stations per quadrant:
+            if (!strcmp(argv[idx],"-q")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 9);
+                }
+                Map->quadrant_min = atoi(argv[++idx]);
+            }
+            
+            // exponent of the distance out of a leave-one-out cross validation at the stations:
+            if (!strcmp(argv[idx],"-a")){
+                Map->tune_exponent = true;
+            }
+            
+            // IDW with several exponents of the distance in one pass (e.g. "-e 1,2,3,4"):
+            if (!strcmp(argv[idx],"-e")){
+                if ((idx+1 >= argc) || (parse_exponents(argv[idx+1], &(Map->config)) == EXIT_FAILURE)){
+                    longjmp(env, 11);
+                }
+                idx++;
+            }
         }
         
-        // check rows to be greater then 0;
-        if (Map->rows <= 0){
+        // without "-e" the raster is interpolated with the exponent "_exp" only,
+        // otherwise "_exp" is the first (smallest) exponent:
+        if (Map->config.num_exponents > 0){
+            Map->config._exp = Map->config.exponents[0];
+        }
+        else{
+            Map->config.exponents[0] = (int)Map->config._exp;
+            Map->config.num_exponents = 1;
+        }
+        
+        // the exponent is either given or determined by the cross validation:
+        if ((Map->tune_exponent) && (Map->config.num_exponents > 1)){
+            longjmp(env, 12);
+        }
+        
+        // range of the exponents of the cross validation:
+        if ((Map->tune_exponent) && 
+            ((Map->config.tune_exp_min <= 0) || (Map->config.tune_exp_step <= 0) || (Map->config.tune_exp_max < Map->config.tune_exp_min))){
+            longjmp(env, 13);
+        }
+        
+        // exponent of the distance greater then 0:
+        if (!(Map->config._exp > 0)){
+            longjmp(env, 14);
+        }
+        
+        // the minimum per quadrant supplements the k nearest stations:
+        if ((Map->quadrant_min > 0) && (Map->num_neighbours <= 0)){
+            longjmp(env, 10);
+        }
+        
+        // use all available processors if the number of threads is not given:
+        if (Map->num_threads == 0){
+            Map->num_threads = (sysconf(_SC_NPROCESSORS_ONLN) > 0) ? (unsigned int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+        }
+        
+        // check rows to be greater then 1 (resolution);
+        if (Map->rows <= 1){
             longjmp(env, 1);
         }
         // check maxLon & minLon to be greater then 0;        
@@ -85,6 +261,10 @@ int set_config(struct usr_map *Map, int argc, char **argv){
         if ((Map->maxLat <= 0) || (Map->minLat <= 0)){
             longjmp(env, 3);
         }        
+        // check the raster to lie within the valid coordinates (no further checks of the coordinates during the interpolation):
+        if ((Map->minLat >= Map->maxLat) || (Map->maxLat > 90) || (Map->minLon >= Map->maxLon) || (Map->maxLon > 180)){
+            longjmp(env, 6);
+        }
         
         // calculate the number of columns:
         cols = ceil(Map->rows * (double)(Map->maxLon - Map->minLon) / (double)(Map->maxLat - Map->minLat));
@@ -108,10 +288,20 @@ int set_config(struct usr_map *Map, int argc, char **argv){
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\nThe number of rows must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\nThe number of rows must be greater then 1!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 2: fprintf(stderr, "ERROR: %s --> %d:\nThe number of maxLon and minLon must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 3: fprintf(stderr, "ERROR: %s --> %d:\nThe number of maxLat and minLat must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 4: fprintf(stderr, "ERROR: %s --> %d:\nThe calculated number of columns of the output raster is \"NAN\" or \"INF\"!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;        
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\nminLat must be less then maxLat (max. 90) and minLon less then maxLon (max. 180)!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-t\" requires a number of threads greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-k\" requires a number of stations greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-r\" requires a search radius (km) greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 9: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-q\" requires a number of stations greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 10: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-q\" requires the number of nearest stations (\"-k\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 11: fprintf(stderr, "ERROR: %s --> %d:\nThe argument \"-e\" requires a list of at most %d integer exponents from 1 to 255 (e.g. 1,2,3,4)!\n\n", __FILE__, __LINE__, IDW_MAX_EXPONENTS); return EXIT_FAILURE;
+            case 12: fprintf(stderr, "ERROR: %s --> %d:\nThe arguments \"-a\" and \"-e\" (several exponents) can not be combined!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 13: fprintf(stderr, "ERROR: %s --> %d:\nThe exponents of the cross validation need tune_exp_min > 0, tune_exp_step > 0 and tune_exp_max >= tune_exp_min!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 14: fprintf(stderr, "ERROR: %s --> %d:\nThe exponent of the distance must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\nWoops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
         }
     }
@@ -122,15 +312,95 @@ int set_config(struct usr_map *Map, int argc, char **argv){
 // ##################################################################################################
 
 
-int create_maps_raster(struct usr_data_point ***raster, int rows, int cols){
+int parse_exponents(const char *text, struct usr_config *config){
+
+    /*
+        DESCRIPTION:
+        Reads a comma separated list of integer exponents of the distance (e.g. "1,2,3,4") into the
+        configuration. The exponents are sorted ascending and duplicates are removed, so the powers of
+        the distances can be built one after the other (see idw_point_multi).
+    
+        INPUT:
+        const char *text		...	list of the exponents
+        struct usr_config *config	...	pointer to the configuration (exponents, num_exponents)
+    
+        OUTPUT:(error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE (no valid list)
+    */
+
+    int idx, num = 0;
+    long value;
+    char *end;
+    
+    while (true){
+    
+        value = strtol(text, &end, 10);
+        if ((end == text) || (value < 1) || (value > 255) || ((*end != ',') && (*end != '\0'))){
+            return EXIT_FAILURE;
+        }
+        
+        // insert the exponent in ascending order, but only once:
+        idx = num;
+        while ((idx > 0) && (config->exponents[idx-1] > value)){
+            idx--;
+        }
+        
+        if ((idx == 0) || (config->exponents[idx-1] != value)){
+        
+            if (num >= IDW_MAX_EXPONENTS){
+                return EXIT_FAILURE;
+            }
+            memmove(&(config->exponents[idx+1]), &(config->exponents[idx]), (num - idx) * sizeof(int));
+            config->exponents[idx] = (int)value;
+            num++;
+        }
+        
+        if (*end == '\0'){
+            break;
+        }
+        text = end + 1;
+    }
+    
+    config->num_exponents = num;
+    
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+struct usr_raster *exponent_raster(struct usr_map *Map, int idx){
+
+    /*
+        DESCRIPTION:
+        Raster of the exponent "Map->config.exponents[idx]": the first exponent uses the raster of the
+        map (Map->raster), the further exponents the rasters "Map->exp_rasters".
+    */
+
+    return (idx == 0) ? &(Map->raster) : &(Map->exp_rasters[idx-1]);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_maps_raster(struct usr_arena *arena, struct usr_raster *raster, int rows, int cols){
 
     /*
     
         DESCRIPTION:
-        Initialize an raster of dimensions "Map->rows" x "Map->cols" of type struct usr_data_point.
+        Initialize an raster of dimensions "rows" x "cols".
+        The values of all raster points are stored row by row within one contiguous block of memory
+        out of the arena, aligned to ARENA_ALIGN bytes. The coordinates are not stored, they follow out of the
+        geometry of the raster (see raster_lat / raster_lon).
         
         INPUT:
-        struct usr_data_point ***rasters	...	pointer to the maps 2d raster
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_raster *raster		...	pointer to the maps raster
         int rows				...	number of rows
         int cols				...	number of cols
     
@@ -140,48 +410,218 @@ int create_maps_raster(struct usr_data_point ***raster, int rows, int cols){
      
     */
     
-    int idx, jdx;
     int excno;
-    jmp_buf env;
-   
+    jmp_buf env;    
     
     if ((excno = setjmp(env)) == 0){
 
-        struct usr_data_point **zgr;
+        if ((rows <= 0) || (cols <= 0)){
+            longjmp(env, 2);
+        }
+        
+        raster->value = (double *) arena_alloc(arena, (size_t)rows * cols * sizeof(double));
+        if (raster->value == NULL){
+            longjmp(env, 1);
+        }
+        
+        raster->rows = rows;
+        raster->cols = cols;
+        raster->num_stations = 0;
+        raster->stations = NULL;
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure during the attempt to allocate memory\n--> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
+        }
+    } 
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double raster_lat(struct usr_raster *raster, int row){
+
+    /*
+        DESCRIPTION:
+        Returns the latitude (decimal degree) of a row of the raster.
+    */
+    
+    return raster->maxLat - row*(raster->latRes);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double raster_lon(struct usr_raster *raster, int col){
+
+    /*
+        DESCRIPTION:
+        Returns the longitude (decimal degree) of a column of the raster.
+    */
+    
+    return raster->minLon + col*(raster->lonRes);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_grid_distance(struct usr_arena *arena, struct usr_grid_distance *grid, struct usr_raster *raster, struct usr_dataset *input_data){
 
+    /*
+        DESCRIPTION:
+        Precomputes the trigonometric terms of the distances between the raster points and the stations.
+        
+        The raster is a regular grid of latitudes and longitudes. So the sine and cosine of the
+        latitude only depend on the row and the cosine of the difference of the longitudes only
+        depends on the column and the station. With these tables the distance of a raster point
+        to a station (see grid_distances) needs 3 multiplications, 1 addition and 1 acos.
+        The terms are calculated exactly as in calc_distance, so the distances are identical.
+        
+        INPUT:
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_grid_distance *grid		...	pointer to the object of the tables
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
+    
+        OUTPUT:(error code)
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
+    */
 
-        zgr = (struct usr_data_point **) malloc(rows * sizeof(struct usr_data_point *));
-        if (zgr == NULL){
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        double lat_rad, lon_rad;
+        double *col_cos_dlon;
+        
+        if ((raster->rows <= 0) || (raster->cols <= 0) || (input_data->length <= 0)){
             longjmp(env, 1);
         }
-        else{
-            for (idx=0; idx<rows; idx++){
         
-                zgr[idx] = (struct usr_data_point *) malloc(cols * sizeof(struct usr_data_point));        
-                if (zgr[idx] == NULL){
-                    
-                    // clean the already allocated memory
-                    for (jdx=0; jdx<idx; jdx++){
-                        free(zgr[jdx]);
-                    }
-                    free(zgr);
-                    longjmp(env, 1);
-                }
+        grid->rows = raster->rows;
+        grid->cols = raster->cols;
+        grid->num_stations = input_data->length;
+        
+        grid->row_sin = (double *) arena_alloc(arena, grid->rows * sizeof(double));
+        grid->row_cos = (double *) arena_alloc(arena, grid->rows * sizeof(double));
+        grid->station_sin = (double *) arena_alloc(arena, grid->num_stations * sizeof(double));
+        grid->station_cos = (double *) arena_alloc(arena, grid->num_stations * sizeof(double));
+        grid->col_cos_dlon = (double *) arena_alloc(arena, (size_t)grid->cols * grid->num_stations * sizeof(double));
+        
+        if ((grid->row_sin == NULL) || (grid->row_cos == NULL) || 
+            (grid->station_sin == NULL) || (grid->station_cos == NULL) || (grid->col_cos_dlon == NULL)){
+            longjmp(env, 2);
+        }
+        
+        // latitude of the rows (point A in calc_distance):
+        for (idx=0; idx<grid->rows; idx++){
+        
+            lat_rad = (raster_lat(raster, idx)/180.0) * M_PI;
+            grid->row_sin[idx] = sin(lat_rad);
+            grid->row_cos[idx] = cos(lat_rad);
+        }
+        
+        // latitude of the stations (point B in calc_distance):
+        for (jdx=0; jdx<grid->num_stations; jdx++){
+        
+            if ((isnan(input_data->data[jdx].lat)) || (isinf(input_data->data[jdx].lat)) ||
+                (isnan(input_data->data[jdx].lon)) || (isinf(input_data->data[jdx].lon))){
+                longjmp(env, 3);
             }
-            // assign the address of the matrix to the raster address.
-            *raster = zgr;
             
+            lat_rad = (input_data->data[jdx].lat/180.0) * M_PI;
+            grid->station_sin[jdx] = sin(lat_rad);
+            grid->station_cos[jdx] = cos(lat_rad);
+        }
+        
+        // difference of the longitudes between every column and every station:
+        for (idx=0; idx<grid->cols; idx++){
+        
+            lon_rad = (raster_lon(raster, idx)/180.0) * M_PI;
+            col_cos_dlon = &(grid->col_cos_dlon[(size_t)idx * grid->num_stations]);
+            
+            for (jdx=0; jdx<grid->num_stations; jdx++){
+                col_cos_dlon[jdx] = cos(((input_data->data[jdx].lon/180.0) * M_PI) - lon_rad);
+            }
         }
+        
         return EXIT_SUCCESS;
     }
-    
-    // ##############################################################################################
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The raster and the input dataset must not be empty!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> One of the coordinates of the stations is equal to \"NAN\" or \"INF\"\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
 
-    switch(excno){
-        case 1: fprintf(stderr, "ERROR: %s --> %d:\nFailure during the attempt to allocate memory\n--> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        default: fprintf(stderr, "ERROR: %s --> %d:\nWoops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
-    }    
-    
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline void grid_distances(struct usr_grid_distance *grid, int row, int col, double *distances){
+
+    /*
+        DESCRIPTION:
+        Calculates the distances of a raster point to all stations with the help of the
+        precomputed tables (see create_grid_distance). Kernel without any checks, the
+        cosine is clamped like in calc_distance.
+        With ACOS_AVX2 the distances of 4 stations are calculated at once (the vector acos
+        may differ from acos in the last bits).
+        
+        INPUT:
+        struct usr_grid_distance *grid	...	pointer to the object of the tables
+        int row				...	row index of the raster point
+        int col				...	column index of the raster point
+        double *distances		...	distances (km) to the stations, vector of length grid->num_stations
+    */
+
+    int idx;
+    double row_sin = grid->row_sin[row];
+    double row_cos = grid->row_cos[row];
+    const double *station_sin = grid->station_sin;
+    const double *station_cos = grid->station_cos;
+    const double *col_cos_dlon = &(grid->col_cos_dlon[(size_t)col * grid->num_stations]);
+    
+    idx = 0;
+#ifdef ACOS_AVX2
+    __m256d cos4;
+    __m256d row_sin4 = _mm256_set1_pd(row_sin);
+    __m256d row_cos4 = _mm256_set1_pd(row_cos);
+    __m256d radius4 = _mm256_set1_pd(RADIUS_EARTH);
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d minus_one = _mm256_set1_pd(-1.0);
+    
+    for (; idx+4<=grid->num_stations; idx+=4){
+    
+        cos4 = _mm256_add_pd(_mm256_mul_pd(row_sin4, _mm256_loadu_pd(&station_sin[idx])),
+                             _mm256_mul_pd(_mm256_mul_pd(row_cos4, _mm256_loadu_pd(&station_cos[idx])), _mm256_loadu_pd(&col_cos_dlon[idx])));
+        
+        // clamp to [-1, 1], "NAN" stays "NAN" (see clamp_unit):
+        cos4 = _mm256_max_pd(minus_one, _mm256_min_pd(one, cos4));
+        
+        _mm256_storeu_pd(&distances[idx], _mm256_mul_pd(radius4, _ZGVdN4v_acos(cos4)));
+    }
+#endif
+    for (; idx<grid->num_stations; idx++){
+        distances[idx] = RADIUS_EARTH * acos( clamp_unit( (row_sin * station_sin[idx]) + ( row_cos * station_cos[idx] * col_cos_dlon[idx] ) ) );
+    }
 }
 
 
@@ -193,7 +633,7 @@ int fill_raster_with_default_data(struct usr_map *Map){
 
     /*
         DESCRIPTION:
-        Fills any point of the raster with default data.
+        Fills any point of the raster (and of the rasters of the further exponents) with default data.
     
         INPUT:
         struct usr_map *Map	...	pointer to map object
@@ -210,6 +650,7 @@ int fill_raster_with_default_data(struct usr_map *Map){
     int idx, jdx;
     int excno;
     jmp_buf env;
+    struct usr_raster *raster;
     
     if ((excno = setjmp(env)) == 0){
 
@@ -233,21 +674,20 @@ int fill_raster_with_default_data(struct usr_map *Map){
             longjmp(env, 4);
         }        
         
-        // fill any point of the raster with default data.
-        for (idx=0; idx<Map->rows; idx++){
-    
-            for (jdx=0; jdx<Map->cols; jdx++){
+        // the raster of every exponent of the distance:
+        for (jdx=0; jdx<Map->config.num_exponents; jdx++){
         
-                // set the indices:
-                Map->raster[idx][jdx].row_idx = idx;
-                Map->raster[idx][jdx].col_idx = jdx;
-            
-                // set the coordinates:
-                Map->raster[idx][jdx].lon = (Map->minLon) + jdx*(Map->lonRes);
-                Map->raster[idx][jdx].lat = (Map->maxLat) - idx*(Map->latRes);            
+            raster = exponent_raster(Map, jdx);
+        
+            // geometry of the raster, the coordinates of the raster points follow out of it:
+            raster->maxLat = Map->maxLat;
+            raster->minLon = Map->minLon;
+            raster->latRes = Map->latRes;
+            raster->lonRes = Map->lonRes;
             
-                // set the default values:
-                Map->raster[idx][jdx].value = NO_VALUE;
+            // fill any point of the raster with the default value:
+            for (idx=0; idx<(int)(Map->rows * Map->cols); idx++){
+                raster->value[idx] = NO_VALUE;
             }
         }
         return EXIT_SUCCESS;
@@ -273,6 +713,12 @@ int input_csv_data(struct usr_map *Map, char *input_datafile){
     /*
         DESCRIPTION:
         Reads the input dataset provided by the csv-file in the input directory.
+        The file is mapped into the memory and parsed in one pass. The first line (header) is skipped,
+        every further line has to contain: name;lat;lon;value
+        The numbers may have a decimal point or a decimal comma. Empty lines are ignored.
+        The array of the stations grows as needed. A malformed line stops the reading with
+        its line number. The coordinates and values are checked here once, the kernels of the
+        interpolation (e.g. calc_distance) do not check them again.
     
         INPUT:
         struct usr_map *Map	...	pointer to map object
@@ -285,147 +731,305 @@ int input_csv_data(struct usr_map *Map, char *input_datafile){
     */
       
     jmp_buf env;
-    int excno;
 
-    FILE *fp;
-    int rows = 0;
-    int idx, jdx;
+    int idx;
+    int excno;
+    volatile int line_number = 0;
     
     double sum = 0; 
-    double *values_array;
     
-    char inputRow[255];
-    char inputDecimal[20];
     char path[100];
     
     
+    
     if ((excno = setjmp(env)) == 0){
+    
+        int fd;
+        int capacity = 0;
+        size_t name_length;
+        struct stat file_info;
+        struct usr_data_point *data;
+        const char *text, *end, *line, *line_end, *field, *next;
         
-        // open input file:
-        fp = fopen(strcat(strcpy(path,Map->config.input_dir), input_datafile), "r");
-        if (fp == NULL){
+        Map->input_data.length = 0;
+        Map->input_data.data = NULL;
+        
+        // open input file and map it into the memory:
+        fd = open(strcat(strcpy(path,Map->config.input_dir), input_datafile), O_RDONLY);
+        if (fd < 0){
             longjmp(env, 1);
         }
-        else{
-            // determine the length of the dataset (number of values)
-            while (fgets(inputRow, 255, fp) != NULL){
-                rows++;
-            }
+        if (fstat(fd, &file_info) != 0){
+            close(fd);
+            longjmp(env, 1);
+        }
+        if (file_info.st_size <= 0){
+            close(fd);
+            longjmp(env, 2);
+        }
+        
+        text = (const char *) mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (text == MAP_FAILED){
+            longjmp(env, 1);
+        }
+        end = text + file_info.st_size;
+        
+        // read the data line by line:
+        for (line=text; line<end; line=line_end+1){
+        
+            line_number++;
             
-            // check for rows ist greater then 0:
-            if (rows <= 0){
-                longjmp(env, 2);
-            }
-            else{
-                // Länge des Input_Datensatzes übergeben:
-                Map->input_data.length = rows-1;
-            }
-        
-            /* 
-            allocate memory of type usr_data_point.
-            contains:
-               - stationname
-               - geogr. latitude
-               - geogr. longitude
-               - value
-            */
-            Map->input_data.data = (struct usr_data_point*) malloc(rows * sizeof(struct usr_data_point));
-            if (Map->input_data.data == NULL){
-                longjmp(env, 3);
+            line_end = (const char *) memchr(line, '\n', end - line);
+            if (line_end == NULL){
+                line_end = end;
             }
             
-            idx = 0;
-            // set the pointer to the start of the file:
-            fseek(fp, 0, SEEK_SET);
-            
-            // read the data row by row:
-            while (fgets(inputRow, 255, fp) != NULL){
-            
-                if (idx > 0){
-                    // Einlesen des Stationsnamens:
-                    strcpy(Map->input_data.data[idx-1].name, strtok(inputRow, ";"));
-            
-                    // Einlesen der geogr. Breite:
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
+            // skip the header and empty lines:
+            if ((line_number == 1) || (skip_blanks(line, line_end) == line_end)){
+                continue;
+            }
             
-                        if (inputDecimal[jdx] == ','){
-                
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
-                    }
-                    Map->input_data.data[idx-1].lat = atof(inputDecimal);
+            // grow the array of the stations:
+            if (Map->input_data.length == capacity){
             
-                    // Einlesen der geogr. Länge:            
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
+                capacity = (capacity > 0) ? 2 * capacity : INPUT_DATA_CAPACITY;
+                data = (struct usr_data_point *) realloc(Map->input_data.data, capacity * sizeof(struct usr_data_point));
+                if (data == NULL){
+                    munmap((void *)text, file_info.st_size);
+                    longjmp(env, 3);
+                }
+                Map->input_data.data = data;
+            }
+            data = &Map->input_data.data[Map->input_data.length];
             
-                        if (inputDecimal[jdx] == ','){
-                
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
-                    }
-                    Map->input_data.data[idx-1].lon = atof(inputDecimal);  
+            // Einlesen des Stationsnamens:
+            field = line;
+            next = (const char *) memchr(field, ';', line_end - field);
+            if (next == NULL){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            name_length = (size_t)(next - field);
+            if ((name_length == 0) || (name_length >= sizeof(data->name))){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 4);
+            }
+            memcpy(data->name, field, name_length);
+            data->name[name_length] = '\0';
             
-                    // Einlesen des Messwerts:         
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
+            // Einlesen der geogr. Breite:
+            field = parse_decimal(next + 1, line_end, &(data->lat));
+            if ((field != NULL) && (skip_blanks(field, line_end) == line_end)){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            if ((field == NULL) || (*field != ';')){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 5);
+            }
             
-                        if (inputDecimal[jdx] == ','){
-                
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
-                    }
-                    Map->input_data.data[idx-1].value = atof(inputDecimal);             
-                    idx++;
-                }
-                else{
-                    idx++;
-                    continue;
-                }
+            // Einlesen der geogr. Länge:
+            field = parse_decimal(field + 1, line_end, &(data->lon));
+            if ((field != NULL) && (skip_blanks(field, line_end) == line_end)){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            if ((field == NULL) || (*field != ';')){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 6);
             }
-        
-        
-            // determine statistical metadata over the input datasets.
-            Map->input_data.minimum = Map->input_data.data[0].value;
-            Map->input_data.maximum = Map->input_data.data[0].value;
-            Map->input_data.average = Map->input_data.data[0].value;
-                
-            for (idx=0; idx<Map->input_data.length; idx++){
-        
-                sum += Map->input_data.data[idx].value;
-        
-                if (Map->input_data.data[idx].value < Map->input_data.minimum){
             
-                    Map->input_data.minimum = Map->input_data.data[idx].value;
-                }
+            // Einlesen des Messwerts:
+            field = parse_decimal(field + 1, line_end, &(data->value));
+            if (field == NULL){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 7);
+            }
             
-                if (Map->input_data.data[idx].value > Map->input_data.maximum){
+            // nothing but blanks (e.g. '\r') may follow:
+            if (skip_blanks(field, line_end) != line_end){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 8);
+            }
             
-                    Map->input_data.maximum = Map->input_data.data[idx].value;
-                }
+            // valid coordinates and value (no further checks of the input data during the interpolation):
+            if ((!isfinite(data->lat)) || (fabs(data->lat) > 90) || (!isfinite(data->lon)) || (fabs(data->lon) > 180) || (!isfinite(data->value))){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 10);
             }
+            
+            Map->input_data.length++;
+        }
         
-            Map->input_data.average = (double)(sum / Map->input_data.length);
+        munmap((void *)text, file_info.st_size);
         
-            fclose(fp);
-            
-            return EXIT_SUCCESS;
+        // check for rows ist greater then 0:
+        if (Map->input_data.length <= 0){
+            longjmp(env, 2);
         }
         
+        // determine statistical metadata over the input datasets.
+        Map->input_data.minimum = Map->input_data.data[0].value;
+        Map->input_data.maximum = Map->input_data.data[0].value;
+        Map->input_data.average = Map->input_data.data[0].value;
+            
+        for (idx=0; idx<Map->input_data.length; idx++){
+    
+            sum += Map->input_data.data[idx].value;
+    
+            if (Map->input_data.data[idx].value < Map->input_data.minimum){
+        
+                Map->input_data.minimum = Map->input_data.data[idx].value;
+            }
+        
+            if (Map->input_data.data[idx].value > Map->input_data.maximum){
+        
+                Map->input_data.maximum = Map->input_data.data[idx].value;
+            }
+        }
+    
+        Map->input_data.average = (double)(sum / Map->input_data.length);
+    
+        return EXIT_SUCCESS;
     }
+    // ##############################################################################################
     else{
-        // ##############################################################################################
         switch(excno){
             case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure when opening the csv-file:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
             case 2: fprintf(stderr, "ERROR: %s --> %d:\n The counted number of datapoints is 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 3: fprintf(stderr, "ERROR: %s --> %d:\n Failure when allocating the memory for the input dataset:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The name of the station is missing or longer then %d characters!\n\n", __FILE__, __LINE__, path, line_number, (int)sizeof(Map->input_data.data[0].name)-1); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The latitude is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The longitude is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The value is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Unexpected characters after the value (expected: name;lat;lon;value)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 9: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Too few fields (expected: name;lat;lon;value)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 10: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The coordinates are out of range (lat: -90 ... 90, lon: -180 ... 180) or a number is \"INF\"!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        }   
-    } 
+        }
+    }    
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+const char *parse_decimal(const char *text, const char *end, double *value){
+
+    /*
+        DESCRIPTION:
+        Parses a decimal number with a decimal point or a decimal comma (e.g. "-47,398429")
+        out of the text up to "end". Leading blanks are skipped.
+        Numbers of up to 15 significant digits are calculated as integer / 10^decimals, which is
+        exactly the correctly rounded result of strtod. Longer numbers and numbers with an
+        exponent are passed to strtod.
+        
+        INPUT:
+        const char *text	...	start of the number
+        const char *end		...	end of the text (the number must not reach beyond)
+        double *value		...	parsed number
+        
+        OUTPUT:
+        on success		...	pointer to the first character after the number
+        on failure		...	NULL (no digits)
+    */
+
+    static const double pow10[23] = {1.0E0, 1.0E1, 1.0E2, 1.0E3, 1.0E4, 1.0E5, 1.0E6, 1.0E7, 1.0E8, 1.0E9, 1.0E10, 1.0E11,
+                                     1.0E12, 1.0E13, 1.0E14, 1.0E15, 1.0E16, 1.0E17, 1.0E18, 1.0E19, 1.0E20, 1.0E21, 1.0E22};
+    const char *pos;
+    char number[64];
+    unsigned long long mantissa = 0;
+    int num_digits = 0;
+    int num_decimals = 0;
+    int num_significant = 0;
+    int idx;
+    bool negative = false;
+    bool separator = false;
+    
+    
+    text = skip_blanks(text, end);
+    pos = text;
+    
+    if ((pos < end) && ((*pos == '-') || (*pos == '+'))){
+        negative = (*pos == '-');
+        pos++;
+    }
+    
+    for (; pos<end; pos++){
+    
+        if ((*pos >= '0') && (*pos <= '9')){
+        
+            // leading zeros are no significant digits:
+            if ((mantissa > 0) || (*pos != '0')){
+                num_significant++;
+            }
+            if (num_significant <= 19){
+                mantissa = 10 * mantissa + (unsigned long long)(*pos - '0');
+            }
+            num_decimals += (separator) ? 1 : 0;
+            num_digits++;
+        }
+        else if (((*pos == '.') || (*pos == ',')) && (!separator)){
+            separator = true;
+        }
+        else{
+            break;
+        }
+    }
+    
+    if (num_digits == 0){
+        return NULL;
+    }
+    
+    // fast path:
+    if ((num_significant <= 15) && (num_decimals <= 22) && ((pos == end) || ((*pos != 'e') && (*pos != 'E')))){
+        *value = (double)mantissa / pow10[num_decimals];
+        *value = (negative) ? -(*value) : *value;
+        return pos;
+    }
+    
+    // rare cases: copy the number with a decimal point for strtod:
+    if ((pos < end) && ((*pos == 'e') || (*pos == 'E'))){
+        pos++;
+        if ((pos < end) && ((*pos == '-') || (*pos == '+'))){
+            pos++;
+        }
+        while ((pos < end) && (*pos >= '0') && (*pos <= '9')){
+            pos++;
+        }
+    }
+    if (pos - text >= (int)sizeof(number)){
+        return NULL;
+    }
+    for (idx=0; idx<pos-text; idx++){
+        number[idx] = (text[idx] == ',') ? '.' : text[idx];
+    }
+    number[idx] = '\0';
+    *value = strtod(number, NULL);
+    
+    return pos;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+const char *skip_blanks(const char *text, const char *end){
+
+    /*
+        DESCRIPTION:
+        Returns a pointer to the first character of the text, which is no blank (' ', '\t', '\r'),
+        or "end" if there is none.
+    */
+
+    while ((text < end) && ((*text == ' ') || (*text == '\t') || (*text == '\r'))){
+        text++;
+    }
+    
+    return text;
 }
 
 
@@ -438,6 +1042,9 @@ int fill_raster_with_input_data(struct usr_map *Map){
     /*
         DESCRIPTION:
         writes the input dataset into the raster points of the map raster.
+        Every station is assigned to its nearest raster point (see snap_station_to_raster). These assignments
+        are kept as an overlay of the raster (Map->raster.stations), that is written over the interpolated values.
+        Stations outside the raster and stations that share a raster point are reported.
     
         INPUT:
         struct usr_map *Map	...	pointer to map object
@@ -449,16 +1056,16 @@ int fill_raster_with_input_data(struct usr_map *Map){
     */ 
 
     
-    int idx, jdx, kdx;
+    int idx;
     int excno;
     jmp_buf env;
     
-    if ((excno = setjmp(env)) == 0){   
     
-        int min_row_idx, min_col_idx;
-        double mlat, mlon, distance;
-        double rlat, rlat_rad, rlon, rlon_rad;
-        double min_distance, min_mlat, min_mlon, min_rlat, min_rlon;
+    if ((excno = setjmp(env)) == 0){ 
+    
+        int row_idx, col_idx;
+        int err;
+        struct usr_raster *raster;
         
     
         // output?
@@ -472,57 +1079,2172 @@ int fill_raster_with_input_data(struct usr_map *Map){
         if (Map->input_data.length <= 0){
             longjmp(env, 1);
         }
+        
+        // overlay of the raster with the assigned stations:
+        Map->raster.stations = (struct usr_raster_station *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(struct usr_raster_station));
+        if (Map->raster.stations == NULL){
+            longjmp(env, 2);
+        }
+        Map->raster.num_stations = 0;
     
         for (idx=0; idx<Map->input_data.length; idx++){
     
-            // the default distance is the highest distance between 2 points on earth 
-            min_distance = 44000.00;
+            err = snap_station_to_raster(&(Map->raster), 
+                                         Map->input_data.data[idx].lat, 
+                                         Map->input_data.data[idx].lon,
+                                         &row_idx, 
+                                         &col_idx);
+            
+            // the station is not used for the overlay, but still for the interpolation:
+            if (err == 2){
+                fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is not assigned to a raster point!\n", 
+                        __FILE__, __LINE__, Map->input_data.data[idx].name, Map->input_data.data[idx].lat, Map->input_data.data[idx].lon);
+                
+                Map->input_data.data[idx].row_idx = -1;
+                Map->input_data.data[idx].col_idx = -1;
+                continue;
+            }
+            else if (err == 1){
+                fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is assigned to the border point (%d, %d)!\n", 
+                        __FILE__, __LINE__, Map->input_data.data[idx].name, Map->input_data.data[idx].lat, Map->input_data.data[idx].lon, row_idx, col_idx);
+            }
+        
+            // add the station to the overlay of the raster
+            Map->raster.stations[Map->raster.num_stations].row_idx = row_idx;
+            Map->raster.stations[Map->raster.num_stations].col_idx = col_idx;
+            Map->raster.stations[Map->raster.num_stations].station_idx = idx;
+            Map->raster.num_stations++;
+            
+            Map->raster.value[(size_t)row_idx * Map->cols + col_idx] = Map->input_data.data[idx].value;
+        
+            // give the input data the corresponding index values of the raster point
+            Map->input_data.data[idx].row_idx = row_idx;
+            Map->input_data.data[idx].col_idx = col_idx;
+        }
+        
+        // stations on the same raster point:
+        err = report_station_collisions(&(Map->raster), &(Map->input_data));
+        if (err == EXIT_FAILURE){
+            longjmp(env, 2);
+        }
+        
+        // the rasters of the further exponents get the same overlay:
+        for (idx=1; idx<Map->config.num_exponents; idx++){
+        
+            raster = exponent_raster(Map, idx);
+            raster->stations = (struct usr_raster_station *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(struct usr_raster_station));
+            if (raster->stations == NULL){
+                longjmp(env, 2);
+            }
+            memcpy(raster->stations, Map->raster.stations, Map->raster.num_stations * sizeof(struct usr_raster_station));
+            raster->num_stations = Map->raster.num_stations;
+        }
+        
+        // output:
+        if (Map->show_output){
+            printf(" ok.\n");
+        }
+        
+        return EXIT_SUCCESS;
+    }  
+    else{  
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }    
+
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int snap_station_to_raster(struct usr_raster *raster, double lat, double lon, int *row_idx, int *col_idx){
+
+    /*
+        DESCRIPTION:
+        Finds the nearest raster point of a station.
+        
+        The raster is a regular grid, so the row and the column of the nearest raster point follow
+        directly from the coordinates. Because the distance on the sphere differs slightly from the
+        distance in degrees, the 3 x 3 neighbourhood of this raster point is checked by calc_distance.
+        Of two raster points with the same distance the first one (row by row) is taken, just as by a
+        search over the whole raster.
+        
+        A station that is up to one raster point outside the raster is assigned to the nearest
+        point of the border, a station that is further away is not assigned.
+        
+        INPUT:
+        struct usr_raster *raster	...	pointer to the raster
+        double lat			...	latitude of the station
+        double lon			...	longitude of the station
+        int *row_idx			...	row of the nearest raster point
+        int *col_idx			...	column of the nearest raster point
+    
+        OUTPUT:
+        0				...	the station is within the raster
+        1				...	the station is outside the raster and has been assigned to the border
+        2				...	the station is outside the raster and has not been assigned
+    */
+
+    int row, col;
+    int row0, col0;
+    int status = 0;
+    double fidx;
+    double distance, min_distance;
+    
+    
+    // nearest row and column of the grid (not yet limited to the raster):
+    fidx = round((raster->maxLat - lat) / raster->latRes);
+    if ((isnan(fidx)) || (fidx < -1.0) || (fidx > (double)raster->rows)){
+        return 2;
+    }
+    row0 = (int)fidx;
+    
+    fidx = round((lon - raster->minLon) / raster->lonRes);
+    if ((isnan(fidx)) || (fidx < -1.0) || (fidx > (double)raster->cols)){
+        return 2;
+    }
+    col0 = (int)fidx;
+    
+    // limit to the raster:
+    if ((row0 < 0) || (row0 >= (int)raster->rows) || (col0 < 0) || (col0 >= (int)raster->cols)){
+        status = 1;
+        row0 = (row0 < 0) ? 0 : ((row0 >= (int)raster->rows) ? (int)raster->rows - 1 : row0);
+        col0 = (col0 < 0) ? 0 : ((col0 >= (int)raster->cols) ? (int)raster->cols - 1 : col0);
+    }
+    
+    // the default distance is the highest distance between 2 points on earth 
+    min_distance = 44000.00;
+    *row_idx = row0;
+    *col_idx = col0;
+    
+    // check the neighbourhood:
+    for (row=row0-1; row<=row0+1; row++){
+    
+        if ((row < 0) || (row >= (int)raster->rows)){
+            continue;
+        }
         
-            // latitude and longitude of the station:
-            mlat = Map->input_data.data[idx].lat;
-            mlon = Map->input_data.data[idx].lon;
+        for (col=col0-1; col<=col0+1; col++){
         
-            // find the shortest distance between the station and a raster point
-            for (jdx=0; jdx<Map->rows; jdx++){
-                for (kdx=0; kdx<Map->cols; kdx++){
+            if ((col < 0) || (col >= (int)raster->cols)){
+                continue;
+            }
             
-                    // latitude and longitude of the raster point:
-                    rlat = Map->raster[jdx][kdx].lat;
-                    rlon = Map->raster[jdx][kdx].lon;
-                            
-                    // Distance on a sphere with radius at 51°N.
-                    distance = calc_distance(mlat, mlon, rlat, rlon);
-                
-                    if (distance < min_distance){                  
-                        min_distance = distance;
-                        min_mlat = mlat;
-                        min_mlon = mlon;
-                        min_rlat = rlat;
-                        min_rlon = rlon;
-                        min_row_idx = Map->raster[jdx][kdx].row_idx;
-                        min_col_idx = Map->raster[jdx][kdx].col_idx;
-                    }
-                }
+            distance = calc_distance(lat, lon, raster_lat(raster, row), raster_lon(raster, col));
+            
+            if (distance < min_distance){
+                min_distance = distance;
+                *row_idx = row;
+                *col_idx = col;
+            }
+        }
+    }
+    
+    return status;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int compare_raster_stations(const void *a, const void *b){
+
+    /*
+        DESCRIPTION:
+        Compare function (qsort) of two stations of the overlay by their raster point (row by row).
+        Stations on the same raster point keep the order of the input dataset.
+    */
+
+    const struct usr_raster_station *sa = (const struct usr_raster_station *) a;
+    const struct usr_raster_station *sb = (const struct usr_raster_station *) b;
+    
+    if (sa->row_idx != sb->row_idx){
+        return (sa->row_idx < sb->row_idx) ? -1 : 1;
+    }
+    if (sa->col_idx != sb->col_idx){
+        return (sa->col_idx < sb->col_idx) ? -1 : 1;
+    }
+    return (sa->station_idx < sb->station_idx) ? -1 : ((sa->station_idx > sb->station_idx) ? 1 : 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int report_station_collisions(struct usr_raster *raster, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Reports all stations of the overlay that share their raster point with an earlier station of
+        the input dataset. The value of the later station remains (see apply_station_overlay).
+        The overlay itself stays untouched, a sorted copy is used.
+    
+        INPUT:
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset
+    
+        OUTPUT:(error code)
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
+    */
+
+    int idx;
+    int num_collisions = 0;
+    struct usr_raster_station *sorted;
+    
+    if (raster->num_stations < 2){
+        return EXIT_SUCCESS;
+    }
+    
+    sorted = (struct usr_raster_station *) malloc(raster->num_stations * sizeof(struct usr_raster_station));
+    if (sorted == NULL){
+        return EXIT_FAILURE;
+    }
+    memcpy(sorted, raster->stations, raster->num_stations * sizeof(struct usr_raster_station));
+    qsort(sorted, raster->num_stations, sizeof(struct usr_raster_station), compare_raster_stations);
+    
+    for (idx=1; idx<raster->num_stations; idx++){
+        if ((sorted[idx].row_idx == sorted[idx-1].row_idx) && (sorted[idx].col_idx == sorted[idx-1].col_idx)){
+            num_collisions++;
+        }
+    }
+    
+    if (num_collisions > 0){
+    
+        fprintf(stderr, "WARNING: %s --> %d:\n >>> %d station(s) share their raster point with another station, the value of the later one is used:\n", 
+                __FILE__, __LINE__, num_collisions);
+    
+        for (idx=1; idx<raster->num_stations; idx++){
+        
+            if ((sorted[idx].row_idx == sorted[idx-1].row_idx) && (sorted[idx].col_idx == sorted[idx-1].col_idx)){
+            
+                fprintf(stderr, "     (%4d, %4d): \"%s\" <-- \"%s\"\n", 
+                        sorted[idx].row_idx, sorted[idx].col_idx,
+                        input_data->data[sorted[idx-1].station_idx].name,
+                        input_data->data[sorted[idx].station_idx].name);
             }
+        }
+    }
+    
+    free(sorted);
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void apply_station_overlay(struct usr_raster *raster, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Writes the values of the assigned stations over the interpolated values of the raster.
+        If two stations share the same raster point, the later one of the input dataset remains.
+    
+        INPUT:
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset
+    */
+
+    int idx;
+    
+    for (idx=0; idx<raster->num_stations; idx++){
+    
+        raster->value[(size_t)raster->stations[idx].row_idx * raster->cols + raster->stations[idx].col_idx] = 
+            input_data->data[raster->stations[idx].station_idx].value;
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int tune_exponent(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION:
+        Determines the exponent of the distance by a leave-one-out cross validation at the stations:
+        every station is interpolated by the other stations for the exponents tune_exp_min,
+        tune_exp_min + tune_exp_step, ... tune_exp_max. The exponent with the smallest root mean
+        square error becomes the exponent of the raster (Map->config._exp).
+        
+        The distances between the stations are calculated once. The table of their logarithms gives the
+        weight of any real exponent as exp(-exponent * log(distance)) (see loo_squared_error), so the
+        effort is O(n² * number of exponents) and small compared to the raster.
+        With local IDW (see is_local_idw) a station is interpolated by its nearest stations within the
+        search radius, like a raster point. The minimum per quadrant (-q) is not taken into account.
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+        
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+    
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int n = Map->input_data.length;
+        int k, edx, num_exponents, count;
+        double _exp, error, rmse, limit;
+        double best_exp = 0;
+        double best_rmse = INFINITY;
+        double *distances, *log_distances, *station_values, *sorted, *row;
+        struct usr_data_point *data = Map->input_data.data;
+        struct usr_arena_mark scratch;
+        
+        if (n < 2){
+            longjmp(env, 1);
+        }
+        
+        // the tables are given back at the end:
+        scratch = arena_mark(&(Map->arena));
+        distances = (double *) arena_alloc(&(Map->arena), (size_t)n * n * sizeof(double));
+        log_distances = (double *) arena_alloc(&(Map->arena), (size_t)n * n * sizeof(double));
+        station_values = (double *) arena_alloc(&(Map->arena), n * sizeof(double));
+        sorted = (double *) arena_alloc(&(Map->arena), n * sizeof(double));
+        
+        if ((distances == NULL) || (log_distances == NULL) || (station_values == NULL) || (sorted == NULL)){
+            arena_rewind(&(Map->arena), scratch);
+            longjmp(env, 2);
+        }
+        
+        for (idx=0; idx<n; idx++){
+            station_values[idx] = data[idx].value;
+        }
+        
+        // distances between the stations (a station has no distance to itself => "INF"):
+        for (idx=0; idx<n; idx++){
+        
+            distances[(size_t)idx*n + idx] = INFINITY;
+            
+            for (jdx=idx+1; jdx<n; jdx++){
+                distances[(size_t)idx*n + jdx] = calc_distance(data[idx].lat, data[idx].lon, data[jdx].lat, data[jdx].lon);
+                distances[(size_t)jdx*n + idx] = distances[(size_t)idx*n + jdx];
+            }
+        }
+        
+        // logarithms of the distances, the stations that are not used get "INF" (weight 0):
+        k = ((Map->num_neighbours > 0) && (Map->num_neighbours < n-1)) ? Map->num_neighbours : n-1;
+        
+        for (idx=0; idx<n; idx++){
+        
+            row = &distances[(size_t)idx*n];
+            limit = (Map->search_radius > 0) ? Map->search_radius : INFINITY;
+            
+            // local IDW: distance of the k-th nearest station:
+            if (k < n-1){
+                memcpy(sorted, row, n * sizeof(double));
+                qsort(sorted, n, sizeof(double), compare_distances);
+                limit = fmin(limit, sorted[k-1]);
+            }
+            
+            for (jdx=0; jdx<n; jdx++){
+                log_distances[(size_t)idx*n + jdx] = ((jdx != idx) && (row[jdx] <= limit)) ? log(row[jdx]) : INFINITY;
+            }
+        }
+        
+        if (Map->show_output){
+            printf("\nleave-one-out cross validation of the exponent:\n");
+        }
+        
+        num_exponents = 1 + (int)floor((Map->config.tune_exp_max - Map->config.tune_exp_min) / Map->config.tune_exp_step + 1.0E-9);
+        
+        for (edx=0; edx<num_exponents; edx++){
+        
+            _exp = Map->config.tune_exp_min + edx * Map->config.tune_exp_step;
+            error = loo_squared_error(distances, log_distances, station_values, n, _exp, &count);
+            rmse = (count > 0) ? sqrt(error / count) : INFINITY;
+            
+            if (Map->show_output){
+                printf("   exponent %6.3f: RMSE %10.4f (%d stations)\n", _exp, rmse, count);
+            }
+            
+            if (rmse < best_rmse){
+                best_rmse = rmse;
+                best_exp = _exp;
+            }
+        }
+        
+        arena_rewind(&(Map->arena), scratch);
+        
+        // no station has any other station within the search radius:
+        if (!isfinite(best_rmse)){
+            longjmp(env, 3);
+        }
+        
+        Map->config._exp = best_exp;
+        
+        if (Map->show_output){
+            printf("exponent of the distance: %.3f (RMSE %.4f)\n", best_exp, best_rmse);
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The cross validation requires at least 2 stations!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> No station could be interpolated by the other stations (search radius)!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int compare_distances(const void *a, const void *b){
+
+    /*
+        DESCRIPTION:
+        Compare function (qsort) of two distances (ascending).
+    */
+
+    double da = *(const double *) a;
+    double db = *(const double *) b;
+    
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int interpolate_raster(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION:
+        Calculates for any point of the raster an interpolated value. Afterwards the raster points
+        with an assigned station get the measured value (see apply_station_overlay).
+        
+        The rows of the raster are handed out in blocks of ROW_BLOCK rows to "Map->num_threads" threads
+        (see interpolate_raster_worker). Every thread uses its own vector of the distances, the tables
+        of the distances (see create_grid_distance) and the values of the stations are shared.
+        
+        The numerator and the denominator of the weights are summed up in one pass over the stations
+        (see IDW_POINT_KERNEL). The kernel is chosen once by the exponent of the distance: the integer
+        exponents up to IDW_MAX_FIXED_EXP have their own kernel with plain products instead of pow.
+        
+        With local IDW (see is_local_idw) every raster point is interpolated by its nearest stations,
+        that are found by the station index (see create_station_index). The raster points of a row
+        share the candidates of their nearest stations in sections of SEGMENT_COLS points
+        (see find_segment_candidates), so the effort per raster point does not grow with the
+        number of stations. The length of a section follows the distance of the nearest stations.
+        
+        With several exponents of the distance (Map->config.num_exponents > 1, see "-e") the rasters of
+        all exponents are interpolated in the same pass: every distance and its powers are shared by
+        the exponents (see idw_point_multi) and every exponent gets its own raster (see exponent_raster).
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+        
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+    
+
+    int idx;
+    int excno;
+    volatile int failed_row = -1;
+    jmp_buf env;
+    
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int num_threads;
+        int max_neighbours = 0;
+        int max_quadrant = 0;
+        int err = 0;
+        bool local = is_local_idw(Map);
+        double *station_values;
+        double (*idw_point)(const double *, const double *, int, double);
+        struct usr_thread_pool pool;
+        struct usr_interpol_thread *threads;
+        struct usr_arena_mark scratch = arena_mark(&(Map->arena));	// tables and buffers of the threads, given back at the end
+        
+        num_threads = (Map->num_threads > 0) ? (int)Map->num_threads : 1;
+        
+        // never start more threads than there are rows:
+        if (num_threads > (int)Map->rows){
+            num_threads = (int)Map->rows;
+        }
+    
+        // kernel of the exponent (a real exponent, e.g. out of the cross validation, uses pow):
+        if (Map->config._exp == 1){
+            idw_point = idw_point_exp1;
+        }
+        else if (Map->config._exp == 2){
+            idw_point = idw_point_exp2;
+        }
+        else if (Map->config._exp == 3){
+            idw_point = idw_point_exp3;
+        }
+        else if (Map->config._exp == 4){
+            idw_point = idw_point_exp4;
+        }
+        else{
+            idw_point = idw_point_pow;
+        }
+    
+        if (local){
+        
+            // station index to find the nearest stations:
+            if (create_station_index(&(Map->arena), &(Map->station_index), &(Map->input_data)) == EXIT_FAILURE){
+                longjmp(env, 5);
+            }
+            max_neighbours = ((Map->num_neighbours > 0) && (Map->num_neighbours < Map->input_data.length)) ? Map->num_neighbours : Map->input_data.length;
+            max_quadrant = (max_neighbours > Map->quadrant_min) ? max_neighbours : Map->quadrant_min;
+        }
+        else{
+        
+            // precompute the trigonometric terms of the distances:
+            if (create_grid_distance(&(Map->arena), &(Map->grid_distance), &(Map->raster), &(Map->input_data)) == EXIT_FAILURE){
+                longjmp(env, 2);
+            }
+        }
+        
+        // values of the stations (contiguous):
+        station_values = (double *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(double));
+        if (station_values == NULL){
+            arena_rewind(&(Map->arena), scratch);
+            longjmp(env, 1);
+        }
+        
+        for (idx=0; idx<Map->input_data.length; idx++){
+            station_values[idx] = Map->input_data.data[idx].value;
+        }
+        
+        threads = (struct usr_interpol_thread *) arena_alloc(&(Map->arena), num_threads * sizeof(struct usr_interpol_thread));
+        if (threads == NULL){
+            arena_rewind(&(Map->arena), scratch);
+            longjmp(env, 1);
+        }
+        
+        atomic_init(&pool.next_row, 0);
+        atomic_init(&pool.cells_done, 0);
+        atomic_init(&pool.last_permille, 0);
+        atomic_init(&pool.abort, 0);
+        
+        // every thread gets its own vector of the distances:
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].Map = Map;
+            threads[idx].pool = &pool;
+            threads[idx].idw_point = idw_point;
+            threads[idx].station_values = station_values;
+            threads[idx].excno = 0;
+            threads[idx].failed_row = -1;
+            threads[idx].distances = (double *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(double));
+            
+            if (threads[idx].distances == NULL){
+                arena_rewind(&(Map->arena), scratch);
+                longjmp(env, 1);
+            }
+            
+            // buffers of the nearest stations (k nearest + the minimum of every quadrant), 
+            // of the candidates of a section of a row and of the quadrants:
+            if (local){
+                if ((create_neighbourhood(&(Map->arena), &(threads[idx].neighbourhood), max_neighbours + 4 * Map->quadrant_min) == EXIT_FAILURE) ||
+                    (create_neighbourhood(&(Map->arena), &(threads[idx].candidates), Map->input_data.length) == EXIT_FAILURE) ||
+                    ((Map->quadrant_min > 0) && 
+                     ((create_neighbourhood(&(Map->arena), &(threads[idx].quadrants[0]), max_quadrant) == EXIT_FAILURE) ||
+                      (create_neighbourhood(&(Map->arena), &(threads[idx].quadrants[1]), max_quadrant) == EXIT_FAILURE) ||
+                      (create_neighbourhood(&(Map->arena), &(threads[idx].quadrants[2]), max_quadrant) == EXIT_FAILURE) ||
+                      (create_neighbourhood(&(Map->arena), &(threads[idx].quadrants[3]), max_quadrant) == EXIT_FAILURE)))){
+                    arena_rewind(&(Map->arena), scratch);
+                    longjmp(env, 1);
+                }
+            }
+        }
+    
+        if (Map->show_output){
+            printf("\n");
+            if (local){
+                printf("local IDW: %d nearest stations, search radius %.1f km, %d stations per quadrant\n", 
+                       max_neighbours, Map->search_radius, Map->quadrant_min);
+            }
+            printf("interpolating (%d threads) ...         ", num_threads);
+            fflush(stdout);
+        }
+        
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, interpolate_raster_worker, &threads[idx]) != 0){
+            
+                // stop and wait for the threads that are already running:
+                atomic_store(&pool.abort, 1);
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
+                }
+                arena_rewind(&(Map->arena), scratch);
+                longjmp(env, 4);
+            }
+        }
+        
+        interpolate_raster_worker(&threads[0]);
+        
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
+        }
+        
+        // take over the error of the first thread that failed:
+        for (idx=0; idx<num_threads; idx++){
+            if (threads[idx].excno != 0){
+                err = threads[idx].excno;
+                failed_row = threads[idx].failed_row;
+                break;
+            }
+        }
+        
+        arena_rewind(&(Map->arena), scratch);
+        
+        if (err != 0){
+            longjmp(env, err);
+        }
+        
+        // the raster points with a station get the measured value:
+        for (idx=0; idx<Map->config.num_exponents; idx++){
+            apply_station_overlay(exponent_raster(Map, idx), &(Map->input_data));
+        }
+        
+        if (Map->show_output){
+            printf("ok\n");
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        // ##############################################################################################
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;                              
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when creating the distance tables!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Row %d of the raster contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__, failed_row); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when starting the interpolation threads!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when creating the station index!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    } 
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void *interpolate_raster_worker(void *arg){
+
+    /*
+    
+        DESCRIPTION:
+        Thread function of the interpolation. Takes blocks of ROW_BLOCK rows out of the shared
+        row counter until all rows of the raster are done or another thread has failed.
+        The kernels do not check their results, instead every finished row is checked once
+        for "NAN" or "INF" (see row_is_finite).
+        The progress is counted without any lock and shown in steps of 0.1 %.
+        
+        INPUT:
+        void *arg		...	pointer to the thread object of type struct usr_interpol_thread.
+        
+        OUTPUT:
+        always NULL. An error is passed by the attribute "excno" of the thread object.
+        
+    */
+
+    int idx, row, first_row, last_row, col, first_col, last_col;
+    int permille, last_permille;
+    int section_cols = SEGMENT_COLS;
+    long cells_done;
+    double *values[IDW_MAX_EXPONENTS];
+    double results[IDW_MAX_EXPONENTS];
+    double reach;
+    bool use_candidates, shared;
+    
+    struct usr_interpol_thread *thread = (struct usr_interpol_thread *) arg;
+    struct usr_thread_pool *pool = thread->pool;
+    struct usr_map *Map = thread->Map;
+    
+    long num_cells = (long)Map->rows * (long)Map->cols;
+    
+    // local IDW: number of the nearest stations:
+    int k = ((Map->num_neighbours > 0) && (Map->num_neighbours < Map->input_data.length)) ? Map->num_neighbours : Map->input_data.length;
+    
+    
+    while (!atomic_load(&pool->abort)){
+    
+        // take the next block of rows:
+        first_row = atomic_fetch_add(&pool->next_row, ROW_BLOCK);
+        if (first_row >= (int)Map->rows){
+            break;
+        }
+        last_row = ((first_row + ROW_BLOCK) < (int)Map->rows) ? (first_row + ROW_BLOCK) : (int)Map->rows;
+        
+        // interpolate every point, the points with a station are overwritten later on (overlay):
+        for (row=first_row; row<last_row; row++){
+        
+            // the row of the raster of every exponent:
+            for (idx=0; idx<Map->config.num_exponents; idx++){
+                values[idx] = &(exponent_raster(Map, idx)->value[(size_t)row * Map->cols]);
+            }
+            
+            if (is_local_idw(Map)){
+            
+                // the points of a section of the row share the candidates (not with the minimum per quadrant):
+                use_candidates = (Map->quadrant_min <= 0);
+                
+                for (first_col=0; first_col<(int)Map->cols; first_col=last_col+1){
+                
+                    last_col = ((first_col + section_cols) < (int)Map->cols) ? (first_col + section_cols - 1) : ((int)Map->cols - 1);
+                    
+                    // a short section is faster by searching every point:
+                    shared = (use_candidates) && (section_cols >= SEGMENT_MIN_COLS);
+                    if (shared){
+                        reach = find_segment_candidates(Map, thread, row, first_col, last_col);
+                    }
+                    for (col=first_col; col<=last_col; col++){
+                        interpolate_raster_point_local(Map, thread, row, col, shared);
+                    }
+                    
+                    if (use_candidates){
+                    
+                        if (!shared){
+                            reach = (thread->neighbourhood.num_neighbours == k) ? thread->neighbourhood.distances[k-1] : Map->search_radius;
+                        }
+                        
+                        // length of the next section at most half of the distance of the nearest stations,
+                        // so that the number of candidates stays small:
+                        section_cols = 1 + (int)fmin(reach / (2 * Map->lonMetRes), SEGMENT_COLS);
+                        section_cols = (section_cols > SEGMENT_COLS) ? SEGMENT_COLS : section_cols;
+                    }
+                }
+            }
+            else{
+                for (col=0; col<(int)Map->cols; col++){
+                
+                    // distances of the raster point to all stations:
+                    grid_distances(&(Map->grid_distance), row, col, thread->distances);
+                    
+                    if (Map->config.num_exponents > 1){
+                        idw_point_multi(thread->distances, thread->station_values, Map->input_data.length, 
+                                        Map->config.exponents, Map->config.num_exponents, results);
+                        for (idx=0; idx<Map->config.num_exponents; idx++){
+                            values[idx][col] = results[idx];
+                        }
+                    }
+                    else{
+                        values[0][col] = thread->idw_point(thread->distances, thread->station_values, Map->input_data.length, Map->config._exp);
+                    }
+                }
+            }
+            
+            // status of the row (of every exponent):
+            for (idx=0; idx<Map->config.num_exponents; idx++){
+                if (!row_is_finite(values[idx], Map->cols)){
+                    thread->excno = 3;
+                    thread->failed_row = row;
+                    atomic_store(&pool->abort, 1);
+                    return NULL;
+                }
+            }
+        }
+        
+        cells_done = atomic_fetch_add(&pool->cells_done, (long)(last_row - first_row) * Map->cols) + (long)(last_row - first_row) * Map->cols;
+        
+        // show the progress, but only if no other thread has already shown a higher one:
+        if (Map->show_output){
+        
+            permille = (int)((cells_done * 1000) / num_cells);
+            last_permille = atomic_load(&pool->last_permille);
+            
+            while (permille > last_permille){
+                if (atomic_compare_exchange_weak(&pool->last_permille, &last_permille, permille)){
+                    printf("\b\b\b\b\b\b\b\b\b %5.1f %% ", permille / 10.0);
+                    fflush(stdout);
+                    break;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double find_segment_candidates(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int first_col, int last_col){
+
+    /*
+    
+        DESCRIPTION:
+        Finds the candidates of the nearest stations of the raster points first_col ... last_col of a row
+        (local IDW without a minimum per quadrant). 
+        
+        Let C be the raster point in the middle of the section, h the largest distance of C to a point Q of
+        the section and r the distance of the k-th nearest station of C. The k nearest stations of C are at most
+        r + h away from Q, so all k nearest stations of Q are at most r + 2h away from C (with a search radius R
+        at most R + h). These stations are the candidates of all points of the section 
+        (see interpolate_raster_point_local).
+        
+        INPUT:
+        struct usr_map *Map			...	pointer to the map object.
+        struct usr_interpol_thread *thread	...	pointer to the thread object (buffers "neighbourhood" and "candidates")
+        int row					...	row of the raster
+        int first_col, last_col			...	first and last column of the section
+        
+        OUTPUT:
+        distance r (km) of the k-th nearest station of C (with less then k stations the search radius)
+        
+    */
+
+    int num, k;
+    int mid_col = (first_col + last_col) / 2;
+    double lat = raster_lat(&(Map->raster), row);
+    double lon = raster_lon(&(Map->raster), mid_col);
+    double half, radius;
+    
+    struct usr_neighbourhood *nb = &(thread->neighbourhood);
+    
+    k = ((Map->num_neighbours > 0) && (Map->num_neighbours < Map->input_data.length)) ? Map->num_neighbours : Map->input_data.length;
+    
+    // largest distance of the middle to the points of the section (the distance along a row grows with the columns):
+    half = fmax(calc_distance(lat, lon, lat, raster_lon(&(Map->raster), first_col)),
+                calc_distance(lat, lon, lat, raster_lon(&(Map->raster), last_col)));
+    
+    num = find_nearest_stations(&(Map->station_index), &(Map->input_data), lat, lon, k, Map->search_radius, 0, NULL, nb);
+    
+    if (num == k){
+        radius = nb->distances[k-1] + 2 * half;
+        if (Map->search_radius > 0){
+            radius = fmin(radius, Map->search_radius + half);
+        }
+    }
+    else{
+        // less then k stations within the search radius:
+        radius = Map->search_radius + half;
+    }
+    
+    // all stations within the radius (EPS against rounding errors of the distances):
+    find_stations_within(&(Map->station_index), lat, lon, radius + EPS, &(thread->candidates));
+    
+    return (num == k) ? nb->distances[k-1] : Map->search_radius;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void interpolate_raster_point_local(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int col, bool use_candidates){
+
+    /*
+    
+        DESCRIPTION:
+        Interpolates one raster point by its nearest stations (local IDW). The stations are taken out of
+        the candidates of the section of the row (see find_segment_candidates) or, with a minimum number
+        of stations per quadrant, searched by the station index (see find_nearest_stations).
+        Both ways give the same stations. A raster point without any station within the search radius
+        gets NO_VALUE. With several exponents the raster point of every exponent is interpolated at once
+        (see idw_point_multi).
+        
+        INPUT:
+        struct usr_map *Map			...	pointer to the map object.
+        struct usr_interpol_thread *thread	...	pointer to the thread object (buffers of the nearest stations)
+        int row, col				...	raster point
+        bool use_candidates			...	take the stations out of thread->candidates
+        
+    */
+
+    int idx, sidx, num, k;
+    double lat = raster_lat(&(Map->raster), row);
+    double lon = raster_lon(&(Map->raster), col);
+    double distance;
+    double point[3];
+    double results[IDW_MAX_EXPONENTS];
+    
+    struct usr_neighbourhood *nb = &(thread->neighbourhood);
+    struct usr_neighbourhood *candidates = &(thread->candidates);
+    
+    k = ((Map->num_neighbours > 0) && (Map->num_neighbours < Map->input_data.length)) ? Map->num_neighbours : Map->input_data.length;
+    
+    if (use_candidates){
+    
+        unit_vector(lat, lon, point);
+        nb->num_neighbours = 0;
+        
+        for (idx=0; idx<candidates->num_neighbours; idx++){
+        
+            sidx = candidates->station_idx[idx];
+            distance = index_distance(&(Map->station_index), sidx, point);
+            
+            if ((Map->search_radius > 0) && (distance > Map->search_radius)){
+                continue;
+            }
+            insert_neighbour(nb, k, distance, sidx);
+        }
+        num = nb->num_neighbours;
+    }
+    else{
+        num = find_nearest_stations(&(Map->station_index), &(Map->input_data), lat, lon, k, Map->search_radius, Map->quadrant_min, thread->quadrants, nb);
+    }
+    
+    if (num == 0){
+        for (idx=0; idx<Map->config.num_exponents; idx++){
+            exponent_raster(Map, idx)->value[(size_t)row * Map->cols + col] = NO_VALUE;
+        }
+        return;
+    }
+    
+    for (idx=0; idx<num; idx++){
+        nb->values[idx] = thread->station_values[nb->station_idx[idx]];
+    }
+    
+    if (Map->config.num_exponents > 1){
+        idw_point_multi(nb->distances, nb->values, num, Map->config.exponents, Map->config.num_exponents, results);
+        for (idx=0; idx<Map->config.num_exponents; idx++){
+            exponent_raster(Map, idx)->value[(size_t)row * Map->cols + col] = results[idx];
+        }
+    }
+    else{
+        Map->raster.value[(size_t)row * Map->cols + col] = thread->idw_point(nb->distances, nb->values, num, Map->config._exp);
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+bool is_local_idw(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Local IDW: every raster point is interpolated by its "Map->num_neighbours" nearest stations
+        and/or by the stations within "Map->search_radius" km.
+    */
+
+    return (Map->num_neighbours > 0) || (Map->search_radius > 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_station_index(struct usr_arena *arena, struct usr_station_index *index, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Creates a spatial index of the stations: a regular grid of latitudes and longitudes over the
+        extent of the stations with about STATION_INDEX_FILL stations per cell. The stations of every
+        cell are stored one after the other (index->stations), the first entry of every cell is
+        given by index->cell_start.
+        The unit vectors of the stations are stored as well, so a distance needs 3 multiplications
+        and 1 acos (see index_distance).
+        
+        INPUT:
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_station_index *index		...	pointer to the object of the index
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
+    
+        OUTPUT:(error code)
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
+    */
+
+    int idx, cell;
+    int excno;
+    jmp_buf env;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int num_cells;
+        int *fill;
+        double maxLat, maxLon, height, width;
+        struct usr_arena_mark scratch;
+        
+        if (input_data->length <= 0){
+            longjmp(env, 1);
+        }
+        
+        // extent of the stations:
+        index->minLat = maxLat = input_data->data[0].lat;
+        index->minLon = maxLon = input_data->data[0].lon;
+        index->maxAbsLat = 0;
+        
+        for (idx=0; idx<input_data->length; idx++){
+        
+            index->minLat = (input_data->data[idx].lat < index->minLat) ? input_data->data[idx].lat : index->minLat;
+            index->minLon = (input_data->data[idx].lon < index->minLon) ? input_data->data[idx].lon : index->minLon;
+            maxLat = (input_data->data[idx].lat > maxLat) ? input_data->data[idx].lat : maxLat;
+            maxLon = (input_data->data[idx].lon > maxLon) ? input_data->data[idx].lon : maxLon;
+            index->maxAbsLat = (fabs(input_data->data[idx].lat) > index->maxAbsLat) ? fabs(input_data->data[idx].lat) : index->maxAbsLat;
+        }
+        
+        // number of rows and columns, so that the cells are about square (km):
+        num_cells = (input_data->length / STATION_INDEX_FILL > 1) ? input_data->length / STATION_INDEX_FILL : 1;
+        height = maxLat - index->minLat;
+        width = (maxLon - index->minLon) * cos(((index->minLat + maxLat) / 360.0) * M_PI);
+        
+        if ((height > 0) && (width > 0)){
+            index->rows = (int)round(sqrt(num_cells * height / width));
+            index->rows = (index->rows < 1) ? 1 : ((index->rows > num_cells) ? num_cells : index->rows);
+            index->cols = num_cells / index->rows;
+        }
+        else{
+            index->rows = (height > 0) ? num_cells : 1;
+            index->cols = (width > 0) ? num_cells : 1;
+        }
+        
+        index->cellLat = (height > 0) ? height / index->rows : 1.0;
+        index->cellLon = (maxLon > index->minLon) ? (maxLon - index->minLon) / index->cols : 1.0;
+        
+        index->cell_start = (int *) arena_alloc(arena, (index->rows * index->cols + 1) * sizeof(int));
+        index->stations = (int *) arena_alloc(arena, input_data->length * sizeof(int));
+        index->unit_vectors = (double *) arena_alloc(arena, 3 * input_data->length * sizeof(double));
+        scratch = arena_mark(arena);
+        fill = (int *) arena_alloc(arena, index->rows * index->cols * sizeof(int));
+        if ((index->cell_start == NULL) || (index->stations == NULL) || (index->unit_vectors == NULL) || (fill == NULL)){
+            longjmp(env, 2);
+        }
+        
+        // count the stations of every cell, then sort them into the cells:
+        for (idx=0; idx<input_data->length; idx++){
+            cell = station_index_cell(index, input_data->data[idx].lat, input_data->data[idx].lon);
+            index->cell_start[cell+1]++;
+        }
+        for (cell=0; cell<index->rows * index->cols; cell++){
+            index->cell_start[cell+1] += index->cell_start[cell];
+        }
+        for (idx=0; idx<input_data->length; idx++){
+            cell = station_index_cell(index, input_data->data[idx].lat, input_data->data[idx].lon);
+            index->stations[index->cell_start[cell] + fill[cell]++] = idx;
+            
+            unit_vector(input_data->data[idx].lat, input_data->data[idx].lon, &(index->unit_vectors[3 * idx]));
+        }
+        
+        arena_rewind(arena, scratch);
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int station_index_cell(struct usr_station_index *index, double lat, double lon){
+
+    /*
+        DESCRIPTION:
+        Returns the cell of the station index of a point. Points outside the index are assigned to the nearest cell of the border.
+    */
+
+    int row, col;
+    
+    row = (int)floor((lat - index->minLat) / index->cellLat);
+    col = (int)floor((lon - index->minLon) / index->cellLon);
+    
+    row = (row < 0) ? 0 : ((row >= index->rows) ? index->rows - 1 : row);
+    col = (col < 0) ? 0 : ((col >= index->cols) ? index->cols - 1 : col);
+    
+    return row * index->cols + col;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void unit_vector(double lat, double lon, double *vector){
+
+    /*
+        DESCRIPTION:
+        Unit vector (x, y, z) of a point on the sphere. The cosine of the angle between two points
+        is the scalar product of their unit vectors (see index_distance).
+        
+        INPUT:
+        double lat, lon		...	coordinates of the point in decimal degree
+        double *vector		...	unit vector, vector of length 3
+    */
+
+    double lat_rad = (lat/180.0) * M_PI;
+    double lon_rad = (lon/180.0) * M_PI;
+    
+    vector[0] = cos(lat_rad) * cos(lon_rad);
+    vector[1] = cos(lat_rad) * sin(lon_rad);
+    vector[2] = sin(lat_rad);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double index_distance(struct usr_station_index *index, int station, const double *point){
+
+    /*
+        DESCRIPTION:
+        Distance (km) of a point to a station of the index by the scalar product of their unit vectors.
+        Kernel without any checks, the cosine is clamped like in calc_distance.
+        
+        INPUT:
+        struct usr_station_index *index	...	pointer to the station index
+        int station			...	index of the station
+        const double *point		...	unit vector of the point (see unit_vector)
+    */
+
+    const double *vector = &(index->unit_vectors[3 * station]);
+    
+    return RADIUS_EARTH * acos( clamp_unit( (vector[0] * point[0]) + (vector[1] * point[1]) + (vector[2] * point[2]) ) );
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline void insert_neighbour(struct usr_neighbourhood *nb, int k, double distance, int station){
+
+    /*
+        DESCRIPTION:
+        Inserts a station into the list of the k nearest stations, that is sorted by the distance
+        (stations with the same distance by their index). A station behind the k-th is dropped.
+    */
+
+    int pos = nb->num_neighbours;
+    
+    while ((pos > 0) && ((distance < nb->distances[pos-1]) ||
+                         ((distance == nb->distances[pos-1]) && (station < nb->station_idx[pos-1])))){
+        pos--;
+    }
+    if (pos >= k){
+        return;
+    }
+    if (nb->num_neighbours < k){
+        nb->num_neighbours++;
+    }
+    memmove(&(nb->distances[pos+1]), &(nb->distances[pos]), (nb->num_neighbours - 1 - pos) * sizeof(double));
+    memmove(&(nb->station_idx[pos+1]), &(nb->station_idx[pos]), (nb->num_neighbours - 1 - pos) * sizeof(int));
+    nb->distances[pos] = distance;
+    nb->station_idx[pos] = station;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int find_nearest_stations(struct usr_station_index *index, struct usr_dataset *input_data, double lat, double lon,
+                          int k, double radius, int quadrant_min, struct usr_neighbourhood *quadrants, struct usr_neighbourhood *nb){
+
+    /*
+        DESCRIPTION:
+        Finds the k nearest stations of a point (optional within a radius) by the station index.
+        
+        The cells of the index are searched ring by ring around the cell of the point. After every ring
+        a lower limit of the distance to all stations outside of the searched rings is calculated:
+        in direction of the latitude by the width of the rings, in direction of the longitude by
+        sin(d/2R) >= cos(lat_max) * sin(dlon/2) (haversine formula). The search stops, as soon as this
+        limit exceeds the distance of the k-th station or the radius.
+        
+        With quadrant_min > 0 the k nearest stations are supplemented by the nearest stations of every
+        quadrant (north-east, north-west, south-east, south-west of the point), until every quadrant has
+        at least quadrant_min stations (as far as there are any). The stations are collected per quadrant
+        (quadrants[0 ... 3], buffers of at least max(k, quadrant_min) stations) and merged afterwards.
+        A quadrant without stations is searched up to the radius (or the whole index).
+        
+        The stations are sorted by their distance, stations with the same distance by their index.
+        So the result does not depend on the order of the search.
+        
+        INPUT:
+        struct usr_station_index *index		...	pointer to the station index
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
+        double lat, lon				...	coordinates of the point
+        int k					...	number of stations (at most nb->max_neighbours)
+        double radius				...	search radius in km (0 => unlimited)
+        int quadrant_min			...	minimum number of stations per quadrant (0 => none)
+        struct usr_neighbourhood *quadrants	...	buffers of the 4 quadrants (only with quadrant_min > 0)
+        struct usr_neighbourhood *nb		...	nearest stations and their distances
+    
+        OUTPUT:
+        number of stations found
+    */
+
+    int ring, max_ring, row, col, step, row0, col0;
+    int idx, sidx, cell, quadrant, num_known, num_quadrant;
+    int pos[4], taken[4];
+    double distance, bound, bound_lat, bound_lon, cos_lat_max;
+    double point[3];
+    bool quadrants_done;
+    struct usr_neighbourhood *list;
+    
+    k = (k < nb->max_neighbours) ? k : nb->max_neighbours;
+    nb->num_neighbours = 0;
+    
+    if (quadrant_min > 0){
+        for (quadrant=0; quadrant<4; quadrant++){
+            quadrants[quadrant].num_neighbours = 0;
+        }
+    }
+    
+    unit_vector(lat, lon, point);
+    
+    cell = station_index_cell(index, lat, lon);
+    row0 = cell / index->cols;
+    col0 = cell % index->cols;
+    
+    max_ring = (index->rows > index->cols) ? index->rows : index->cols;
+    cos_lat_max = cos((((fabs(lat) > index->maxAbsLat) ? fabs(lat) : index->maxAbsLat) / 180.0) * M_PI);
+    
+    for (ring=0; ring<=max_ring; ring++){
+    
+        // the cells of the ring:
+        for (row=row0-ring; row<=row0+ring; row++){
+        
+            if ((row < 0) || (row >= index->rows)){
+                continue;
+            }
+            
+            // within the ring only the first and the last column:
+            step = ((row == row0-ring) || (row == row0+ring) || (ring == 0)) ? 1 : 2*ring;
+            
+            for (col=col0-ring; col<=col0+ring; col+=step){
+            
+                if ((col < 0) || (col >= index->cols)){
+                    continue;
+                }
+                
+                cell = row * index->cols + col;
+                for (idx=index->cell_start[cell]; idx<index->cell_start[cell+1]; idx++){
+                
+                    sidx = index->stations[idx];
+                    distance = index_distance(index, sidx, point);
+                    
+                    if ((radius > 0) && (distance > radius)){
+                        continue;
+                    }
+                    
+                    if (quadrant_min > 0){
+                        quadrant = ((input_data->data[sidx].lat >= lat) ? 0 : 2) + ((input_data->data[sidx].lon >= lon) ? 0 : 1);
+                        insert_neighbour(&quadrants[quadrant], quadrants[quadrant].max_neighbours, distance, sidx);
+                    }
+                    else{
+                        insert_neighbour(nb, k, distance, sidx);
+                    }
+                }
+            }
+        }
+        
+        // lower limit of the distance to the stations outside of the searched rings:
+        bound_lat = RADIUS_EARTH * ((ring * index->cellLat) / 180.0) * M_PI;
+        bound_lon = 2 * RADIUS_EARTH * asin(cos_lat_max * sin(((((ring * index->cellLon) < 180.0) ? ring * index->cellLon : 180.0) / 360.0) * M_PI));
+        bound = fmin(bound_lat, bound_lon);
+        
+        if ((radius > 0) && (bound > radius)){
+            break;
+        }
+        
+        if (quadrant_min > 0){
+        
+            // the stations within the limit are final: at least k of them and quadrant_min of every quadrant?
+            num_known = 0;
+            quadrants_done = true;
+            for (quadrant=0; quadrant<4; quadrant++){
+            
+                for (num_quadrant=0; (num_quadrant < quadrants[quadrant].num_neighbours) && 
+                                     (quadrants[quadrant].distances[num_quadrant] <= bound); num_quadrant++);
+                
+                num_known += num_quadrant;
+                quadrants_done = quadrants_done && (num_quadrant >= quadrant_min);
+            }
+            if ((quadrants_done) && (num_known >= k)){
+                break;
+            }
+        }
+        else if ((nb->num_neighbours == k) && (bound >= nb->distances[k-1])){
+            break;
+        }
+    }
+    
+    // merge the quadrants: the k nearest stations and the nearest ones of every quadrant up to quadrant_min:
+    if (quadrant_min > 0){
+    
+        for (quadrant=0; quadrant<4; quadrant++){
+            pos[quadrant] = 0;
+            taken[quadrant] = 0;
+        }
+        
+        while (nb->num_neighbours < nb->max_neighbours){
+        
+            // the nearest of the remaining stations of all quadrants:
+            list = NULL;
+            for (quadrant=0; quadrant<4; quadrant++){
+            
+                if ((pos[quadrant] < quadrants[quadrant].num_neighbours) &&
+                    ((list == NULL) || 
+                     (quadrants[quadrant].distances[pos[quadrant]] < list->distances[pos[idx]]) ||
+                     ((quadrants[quadrant].distances[pos[quadrant]] == list->distances[pos[idx]]) && 
+                      (quadrants[quadrant].station_idx[pos[quadrant]] < list->station_idx[pos[idx]])))){
+                    list = &quadrants[quadrant];
+                    idx = quadrant;
+                }
+            }
+            if (list == NULL){
+                break;
+            }
+            
+            if ((nb->num_neighbours < k) || (taken[idx] < quadrant_min)){
+                nb->distances[nb->num_neighbours] = list->distances[pos[idx]];
+                nb->station_idx[nb->num_neighbours] = list->station_idx[pos[idx]];
+                nb->num_neighbours++;
+                taken[idx]++;
+            }
+            pos[idx]++;
+        }
+    }
+    
+    return nb->num_neighbours;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int find_stations_within(struct usr_station_index *index, double lat, double lon, double radius, struct usr_neighbourhood *nb){
+
+    /*
+        DESCRIPTION:
+        Finds all stations within a radius of a point by the station index (unsorted). The cells are
+        searched ring by ring like in find_nearest_stations, until the lower limit of the distance to
+        the stations outside of the searched rings exceeds the radius.
+        
+        INPUT:
+        struct usr_station_index *index		...	pointer to the station index
+        double lat, lon				...	coordinates of the point
+        double radius				...	radius in km
+        struct usr_neighbourhood *nb		...	stations and their distances (buffer of all stations)
+    
+        OUTPUT:
+        number of stations found
+    */
+
+    int ring, max_ring, row, col, step, row0, col0;
+    int idx, sidx, cell;
+    double distance, bound_lat, bound_lon, cos_lat_max;
+    double point[3];
+    
+    nb->num_neighbours = 0;
+    unit_vector(lat, lon, point);
+    
+    cell = station_index_cell(index, lat, lon);
+    row0 = cell / index->cols;
+    col0 = cell % index->cols;
+    
+    max_ring = (index->rows > index->cols) ? index->rows : index->cols;
+    cos_lat_max = cos((((fabs(lat) > index->maxAbsLat) ? fabs(lat) : index->maxAbsLat) / 180.0) * M_PI);
+    
+    for (ring=0; ring<=max_ring; ring++){
+    
+        for (row=row0-ring; row<=row0+ring; row++){
+        
+            if ((row < 0) || (row >= index->rows)){
+                continue;
+            }
+            step = ((row == row0-ring) || (row == row0+ring) || (ring == 0)) ? 1 : 2*ring;
+            
+            for (col=col0-ring; col<=col0+ring; col+=step){
+            
+                if ((col < 0) || (col >= index->cols)){
+                    continue;
+                }
+                
+                cell = row * index->cols + col;
+                for (idx=index->cell_start[cell]; idx<index->cell_start[cell+1]; idx++){
+                
+                    sidx = index->stations[idx];
+                    distance = index_distance(index, sidx, point);
+                    
+                    if ((distance <= radius) && (nb->num_neighbours < nb->max_neighbours)){
+                        nb->station_idx[nb->num_neighbours] = sidx;
+                        nb->distances[nb->num_neighbours] = distance;
+                        nb->num_neighbours++;
+                    }
+                }
+            }
+        }
+        
+        // lower limit of the distance to the stations outside of the searched rings:
+        bound_lat = RADIUS_EARTH * ((ring * index->cellLat) / 180.0) * M_PI;
+        bound_lon = 2 * RADIUS_EARTH * asin(cos_lat_max * sin(((((ring * index->cellLon) < 180.0) ? ring * index->cellLon : 180.0) / 360.0) * M_PI));
+        
+        if (fmin(bound_lat, bound_lon) > radius){
+            break;
+        }
+    }
+    
+    return nb->num_neighbours;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_neighbourhood(struct usr_arena *arena, struct usr_neighbourhood *nb, int max_neighbours){
+
+    /*
+        DESCRIPTION:
+        Allocates the buffers for the nearest stations of a raster point out of the arena.
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    nb->max_neighbours = max_neighbours;
+    nb->num_neighbours = 0;
+    nb->station_idx = (int *) arena_alloc(arena, max_neighbours * sizeof(int));
+    nb->distances = (double *) arena_alloc(arena, max_neighbours * sizeof(double));
+    nb->values = (double *) arena_alloc(arena, max_neighbours * sizeof(double));
+    
+    if ((nb->station_idx == NULL) || (nb->distances == NULL) || (nb->values == NULL)){
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+/*
+    DESCRIPTION:
+    Generates the kernel of the inverse distance weighting of one raster point for one exponent.
+    WEIGHT is the weight of the station out of its distance "d" (e.g. 1.0/(d*d)).
+    The numerator and the denominator are summed up in one pass without branches, so the
+    compiler can vectorize the loop. A station with the distance 0 has an infinite weight,
+    in this case the raster point gets the value of the nearest station(s) (see idw_exact_hit).
+    
+    If the compiler generates AVX2 code (e.g. -O2 -mavx2), IDW_POINT_KERNEL sums up 4 stations at once
+    with WEIGHT_AVX2, the weight out of the 4 distances "d4" (e.g. _mm256_div_pd(one, _mm256_mul_pd(d4, d4))),
+    and the remaining stations with WEIGHT. Otherwise IDW_POINT_KERNEL is the scalar kernel.
+    The kernel of a real exponent (idw_point_pow) needs the vector pow of the glibc (EXP_AVX2).
+    
+    INPUT (of the generated kernel):
+    const double *distances		...	distances (km) of the raster point to all stations
+    const double *station_values	...	values of the stations
+    int length				...	number of stations
+    double _exp				...	exponent of the distance (only used by WEIGHT of idw_point_pow)
+    
+    OUTPUT (of the generated kernel):
+    interpolated value of the raster point
+*/
+#define IDW_POINT_KERNEL_SCALAR(name, WEIGHT)										\
+static inline double name(const double *distances, const double *station_values, int length, double _exp){	\
+														\
+    int kdx;													\
+    double d, weight;												\
+    double weight_sum = 0;											\
+    double value_sum = 0;											\
+														\
+    (void)_exp;													\
+    for (kdx=0; kdx<length; kdx++){										\
+        d = distances[kdx];											\
+        weight = (WEIGHT);											\
+        weight_sum += weight;											\
+        value_sum += weight * station_values[kdx];								\
+    }														\
+														\
+    return (isinf(weight_sum)) ? idw_exact_hit(distances, station_values, length) : (value_sum / weight_sum);	\
+}
+
+#ifdef __AVX2__
+#define IDW_POINT_KERNEL(name, WEIGHT, WEIGHT_AVX2)									\
+static inline double name(const double *distances, const double *station_values, int length, double _exp){	\
+														\
+    int kdx;													\
+    double d, weight;												\
+    double weight_sum, value_sum;										\
+    __m256d d4, weight4;											\
+    __m256d one = _mm256_set1_pd(1.0);										\
+    __m256d weight_sum4 = _mm256_setzero_pd();									\
+    __m256d value_sum4 = _mm256_setzero_pd();									\
+														\
+    (void)_exp;													\
+    for (kdx=0; kdx+4<=length; kdx+=4){										\
+        d4 = _mm256_loadu_pd(&distances[kdx]);									\
+        weight4 = (WEIGHT_AVX2);										\
+        weight_sum4 = _mm256_add_pd(weight_sum4, weight4);							\
+        value_sum4 = _mm256_add_pd(value_sum4, _mm256_mul_pd(weight4, _mm256_loadu_pd(&station_values[kdx])));	\
+    }														\
+    weight_sum = sum_vector_avx2(weight_sum4);									\
+    value_sum = sum_vector_avx2(value_sum4);									\
+														\
+    for (; kdx<length; kdx++){											\
+        d = distances[kdx];											\
+        weight = (WEIGHT);											\
+        weight_sum += weight;											\
+        value_sum += weight * station_values[kdx];								\
+    }														\
+														\
+    return (isinf(weight_sum)) ? idw_exact_hit(distances, station_values, length) : (value_sum / weight_sum);	\
+}
+#else
+#define IDW_POINT_KERNEL(name, WEIGHT, WEIGHT_AVX2) IDW_POINT_KERNEL_SCALAR(name, WEIGHT)
+#endif
+
+IDW_POINT_KERNEL(idw_point_exp1, 1.0/d, _mm256_div_pd(one, d4))
+IDW_POINT_KERNEL(idw_point_exp2, 1.0/(d*d), _mm256_div_pd(one, _mm256_mul_pd(d4, d4)))
+IDW_POINT_KERNEL(idw_point_exp3, 1.0/(d*d*d), _mm256_div_pd(one, _mm256_mul_pd(_mm256_mul_pd(d4, d4), d4)))
+IDW_POINT_KERNEL(idw_point_exp4, 1.0/(d*d*d*d), _mm256_div_pd(one, _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(d4, d4), d4), d4)))
+#ifdef EXP_AVX2
+IDW_POINT_KERNEL(idw_point_pow, 1.0/pow(d, _exp), _mm256_div_pd(one, _ZGVdN4vv_pow(d4, _mm256_set1_pd(_exp))))
+#else
+IDW_POINT_KERNEL_SCALAR(idw_point_pow, 1.0/pow(d, _exp))
+#endif
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline void idw_point_multi(const double *distances, const double *station_values, int length, 
+                                   const int *exponents, int num_exponents, double *results){
+
+    /*
+        DESCRIPTION:
+        Inverse distance weighting of one raster point for several exponents of the distance in one pass
+        over the stations. The powers of a distance are built one after the other by multiplication,
+        so the exponents (ascending) share every distance and every power below them.
+        The products and the order of the sums are the same as those of the kernels idw_point_exp1 ...
+        idw_point_exp4 (see IDW_POINT_KERNEL), so these exponents give exactly the same values as the
+        interpolation with one exponent. Greater exponents differ by rounding from idw_point_pow.
+        
+        INPUT:
+        const double *distances		...	distances (km) of the raster point to all stations
+        const double *station_values	...	values of the stations
+        int length			...	number of stations
+        const int *exponents		...	exponents of the distance (ascending, at most IDW_MAX_EXPONENTS)
+        int num_exponents		...	number of exponents
+        double *results			...	interpolated value of the raster point for every exponent
+    */
+
+    int kdx, edx, power_exp;
+    double d, power, weight;
+    double weight_sum[IDW_MAX_EXPONENTS];
+    double value_sum[IDW_MAX_EXPONENTS];
+    
+#ifdef __AVX2__
+    __m256d d4, power4, weight4, value4;
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d weight_sum4[IDW_MAX_EXPONENTS];
+    __m256d value_sum4[IDW_MAX_EXPONENTS];
+    
+    for (edx=0; edx<num_exponents; edx++){
+        weight_sum4[edx] = _mm256_setzero_pd();
+        value_sum4[edx] = _mm256_setzero_pd();
+    }
+    
+    for (kdx=0; kdx+4<=length; kdx+=4){
+    
+        d4 = _mm256_loadu_pd(&distances[kdx]);
+        value4 = _mm256_loadu_pd(&station_values[kdx]);
+        power4 = d4;
+        power_exp = 1;
+        
+        for (edx=0; edx<num_exponents; edx++){
+        
+            for (; power_exp<exponents[edx]; power_exp++){
+                power4 = _mm256_mul_pd(power4, d4);
+            }
+            weight4 = _mm256_div_pd(one, power4);
+            weight_sum4[edx] = _mm256_add_pd(weight_sum4[edx], weight4);
+            value_sum4[edx] = _mm256_add_pd(value_sum4[edx], _mm256_mul_pd(weight4, value4));
+        }
+    }
+    
+    for (edx=0; edx<num_exponents; edx++){
+        weight_sum[edx] = sum_vector_avx2(weight_sum4[edx]);
+        value_sum[edx] = sum_vector_avx2(value_sum4[edx]);
+    }
+#else
+    kdx = 0;
+    
+    for (edx=0; edx<num_exponents; edx++){
+        weight_sum[edx] = 0;
+        value_sum[edx] = 0;
+    }
+#endif
+    
+    for (; kdx<length; kdx++){
+    
+        d = distances[kdx];
+        power = d;
+        power_exp = 1;
+        
+        for (edx=0; edx<num_exponents; edx++){
+        
+            for (; power_exp<exponents[edx]; power_exp++){
+                power *= d;
+            }
+            weight = 1.0/power;
+            weight_sum[edx] += weight;
+            value_sum[edx] += weight * station_values[kdx];
+        }
+    }
+    
+    for (edx=0; edx<num_exponents; edx++){
+        results[edx] = (isinf(weight_sum[edx])) ? idw_exact_hit(distances, station_values, length) : (value_sum[edx] / weight_sum[edx]);
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+#ifdef __AVX2__
+static inline double sum_vector_avx2(__m256d vector){
+
+    /*
+        DESCRIPTION:
+        Sum of the 4 elements of an AVX2 vector (horizontal addition).
+    */
+
+    __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(vector), _mm256_extractf128_pd(vector, 1));
+    
+    return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+}
+#endif
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double idw_exact_hit(const double *distances, const double *station_values, int length){
+
+    /*
+        DESCRIPTION:
+        Value of a raster point with an infinite weight (distance 0 to a station or an underflow of the
+        power of a very small distance): the weight of the nearest station(s) dominates all others, so the
+        raster point gets the average of the stations with the smallest distance.
+        
+        INPUT:
+        const double *distances		...	distances (km) of the raster point to all stations
+        const double *station_values	...	values of the stations
+        int length			...	number of stations
+        
+        OUTPUT:
+        value of the raster point
+    */
+
+    int kdx;
+    int hits = 0;
+    double nearest = INFINITY;
+    double value_sum = 0;
+    
+    for (kdx=0; kdx<length; kdx++){
+    
+        if (distances[kdx] < nearest){
+            nearest = distances[kdx];
+            value_sum = 0;
+            hits = 0;
+        }
+        if (distances[kdx] == nearest){
+            value_sum += station_values[kdx];
+            hits++;
+        }
+    }
+    
+    return value_sum / hits;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline bool row_is_finite(const double *values, int length){
+
+    /*
+        DESCRIPTION:
+        Status flag of a row of the raster: the kernels of the interpolation do not check their
+        results, a "NAN" or "INF" is passed on to the value of the raster point instead.
+        value - value is 0 for any finite value and "NAN" otherwise, so one comparison of the sum
+        per row is enough.
+        
+        INPUT:
+        const double *values	...	values of the row
+        int length		...	number of values
+        
+        OUTPUT:
+        true, if all values are finite
+    */
+
+    int idx;
+    double status = 0;
+    
+    for (idx=0; idx<length; idx++){
+        status += values[idx] - values[idx];
+    }
+    
+    return (status == 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double loo_squared_error(const double *distances, const double *log_distances, const double *values, int length, double _exp, int *count){
+
+    /*
+        DESCRIPTION:
+        Kernel of the leave-one-out cross validation (see tune_exponent): interpolates every station by
+        the other stations with the weights exp(-_exp * log(distance)) and sums up the squared errors.
+        A log distance of "INF" (the station itself, stations not used by local IDW) has the weight 0.
+        Stations without any other station are skipped.
+        With EXP_AVX2 the weights of 4 stations are calculated at once.
+        
+        INPUT:
+        const double *distances		...	distances (km) between the stations (length x length)
+        const double *log_distances	...	logarithms of the distances (length x length)
+        const double *values		...	values of the stations
+        int length			...	number of stations
+        double _exp			...	exponent of the distance
+        int *count			...	number of the interpolated stations
+        
+        OUTPUT:
+        sum of the squared errors
+    */
+
+    int idx, kdx;
+    double weight, weight_sum, value_sum, estimate;
+    double error = 0;
+    const double *log_row;
+    
+    *count = 0;
+    
+    for (idx=0; idx<length; idx++){
+    
+        log_row = &log_distances[(size_t)idx * length];
+        weight_sum = 0;
+        value_sum = 0;
+        kdx = 0;
+        
+#ifdef EXP_AVX2
+        __m256d weight4;
+        __m256d minus_exp4 = _mm256_set1_pd(-_exp);
+        __m256d weight_sum4 = _mm256_setzero_pd();
+        __m256d value_sum4 = _mm256_setzero_pd();
+        
+        for (; kdx+4<=length; kdx+=4){
+            weight4 = _ZGVdN4v_exp(_mm256_mul_pd(minus_exp4, _mm256_loadu_pd(&log_row[kdx])));
+            weight_sum4 = _mm256_add_pd(weight_sum4, weight4);
+            value_sum4 = _mm256_add_pd(value_sum4, _mm256_mul_pd(weight4, _mm256_loadu_pd(&values[kdx])));
+        }
+        weight_sum = sum_vector_avx2(weight_sum4);
+        value_sum = sum_vector_avx2(value_sum4);
+#endif
+        for (; kdx<length; kdx++){
+            weight = exp(-_exp * log_row[kdx]);
+            weight_sum += weight;
+            value_sum += weight * values[kdx];
+        }
+        
+        if (weight_sum == 0){
+            continue;
+        }
+        
+        // a station at the same location dominates (see idw_exact_hit):
+        estimate = (isinf(weight_sum)) ? idw_exact_hit(&distances[(size_t)idx * length], values, length) : (value_sum / weight_sum);
+        
+        error += (estimate - values[idx]) * (estimate - values[idx]);
+        (*count)++;
+    }
+    
+    return error;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int get_output_information(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION:
+        Calculates/determines additional information of the output raster. The raster points
+        without a value (NO_VALUE) are left out.
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object
+        
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+    
+    size_t idx;
+    int excno;
+    jmp_buf env;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        double sum=0;
+        double value;
+        size_t num_cells = (size_t)Map->rows * Map->cols;
+        size_t num_values = 0;
+    
+        // determine the maximum and minimum value of the raster (without the raster points of NO_VALUE):
+        Map->output_data.maximum = NO_VALUE;
+        Map->output_data.minimum = NO_VALUE; 
+        Map->output_data.average = NO_VALUE; 
+       
+        for (idx=0; idx<num_cells; idx++){
+        
+            value = Map->raster.value[idx];
+            
+            if (value == NO_VALUE){
+                continue;
+            }
+        
+            if ((num_values == 0) || (value > Map->output_data.maximum)){
+                Map->output_data.maximum = value;
+            }
+            
+            if ((num_values == 0) || (value < Map->output_data.minimum)){
+                Map->output_data.minimum = value;
+            }
+            
+            sum += value;
+            num_values++;
+        }
+    
+        if (num_values > 0){
+            Map->output_data.average = sum / (double)(num_values);
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }    
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int show_map_info(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION
+        Show information to the current interpolated raster.
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object
+        
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+
+    jmp_buf env;
+    int excno;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        if (Map->show_output){
+            printf("\n\n");
+            printf("############### INFORMATION ##############\n\n");
+            printf("   Geogr. latitude: %.3f (minimum)\n",Map->minLat);
+            printf("   Geogr. latitude: %.3f (maximum)\n",Map->maxLat);   
+            printf("   Geogr. longitude: %.3f (minimum)\n",Map->minLon);
+            printf("   Geogr. longitude: %.3f (maximum)\n\n",Map->maxLon);    
+            printf("\n");    
+            printf("   Number of raster points: %d\n", (Map->rows)*(Map->cols));
+            printf("   Rows: %d\n", Map->rows);
+            printf("   Columns: %d\n", Map->cols); 
+            printf("\n");    
+            printf("   Resolution (latitude): %.3f\n", Map->latRes);
+            printf("   Resolution (longitude): %.3f\n", Map->lonRes); 
+            printf("   Resolution (latitude, km): %.3f\n", Map->latMetRes);
+            printf("   Resolution (longitude, km): %.3f\n", Map->lonMetRes);  
+            printf("\n");    
+            printf("   --------------input data---------------\n\n");
+            printf("   Number of measured values: %d\n", Map->input_data.length);
+            printf("   Maximum: %.3f\n", Map->input_data.maximum);
+            printf("   Minimum: %.3f\n", Map->input_data.minimum);
+            printf("   Average: %.3f\n", Map->input_data.average);
+            printf("\n");
+            printf("   --------------output data--------------\n\n");
+            if (Map->barnes.passes > 0){
+                printf("   Barnes analysis: %d passes, smoothing length %.1f km, gamma %.2f\n", Map->barnes.passes, Map->barnes.smoothing_length, Map->barnes.gamma);
+            }
+            else{
+                printf("   Exponent of the distance: %.3f\n", Map->config._exp);
+            }
+            printf("   Maximum: %.3f\n", Map->output_data.maximum);
+            printf("   Minimum: %.3f\n", Map->output_data.minimum);
+            printf("   Average: %.3f\n", Map->output_data.average);
+            printf("\n");    
+            printf("##########################################\n\n");          
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }   
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int outputRasterCSV(struct usr_raster *raster, char *output_dir, char *filename, char decimal_separator, char field_separator, int max_threads, bool show_output){
+
+    /*
+    
+        DESCRIPTION:
+        This function outputs 3 csv-files.
+        1.	csv-file with the values of the raster in dimensions of rows x cols.
+        2.	csv-file with the latitude values of the values in dimensions of Map.rows x Map.cols.
+        3.	csv-file with the longitude values of thevalues in dimensions of Map.rows x Map.cols.
+        
+        The rows of the raster are split into "num_threads" blocks. Every thread renders the lines of
+        its rows into its own buffers (see output_raster_csv_worker). Afterwards the buffers are written
+        in the order of the rows, each with one call of fwrite.
+        
+        INPUT:
+        struct usr_raster *raster	...	pointer to the raster you want to output.
+        char *output_dir		...	directory you want to output the data
+        char *filename			...	filename of the csv-file (without extension)
+        char decimal_separator		...	decimal separator of the numbers (e.g. '.' or ',')
+        char field_separator		...	separator of the fields of a line (e.g. ';')
+        int max_threads			...	number of threads to render the lines
+        bool show_output		...	show output?
+        
+        OUTPUT:(error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+        
+    */
+
+
+
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int rows = raster->rows;
+        int cols = raster->cols;
+        int num_threads = (max_threads < rows) ? max_threads : rows;
+        int rows_per_thread;
+        char path[100];
+        struct usr_csv_buffer lon_line = {.text = NULL, .length = 0, .capacity = 0};
+        struct usr_csv_thread *threads;
+    
+        FILE *fp_values, *fp_lat, *fp_lon;
+    
+    
+        if ((rows<=0) || (cols<=0)){
+            longjmp(env, 1);        
+        }
+        
+        // the number separator and the field separator must differ:
+        if ((decimal_separator == field_separator) || (field_separator == '-') || ((field_separator >= '0') && (field_separator <= '9'))){
+            longjmp(env, 5);
+        }
+        
+        if (num_threads < 1){
+            num_threads = 1;
+        }
+        
+        // show output?
+        if (show_output){
+            printf("\nwriting csv files to:\n");
+            printf(">>> %s\n", output_dir);
+            
+            printf("writing ... ");
+            fflush(stdout);
+        }
+        
+        // the line of the longitudes is the same for all rows, so it is rendered only once:
+        for (jdx=0; jdx<cols; jdx++){
+        
+            if (csv_buffer_reserve(&lon_line, CSV_FIELD_MAX + 2) == EXIT_FAILURE){
+                free(lon_line.text);
+                longjmp(env, 3);
+            }
+            lon_line.length += format_fixed(&lon_line.text[lon_line.length], raster_lon(raster, jdx), CSV_COORD_DECIMALS, decimal_separator);
+            lon_line.text[lon_line.length++] = (jdx != (cols-1)) ? field_separator : '\n';
+        }
+        
+        threads = (struct usr_csv_thread *) calloc(num_threads, sizeof(struct usr_csv_thread));
+        if (threads == NULL){
+            free(lon_line.text);
+            longjmp(env, 3);
+        }
+        
+        // split the rows into blocks of about the same size:
+        rows_per_thread = (rows + num_threads - 1) / num_threads;
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].raster = raster;
+            threads[idx].first_row = (idx * rows_per_thread < rows) ? idx * rows_per_thread : rows;
+            threads[idx].last_row = ((idx+1) * rows_per_thread < rows) ? (idx+1) * rows_per_thread : rows;
+            threads[idx].decimal_separator = decimal_separator;
+            threads[idx].field_separator = field_separator;
+            threads[idx].lon_line = &lon_line;
+            threads[idx].err = EXIT_SUCCESS;
+        }
+        
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, output_raster_csv_worker, &threads[idx]) != 0){
+            
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
+                }
+                free_csv_threads(threads, num_threads);
+                free(lon_line.text);
+                longjmp(env, 4);
+            }
+        }
+        
+        output_raster_csv_worker(&threads[0]);
+        
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
+        }
+        free(lon_line.text);
+        
+        for (idx=0; idx<num_threads; idx++){
+            if (threads[idx].err == EXIT_FAILURE){
+                free_csv_threads(threads, num_threads);
+                longjmp(env, 3);
+            }
+        }
+    
+        // file pointer to the values csv file:
+        fp_values = fopen(strcat(strcat(strcpy(path, output_dir), filename), RASTER_CSV_EXT),"w");
+        if (fp_values == NULL){
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+        
+        // file pointer to the latitude csv file:
+        fp_lat = fopen(strcat(strcpy(path, output_dir), "lat.csv"),"w");
+        if (fp_lat == NULL){
+            fclose(fp_values);
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+    
+        // file pointer to the csv file for the longitude values:  
+        fp_lon = fopen(strcat(strcpy(path, output_dir), "lon.csv"),"w");
+        if (fp_lon == NULL){
+            fclose(fp_values);
+            fclose(fp_lat);
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+        
+        // write the buffers in the order of the rows:
+        excno = 0;
+        for (idx=0; idx<num_threads; idx++){
+        
+            if ((fwrite(threads[idx].values.text, 1, threads[idx].values.length, fp_values) != threads[idx].values.length) ||
+                (fwrite(threads[idx].lat.text, 1, threads[idx].lat.length, fp_lat) != threads[idx].lat.length) ||
+                (fwrite(threads[idx].lon.text, 1, threads[idx].lon.length, fp_lon) != threads[idx].lon.length)){
+                excno = 6;
+                break;
+            }
+        }
         
-            // give the raster point the name of the station
-            strcpy(Map->raster[min_row_idx][min_col_idx].name, Map->input_data.data[idx].name);
-            Map->raster[min_row_idx][min_col_idx].value = Map->input_data.data[idx].value;
+        free_csv_threads(threads, num_threads);
         
-            // give the input data the corresponding index values of the raster point
-            Map->input_data.data[idx].row_idx = min_row_idx;
-            Map->input_data.data[idx].col_idx = min_col_idx;
+        // close all files:
+        if ((fclose(fp_values) != 0) || (excno != 0)){
+            excno = 6;
+        }
+        if (fclose(fp_lat) != 0){
+            excno = 6;
+        }
+        if (fclose(fp_lon) != 0){
+            excno = 6;
+        }
+        if (excno != 0){
+            longjmp(env, excno);
         }
         
-        // output:
-        if (Map->show_output){
-            printf(" ok.\n");
+        if (show_output){
+            printf("ok\n");
         }
+        
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The filepointer returns an error!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n Failure when starting the csv threads!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n The decimal separator and the field separator of the csv files must differ (and must not be a digit or \"-\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n The csv files could not be written completely!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
@@ -533,89 +3255,63 @@ int fill_raster_with_input_data(struct usr_map *Map){
 // ##################################################################################################
 
 
-int interpolate_raster(struct usr_map *Map){
+void *output_raster_csv_worker(void *arg){
 
     /*
-    
         DESCRIPTION:
-        Calculates for any point of the raster who has no value an interpolated value.
+        Renders the lines of the rows first_row ... last_row-1 of the three csv files
+        (values, latitudes, longitudes) into the buffers of the thread.
+        The buffers grow as needed. On failure thread->err is set to EXIT_FAILURE.
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object.
-        
-        OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+        void *arg		...	pointer to an object of type "struct usr_csv_thread"
         
+        OUTPUT:
+        NULL
     */
-    
 
-    int idx, jdx, kdx, ldx;
-    int excno;
-    int value_cnt=0;
-    jmp_buf env;
+    struct usr_csv_thread *thread = (struct usr_csv_thread *)arg;
+    struct usr_raster *raster = thread->raster;
+    int cols = raster->cols;
+    int row, col;
+    int lat_length;
+    char lat_text[CSV_FIELD_MAX];
+    const double *values;
     
-    double weight_denom, weight_counter;
     
-    if ((excno = setjmp(env)) == 0){   
+    for (row=thread->first_row; row<thread->last_row; row++){
     
-        if (Map->show_output){
-            printf("\n");
-            printf("interpolating ...         ");
-            fflush(stdout);
+        // make sure, that the whole line fits into the buffers:
+        if ((csv_buffer_reserve(&(thread->values), (size_t)cols * (CSV_FIELD_MAX + 1) + 1) == EXIT_FAILURE) ||
+            (csv_buffer_reserve(&(thread->lat), (size_t)cols * (CSV_FIELD_MAX + 1) + 1) == EXIT_FAILURE) ||
+            (csv_buffer_reserve(&(thread->lon), thread->lon_line->length) == EXIT_FAILURE)){
+            thread->err = EXIT_FAILURE;
+            return NULL;
         }
-    
-        for (idx=0; idx<Map->rows; idx++){
-            for (jdx=0; jdx<Map->cols; jdx++){
-            
-                value_cnt++;
-            
-                if (Map->show_output){
-                    printf("\b\b\b\b\b\b\b\b\b");
-                    fflush(stdout);                   
-                    printf(" %5.1f %% ", ((value_cnt*1.0)/(Map->rows*Map->cols*1.0)*100.0));               
-                    fflush(stdout);
-                }             
-            
-            
-            
-                // interpolate if value of raster point is lower then 0:
-                if (Map->raster[idx][jdx].value < 0){
-                
-                    // set the value for that point to 0:
-                    Map->raster[idx][jdx].value = 0;
-                    
-                    // calculate the denominator of the weight:
-                    weight_denom = 0;                  
-                    for (kdx=0; kdx<Map->input_data.length; kdx++){
-                        weight_denom += 1/pow(calc_distance(Map->raster[idx][jdx].lat, Map->raster[idx][jdx].lon, 
-                                                            Map->input_data.data[kdx].lat, Map->input_data.data[kdx].lon), Map->config._exp);    
-                    }
-                    
-                    // over all input data points
-                    for (kdx=0; kdx<Map->input_data.length; kdx++){
-                    
-                        // distance to every point (counter)
-                        weight_counter = 1/pow(calc_distance(Map->raster[idx][jdx].lat, Map->raster[idx][jdx].lon, 
-                                                           Map->input_data.data[kdx].lat, Map->input_data.data[kdx].lon), Map->config._exp);
-                        
-                        Map->raster[idx][jdx].value += (weight_counter / weight_denom) * Map->input_data.data[kdx].value;
-                    }
-                }
-                else{
-                    continue;
-                }
-            }
+        
+        // the values:
+        values = &raster->value[(size_t)row * cols];
+        for (col=0; col<cols; col++){
+            thread->values.length += format_fixed(&thread->values.text[thread->values.length], values[col], CSV_VALUE_DECIMALS, thread->decimal_separator);
+            thread->values.text[thread->values.length++] = thread->field_separator;
         }
-        return EXIT_SUCCESS;
-    }
-    else{
-        // ##############################################################################################
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;                              
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        thread->values.text[thread->values.length-1] = '\n';
+        
+        // the latitude is the same for the whole row:
+        lat_length = format_fixed(lat_text, raster_lat(raster, row), CSV_COORD_DECIMALS, thread->decimal_separator);
+        lat_text[lat_length++] = thread->field_separator;
+        for (col=0; col<cols; col++){
+            memcpy(&thread->lat.text[thread->lat.length], lat_text, lat_length);
+            thread->lat.length += lat_length;
         }
-    } 
+        thread->lat.text[thread->lat.length-1] = '\n';
+        
+        // the longitudes are the same for all rows:
+        memcpy(&thread->lon.text[thread->lon.length], thread->lon_line->text, thread->lon_line->length);
+        thread->lon.length += thread->lon_line->length;
+    }
+    
+    return NULL;
 }
 
 
@@ -623,65 +3319,79 @@ int interpolate_raster(struct usr_map *Map){
 // ##################################################################################################
 
 
-int get_output_information(struct usr_map *Map){
+int format_fixed(char *text, double value, int decimals, char decimal_separator){
 
     /*
-    
         DESCRIPTION:
-        Calculates/determines additional information of the output raster.
+        Writes a number with a fixed number of decimals into the text, like printf("%.*f") would do,
+        but with the given decimal separator. The text is not terminated by '\0'.
+        The digits are created out of the rounded integer value*10^decimals. Values which are
+        (nearly) exactly between two possible results, are large or "NAN"/"INF" are formatted by
+        snprintf, so the result is the same as the one of printf (numbers, that do not fit into
+        CSV_FIELD_MAX characters, are written in exponential notation).
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object
-        
-        OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+        char *text			...	text of at least CSV_FIELD_MAX characters
+        double value			...	number to format
+        int decimals			...	number of decimals (0 ... CSV_MAX_DECIMALS)
+        char decimal_separator		...	decimal separator
         
+        OUTPUT:
+        number of characters written into the text
     */
+
+    static const double pow10[CSV_MAX_DECIMALS+1] = {1.0E0, 1.0E1, 1.0E2, 1.0E3, 1.0E4, 1.0E5, 1.0E6, 1.0E7, 1.0E8, 1.0E9};
+    char digits[24];
+    double scaled, fraction;
+    unsigned long long number;
+    int length = 0;
+    int num_digits = 0;
+    int idx;
     
-    int idx, jdx;
-    int excno;
-    jmp_buf env;
-    
-    if ((excno = setjmp(env)) == 0){
-    
-        double sum=0;
     
-        // determine the maximum and minimum value of the raster:
-        Map->output_data.maximum = Map->raster[0][0].value;
-        Map->output_data.minimum = Map->raster[0][0].value; 
-        Map->output_data.average = Map->raster[0][0].value; 
-       
-        for (idx=0; idx<Map->rows; idx++){
+    if ((decimals >= 0) && (decimals <= CSV_MAX_DECIMALS)){
     
-            for (jdx=0; jdx<Map->cols; jdx++){
+        scaled = fabs(value) * pow10[decimals];
+        fraction = scaled - floor(scaled);
         
-                if (Map->raster[idx][jdx].value > Map->output_data.maximum){
+        // not too large (precision of the fraction) and not (nearly) in the middle between two results:
+        if ((scaled < 1.0E9) && (fabs(fraction - 0.5) > 1.0E-6)){
+        
+            number = (unsigned long long)(scaled + 0.5);
             
-                    Map->output_data.maximum = Map->raster[idx][jdx].value;
-                }
+            if (signbit(value)){
+                text[length++] = '-';
+            }
             
-                if (Map->raster[idx][jdx].value < Map->output_data.minimum){
+            // digits in reverse order (at least one digit before the decimal separator):
+            do{
+                digits[num_digits++] = (char)('0' + (number % 10));
+                number /= 10;
+            }while ((number > 0) || (num_digits <= decimals));
             
-                    Map->output_data.minimum = Map->raster[idx][jdx].value;
-                
+            for (idx=num_digits-1; idx>=0; idx--){
+                text[length++] = digits[idx];
+                if ((idx == decimals) && (decimals > 0)){
+                    text[length++] = decimal_separator;
                 }
+            }
             
-                sum += Map->raster[idx][jdx].value;
-           }
-    
+            return length;
         }
+    }
     
-        Map->output_data.average = sum / (double)(Map->rows * Map->cols);
-        
-        return EXIT_SUCCESS;
+    // rare cases:
+    length = snprintf(text, CSV_FIELD_MAX, "%.*f", decimals, value);
+    if ((length < 0) || (length >= CSV_FIELD_MAX)){
+        length = snprintf(text, CSV_FIELD_MAX, "%.*e", decimals, value);
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+    for (idx=0; idx<length; idx++){
+        if (text[idx] == '.'){
+            text[idx] = decimal_separator;
         }
-    }    
+    }
+    
+    return length;
 }
 
 
@@ -689,66 +3399,60 @@ int get_output_information(struct usr_map *Map){
 // ##################################################################################################
 
 
-int show_map_info(struct usr_map *Map){
+int csv_buffer_reserve(struct usr_csv_buffer *buffer, size_t size){
 
     /*
-    
-        DESCRIPTION
-        Show information to the current interpolated raster.
+        DESCRIPTION:
+        Makes sure, that at least "size" further characters fit into the buffer.
+        The capacity of the buffer is at least doubled, if it has to grow.
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object
+        struct usr_csv_buffer *buffer	...	pointer to the buffer
+        size_t size			...	number of characters, which will be added
         
         OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
-        
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
     */
 
-    jmp_buf env;
-    int excno;
-    
-    if ((excno = setjmp(env)) == 0){
+    size_t capacity;
+    char *text;
     
-        if (Map->show_output){
-            printf("\n\n");
-            printf("############### INFORMATION ##############\n\n");
-            printf("   Geogr. latitude: %.3f (minimum)\n",Map->minLat);
-            printf("   Geogr. latitude: %.3f (maximum)\n",Map->maxLat);   
-            printf("   Geogr. longitude: %.3f (minimum)\n",Map->minLon);
-            printf("   Geogr. longitude: %.3f (maximum)\n\n",Map->maxLon);    
-            printf("\n");    
-            printf("   Number of raster points: %d\n", (Map->rows)*(Map->cols));
-            printf("   Rows: %d\n", Map->rows);
-            printf("   Columns: %d\n", Map->cols); 
-            printf("\n");    
-            printf("   Resolution (latitude): %.3f\n", Map->latRes);
-            printf("   Resolution (longitude): %.3f\n", Map->lonRes); 
-            printf("   Resolution (latitude, km): %.3f\n", Map->latMetRes);
-            printf("   Resolution (longitude, km): %.3f\n", Map->lonMetRes);  
-            printf("\n");    
-            printf("   --------------input data---------------\n\n");
-            printf("   Number of measured values: %d\n", Map->input_data.length);
-            printf("   Maximum: %.3f\n", Map->input_data.maximum);
-            printf("   Minimum: %.3f\n", Map->input_data.minimum);
-            printf("   Average: %.3f\n", Map->input_data.average);
-            printf("\n");
-            printf("   --------------output data--------------\n\n");
-            printf("   Maximum: %.3f\n", Map->output_data.maximum);
-            printf("   Minimum: %.3f\n", Map->output_data.minimum);
-            printf("   Average: %.3f\n", Map->output_data.average);
-            printf("\n");    
-            printf("##########################################\n\n");          
-        }
-        
+    if (buffer->length + size <= buffer->capacity){
         return EXIT_SUCCESS;
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        }
-    }   
+    
+    capacity = (buffer->capacity > 0) ? 2 * buffer->capacity : 4096;
+    while (capacity < buffer->length + size){
+        capacity *= 2;
+    }
+    
+    text = (char *) realloc(buffer->text, capacity);
+    if (text == NULL){
+        return EXIT_FAILURE;
+    }
+    
+    buffer->text = text;
+    buffer->capacity = capacity;
+    
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void free_csv_threads(struct usr_csv_thread *threads, int num_threads){
+
+    int idx;
+    
+    for (idx=0; idx<num_threads; idx++){
+        free(threads[idx].values.text);
+        free(threads[idx].lat.text);
+        free(threads[idx].lon.text);
+    }
+    free(threads);
 }
 
 
@@ -756,144 +3460,125 @@ int show_map_info(struct usr_map *Map){
 // ##################################################################################################
 
 
-int outputRasterCSV(struct usr_data_point **raster, char *output_dir, char *filename, int rows, int cols, bool show_output){
+int outputRasterBinary(struct usr_raster *raster, char *output_dir, char *filename, bool show_output){
 
     /*
     
         DESCRIPTION:
-        This function outputs 3 csv-files.
-        1.	csv-file with the values of the raster in dimensions of rows x cols.
-        2.	csv-file with the latitude values of the values in dimensions of Map.rows x Map.cols.
-        3.	csv-file with the longitude values of thevalues in dimensions of Map.rows x Map.cols.
+        This function outputs the raster into one binary file (extension RASTER_BIN_EXT).
+        The file starts with a header of RASTER_HEADER_SIZE bytes which describes the geometry
+        of the raster once, followed by the values of the raster (float32, row by row).
+        The latitude and longitude of every raster point can be calculated out of the header:
+        lat = maxLat - row * latRes, lon = minLon + col * lonRes
+        
+        Header (little endian, as written by x86/arm):
+        offset  0	char[4]		magic number RASTER_MAGIC
+        offset  4	uint32		version of the format (RASTER_VERSION)
+        offset  8	uint32		size of the header in bytes
+        offset 12	uint32		number of rows
+        offset 16	uint32		number of columns
+        offset 20	uint32		datatype of the values (1 => float32)
+        offset 24	float64		maxLat (latitude of the first row)
+        offset 32	float64		minLon (longitude of the first column)
+        offset 40	float64		latRes (resolution between two rows)
+        offset 48	float64		lonRes (resolution between two columns)
+        offset 56	float32		value of the raster points without a value (NO_VALUE)
+        offset 60	uint32		reserved (0)
         
         INPUT:
-        struct usr_data_point **raster	...	pointer to the matrix you want to output of type struct usr_data_point.
+        struct usr_raster *raster	...	pointer to the raster you want to output.
         char *output_dir		...	directory you want to output the data
-        char *filename			...	filename of the csv-file
-        int rows			...	number of rows of the raster
-        int cols			...	number of columns of the raster
+        char *filename			...	filename of the binary file (without extension)
+        bool show_output		...	show output?
+        
+        OUTPUT:(error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
         
     */
 
 
 
-    int idx, jdx, kdx;
+    int idx, jdx;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
     
-        char valueText[20], latText[20], lonText[20];
+        int rows = raster->rows;
+        int cols = raster->cols;
+        unsigned char header[RASTER_HEADER_SIZE];
+        uint32_t header_int[5] = {RASTER_VERSION, RASTER_HEADER_SIZE, raster->rows, raster->cols, 1};
+        uint32_t reserved = 0;
+        float no_value = (float)NO_VALUE;
+        float *row_values;
         char path[100];
     
-        FILE *fp_values, *fp_lat, *fp_lon;
+        FILE *fp_values;
     
     
         if ((rows<=0) || (cols<=0)){
             longjmp(env, 1);        
         }
     
-        // file pointer to the values csv file:
-        fp_values = fopen(strcat(strcpy(path, output_dir), filename),"w");
-        if (fp_values == NULL){
-            longjmp(env, 2);
-        }
-        
-        // file pointer to the latitude csv file:
-        fp_lat = fopen(strcat(strcpy(path, output_dir), "lat.csv"),"w");
-        if (fp_lat == NULL){
+        // buffer for one row of the raster:
+        row_values = (float *) malloc(cols * sizeof(float));
+        if (row_values == NULL){
             longjmp(env, 3);
         }
     
-        // file pointer to the csv file for the longitude values:  
-        fp_lon = fopen(strcat(strcpy(path, output_dir), "lon.csv"),"w");
-        if (fp_lon == NULL){
+        // file pointer to the binary file:
+        fp_values = fopen(strcat(strcat(strcpy(path, output_dir), filename), RASTER_BIN_EXT),"wb");
+        if (fp_values == NULL){
+            free(row_values);
             longjmp(env, 2);
         }
 
         // show output?
         if (show_output){
-            printf("\nwriting csv files to:\n");
-            printf(">>> %s\n", output_dir);
+            printf("\nwriting binary file to:\n");
+            printf(">>> %s\n", path);
             
             printf("writing ... ");
             fflush(stdout);
         }
-    
         
+        // the header:
+        memset(header, 0, RASTER_HEADER_SIZE);
+        memcpy(&header[0], RASTER_MAGIC, 4);
+        memcpy(&header[4], header_int, 5 * sizeof(uint32_t));
+        memcpy(&header[24], &(raster->maxLat), sizeof(double));
+        memcpy(&header[32], &(raster->minLon), sizeof(double));
+        memcpy(&header[40], &(raster->latRes), sizeof(double));
+        memcpy(&header[48], &(raster->lonRes), sizeof(double));
+        memcpy(&header[56], &no_value, sizeof(float));
+        memcpy(&header[60], &reserved, sizeof(uint32_t));
+        
+        if (fwrite(header, 1, RASTER_HEADER_SIZE, fp_values) != RASTER_HEADER_SIZE){
+            free(row_values);
+            fclose(fp_values);
+            longjmp(env, 4);
+        }
+        
+        // the values, row by row:
         for (idx=0; idx<rows; idx++){
+        
             for (jdx=0; jdx<cols; jdx++){
+                row_values[jdx] = (float)raster->value[(size_t)idx*cols + jdx];
+            }
             
-                // pass the value to a field of type char:
-                sprintf(valueText,"%.3f", raster[idx][jdx].value);
-                
-                // pass the latitude to a field of type char:
-                sprintf(latText, "%.4f", raster[idx][jdx].lat);
-                
-                // pass the longitude to a field of type char:
-                sprintf(lonText, "%.4f", raster[idx][jdx].lon);
-                
-                
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(valueText); kdx++){
-                
-                    if (valueText[kdx] == ','){
-                    
-                        valueText[kdx] = '.';
-                        break;
-                    }
-                
-                }
-                // write that value into the file
-                fprintf(fp_values,"%s",valueText);
-
-
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(latText); kdx++){
-                
-                    if (latText[kdx] == ','){
-                    
-                        latText[kdx] = '.';
-                        break;
-                    }
-                }
-                // write that latitude into the file               
-                fprintf(fp_lat,"%s",latText);
-
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(lonText); kdx++){
-                
-                    if (lonText[kdx] == ','){
-                    
-                        lonText[kdx] = '.';
-                        break;
-                    }
-                }
-                // write that longitude into the file                
-                fprintf(fp_lon,"%s",lonText);
-                
-                // add a semicolon to the line until ... 
-                if (jdx != (cols-1)){
-                
-                    fprintf(fp_values,"%s",";");
-                    fprintf(fp_lat,"%s",";");    
-                    fprintf(fp_lon,"%s",";");
-                    
-                }
-                else{
-                    // ... we finish that line, than add a newline sign:
-                    fprintf(fp_values, "%s", "\n");
-                    fprintf(fp_lat, "%s", "\n");    
-                    fprintf(fp_lon, "%s", "\n");                
-                
-                }
+            if (fwrite(row_values, sizeof(float), cols, fp_values) != (size_t)cols){
+                free(row_values);
+                fclose(fp_values);
+                longjmp(env, 4);
             }
         }
         
-        // close all files:
-        fclose(fp_values);
-        fclose(fp_lat);
-        fclose(fp_lon);
+        free(row_values);
+        
+        if (fclose(fp_values) != 0){
+            longjmp(env, 4);
+        }
         
         if (show_output){
             printf("ok\n");
@@ -906,6 +3591,7 @@ int outputRasterCSV(struct usr_data_point **raster, char *output_dir, char *file
             case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 2: fprintf(stderr, "ERROR: %s --> %d:\n The filepointer returns an error!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
             case 3: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The raster could not be written completely!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
@@ -968,11 +3654,15 @@ int show_input_data(struct usr_map *Map){
 // ##################################################################################################
 
 
-double calc_distance(double latA, double lonA, double latB, double lonB){
+static inline double calc_distance(double latA, double lonA, double latB, double lonB){
 
     /*
         DESCRIPTION:
         Calculates the distance between 2 point on a sphere with the radius of the earth at 51°N.
+        Kernel of the hot paths without any checks: the coordinates are checked once, when the
+        input dataset and the configuration are read (see input_csv_data, set_config).
+        The cosine of the angle is clamped to [-1, 1], so rounding can not produce "NAN"
+        (e.g. for two identical points).
         
         INPUT:
         double latA	...	latitude of point A in decimal degree.
@@ -981,41 +3671,33 @@ double calc_distance(double latA, double lonA, double latB, double lonB){
         double lonB	...	longitude of point B in decimal degree.
         
         OUTPUT:
-        on success	...	distance between the two points in km
-        on failure	...	NAN
+        distance between the two points in km
     */ 
     
-    jmp_buf env;
-    int excno;
-    
-    if ((excno = setjmp(env)) == 0){
-    
-    
-        if ((isnan(latA)) || (isnan(lonA)) || (isnan(latB)) || (isnan(lonB)) ||
-            (isinf(latA)) || (isinf(lonA)) || (isinf(latB)) || (isinf(lonB))){
-        
-            longjmp(env, 1);
-        }
-        
-        
-        // point A: 
-        double latA_rad = (latA/180.0) * M_PI;
-        double lonA_rad = (lonA/180.0) * M_PI;
+    // point A: 
+    double latA_rad = (latA/180.0) * M_PI;
+    double lonA_rad = (lonA/180.0) * M_PI;
 
-        // point B:
-        double latB_rad = (latB/180.0) * M_PI;
-        double lonB_rad = (lonB/180.0) * M_PI;
+    // point B:
+    double latB_rad = (latB/180.0) * M_PI;
+    double lonB_rad = (lonB/180.0) * M_PI;
 
-        return RADIUS_EARTH * acos( (sin(latA_rad) * sin(latB_rad) ) + ( cos(latA_rad) * cos(latB_rad) * ( cos(lonB_rad - lonA_rad) ) ) );
-    }
-    
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n>>> One of the coordinates is equal to \"NAN\" or \"INF\"\n", __FILE__, __LINE__); return NAN;                       
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n>>> %s\n", __FILE__, __LINE__, strerror(errno)); return NAN;               
-            default: fprintf(stderr, "\nERROR: %s --> %d:\nWoops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
-        }     
-    }
+    return RADIUS_EARTH * acos( clamp_unit( (sin(latA_rad) * sin(latB_rad) ) + ( cos(latA_rad) * cos(latB_rad) * ( cos(lonB_rad - lonA_rad) ) ) ) );
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double clamp_unit(double value){
+
+    /*
+        DESCRIPTION:
+        Clamps a value to [-1, 1] (argument of acos). "NAN" stays "NAN".
+    */
+
+    return (value > 1.0) ? 1.0 : ((value < -1.0) ? -1.0 : value);
 }
 
 
@@ -1029,15 +3711,23 @@ void free_raster(struct usr_map *Map){
     
     printf("\n");
     
-    // check if the raster exists
-    if (Map->raster != NULL){
-        for (idx=0; idx<(Map->rows); idx++){
+    // the rasters, the overlays, the tables of the distances and the station index are released at once with the arena:
+    if (Map->arena.blocks != NULL){
     
-            free(Map->raster[idx]);
+        if (Map->show_output){
+            show_arena_info(&(Map->arena));
+        }
+        free_arena(&(Map->arena));
+        
+        Map->raster.value = NULL;
+        Map->raster.stations = NULL;
+        for (idx=0; idx<IDW_MAX_EXPONENTS-1; idx++){
+            Map->exp_rasters[idx].value = NULL;
+            Map->exp_rasters[idx].stations = NULL;
         }
+        
         if (Map->show_output){
-            free(Map->raster);
-            printf("%-40s %s\n","raster:","deallocate memory successful!");
+            printf("%-40s %s\n","memory arena:","deallocate memory successful!");
         }
     }
 }
@@ -1060,6 +3750,3 @@ void free_vector(struct usr_map *Map){
         }
     }    
 }
-
-
-
@@ -1,4 +1,153 @@
 
+#define IDW_MAX_EXPONENTS 8					// maximum number of exponents of the distance in one pass (see "-e")
+
+
+struct usr_arena_block{
+
+    struct usr_arena_block *next;	// zuvor angelegter Block der Arena
+    size_t size;			// Größe des Blocks (Bytes, ohne Kopf)
+    size_t used;			// bereits vergebene Bytes des Blocks
+    unsigned char *data;		// Beginn der Daten (ARENA_ALIGN Bytes ausgerichtet)
+
+};
+
+struct usr_arena{
+
+    struct usr_arena_block *blocks;	// zuletzt angelegter Block (Anfang der Liste)
+    size_t block_size;			// Mindestgröße eines Blocks (Bytes)
+    size_t in_use;			// vergebene Bytes
+    size_t peak;			// Höchststand der vergebenen Bytes
+    size_t reserved;			// Bytes aller Blöcke
+    int num_blocks;			// Anzahl der Blöcke
+    long num_allocations;		// Anzahl der Anforderungen
+
+};
+
+struct usr_arena_mark{
+
+    struct usr_arena_block *block;	// Block, der zum Zeitpunkt der Marke der aktuelle war
+    size_t used;			// vergebene Bytes dieses Blocks
+    size_t in_use;			// vergebene Bytes der Arena
+
+};
+
+struct usr_raster_station{
+
+    int row_idx;			// Zeile des Rasterpunktes
+    int col_idx;			// Spalte des Rasterpunktes
+    int station_idx;			// Index der Station im Eingabedatensatz
+
+};
+
+struct usr_raster{
+
+    unsigned int rows;			// Anzahl der Zeilen
+    unsigned int cols;			// Anzahl der Spalten
+    double maxLat;			// geogr. Breite der ersten Zeile
+    double minLon;			// geogr. Länge der ersten Spalte
+    double latRes;			// Auflösung (Dezimalgrad) zwischen zwei Zeilen
+    double lonRes;			// Auflösung (Dezimalgrad) zwischen zwei Spalten
+    double *value;			// Werte der Rasterpunkte (zeilenweise, zusammenhängend, aus der Arena, ARENA_ALIGN Bytes ausgerichtet)
+    int num_stations;			// Anzahl der zugeordneten Stationen
+    struct usr_raster_station *stations;	// zugeordnete Stationen (überlagern die interpolierten Werte)
+
+};
+
+struct usr_csv_buffer{
+
+    char *text;				// Text (ohne abschließendes '\0')
+    size_t length;			// Anzahl der Zeichen im Text
+    size_t capacity;			// Größe des reservierten Speichers
+
+};
+
+struct usr_csv_thread{
+
+    struct usr_raster *raster;		// Zeiger auf das auszugebende Raster
+    pthread_t thread;			// Thread-Handle
+    int first_row;			// erste Zeile des Rasters dieses Threads
+    int last_row;			// erste Zeile nach dem Bereich dieses Threads
+    char decimal_separator;		// Dezimaltrennzeichen
+    char field_separator;		// Trennzeichen der Felder einer Zeile
+    struct usr_csv_buffer *lon_line;	// Zeile der Längengrade (für alle Zeilen gleich)
+    struct usr_csv_buffer values;	// Zeilen der Werte dieses Threads
+    struct usr_csv_buffer lat;		// Zeilen der Breitengrade dieses Threads
+    struct usr_csv_buffer lon;		// Zeilen der Längengrade dieses Threads
+    int err;				// EXIT_FAILURE, falls der Speicher nicht reserviert werden konnte
+
+};
+
+struct usr_grid_distance{
+
+    int rows;				// Anzahl der Zeilen des Rasters
+    int cols;				// Anzahl der Spalten des Rasters
+    int num_stations;			// Anzahl der Stationen
+    double *row_sin;			// sin(geogr. Breite) jeder Zeile des Rasters
+    double *row_cos;			// cos(geogr. Breite) jeder Zeile des Rasters
+    double *station_sin;		// sin(geogr. Breite) jeder Station
+    double *station_cos;		// cos(geogr. Breite) jeder Station
+    double *col_cos_dlon;		// cos(Längendifferenz) zwischen Spalte und Station (cols x num_stations)
+
+};
+
+struct usr_station_index{
+
+    int rows;				// Anzahl der Zeilen des Index-Gitters
+    int cols;				// Anzahl der Spalten des Index-Gitters
+    double minLat;			// geogr. Breite der unteren Kante des Index-Gitters
+    double minLon;			// geogr. Länge der linken Kante des Index-Gitters
+    double cellLat;			// Ausdehnung einer Zelle (Dezimalgrad, Breite)
+    double cellLon;			// Ausdehnung einer Zelle (Dezimalgrad, Länge)
+    double maxAbsLat;			// größter Betrag der geogr. Breite der Stationen
+    int *cell_start;			// erster Eintrag jeder Zelle in "stations" (rows x cols + 1)
+    int *stations;			// Indizes der Stationen, nach Zellen sortiert
+    double *unit_vectors;		// Einheitsvektoren (x, y, z) der Stationen (3 x Anzahl der Stationen)
+
+};
+
+struct usr_neighbourhood{
+
+    int max_neighbours;			// maximale Anzahl der Stationen (Größe der Puffer)
+    int num_neighbours;			// Anzahl der gefundenen Stationen
+    int *station_idx;			// Indizes der nächsten Stationen
+    double *distances;			// Distanzen (km) zu den nächsten Stationen
+    double *values;			// Werte der nächsten Stationen
+
+};
+
+struct usr_thread_pool{
+
+    atomic_int next_row;		// erste Zeile des Rasters, die noch keinem Thread zugeteilt wurde
+    atomic_long cells_done;		// Anzahl der bereits bearbeiteten Rasterpunkte (Fortschritt)
+    atomic_int last_permille;		// zuletzt ausgegebener Fortschritt in Promille
+    atomic_int abort;			// wird von einem Thread gesetzt, sobald ein Fehler auftritt
+
+};
+
+struct usr_interpol_thread{
+
+    struct usr_map *Map;		// Zeiger auf das Kartenobjekt
+    struct usr_thread_pool *pool;	// Zeiger auf den gemeinsamen Zustand aller Threads
+    pthread_t thread;			// Thread-Handle
+    double (*idw_point)(const double *, const double *, int, double);	// Kernel des Exponenten der Distanz
+    const double *station_values;	// Werte der Stationen (gemeinsam für alle Threads)
+    double *distances;			// eigener Vektor der Distanzen des Threads
+    struct usr_neighbourhood neighbourhood;	// nächste Stationen des aktuellen Rasterpunktes (lokale IDW)
+    struct usr_neighbourhood candidates;	// Kandidaten der nächsten Stationen eines Abschnitts der Zeile (lokale IDW)
+    struct usr_neighbourhood quadrants[4];	// nächste Stationen je Quadrant des aktuellen Rasterpunktes (lokale IDW)
+    int excno;				// Fehlernummer des Threads (0 => kein Fehler)
+    int failed_row;			// Zeile des Rasters, in der der Fehler aufgetreten ist
+
+};
+
+struct usr_barnes{
+
+    double smoothing_length;		// Glättungslänge (km) des ersten Durchlaufs (Standardabweichung der Gauß-Gewichte, 0 => aus dem mittleren Stationsabstand)
+    double gamma;			// Faktor der Glättung (kappa) der Korrekturdurchläufe (0 < gamma <= 1)
+    int passes;				// Anzahl der Durchläufe (erster Durchlauf + Korrekturdurchläufe)
+
+};
+
 struct usr_dataset{
 
     int length;
@@ -30,7 +179,14 @@ struct usr_config{
     char input_dir[100];
     char input_datafile[100];
     char output_datafile[100];
-    unsigned char _exp;
+    char csv_decimal_separator;		// Dezimaltrennzeichen der csv-Dateien
+    char csv_field_separator;		// Trennzeichen der Felder der csv-Dateien
+    double _exp;			// Exponent der Distanz
+    double tune_exp_min;		// kleinster Exponent der Kreuzvalidierung (siehe "-a")
+    double tune_exp_max;		// größter Exponent der Kreuzvalidierung
+    double tune_exp_step;		// Schrittweite der Exponenten der Kreuzvalidierung
+    int exponents[IDW_MAX_EXPONENTS];	// Exponenten der Distanz (aufsteigend), ein Raster je Exponent
+    int num_exponents;			// Anzahl der Exponenten (1 => nur "_exp")
 
 };
 
@@ -61,9 +217,27 @@ struct usr_map{
     // show output during calculations on console:
     bool show_output;
     
+    // Ausgabe der Raster als csv-Dateien (Werte, Breiten- und Längengrade) anstatt einer Binärdatei?
+    bool output_csv;
+    
+    // Exponent der Distanz durch Kreuzvalidierung (leave-one-out) an den Stationen bestimmen?
+    bool tune_exponent;
+    
+    // Anzahl der Threads (0 => Anzahl der verfügbaren Prozessoren):
+    unsigned int num_threads;
+    
+    // Lokale IDW: Anzahl der nächsten Stationen je Rasterpunkt (0 => alle), Suchradius in km (0 => unbegrenzt)
+    // und Mindestanzahl der Stationen je Quadrant (0 => keine):
+    int num_neighbours;
+    double search_radius;
+    int quadrant_min;
+    
     // Konfiguration:
     struct usr_config config;
     
+    // Arena, aus der die Puffer für die Dauer eines Laufs reserviert werden (freigegeben in free_raster):
+    struct usr_arena arena;
+    
     // Eingabe-Daten:
     struct usr_dataset input_data;
     
@@ -71,6 +245,18 @@ struct usr_map{
     struct usr_dataset output_data;
     
     // Eingabe-Raster:
-    struct usr_data_point **raster;
+    struct usr_raster raster;
+    
+    // Raster der weiteren Exponenten (IDW mit mehreren Exponenten in einem Durchlauf, siehe exponent_raster):
+    struct usr_raster exp_rasters[IDW_MAX_EXPONENTS-1];
+    
+    // Tabellen zur Berechnung der Distanzen zwischen Rasterpunkten und Stationen:
+    struct usr_grid_distance grid_distance;
+    
+    // Räumlicher Index der Stationen (lokale IDW):
+    struct usr_station_index station_index;
+    
+    // Barnes-Analyse (siehe barnes.c):
+    struct usr_barnes barnes;
  
 };
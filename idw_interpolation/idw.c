@@ -5,6 +5,8 @@
     #include <math.h>
     #include <string.h>
     #include <stdbool.h>
+    #include <pthread.h>
+    #include <stdatomic.h>
     #include "./headerfiles/idw_structs.h"
     #include "./headerfiles/idw.h"
 #endif
@@ -25,6 +27,22 @@ Basically this function performs an "inverse distance weighted" interpolation.
 
 -o	...	This function shows no output during its calculations.
 		You can enable an extensive output by using this parameter
+-csv	...	the raster is written to csv files (values, "lat.csv" and "lon.csv")
+		instead of one binary file (header with the geometry + float32 values).
+-t <n>	...	number of threads used to interpolate the raster and to write the csv files.
+		By default all available processors are used.
+-k <n>	...	local IDW: every raster point is interpolated by its n nearest stations.
+-r <km>	...	local IDW: only stations within this search radius are used.
+-q <n>	...	local IDW (with -k): the n nearest stations of every quadrant are added
+		to the nearest stations (as far as there are any within the search radius).
+-a	...	the exponent of the distance is determined by a leave-one-out cross validation
+		at the stations (exponents tune_exp_min ... tune_exp_max, smallest RMSE).
+-e <list>	...	IDW with several integer exponents of the distance in one pass (e.g. -e 1,2,3,4).
+		The distances are shared by all exponents, every exponent gets its own
+		raster "interpolRaster_exp<exponent>". The information (-o) refers to the smallest exponent.
+		
+Compile with:	gcc idw.c -o idw -lm -lpthread
+		(gcc -O2 -mavx2 idw.c -o idw -lm -lpthread calculates the distances and weights of 4 stations at once)
 		
 ###########################################################################################*/
 
@@ -36,6 +54,7 @@ int main(int argc, char **argv){
 
     int idx;
     int err;
+    char output_datafile[120];
     
     // ####################################################################################
     // ############ declaration and initializing of object "Map" ############################
@@ -51,17 +70,32 @@ int main(int argc, char **argv){
         .latMetRes = 0,						// resolution between two points (geogr. latitude)
         .lonMetRes = 0,						// resolution between two points (geogr. longitude)
         .show_output = false,					// show output during calculations
+        .tune_exponent = false,					// exponent of the distance by a leave-one-out cross validation
+        .output_csv = false,					// output csv files instead of one binary file
+        .num_threads = 0,					// number of threads (0 => all available processors)
+        .num_neighbours = 0,					// local IDW: number of nearest stations (0 => all stations)
+        .search_radius = 0,					// local IDW: search radius in km (0 => unlimited)
+        .quadrant_min = 0,					// local IDW: minimum number of stations per quadrant (0 => none)
         .rows = 900,						// 900 => resolution of 1 km in horizontal direction
         .cols = 0,						// will be subsequently calculated 						
         .config = {
             .output_dir = {"./output/"},			// output directory 
-            .output_datafile = {"interpolRaster.csv"}, 		// outputfile without correction
+            .output_datafile = {"interpolRaster"}, 		// outputfile (without extension)
+            .csv_decimal_separator = '.',			// decimal separator of the csv files
+            .csv_field_separator = ';',				// field separator of the csv files
             .input_dir = {"./input/"},				// input directory 			
             .input_datafile = {"tagessummen_452.csv"},		// dataset of the sums of daily precipiation
             ._exp = 2,						// exponent of the distance
+            .tune_exp_min = 0.5,				// smallest exponent of the cross validation (-a)
+            .tune_exp_max = 6.0,				// greatest exponent of the cross validation (-a)
+            .tune_exp_step = 0.25,				// step between the exponents of the cross validation (-a)
+            .num_exponents = 0,					// number of exponents (0 => only "_exp", see "-e")
         },
+        .arena = {.blocks = NULL, .block_size = ARENA_BLOCK_SIZE},	// buffers of the run (released at once in free_raster)
         .input_data.data = NULL,
-        .raster = NULL,
+        .raster = {.value = NULL, .stations = NULL},
+        .grid_distance = {.row_sin = NULL, .row_cos = NULL, .station_sin = NULL, .station_cos = NULL, .col_cos_dlon = NULL},
+        .station_index = {.cell_start = NULL, .stations = NULL, .unit_vectors = NULL},
         };
     
     
@@ -78,16 +112,26 @@ int main(int argc, char **argv){
     
     
     // initialize the raster of the map:
-    err = create_maps_raster(&(Map.raster), Map.rows, Map.cols);
+    err = create_maps_raster(&(Map.arena), &(Map.raster), Map.rows, Map.cols);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
         exit(err);
     }) : NULL;
-
-    // fill the raster points with information:
-    // - coordinates
-    // - index
+    
+    // initialize the rasters of the further exponents (-e):
+    for (idx=1; idx<Map.config.num_exponents; idx++){
+        err = create_maps_raster(&(Map.arena), exponent_raster(&Map, idx), Map.rows, Map.cols);
+        (err == EXIT_FAILURE) ? ({
+            free_raster(&Map);
+            free_vector(&Map);
+            exit(err);
+        }) : NULL;
+    }
+
+    // fill the raster with information:
+    // - geometry (coordinates of the raster points)
+    // - default values
     err = fill_raster_with_default_data(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
@@ -120,6 +164,14 @@ int main(int argc, char **argv){
         exit(err);
     }) : NULL;    
 
+    // determine the exponent of the distance by a cross validation at the stations (-a):
+    err = (Map.tune_exponent) ? tune_exponent(&Map) : EXIT_SUCCESS;
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+
     // Interpoliere nun das Raster:
     err = interpolate_raster(&Map);
     (err == EXIT_FAILURE) ? ({
@@ -145,8 +197,25 @@ int main(int argc, char **argv){
     }) : NULL;
     
        
-    // tnow output the value, latitude and longitude raster to csv files:
-    outputRasterCSV(Map.raster, Map.config.output_dir, Map.config.output_datafile, Map.rows, Map.cols, Map.show_output);
+    // now output the raster (binary file or value, latitude and longitude csv files),
+    // with several exponents one raster per exponent ("<output_datafile>_exp<exponent>"):
+    for (idx=0; idx<Map.config.num_exponents; idx++){
+    
+        if (Map.config.num_exponents > 1){
+            snprintf(output_datafile, sizeof(output_datafile), "%s_exp%d", Map.config.output_datafile, Map.config.exponents[idx]);
+        }
+        else{
+            snprintf(output_datafile, sizeof(output_datafile), "%s", Map.config.output_datafile);
+        }
+        
+        err = (Map.output_csv) ? outputRasterCSV(exponent_raster(&Map, idx), Map.config.output_dir, output_datafile, Map.config.csv_decimal_separator, Map.config.csv_field_separator, Map.num_threads, Map.show_output)
+                               : outputRasterBinary(exponent_raster(&Map, idx), Map.config.output_dir, output_datafile, Map.show_output);
+        (err == EXIT_FAILURE) ? ({
+            free_raster(&Map);
+            free_vector(&Map);
+            exit(err);
+        }) : NULL;
+    }
     
     
     // clean up:
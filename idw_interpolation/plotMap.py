@@ -19,9 +19,7 @@ image_config = {
     "input_dir": f"{os.getcwd()}/output/",				# 
     "output_dir": f"{os.getcwd()}/output/",				# 
     "tmp_dir": f"{os.getcwd()}/tmp/",					# Verzeichnis für Zwischenergebnisse
-    "latitude_raster_file": "lat.csv",					# Datei mit den Breitengraden des Rasters
-    "longitude_raster_file": "lon.csv",					# Datei mit den Längengraden des Rasters
-    "value_raster_file": "interpolRaster.csv",				# Datei mit den interpolierten Rasterwerten
+    "value_raster_file": "interpolRaster.bin",				# Binärdatei mit den interpolierten Rasterwerten (Kopf mit der Geometrie + float32)
     "input_csv_data_dir": f"{os.getcwd()}/input/",			# directory of input file
     "input_csv_data_file": f"tagessummen_452.csv",				# filename of input file 
     "germany_shapefile": f"{os.getcwd()}/ger_shapefile/germany.shp",	# Shapefile zum erstellen der Maske
@@ -39,6 +37,22 @@ image_config = {
 
 
 
+# Kopf der Binärdatei des Rasters (siehe outputRasterBinary):
+raster_header_dtype = np.dtype([("magic", "S4"),					# "RSTR"
+                                ("version", "<u4"),					# Version des Formats
+                                ("header_size", "<u4"),				# Größe des Kopfes in Bytes
+                                ("rows", "<u4"),					# Anzahl der Zeilen
+                                ("cols", "<u4"),					# Anzahl der Spalten
+                                ("dtype", "<u4"),					# Datentyp der Werte (1 => float32)
+                                ("maxLat", "<f8"),					# geogr. Breite der ersten Zeile
+                                ("minLon", "<f8"),					# geogr. Länge der ersten Spalte
+                                ("latRes", "<f8"),					# Auflösung zwischen zwei Zeilen
+                                ("lonRes", "<f8"),					# Auflösung zwischen zwei Spalten
+                                ("no_value", "<f4"),					# Wert der Rasterpunkte ohne Wert
+                                ("reserved", "<u4")])
+
+
+
 class InterpolMap():
 
 
@@ -50,8 +64,6 @@ class InterpolMap():
         self.input_dir = image_config.get("input_dir")
         self.output_dir = image_config.get("output_dir")
         self.tmp_dir = image_config.get("tmp_dir")
-        self.latitude_raster_file = image_config.get("latitude_raster_file")
-        self.longitude_raster_file = image_config.get("longitude_raster_file")
         self.value_raster_file = image_config.get("value_raster_file")
         self.input_csv_data_dir = image_config.get("input_csv_data_dir")
         self.input_csv_data_file = image_config.get("input_csv_data_file")
@@ -81,8 +93,6 @@ class InterpolMap():
             print("input_directory: %61s" % (self.input_dir))
             print("output_directory: %60s" % (self.output_dir))
             print("temp_directory: %59s" % (self.tmp_dir))            
-            print("latitude raster file: %15s" % (self.latitude_raster_file))
-            print("longitude raster file: %14s" % (self.longitude_raster_file))
             print("values raster file: %28s" % (self.value_raster_file))
             print("germany shapefile: %77s" % (self.germany_shapefile))           
             print("=================================================================================================")        
@@ -118,37 +128,33 @@ class InterpolMap():
     def read_rasters(self):
 
         """
-            Ließt die 3 Raster mit Längenkoordinaten (X) und Breitenkoordinaten (Y) und den interpolierten Werten.
+            Ließt die Binärdatei mit den interpolierten Werten und erstellt aus der Geometrie im Dateikopf
+            die Raster mit Längenkoordinaten (X) und Breitenkoordinaten (Y).
         """
 
         try:
         
-            # Lese die lat und lon csv-Dateien im Inputordner und erstelle 2 Raster X (Länge) und Y (Breite)
-            # Existenz des Rasters mit den geogr. Breitengraden prüfen:
-            if (self.latitude_raster_file in os.listdir(self.input_dir)):
+            # Existenz der Binärdatei prüfen:
+            if (self.value_raster_file in os.listdir(self.input_dir)):
+            
+                # Einlesen des Dateikopfes (64 Bytes, little endian):
+                header = np.fromfile(os.path.join(self.input_dir,self.value_raster_file), dtype=raster_header_dtype, count=1)[0]
                 
-                # Existenz des Rasters mit den geogr. Längengraden prüfen:
-                if (self.longitude_raster_file in os.listdir(self.input_dir)):
+                if (header["magic"] != b"RSTR") or (header["dtype"] != 1):
+                    raise Exception("Fehler!",f"{self.value_raster_file} ist keine gültige Rasterdatei.")
                 
-                    # Einlesen der drei Raster:
-                    # --------------------------------------
-                    
-                    # Einlesen Breitengrade
-                    self.lat_raster = pd.read_csv(os.path.join(self.input_dir,self.latitude_raster_file), sep=";", header=None, dtype=np.float64 , decimal=".").values
-                    
-                    # Einlesen Längengrade
-                    self.lon_raster = pd.read_csv(os.path.join(self.input_dir,self.longitude_raster_file), sep=";", header=None, dtype=np.float64 , decimal=".").values
-
-                    # Einlesen interpolierte Werte
-                    self.value_raster = pd.read_csv(os.path.join(self.input_dir,self.value_raster_file), sep=";", header=None, dtype=np.float64 , decimal=".").values                    
-                  
-                    return {"success": True}
+                # Einlesen interpolierte Werte
+                self.value_raster = np.fromfile(os.path.join(self.input_dir,self.value_raster_file), dtype="<f4", offset=int(header["header_size"])).reshape(int(header["rows"]), int(header["cols"])).astype(np.float64)
+                
+                # Breiten- und Längengrade aus der Geometrie des Rasters:
+                lat = header["maxLat"] - np.arange(header["rows"]) * header["latRes"]
+                lon = header["minLon"] + np.arange(header["cols"]) * header["lonRes"]
+                self.lon_raster, self.lat_raster = np.meshgrid(lon, lat)
+              
+                return {"success": True}
 
-                else:
-                    Exception("Fehler!",f"{self.latitude_raster_file} nicht vorhanden.")
-            
             else:
-                raise Exception("Fehler!",f"{self.longitude_raster_file} nicht vorhanden.")
+                raise Exception("Fehler!",f"{self.value_raster_file} nicht vorhanden.")
     
         except Exception as e:
             return {"success": False, "err": e, "msg": traceback.format_exc()}
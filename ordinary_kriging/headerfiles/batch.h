@@ -0,0 +1,406 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <stdbool.h>
+    #include <setjmp.h>
+    #include <errno.h>
+#endif
+
+#define BATCH_FIELD_NAME "_field"				// the rasters of the batch are written to "<output file>_field<number>"
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int set_batch_config(struct usr_map *Map, int argc, char **argv);
+int get_field_models(struct usr_map *Map);
+int interpolate_fields(struct usr_map *Map);
+bool same_field_model(struct usr_field_model *a, struct usr_field_model *b);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int set_batch_config(struct usr_map *Map, int argc, char **argv){
+
+    /*
+        DESCRIPTION:
+        Reads the arguments of the batch (see kriging.c). The general arguments are handled by set_config.
+        The batch interpolates every value column (field) of the input file, e.g. the hourly sums of a day,
+        on the same stations:
+        -b	...	all fields share the variogram of the first field
+        -bv	...	every field gets its own variogram
+        The batch interpolates the whole raster by all stations: local kriging ("-k", "-r") and the
+        kriging variance ("-v") can not be combined with it.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the "map" object of datatype "struct usr_map".
+
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        for (idx=0; idx<argc; idx++){
+
+            // all fields with the variogram of the first field:
+            if (!strcmp(argv[idx],"-b")){
+                Map->batch.enabled = true;
+            }
+
+            // every field with its own variogram:
+            if (!strcmp(argv[idx],"-bv")){
+                Map->batch.enabled = true;
+                Map->batch.field_variograms = true;
+            }
+        }
+
+        if ((Map->batch.enabled) && (is_local_kriging(Map))){
+            longjmp(env, 1);
+        }
+        if ((Map->batch.enabled) && (Map->kriging_variance)){
+            longjmp(env, 2);
+        }
+
+        // the given model, every variogram of a field is fitted with it:
+        Map->batch.model = Map->variogram.model;
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The batch (\"-b\", \"-bv\") can not be combined with local kriging (\"-k\", \"-r\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The batch (\"-b\", \"-bv\") can not be combined with the kriging variance (\"-v\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int get_field_models(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Determines the covariance model of every field of the batch ("Map->batch.models").
+        With "-bv" the variogram of every field is created and fitted (see create_variogram and
+        get_variogram_model), the distance matrix is the same for all fields. Otherwise every field
+        takes the model of the first field, that is already fitted.
+        Afterwards the values of the stations ("value") are the ones of the first field again.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx, field;
+    int excno;
+    volatile int failed_field = 0;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int num_fields = Map->input_data.num_fields;
+        struct usr_field_model model = {.model = Map->variogram.model,
+                                        .nugget = Map->variogram.nugget,
+                                        .sill = Map->variogram.sill,
+                                        .range = Map->variogram.range,
+                                        .wrss = Map->variogram.wrss};
+
+        Map->batch.models = (struct usr_field_model *) arena_alloc(&(Map->arena), num_fields * sizeof(struct usr_field_model));
+        if (Map->batch.models == NULL){
+            longjmp(env, 1);
+        }
+
+        for (field=0; field<num_fields; field++){
+
+            if ((Map->batch.field_variograms) && (field > 0)){
+
+                for (idx=0; idx<Map->input_data.length; idx++){
+                    Map->input_data.data[idx].value = Map->input_data.fields[(size_t)idx * num_fields + field];
+                }
+
+                if (Map->show_output){
+                    printf("\nfield %d:\n", field + 1);
+                }
+
+                // the variogram of the field, the model is fitted once more (e.g. VARIO_MODEL_AUTO):
+                Map->variogram.model = Map->batch.model;
+                Map->variogram.model_adjust_index = 0;
+                if ((create_variogram(Map) == EXIT_FAILURE) || (get_variogram_model(Map) == EXIT_FAILURE)){
+                    failed_field = field;
+                    longjmp(env, 2);
+                }
+
+                model.model = Map->variogram.model;
+                model.nugget = Map->variogram.nugget;
+                model.sill = Map->variogram.sill;
+                model.range = Map->variogram.range;
+                model.wrss = Map->variogram.wrss;
+            }
+            Map->batch.models[field] = model;
+        }
+
+        // the values of the first field:
+        for (idx=0; idx<Map->input_data.length; idx++){
+            Map->input_data.data[idx].value = Map->input_data.fields[(size_t)idx * num_fields];
+        }
+
+        if (Map->show_output){
+
+            printf("\n%-8s%-14s%12s%12s%12s%12s\n", "field", "model", "nugget", "sill", "range", "WRSS");
+            printf("----------------------------------------------------------------------\n");
+            for (field=0; field<num_fields; field++){
+                printf("%-8d%-14s%12.3f%12.3f%12.3f%12.3f\n", field + 1,
+                                                               variogram_model_name(Map->batch.models[field].model),
+                                                               Map->batch.models[field].nugget,
+                                                               Map->batch.models[field].sill,
+                                                               Map->batch.models[field].range,
+                                                               Map->batch.models[field].wrss);
+            }
+            printf("----------------------------------------------------------------------\n\n");
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> The variogram of field %d could not be fitted!\n", __FILE__, __LINE__, failed_field + 1); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+bool same_field_model(struct usr_field_model *a, struct usr_field_model *b){
+
+    /*
+        DESCRIPTION:
+        Returns true, if both fields have the same covariance model (so the same covariance matrix).
+    */
+
+    return ((a->model == b->model) && (a->nugget == b->nugget) && (a->sill == b->sill) && (a->range == b->range));
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int interpolate_fields(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Batch: interpolates every field of the input dataset and writes its raster to
+        "<output file>_field<number>" (see set_batch_config). The covariance matrix of the first field is
+        already decomposed (see factorize_covariance_matrix).
+
+        The fields are taken by their covariance model (see get_field_models): the covariance matrix is
+        built and decomposed once for every distinct model. The fields of a model are interpolated in
+        passes of up to BATCH_FIELDS_PER_PASS fields:
+        1. the dual coefficients of all fields of the pass are solved at once (see lu_solve_multi),
+           without dual kriging the weights of a raster point are shared by the fields instead
+        2. one pass over the raster calculates the covariance vector of every point once for all
+           fields (see interpolate_raster and interpolate_raster_point_fields)
+        3. the rasters are written and their memory is given back, before the next pass starts
+        So a further field costs about one dot product per raster point.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx, jdx, field;
+    int excno;
+    volatile int failed_field = 0;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int err;
+        int n = Map->input_data.length;
+        int num_fields = Map->input_data.num_fields;
+        int num_pass;
+        bool *done;
+        double *rhs;
+        char output_datafile[sizeof(Map->config.output_datafile) + 32];
+        struct usr_field_model *model;
+        struct usr_field_model factorized = {.model = Map->variogram.model,
+                                             .nugget = Map->variogram.nugget,
+                                             .sill = Map->variogram.sill,
+                                             .range = Map->variogram.range,
+                                             .wrss = Map->variogram.wrss};
+        struct usr_arena_mark scratch;
+
+        Map->batch.num_factorizations = (Map->covariance_factor.lu != NULL) ? 1 : 0;
+
+        if (get_field_models(Map) == EXIT_FAILURE){
+            longjmp(env, 2);
+        }
+
+        done = (bool *) arena_alloc(&(Map->arena), num_fields * sizeof(bool));
+        Map->batch.pass_fields = (int *) arena_alloc(&(Map->arena), BATCH_FIELDS_PER_PASS * sizeof(int));
+        if ((done == NULL) || (Map->batch.pass_fields == NULL)){
+            longjmp(env, 1);
+        }
+
+        for (field=0; field<num_fields; field++){
+
+            if (done[field]){
+                continue;
+            }
+            model = &(Map->batch.models[field]);
+
+            Map->variogram.model = model->model;
+            Map->variogram.nugget = model->nugget;
+            Map->variogram.sill = model->sill;
+            Map->variogram.range = model->range;
+            Map->variogram.wrss = model->wrss;
+
+            // the covariance matrix of a further model:
+            if ((Map->covariance_factor.lu == NULL) || (!same_field_model(model, &factorized))){
+
+                if ((create_covariance_matrix(Map) == EXIT_FAILURE) || (factorize_covariance_matrix(Map) == EXIT_FAILURE)){
+                    failed_field = field;
+                    longjmp(env, 3);
+                }
+                factorized = *model;
+                Map->batch.num_factorizations++;
+            }
+
+            // the fields of the pass: the next ones with the same model:
+            num_pass = 0;
+            for (jdx=field; (jdx<num_fields) && (num_pass<BATCH_FIELDS_PER_PASS); jdx++){
+                if ((!done[jdx]) && (same_field_model(&(Map->batch.models[jdx]), model))){
+                    Map->batch.pass_fields[num_pass++] = jdx;
+                    done[jdx] = true;
+                }
+            }
+
+            if (Map->show_output){
+                printf("batch: fields %d", Map->batch.pass_fields[0] + 1);
+                for (idx=1; idx<num_pass; idx++){
+                    printf(", %d", Map->batch.pass_fields[idx] + 1);
+                }
+                printf(" (%s)\n", variogram_model_name(Map->variogram.model));
+            }
+
+            // the rasters, values and coefficients of the pass are given back after the output:
+            scratch = arena_mark(&(Map->arena));
+
+            Map->batch.rasters = (struct usr_raster *) arena_alloc(&(Map->arena), num_pass * sizeof(struct usr_raster));
+            Map->batch.values = create_fvector(&(Map->arena), n * num_pass);
+            if ((Map->batch.rasters == NULL) || (Map->batch.values == NULL)){
+                longjmp(env, 1);
+            }
+
+            for (idx=0; idx<num_pass; idx++){
+
+                if (create_maps_raster(&(Map->arena), &(Map->batch.rasters[idx]), Map->rows, Map->cols) == EXIT_FAILURE){
+                    longjmp(env, 1);
+                }
+
+                // same geometry and stations as the raster of the map:
+                Map->batch.rasters[idx].maxLat = Map->raster.maxLat;
+                Map->batch.rasters[idx].minLon = Map->raster.minLon;
+                Map->batch.rasters[idx].latRes = Map->raster.latRes;
+                Map->batch.rasters[idx].lonRes = Map->raster.lonRes;
+                Map->batch.rasters[idx].num_stations = Map->raster.num_stations;
+                Map->batch.rasters[idx].stations = Map->raster.stations;
+            }
+
+            // measured values of the fields (station by station):
+            for (jdx=0; jdx<n; jdx++){
+                for (idx=0; idx<num_pass; idx++){
+                    Map->batch.values[(size_t)jdx * num_pass + idx] = Map->input_data.fields[(size_t)jdx * num_fields + Map->batch.pass_fields[idx]];
+                }
+            }
+
+            // dual kriging: the coefficients of all fields at once (C * A = (Z, 0)):
+            Map->batch.coefficients = NULL;
+            if ((Map->dual_kriging) && (!Map->weights_correction)){
+
+                Map->batch.coefficients = create_fvector(&(Map->arena), (n + 1) * num_pass);
+                rhs = create_fvector(&(Map->arena), (n + 1) * num_pass);
+                if ((Map->batch.coefficients == NULL) || (rhs == NULL)){
+                    longjmp(env, 1);
+                }
+
+                // the last row (lagrange multiplier) stays 0:
+                memcpy(rhs, Map->batch.values, (size_t)n * num_pass * sizeof(double));
+
+                if (lu_solve_multi(&(Map->covariance_factor), rhs, Map->batch.coefficients, num_pass) == EXIT_FAILURE){
+                    longjmp(env, 4);
+                }
+            }
+
+            Map->batch.num_pass = num_pass;
+            err = interpolate_raster(Map);
+            Map->batch.num_pass = 0;
+            if (err == EXIT_FAILURE){
+                longjmp(env, 5);
+            }
+
+            // output of the rasters of the pass:
+            for (idx=0; idx<num_pass; idx++){
+
+                snprintf(output_datafile, sizeof(output_datafile), "%s%s%d", (Map->weights_correction) ? Map->config.output_datafile_cor : Map->config.output_datafile,
+                                                                           BATCH_FIELD_NAME, Map->batch.pass_fields[idx] + 1);
+
+                err = (Map->output_csv) ? outputRasterCSV(&(Map->batch.rasters[idx]), Map->config.output_dir, output_datafile, Map->config.csv_decimal_separator, Map->config.csv_field_separator, Map->num_threads, Map->show_output)
+                                        : outputRasterBinary(&(Map->batch.rasters[idx]), Map->config.output_dir, output_datafile, Map->show_output);
+                if (err == EXIT_FAILURE){
+                    failed_field = Map->batch.pass_fields[idx];
+                    longjmp(env, 6);
+                }
+            }
+
+            arena_rewind(&(Map->arena), scratch);
+            Map->batch.rasters = NULL;
+            Map->batch.values = NULL;
+            Map->batch.coefficients = NULL;
+        }
+
+        if (Map->show_output){
+            printf("batch: %d fields, %d decompositions of the covariance matrix\n", num_fields, Map->batch.num_factorizations);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        Map->batch.num_pass = 0;
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when determining the covariance models of the fields!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when decomposing the covariance matrix of field %d!\n", __FILE__, __LINE__, failed_field + 1); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Calculation of the dual kriging coefficients of the batch returned an error!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when interpolating the fields of the batch!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when writing the raster of field %d!\n", __FILE__, __LINE__, failed_field + 1); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
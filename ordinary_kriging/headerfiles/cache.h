@@ -0,0 +1,582 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <setjmp.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define MODEL_CACHE_MAGIC "KRGM"				// magic number of the model cache file
+#define MODEL_CACHE_VERSION 1					// version of the model cache file
+#define MODEL_CACHE_HEADER_SIZE 128				// size (bytes) of the header of the model cache file
+#define MODEL_CACHE_ALIGN 64					// alignment (bytes) of the sections of the model cache file
+#define MODEL_CACHE_NAME "modelCache_"				// the cache file of a key is "<output dir>modelCache_<key>.cache"
+#define MODEL_CACHE_EXT ".cache"				// extension of the model cache file
+#define MODEL_CACHE_NUM_SECTIONS 4				// coordinates, distance matrix, LU decomposition, pivots
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int set_cache_config(struct usr_map *Map, int argc, char **argv);
+int read_model_cache(struct usr_map *Map);
+int write_model_cache(struct usr_map *Map);
+bool check_model_cache(struct usr_map *Map, const unsigned char *map, size_t size);
+unsigned long long model_cache_key(struct usr_map *Map);
+size_t model_cache_layout(int num_stations, int dim, uint64_t *offsets);
+int write_cache_padding(FILE *fp, size_t position, size_t offset);
+
+static inline unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int set_cache_config(struct usr_map *Map, int argc, char **argv){
+
+    /*
+        DESCRIPTION:
+        Reads the argument of the model cache (see kriging.c). The general arguments are handled by set_config:
+        -mc	...	the model (distance matrix, variogram and decomposition of the covariance matrix)
+			is read out of the cache of an unchanged station network and written to it otherwise
+			(see read_model_cache and write_model_cache).
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the "map" object of datatype "struct usr_map".
+
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+
+    for (idx=0; idx<argc; idx++){
+
+        // model cache:
+        if (!strcmp(argv[idx],"-mc")){
+            Map->model_cache.enabled = true;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int read_model_cache(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Reads the model of an unchanged station network out of the cache file of its key (see model_cache_key)
+        in the output directory: the distance matrix, the fitted variogram (model, nugget, sill, range) and
+        the LU decomposition of the covariance matrix (not with local kriging). Afterwards the run continues
+        with the dual coefficients and the interpolation, only the values of the stations are new.
+        The variogram is the one of the run that has written the cache file.
+
+        The file is mapped into the memory: the distance matrix is used directly out of the mapping (see
+        free_raster), the decomposition is copied, because it is changed by updates (see lu_border).
+        A missing, invalid or foreign cache file (see check_model_cache) is no error, the model is calculated
+        as usual then and written to the cache afterwards (see write_model_cache).
+
+        Layout of the cache file (little endian, as written by x86/arm):
+        offset  0	char[4]		magic number MODEL_CACHE_MAGIC
+        offset  4	uint32		version of the format (MODEL_CACHE_VERSION)
+        offset  8	uint32		size of the header in bytes
+        offset 12	uint32		number of stations n
+        offset 16	uint64		key (see model_cache_key)
+        offset 24	int32		variogram model (VARIO_MODEL_...)
+        offset 28	uint32		dimension of the decomposition (n+1, 0 => local kriging)
+        offset 32	float64		nugget
+        offset 40	float64		sill
+        offset 48	float64		range
+        offset 56	float64		WRSS of the fitted model
+        offset 64	uint64[4]	offsets of the sections (multiples of MODEL_CACHE_ALIGN bytes):
+					coordinates (lat, lon of every station, float64),
+					distance matrix (packed upper triangle, float64, see create_matrix),
+					LU decomposition (row by row, float64, see lu_factorize),
+					pivots (int32)
+        offset 96	uint64		size of the file in bytes
+        offset 104	...		reserved (0)
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS ("Map->model_cache.loaded" tells, if the model has been read)
+        on failure		...	EXIT_FAILURE
+    */
+
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int fd;
+        int dim;
+        int n = Map->input_data.length;
+        int model;
+        uint32_t value;
+        uint64_t offsets[MODEL_CACHE_NUM_SECTIONS];
+        struct stat file_info;
+        unsigned char *map;
+        struct usr_factorization *fac = &(Map->covariance_factor);
+
+        Map->model_cache.loaded = false;
+
+        if (!Map->model_cache.enabled){
+            return EXIT_SUCCESS;
+        }
+
+        Map->model_cache.key = model_cache_key(Map);
+        if (snprintf(Map->model_cache.path, sizeof(Map->model_cache.path), "%s%s%016llx%s", Map->config.output_dir, MODEL_CACHE_NAME,
+                     Map->model_cache.key, MODEL_CACHE_EXT) >= (int)sizeof(Map->model_cache.path)){
+            longjmp(env, 1);
+        }
+
+        fd = open(Map->model_cache.path, O_RDONLY);
+        if (fd < 0){
+
+            // first run of this station network:
+            if (errno == ENOENT){
+                if (Map->show_output){
+                    printf("model cache: no entry for the key %016llx\n", Map->model_cache.key);
+                }
+                return EXIT_SUCCESS;
+            }
+            longjmp(env, 3);
+        }
+        if ((fstat(fd, &file_info) != 0) || (file_info.st_size < MODEL_CACHE_HEADER_SIZE)){
+            close(fd);
+            longjmp(env, 4);
+        }
+
+        // private mapping: the pages of the file are shared, but never written back:
+        map = (unsigned char *) mmap(NULL, file_info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED){
+            longjmp(env, 3);
+        }
+
+        if (!check_model_cache(Map, map, file_info.st_size)){
+            munmap(map, file_info.st_size);
+            longjmp(env, 4);
+        }
+
+        memcpy(&model, &map[24], sizeof(int32_t));
+        memcpy(&value, &map[28], sizeof(uint32_t));
+        memcpy(offsets, &map[64], sizeof(offsets));
+        dim = (int)value;
+
+        // the decomposition:
+        if (dim > 0){
+
+            free_factorization(fac);
+            fac->lu = (double *) malloc((size_t)dim * dim * sizeof(double));
+            fac->pivot = (int *) malloc(dim * sizeof(int));
+            if ((fac->lu == NULL) || (fac->pivot == NULL)){
+                free_factorization(fac);
+                munmap(map, file_info.st_size);
+                longjmp(env, 2);
+            }
+            memcpy(fac->lu, &map[offsets[2]], (size_t)dim * dim * sizeof(double));
+            memcpy(fac->pivot, &map[offsets[3]], dim * sizeof(int));
+            fac->n = dim;
+            fac->capacity = dim;
+        }
+
+        // the distance matrix within the mapping:
+        Map->distance_matrix.rows = n;
+        Map->distance_matrix.cols = n;
+        Map->distance_matrix.packed = true;
+        Map->distance_matrix.value = (double *) &map[offsets[1]];
+
+        // the fitted variogram:
+        Map->variogram.model = model;
+        memcpy(&(Map->variogram.nugget), &map[32], sizeof(double));
+        memcpy(&(Map->variogram.sill), &map[40], sizeof(double));
+        memcpy(&(Map->variogram.range), &map[48], sizeof(double));
+        memcpy(&(Map->variogram.wrss), &map[56], sizeof(double));
+
+        Map->model_cache.map = map;
+        Map->model_cache.map_size = file_info.st_size;
+        Map->model_cache.loaded = true;
+
+        if (Map->show_output){
+            printf("model cache: read %s\n", Map->model_cache.path);
+            printf("model: %s, nugget: %.3f, sill: %.3f, range: %.3f, WRSS: %.3f\n", variogram_model_name(Map->variogram.model),
+                   Map->variogram.nugget, Map->variogram.sill, Map->variogram.range, Map->variogram.wrss);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> The path of the model cache is longer then %d characters!\n", __FILE__, __LINE__, (int)sizeof(Map->model_cache.path)-1); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "WARNING: %s --> %d:\n >>> The model cache \"%s\" can not be read, the model is calculated (%s)!\n", __FILE__, __LINE__, Map->model_cache.path, strerror(errno)); return EXIT_SUCCESS;
+            case 4: fprintf(stderr, "WARNING: %s --> %d:\n >>> The model cache \"%s\" is invalid or belongs to another station network, the model is calculated!\n", __FILE__, __LINE__, Map->model_cache.path); return EXIT_SUCCESS;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int write_model_cache(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Writes the model of the station network (distance matrix, fitted variogram and LU decomposition of
+        the covariance matrix) into the cache file of its key (see read_model_cache for the layout).
+        The file is written under a temporary name and renamed afterwards, so that a concurrent run never
+        reads a partial file. Does nothing, if the model cache is not used or the model has been read out of it.
+        A cache file, that can not be written, is no error: the next run calculates the model again.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int excno;
+    char path[sizeof(Map->model_cache.path) + 32];
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int n = Map->input_data.length;
+        int dim;
+        int32_t model = Map->variogram.model;
+        uint32_t header_int[3];
+        uint64_t offsets[MODEL_CACHE_NUM_SECTIONS];
+        uint64_t file_size;
+        size_t position;
+        double coordinates[2];
+        unsigned char header[MODEL_CACHE_HEADER_SIZE];
+        FILE *fp;
+
+        if ((!Map->model_cache.enabled) || (Map->model_cache.loaded)){
+            return EXIT_SUCCESS;
+        }
+
+        // local kriging decomposes the systems of the neighbourhoods:
+        dim = (is_local_kriging(Map)) ? 0 : Map->covariance_factor.n;
+        if ((dim > 0) && ((Map->covariance_factor.lu == NULL) || (dim != n+1))){
+            longjmp(env, 1);
+        }
+
+        file_size = model_cache_layout(n, dim, offsets);
+
+        // the header:
+        header_int[0] = MODEL_CACHE_VERSION;
+        header_int[1] = MODEL_CACHE_HEADER_SIZE;
+        header_int[2] = (uint32_t)n;
+
+        memset(header, 0, MODEL_CACHE_HEADER_SIZE);
+        memcpy(&header[0], MODEL_CACHE_MAGIC, 4);
+        memcpy(&header[4], header_int, 3 * sizeof(uint32_t));
+        memcpy(&header[16], &(Map->model_cache.key), sizeof(uint64_t));
+        memcpy(&header[24], &model, sizeof(int32_t));
+        header_int[0] = (uint32_t)dim;
+        memcpy(&header[28], header_int, sizeof(uint32_t));
+        memcpy(&header[32], &(Map->variogram.nugget), sizeof(double));
+        memcpy(&header[40], &(Map->variogram.sill), sizeof(double));
+        memcpy(&header[48], &(Map->variogram.range), sizeof(double));
+        memcpy(&header[56], &(Map->variogram.wrss), sizeof(double));
+        memcpy(&header[64], offsets, sizeof(offsets));
+        memcpy(&header[96], &file_size, sizeof(uint64_t));
+
+        snprintf(path, sizeof(path), "%s.%d.tmp", Map->model_cache.path, (int)getpid());
+        fp = fopen(path, "wb");
+        if (fp == NULL){
+            longjmp(env, 2);
+        }
+
+        if (fwrite(header, 1, MODEL_CACHE_HEADER_SIZE, fp) != MODEL_CACHE_HEADER_SIZE){
+            fclose(fp);
+            longjmp(env, 3);
+        }
+        position = MODEL_CACHE_HEADER_SIZE;
+
+        // the coordinates of the stations:
+        if (write_cache_padding(fp, position, offsets[0]) == EXIT_FAILURE){
+            fclose(fp);
+            longjmp(env, 3);
+        }
+        for (idx=0; idx<n; idx++){
+
+            coordinates[0] = Map->input_data.data[idx].lat;
+            coordinates[1] = Map->input_data.data[idx].lon;
+            if (fwrite(coordinates, sizeof(double), 2, fp) != 2){
+                fclose(fp);
+                longjmp(env, 3);
+            }
+        }
+        position = offsets[0] + 2 * (size_t)n * sizeof(double);
+
+        // the distance matrix:
+        if ((write_cache_padding(fp, position, offsets[1]) == EXIT_FAILURE) ||
+            (fwrite(Map->distance_matrix.value, sizeof(double), matrix_num_values(&(Map->distance_matrix)), fp) != matrix_num_values(&(Map->distance_matrix)))){
+            fclose(fp);
+            longjmp(env, 3);
+        }
+        position = offsets[1] + matrix_num_values(&(Map->distance_matrix)) * sizeof(double);
+
+        // the decomposition and its pivots:
+        if (dim > 0){
+
+            if ((write_cache_padding(fp, position, offsets[2]) == EXIT_FAILURE) ||
+                (fwrite(Map->covariance_factor.lu, sizeof(double), (size_t)dim * dim, fp) != (size_t)dim * dim)){
+                fclose(fp);
+                longjmp(env, 3);
+            }
+            position = offsets[2] + (size_t)dim * dim * sizeof(double);
+
+            if ((write_cache_padding(fp, position, offsets[3]) == EXIT_FAILURE) ||
+                (fwrite(Map->covariance_factor.pivot, sizeof(int), dim, fp) != (size_t)dim)){
+                fclose(fp);
+                longjmp(env, 3);
+            }
+            position = offsets[3] + (size_t)dim * sizeof(int);
+        }
+
+        // the empty sections (local kriging) are aligned as well:
+        if (write_cache_padding(fp, position, file_size) == EXIT_FAILURE){
+            fclose(fp);
+            longjmp(env, 3);
+        }
+
+        if (fclose(fp) != 0){
+            longjmp(env, 3);
+        }
+        if (rename(path, Map->model_cache.path) != 0){
+            longjmp(env, 3);
+        }
+
+        if (Map->show_output){
+            printf("model cache: written %s\n", Map->model_cache.path);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> The covariance matrix has not been decomposed!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "WARNING: %s --> %d:\n >>> The model cache \"%s\" can not be written (%s)!\n", __FILE__, __LINE__, path, strerror(errno)); return EXIT_SUCCESS;
+            case 3: fprintf(stderr, "WARNING: %s --> %d:\n >>> The model cache \"%s\" could not be written completely (%s)!\n", __FILE__, __LINE__, path, strerror(errno)); remove(path); return EXIT_SUCCESS;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+bool check_model_cache(struct usr_map *Map, const unsigned char *map, size_t size){
+
+    /*
+        DESCRIPTION:
+        Checks a mapped cache file (see read_model_cache): the header has to match the format and the key,
+        the sections have to match the layout of the station network (see model_cache_layout) and the
+        coordinates of the stations have to be the same as the ones of the input dataset (so that two
+        networks with the same hash are never mixed up).
+
+        INPUT:
+        struct usr_map *Map		...	pointer to the map object.
+        const unsigned char *map	...	mapped cache file
+        size_t size			...	size of the file in bytes
+
+        OUTPUT:
+        true, if the model of the file can be used
+    */
+
+    int idx;
+    int n = Map->input_data.length;
+    int dim = (is_local_kriging(Map)) ? 0 : n+1;
+    uint32_t header_int[3];
+    uint32_t file_dim;
+    uint64_t key;
+    uint64_t offsets[MODEL_CACHE_NUM_SECTIONS];
+    uint64_t layout[MODEL_CACHE_NUM_SECTIONS];
+    uint64_t file_size;
+    double coordinates[2];
+
+    if ((size < MODEL_CACHE_HEADER_SIZE) || (memcmp(map, MODEL_CACHE_MAGIC, 4) != 0)){
+        return false;
+    }
+
+    memcpy(header_int, &map[4], 3 * sizeof(uint32_t));
+    memcpy(&key, &map[16], sizeof(uint64_t));
+    memcpy(&file_dim, &map[28], sizeof(uint32_t));
+    memcpy(offsets, &map[64], sizeof(offsets));
+    memcpy(&file_size, &map[96], sizeof(uint64_t));
+
+    if ((header_int[0] != MODEL_CACHE_VERSION) || (header_int[1] != MODEL_CACHE_HEADER_SIZE) || (header_int[2] != (uint32_t)n) ||
+        (key != Map->model_cache.key) || (file_dim != (uint32_t)dim)){
+        return false;
+    }
+
+    if ((model_cache_layout(n, dim, layout) != size) || (file_size != size) || (memcmp(offsets, layout, sizeof(layout)) != 0)){
+        return false;
+    }
+
+    for (idx=0; idx<n; idx++){
+
+        memcpy(coordinates, &map[offsets[0] + 2 * (size_t)idx * sizeof(double)], 2 * sizeof(double));
+        if ((coordinates[0] != Map->input_data.data[idx].lat) || (coordinates[1] != Map->input_data.data[idx].lon)){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+unsigned long long model_cache_key(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Key of the model cache: a 64 bit FNV-1a hash of everything the model depends on, that is the
+        coordinates of the stations (in the order of the input dataset), the parameters of the variogram,
+        the raster and whether local kriging is used. The values of the stations are not part of it.
+    */
+
+    int idx;
+    int local = (is_local_kriging(Map)) ? 1 : 0;
+    int version = MODEL_CACHE_VERSION;
+    unsigned long long hash = 14695981039346656037ULL;
+
+    hash = hash_bytes(hash, &version, sizeof(int));
+    hash = hash_bytes(hash, &(Map->input_data.length), sizeof(int));
+    for (idx=0; idx<Map->input_data.length; idx++){
+        hash = hash_bytes(hash, &(Map->input_data.data[idx].lat), sizeof(double));
+        hash = hash_bytes(hash, &(Map->input_data.data[idx].lon), sizeof(double));
+    }
+
+    // variogram:
+    hash = hash_bytes(hash, &(Map->variogram.distInterval), sizeof(double));
+    hash = hash_bytes(hash, &(Map->variogram.maxDistance), sizeof(double));
+    hash = hash_bytes(hash, &(Map->variogram.nugget), sizeof(double));
+    hash = hash_bytes(hash, &(Map->variogram.model), sizeof(int));
+    hash = hash_bytes(hash, &(Map->variogram.reg_function.order), sizeof(int));
+
+    // raster:
+    hash = hash_bytes(hash, &(Map->rows), sizeof(unsigned int));
+    hash = hash_bytes(hash, &(Map->cols), sizeof(unsigned int));
+    hash = hash_bytes(hash, &(Map->minLat), sizeof(double));
+    hash = hash_bytes(hash, &(Map->maxLat), sizeof(double));
+    hash = hash_bytes(hash, &(Map->minLon), sizeof(double));
+    hash = hash_bytes(hash, &(Map->maxLon), sizeof(double));
+    hash = hash_bytes(hash, &local, sizeof(int));
+
+    return hash;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+size_t model_cache_layout(int num_stations, int dim, uint64_t *offsets){
+
+    /*
+        DESCRIPTION:
+        Determines the offsets of the sections of the cache file (see read_model_cache), every section
+        starts at a multiple of MODEL_CACHE_ALIGN bytes.
+
+        INPUT:
+        int num_stations	...	number of stations
+        int dim			...	dimension of the decomposition (0 => none)
+        uint64_t *offsets	...	offsets of the MODEL_CACHE_NUM_SECTIONS sections
+
+        OUTPUT:
+        size of the file in bytes
+    */
+
+    size_t position = MODEL_CACHE_HEADER_SIZE;
+    size_t lengths[MODEL_CACHE_NUM_SECTIONS] = {2 * (size_t)num_stations * sizeof(double),
+                                                ((size_t)num_stations * (num_stations + 1)) / 2 * sizeof(double),
+                                                (size_t)dim * dim * sizeof(double),
+                                                (size_t)dim * sizeof(int32_t)};
+    int idx;
+
+    for (idx=0; idx<MODEL_CACHE_NUM_SECTIONS; idx++){
+
+        position = ((position + MODEL_CACHE_ALIGN - 1) / MODEL_CACHE_ALIGN) * MODEL_CACHE_ALIGN;
+        offsets[idx] = position;
+        position += lengths[idx];
+    }
+
+    return position;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int write_cache_padding(FILE *fp, size_t position, size_t offset){
+
+    /*
+        DESCRIPTION:
+        Writes zeros from the current position of the file up to the offset of the next section.
+    */
+
+    static const unsigned char zeros[MODEL_CACHE_ALIGN] = {0};
+
+    if (offset < position){
+        return EXIT_FAILURE;
+    }
+    if (fwrite(zeros, 1, offset - position, fp) != offset - position){
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size){
+
+    /*
+        DESCRIPTION:
+        Continues the 64 bit FNV-1a hash with the given bytes.
+    */
+
+    size_t idx;
+    const unsigned char *bytes = (const unsigned char *) data;
+
+    for (idx=0; idx<size; idx++){
+        hash ^= bytes[idx];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
@@ -0,0 +1,537 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <float.h>
+    #include <setjmp.h>
+    #include <errno.h>
+#endif
+
+#define LU_BLOCK 64						// width of the column panels of the blocked LU decomposition
+#define LU_COL_BLOCK 256					// number of columns of the trailing matrix updated at once (cache)
+#define LU_BORDER_RESERVE 32					// additional rows/columns reserved when a decomposition grows (see lu_border)
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int lu_factorize(struct usr_factorization *fac, struct usr_matrix *matrix);
+int lu_solve(struct usr_factorization *fac, double *rhs, double *solution);
+int lu_solve_multi(struct usr_factorization *fac, double *rhs, double *solution, int num_rhs);
+int lu_border(struct usr_factorization *fac, double *column, double *row, double corner);
+
+void free_factorization(struct usr_factorization *fac);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int lu_factorize(struct usr_factorization *fac, struct usr_matrix *matrix){
+
+    /*
+        DESCRIPTION:
+        Decomposes a square matrix of type double into P*A = L*U by using a blocked
+        LU decomposition with partial (row) pivoting.
+        The matrix is copied into one contiguous buffer, the given matrix stays untouched.
+        The buffers of a previous decomposition (e.g. the local systems) are reused if they are large enough.
+        A packed (symmetric) matrix is unpacked into the full square matrix.
+        L (unit lower triangle, without the diagonal) and U are stored within the same buffer.
+
+        The columns are processed in panels of LU_BLOCK columns. After each panel the
+        trailing matrix is updated in blocks of LU_COL_BLOCK columns, so that the rows of the
+        panel remain in the cache.
+
+        INPUT:
+        struct usr_factorization *fac	...	pointer to the factorization object
+        struct usr_matrix *matrix	...	pointer to the square matrix (full or packed, see create_matrix)
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+    */
+
+    int idx, jdx, kdx;
+    int excno;
+    jmp_buf env;
+
+
+    if ((excno = setjmp(env)) == 0){
+
+        int n = matrix->rows;
+        int k0, kb, j0, jb, pidx;
+        double amax = 0;			// maximum absolute value of the matrix
+        double tol;				// smallest pivot that is accepted
+        double tmp;
+        double *A, *rowk, *rowi;
+        const double *src;
+
+        if ((n <= 0) || (matrix->cols != n)){
+            longjmp(env, 1);
+        }
+
+        // the buffers of a previous decomposition are used again, if they are large enough:
+        if ((fac->lu == NULL) || (fac->pivot == NULL) || (fac->capacity < n)){
+        
+            free_factorization(fac);
+            fac->lu = (double *) malloc((size_t)n * n * sizeof(double));
+            fac->pivot = (int *) malloc(n * sizeof(int));
+            if ((fac->lu == NULL) || (fac->pivot == NULL)){
+                free_factorization(fac);
+                longjmp(env, 2);
+            }
+            fac->capacity = n;
+        }
+        fac->n = n;
+        A = fac->lu;
+
+        // copy the matrix into the contiguous buffer, a packed matrix is mirrored at the diagonal:
+        if (matrix->packed){
+            for (idx=0; idx<n; idx++){
+
+                src = matrix_upper_row(matrix, idx);
+                for (jdx=idx; jdx<n; jdx++){
+                    A[(size_t)idx*n + jdx] = src[jdx-idx];
+                    A[(size_t)jdx*n + idx] = src[jdx-idx];
+                }
+            }
+        }
+        else{
+            memcpy(A, matrix->value, (size_t)n * n * sizeof(double));
+        }
+
+        // check it for nan and inf values:
+        for (idx=0; idx<n; idx++){
+            for (jdx=0; jdx<n; jdx++){
+
+                if ((isnan(A[(size_t)idx*n + jdx])) || (isinf(A[(size_t)idx*n + jdx]))){
+                    free_factorization(fac);
+                    longjmp(env, 3);
+                }
+                if (fabs(A[(size_t)idx*n + jdx]) > amax){
+                    amax = fabs(A[(size_t)idx*n + jdx]);
+                }
+            }
+        }
+
+        // pivots smaller then this are treated as 0 (singular matrix):
+        tol = n * DBL_EPSILON * amax;
+
+
+        for (k0=0; k0<n; k0+=LU_BLOCK){
+
+            kb = ((k0 + LU_BLOCK) < n) ? LU_BLOCK : (n - k0);
+
+            // 1. unblocked decomposition of the panel (columns k0 ... k0+kb-1):
+            for (kdx=k0; kdx<k0+kb; kdx++){
+
+                // find the pivot:
+                pidx = kdx;
+                for (idx=kdx+1; idx<n; idx++){
+                    if (fabs(A[(size_t)idx*n + kdx]) > fabs(A[(size_t)pidx*n + kdx])){
+                        pidx = idx;
+                    }
+                }
+                if (fabs(A[(size_t)pidx*n + kdx]) <= tol){
+                    free_factorization(fac);
+                    longjmp(env, 4);
+                }
+                fac->pivot[kdx] = pidx;
+
+                // swap the whole rows:
+                if (pidx != kdx){
+                    rowk = &A[(size_t)kdx*n];
+                    rowi = &A[(size_t)pidx*n];
+                    for (jdx=0; jdx<n; jdx++){
+                        tmp = rowk[jdx];
+                        rowk[jdx] = rowi[jdx];
+                        rowi[jdx] = tmp;
+                    }
+                }
+
+                // eliminate below the pivot, but only within the panel:
+                rowk = &A[(size_t)kdx*n];
+                for (idx=kdx+1; idx<n; idx++){
+
+                    rowi = &A[(size_t)idx*n];
+                    rowi[kdx] /= rowk[kdx];
+
+                    for (jdx=kdx+1; jdx<k0+kb; jdx++){
+                        rowi[jdx] -= rowi[kdx] * rowk[jdx];
+                    }
+                }
+            }
+
+            // 2. + 3. update the rows of the panel (U12) and the trailing matrix (A22) block by block:
+            for (j0=k0+kb; j0<n; j0+=LU_COL_BLOCK){
+
+                jb = ((j0 + LU_COL_BLOCK) < n) ? LU_COL_BLOCK : (n - j0);
+
+                // U12 = L11^-1 * A12 (unit lower triangle):
+                for (kdx=k0; kdx<k0+kb; kdx++){
+
+                    rowk = &A[(size_t)kdx*n];
+                    for (idx=kdx+1; idx<k0+kb; idx++){
+
+                        rowi = &A[(size_t)idx*n];
+                        tmp = rowi[kdx];
+                        for (jdx=j0; jdx<j0+jb; jdx++){
+                            rowi[jdx] -= tmp * rowk[jdx];
+                        }
+                    }
+                }
+
+                // A22 = A22 - L21 * U12:
+                for (idx=k0+kb; idx<n; idx++){
+
+                    rowi = &A[(size_t)idx*n];
+                    for (kdx=k0; kdx<k0+kb; kdx++){
+
+                        rowk = &A[(size_t)kdx*n];
+                        tmp = rowi[kdx];
+                        for (jdx=j0; jdx<j0+jb; jdx++){
+                            rowi[jdx] -= tmp * rowk[jdx];
+                        }
+                    }
+                }
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix must be square and its dimension greater then 0!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix is singular (e.g. two stations at the same location)!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int lu_solve(struct usr_factorization *fac, double *rhs, double *solution){
+
+    /*
+        DESCRIPTION:
+        Solves the linear system A*x = b with the help of the LU decomposition of A.
+        The inverse of A is never formed. The right hand side stays untouched.
+
+        INPUT:
+        struct usr_factorization *fac	...	pointer to the factorization object (see lu_factorize)
+        double *rhs			...	right hand side b of length fac->n
+        double *solution		...	solution x of length fac->n
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+    */
+
+    int idx, jdx;
+    int n = fac->n;
+    double sum, tmp;
+    const double *row;
+
+    if ((fac->lu == NULL) || (fac->pivot == NULL)){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix has not been factorized!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    memcpy(solution, rhs, n * sizeof(double));
+
+    // apply the row permutation:
+    for (idx=0; idx<n; idx++){
+        if (fac->pivot[idx] != idx){
+            tmp = solution[idx];
+            solution[idx] = solution[fac->pivot[idx]];
+            solution[fac->pivot[idx]] = tmp;
+        }
+    }
+
+    // forward substitution (L*y = P*b):
+    for (idx=1; idx<n; idx++){
+
+        row = &fac->lu[(size_t)idx*n];
+        sum = solution[idx];
+        for (jdx=0; jdx<idx; jdx++){
+            sum -= row[jdx] * solution[jdx];
+        }
+        solution[idx] = sum;
+    }
+
+    // backward substitution (U*x = y):
+    for (idx=n-1; idx>=0; idx--){
+
+        row = &fac->lu[(size_t)idx*n];
+        sum = solution[idx];
+        for (jdx=idx+1; jdx<n; jdx++){
+            sum -= row[jdx] * solution[jdx];
+        }
+        solution[idx] = sum / row[idx];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int lu_solve_multi(struct usr_factorization *fac, double *rhs, double *solution, int num_rhs){
+
+    /*
+        DESCRIPTION:
+        Solves the linear system A*X = B for several right hand sides at once with the help of the
+        LU decomposition of A (see lu_solve). B and X are stored row by row (fac->n x num_rhs), so
+        every row of L and U is read once for all right hand sides and the innermost loop runs over
+        the contiguous values of a row of X. Every column of X is the same as the one of lu_solve.
+
+        INPUT:
+        struct usr_factorization *fac	...	pointer to the factorization object (see lu_factorize)
+        double *rhs			...	right hand sides B (fac->n x num_rhs, row by row)
+        double *solution		...	solutions X (fac->n x num_rhs, row by row)
+        int num_rhs			...	number of right hand sides
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+    */
+
+    int idx, jdx, kdx;
+    int n = fac->n;
+    double factor, tmp;
+    double *x, *y;
+    const double *row;
+
+    if ((fac->lu == NULL) || (fac->pivot == NULL)){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix has not been factorized!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+    if (num_rhs <= 0){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The number of right hand sides must be greater then 0!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    memcpy(solution, rhs, (size_t)n * num_rhs * sizeof(double));
+
+    // apply the row permutation:
+    for (idx=0; idx<n; idx++){
+        if (fac->pivot[idx] != idx){
+            x = &solution[(size_t)idx * num_rhs];
+            y = &solution[(size_t)fac->pivot[idx] * num_rhs];
+            for (kdx=0; kdx<num_rhs; kdx++){
+                tmp = x[kdx];
+                x[kdx] = y[kdx];
+                y[kdx] = tmp;
+            }
+        }
+    }
+
+    // forward substitution (L*Y = P*B):
+    for (idx=1; idx<n; idx++){
+
+        row = &fac->lu[(size_t)idx*n];
+        x = &solution[(size_t)idx * num_rhs];
+        for (jdx=0; jdx<idx; jdx++){
+            factor = row[jdx];
+            y = &solution[(size_t)jdx * num_rhs];
+            for (kdx=0; kdx<num_rhs; kdx++){
+                x[kdx] -= factor * y[kdx];
+            }
+        }
+    }
+
+    // backward substitution (U*X = Y):
+    for (idx=n-1; idx>=0; idx--){
+
+        row = &fac->lu[(size_t)idx*n];
+        x = &solution[(size_t)idx * num_rhs];
+        for (jdx=idx+1; jdx<n; jdx++){
+            factor = row[jdx];
+            y = &solution[(size_t)jdx * num_rhs];
+            for (kdx=0; kdx<num_rhs; kdx++){
+                x[kdx] -= factor * y[kdx];
+            }
+        }
+        for (kdx=0; kdx<num_rhs; kdx++){
+            x[kdx] /= row[idx];
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int lu_border(struct usr_factorization *fac, double *column, double *row, double corner){
+
+    /*
+        DESCRIPTION:
+        Extends the LU decomposition P*A = L*U of the matrix A (n x n) to the one of the bordered matrix
+
+            A' = | A      column |
+                 | row^T  corner |
+
+        in O(n^2) instead of decomposing A' again in O(n^3). The pivoting of A is kept, the new row is
+        not permuted:
+
+            L' = | L      0 |     U' = | U  u |     with  L * u = P * column,
+                 | l^T    1 |          | 0  d |           U^T * l = row,
+                                                          d = corner - l^T * u.
+
+        The rows of the buffer are moved to the new dimension, if the buffer is large enough. Otherwise
+        it grows by LU_BORDER_RESERVE rows and columns, so that the next borders are added in place.
+        If the new pivot d is (nearly) 0, the decomposition of A' would be unstable: it stays untouched
+        then and the matrix has to be decomposed again (see lu_factorize).
+
+        INPUT:
+        struct usr_factorization *fac	...	pointer to the factorization object (see lu_factorize)
+        double *column			...	new column (rows 0 ... n-1)
+        double *row			...	new row (columns 0 ... n-1)
+        double corner			...	new value on the diagonal
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+        pivot (nearly) 0		...	2 (the decomposition is unchanged)
+    */
+
+    int idx, jdx;
+    int n = fac->n;
+    int capacity;
+    int *pivot;
+    double amax = fabs(corner);		// maximum absolute value of the border and the diagonal of U
+    double d, tmp;
+    double *u, *l, *A;
+    const double *row_lu;
+
+    if ((fac->lu == NULL) || (fac->pivot == NULL)){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The matrix has not been factorized!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    u = (double *) malloc(2 * (size_t)n * sizeof(double));
+    if (u == NULL){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    l = &u[n];
+
+    for (idx=0; idx<n; idx++){
+        amax = (fabs(column[idx]) > amax) ? fabs(column[idx]) : amax;
+        amax = (fabs(row[idx]) > amax) ? fabs(row[idx]) : amax;
+    }
+
+    // u = L^-1 * P * column (see lu_solve):
+    memcpy(u, column, n * sizeof(double));
+    for (idx=0; idx<n; idx++){
+        if (fac->pivot[idx] != idx){
+            tmp = u[idx];
+            u[idx] = u[fac->pivot[idx]];
+            u[fac->pivot[idx]] = tmp;
+        }
+    }
+    for (idx=1; idx<n; idx++){
+
+        row_lu = &fac->lu[(size_t)idx*n];
+        tmp = u[idx];
+        for (jdx=0; jdx<idx; jdx++){
+            tmp -= row_lu[jdx] * u[jdx];
+        }
+        u[idx] = tmp;
+    }
+
+    // l = U^-T * row, the rows of U are read one after another:
+    memcpy(l, row, n * sizeof(double));
+    for (idx=0; idx<n; idx++){
+
+        row_lu = &fac->lu[(size_t)idx*n];
+        amax = (fabs(row_lu[idx]) > amax) ? fabs(row_lu[idx]) : amax;
+
+        l[idx] /= row_lu[idx];
+        for (jdx=idx+1; jdx<n; jdx++){
+            l[jdx] -= row_lu[jdx] * l[idx];
+        }
+    }
+
+    // the new pivot (Schur complement of A):
+    d = corner;
+    for (idx=0; idx<n; idx++){
+        d -= l[idx] * u[idx];
+    }
+    if ((!isfinite(d)) || (fabs(d) <= (n + 1) * DBL_EPSILON * amax)){
+        free(u);
+        return 2;
+    }
+
+    // room for the new row and column:
+    if (fac->capacity < n + 1){
+
+        capacity = n + 1 + LU_BORDER_RESERVE;
+        A = (double *) malloc((size_t)capacity * capacity * sizeof(double));
+        pivot = (int *) malloc(capacity * sizeof(int));
+        if ((A == NULL) || (pivot == NULL)){
+            free(A);
+            free(pivot);
+            free(u);
+            fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        for (idx=0; idx<n; idx++){
+            memcpy(&A[(size_t)idx*(n+1)], &fac->lu[(size_t)idx*n], n * sizeof(double));
+        }
+        memcpy(pivot, fac->pivot, n * sizeof(int));
+
+        free_factorization(fac);
+        fac->lu = A;
+        fac->pivot = pivot;
+        fac->capacity = capacity;
+    }
+    else{
+
+        // the rows move backwards, beginning with the last one (row 0 stays):
+        A = fac->lu;
+        for (idx=n-1; idx>0; idx--){
+            memmove(&A[(size_t)idx*(n+1)], &A[(size_t)idx*n], n * sizeof(double));
+        }
+    }
+
+    for (idx=0; idx<n; idx++){
+        A[(size_t)idx*(n+1) + n] = u[idx];
+    }
+    memcpy(&A[(size_t)n*(n+1)], l, n * sizeof(double));
+    A[(size_t)n*(n+1) + n] = d;
+
+    fac->pivot[n] = n;
+    fac->n = n + 1;
+
+    free(u);
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void free_factorization(struct usr_factorization *fac){
+
+    free(fac->lu);
+    free(fac->pivot);
+
+    fac->lu = NULL;
+    fac->pivot = NULL;
+    fac->capacity = 0;
+}
@@ -5,15 +5,41 @@
     #include <string.h>
     #include <math.h>
     #include <stdbool.h>
+    #include "arena.h"
     #include "regression.h"
+    #include "variogram_fit.h"
+    #include "matrix.h"
+    #include "factorization.h"
     #include <setjmp.h>
     #include <errno.h>
+    #include <stdint.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <pthread.h>
+    #include <stdatomic.h>
+    #include <unistd.h>
 #endif
 
 #define NO_VALUE -1.0
 #define M_PI 3.14159265358979323846
 #define EPS 1.0E-3
 #define RADIUS_EARTH 6365.265
+#define RASTER_MAGIC "RSTR"					// magic number of the binary raster file
+#define RASTER_VERSION 1					// version of the binary raster file
+#define RASTER_HEADER_SIZE 64					// size (bytes) of the header of the binary raster file
+#define RASTER_BIN_EXT ".bin"					// extension of the binary raster file
+#define RASTER_CSV_EXT ".csv"					// extension of the csv raster files
+#define CSV_FIELD_MAX 32					// maximum number of characters of a number in the csv files
+#define CSV_MAX_DECIMALS 9					// maximum number of decimals of the csv formatter
+#define CSV_VALUE_DECIMALS 3					// decimals of the values in the csv files
+#define CSV_COORD_DECIMALS 4					// decimals of the latitudes/longitudes in the csv files
+#define INPUT_DATA_CAPACITY 256					// initial number of stations of the input dataset (grows as needed)
+#define ROW_BLOCK 4						// number of raster rows a thread takes at once during the interpolation
+#define VARIO_PAIRS_PER_THREAD 1000000				// minimum number of pairs of stations per thread of the variogram
+#define DISTANCE_PAIRS_PER_THREAD 250000			// minimum number of pairs of stations per thread of the distance matrix
+#define STATION_INDEX_FILL 2					// average number of stations per cell of the station index
+#define BATCH_FIELDS_PER_PASS 8					// maximum number of fields (rasters) of the batch that are interpolated in one pass
 
 
 // Deklaration: Funktion
@@ -28,187 +54,258 @@ int set_config(struct usr_map *Map, int argc, char **argv);							// reads the a
 
 int fill_raster_with_default_data(struct usr_map *Map);
 int input_csv_data(struct usr_map *Map, char *input_datafile);
+const char *parse_decimal(const char *text, const char *end, double *value);
+const char *skip_blanks(const char *text, const char *end);
 int fill_raster_with_input_data(struct usr_map *Map);
+int snap_station_to_raster(struct usr_raster *raster, double lat, double lon, int *row_idx, int *col_idx);
+int compare_raster_stations(const void *a, const void *b);
+int report_station_collisions(struct usr_raster *raster, struct usr_dataset *input_data);
 int create_variogram(struct usr_map *Map);
+void *create_variogram_worker(void *arg);
+int get_variogram_class(struct usr_variogram *variogram, double distance);
 int interpolate_raster(struct usr_map *Map);
-int correct_negative_weights(double *weights_vector, double *cov_vector, int length);
-int outputRasterCSV(struct usr_data_point **raster, char *output_dir, char *filename, int rows, int cols, bool show_output);
+int interpolate_raster_point(struct usr_map *Map, int row, int col, double *cov_vector, double *weights_vector);
+int interpolate_raster_point_dual(struct usr_map *Map, int row, int col, double *cov_vector);
+int interpolate_raster_point_local(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int col);
+int interpolate_raster_point_fields(struct usr_map *Map, int row, int col, double *cov_vector, double *weights_vector);
+int outputRasterCSV(struct usr_raster *raster, char *output_dir, char *filename, char decimal_separator, char field_separator, int max_threads, bool show_output);
+void *output_raster_csv_worker(void *arg);
+int format_fixed(char *text, double value, int decimals, char decimal_separator);
+int csv_buffer_reserve(struct usr_csv_buffer *buffer, size_t size);
+void free_csv_threads(struct usr_csv_thread *threads, int num_threads);
+int outputRasterBinary(struct usr_raster *raster, char *output_dir, char *filename, bool show_output);
 int get_output_information(struct usr_map *Map);
 int get_variogram_model(struct usr_map *Map);
-int *create_vector(int length);
 int get_dvector_max(int *values, int length);
 int get_dvector_min(int *values, int length);
 int show_map_info(struct usr_map *Map);
 int show_input_data(struct usr_map *Map);
 int show_variogram_data(struct usr_map *Map);
-int show_matrix(char *name, double **matrix, int rows, int cols, bool show_output);
-int check_matrix(double **matrix, int rows, int cols, bool show_output);
+int show_matrix(char *name, struct usr_matrix *matrix, int rows, int cols, bool show_output);
+int check_matrix(struct usr_matrix *matrix, bool show_output);
 int create_covariance_matrix(struct usr_map *Map);
-int create_inverted_covariance_matrix(struct usr_map *Map);
+int factorize_covariance_matrix(struct usr_map *Map);
+int create_dual_coefficients(struct usr_map *Map);
 int create_distance_matrix(struct usr_map *Map);
-int multiplyMatrixVector(double **matrix, double *vector_in, double *weights_vector, int rows, int cols);
+void *create_distance_matrix_worker(void *arg);
 int find_model_adjust_index(struct usr_map *Map, double *variogram_variances, int length);
       
-double calc_distance(double latA, double lonA, double latB, double lonB);
-double calc_covariance(double distance, double sill, double nugget, double range);
-double calc_RSME(double *values1, double *values2, int length);
+double raster_lat(struct usr_raster *raster, int row);
+double raster_lon(struct usr_raster *raster, int col);
+
+// kernels of the hot paths (no checks, see input_csv_data / set_config / row_is_finite):
+static inline double calc_distance(double latA, double lonA, double latB, double lonB);
+static inline double clamp_unit(double value);
+static inline bool row_is_finite(const double *values, int length);
+static inline double calc_covariance(double distance, double sill, double nugget, double range, int model);
+static inline double calc_kriging_variance(double *weights_vector, double *cov_vector, int length);
+static inline void correct_negative_weights(double *weights_vector, double *cov_vector, int length);
+static inline void grid_distances(struct usr_grid_distance *grid, int row, int col, double *distances);
+
+int create_grid_distance(struct usr_arena *arena, struct usr_grid_distance *grid, struct usr_raster *raster, struct usr_dataset *input_data);
+
+bool is_local_kriging(struct usr_map *Map);
+int create_station_index(struct usr_arena *arena, struct usr_station_index *index, struct usr_dataset *input_data);
+int station_index_cell(struct usr_station_index *index, double lat, double lon);
+int find_nearest_stations(struct usr_station_index *index, struct usr_dataset *input_data, double lat, double lon,
+                          int k, double radius, struct usr_neighbourhood *nb);
+int create_neighbourhood(struct usr_arena *arena, struct usr_neighbourhood *nb, int max_neighbours);
+int create_local_system(struct usr_arena *arena, struct usr_local_system *local, int max_stations);
+int setup_local_system(struct usr_map *Map, struct usr_local_system *local, struct usr_neighbourhood *nb, double *rhs);
+void free_local_system(struct usr_local_system *local);
 double get_fvector_max(double *values, int length);
 double get_fvector_min(double *values, int length);
-double **create_fmatrix(int rows, int cols);
-double *create_fvector(int length);
+
+void *interpolate_raster_worker(void *arg);
 
 void free_raster(struct usr_map *Map);
 void free_vector(struct usr_map *Map);
+void apply_station_overlay(struct usr_raster *raster, struct usr_dataset *input_data);
+void apply_field_overlay(struct usr_raster *raster, struct usr_dataset *input_data, int field);
+void free_interpol_threads(struct usr_interpol_thread *threads, int num_threads);
 
 
 // ##################################################################################################
 // ##################################### Definition: Funktionen #####################################
 
-int create_maps_raster(struct usr_data_point ***raster, int rows, int cols){
+int create_maps_raster(struct usr_arena *arena, struct usr_raster *raster, int rows, int cols){
 
     /*
     
         DESCRIPTION:
-        Initialize an raster of dimensions "Map->rows" x "Map->cols" of type struct usr_data_point.
+        Initialize an raster of dimensions "rows" x "cols".
+        The values of all raster points are stored row by row within one contiguous block of memory
+        out of the arena, aligned to ARENA_ALIGN bytes. The coordinates are not stored, they follow out of the
+        geometry of the raster (see raster_lat / raster_lon).
         
         INPUT:
-        struct usr_data_point ***rasters	...	pointer to the maps 2d raster
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_raster *raster		...	pointer to the maps raster
         int rows				...	number of rows
         int cols				...	number of cols
     
         OUTPUT:(error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE       
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE       
      
     */
     
-    int idx, jdx;
     int excno;
     jmp_buf env;    
     
     if ((excno = setjmp(env)) == 0){
 
-        struct usr_data_point **zgr;
-
-
-        zgr = (struct usr_data_point **) malloc(rows * sizeof(struct usr_data_point *));
-        if (zgr == NULL){
-            longjmp(env, 1);
+        if ((rows <= 0) || (cols <= 0)){
+            longjmp(env, 2);
         }
-        else{
-            for (idx=0; idx<rows; idx++){
         
-                zgr[idx] = (struct usr_data_point *) malloc(cols * sizeof(struct usr_data_point));        
-                if (zgr[idx] == NULL){
-                    
-                    // clean the already allocated memory
-                    for (jdx=0; jdx<idx; jdx++){
-                        free(zgr[jdx]);
-                    }
-                    free(zgr);
-                    longjmp(env, 1);
-                }
-            }
-            // assign the address of the matrix to the raster address.
-            *raster = zgr;
+        raster->value = (double *) arena_alloc(arena, (size_t)rows * cols * sizeof(double));
+        if (raster->value == NULL){
+            longjmp(env, 1);
         }
+        
+        raster->rows = rows;
+        raster->cols = cols;
+        raster->num_stations = 0;
+        raster->stations = NULL;
+        
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
             case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure during the attempt to allocate memory\n--> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
         }
     } 
 }
 
+
 // ##################################################################################################
 // ##################################################################################################
 
 
-int set_config(struct usr_map *Map, int argc, char **argv){
+double raster_lat(struct usr_raster *raster, int row){
 
     /*
         DESCRIPTION:
-        Reads the given arguments and performs some calculations to complete the intern configuration.
+        Returns the latitude (decimal degree) of a row of the raster.
+    */
+    
+    return raster->maxLat - row*(raster->latRes);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double raster_lon(struct usr_raster *raster, int col){
+
+    /*
+        DESCRIPTION:
+        Returns the longitude (decimal degree) of a column of the raster.
+    */
     
+    return raster->minLon + col*(raster->lonRes);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_grid_distance(struct usr_arena *arena, struct usr_grid_distance *grid, struct usr_raster *raster, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Precomputes the trigonometric terms of the distances between the raster points and the stations.
+        
+        The raster is a regular grid of latitudes and longitudes. So the sine and cosine of the
+        latitude only depend on the row and the cosine of the difference of the longitudes only
+        depends on the column and the station. With these tables the distance of a raster point
+        to a station (see grid_distances) needs 3 multiplications, 1 addition and 1 acos.
+        The terms are calculated exactly as in calc_distance, so the distances are identical.
+        
         INPUT:
-        struct usr_map *zgr	...	pointer to the "map" object of datatype "struct usr_map".
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_grid_distance *grid		...	pointer to the object of the tables
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
     
         OUTPUT:(error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
-       
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
     */
 
-    int idx;
+    int idx, jdx;
     int excno;
     jmp_buf env;
-    double cols;
-    
-    
     
     if ((excno = setjmp(env)) == 0){
-
-        // read the arguments:
-        for (idx=0; idx<argc; idx++){
-        
-            // correct negative weights?
-            if (!strcmp(argv[idx],"-c")){
-                Map->weights_correction = true;
-            }
-            
-            // show output during calculations?
-            if (!strcmp(argv[idx],"-o")){
-                Map->show_output = true;
-            }
-            
-            if ((!strcmp(argv[idx],"-co")) || (!strcmp(argv[idx],"-oc"))){
-                Map->show_output = true;
-                Map->weights_correction = true;
-            }                     
-        }
     
-        // check rows to be greater then 0;
-        if (Map->rows <= 0){
+        double lat_rad, lon_rad;
+        double *col_cos_dlon;
+        
+        if ((raster->rows <= 0) || (raster->cols <= 0) || (input_data->length <= 0)){
             longjmp(env, 1);
         }
-        // check maxLon & minLon to be greater then 0;        
-        if ((Map->maxLon <= 0) || (Map->minLon <= 0)){
+        
+        grid->rows = raster->rows;
+        grid->cols = raster->cols;
+        grid->num_stations = input_data->length;
+        
+        grid->row_sin = (double *) arena_alloc(arena, grid->rows * sizeof(double));
+        grid->row_cos = (double *) arena_alloc(arena, grid->rows * sizeof(double));
+        grid->station_sin = (double *) arena_alloc(arena, grid->num_stations * sizeof(double));
+        grid->station_cos = (double *) arena_alloc(arena, grid->num_stations * sizeof(double));
+        grid->col_cos_dlon = (double *) arena_alloc(arena, (size_t)grid->cols * grid->num_stations * sizeof(double));
+        
+        if ((grid->row_sin == NULL) || (grid->row_cos == NULL) || 
+            (grid->station_sin == NULL) || (grid->station_cos == NULL) || (grid->col_cos_dlon == NULL)){
             longjmp(env, 2);
         }
-        // check maxLat & minLat to be greater then 0;        
-        if ((Map->maxLat <= 0) || (Map->minLat <= 0)){
-            longjmp(env, 3);
-        }        
         
-        // calculate the number of columns:
-        cols = ceil(Map->rows * (double)(Map->maxLon - Map->minLon) / (double)(Map->maxLat - Map->minLat));
+        // latitude of the rows (point A in calc_distance):
+        for (idx=0; idx<grid->rows; idx++){
         
-        if (!(isnan(cols)) || (!(isinf(cols)))){
-            Map->cols = (int)cols;
+            lat_rad = (raster_lat(raster, idx)/180.0) * M_PI;
+            grid->row_sin[idx] = sin(lat_rad);
+            grid->row_cos[idx] = cos(lat_rad);
         }
-        else{
-            longjmp(env, 4);
+        
+        // latitude of the stations (point B in calc_distance):
+        for (jdx=0; jdx<grid->num_stations; jdx++){
+        
+            if ((isnan(input_data->data[jdx].lat)) || (isinf(input_data->data[jdx].lat)) ||
+                (isnan(input_data->data[jdx].lon)) || (isinf(input_data->data[jdx].lon))){
+                longjmp(env, 3);
+            }
+            
+            lat_rad = (input_data->data[jdx].lat/180.0) * M_PI;
+            grid->station_sin[jdx] = sin(lat_rad);
+            grid->station_cos[jdx] = cos(lat_rad);
         }
         
-        // Calculate the resolution of the matrix in decimal degree:
-        Map->lonRes = (Map->maxLon - Map->minLon) / (Map->cols-1);
-        Map->latRes= (Map->maxLat - Map->minLat) / (Map->rows-1);
-    
-        // Calculate the resolution of the matrix in kilometer:
-        Map->latMetRes = calc_distance(0.0, 0.0, Map->latRes, 0);		// Distance to the origin of the coordinates (y)
-        Map->lonMetRes = calc_distance(0.0, 0.0, 0.0, Map->lonRes);		// Distance to the origin of the coordinates (x)
+        // difference of the longitudes between every column and every station:
+        for (idx=0; idx<grid->cols; idx++){
+        
+            lon_rad = (raster_lon(raster, idx)/180.0) * M_PI;
+            col_cos_dlon = &(grid->col_cos_dlon[(size_t)idx * grid->num_stations]);
+            
+            for (jdx=0; jdx<grid->num_stations; jdx++){
+                col_cos_dlon[jdx] = cos(((input_data->data[jdx].lon/180.0) * M_PI) - lon_rad);
+            }
+        }
         
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of maxLon and minLon must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The number of maxLat and minLat must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The calculated number of columns of the output raster is \"NAN\" or \"INF\"!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;        
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The raster and the input dataset must not be empty!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> One of the coordinates of the stations is equal to \"NAN\" or \"INF\"\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
 }
@@ -218,78 +315,157 @@ int set_config(struct usr_map *Map, int argc, char **argv){
 // ##################################################################################################
 
 
-int fill_raster_with_default_data(struct usr_map *Map){
+static inline void grid_distances(struct usr_grid_distance *grid, int row, int col, double *distances){
 
     /*
         DESCRIPTION:
-        Fills any point of the raster with default data.
-    
+        Calculates the distances of a raster point to all stations with the help of the
+        precomputed tables (see create_grid_distance). Kernel without any checks, the
+        cosine is clamped like in calc_distance.
+        
         INPUT:
-        struct usr_map *Map	...	pointer to map object
-        int rows		...	number of rows
-        int cols		...	number of cols
+        struct usr_grid_distance *grid	...	pointer to the object of the tables
+        int row				...	row index of the raster point
+        int col				...	column index of the raster point
+        double *distances		...	distances (km) to the stations, vector of length grid->num_stations
+    */
+
+    int idx;
+    double row_sin = grid->row_sin[row];
+    double row_cos = grid->row_cos[row];
+    const double *station_sin = grid->station_sin;
+    const double *station_cos = grid->station_cos;
+    const double *col_cos_dlon = &(grid->col_cos_dlon[(size_t)col * grid->num_stations]);
+    
+    for (idx=0; idx<grid->num_stations; idx++){
+        distances[idx] = RADIUS_EARTH * acos( clamp_unit( (row_sin * station_sin[idx]) + ( row_cos * station_cos[idx] * col_cos_dlon[idx] ) ) );
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+bool is_local_kriging(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Local kriging: every raster point is interpolated by its "Map->num_neighbours" nearest stations
+        and/or by the stations within "Map->search_radius" km.
+    */
+
+    return (Map->num_neighbours > 0) || (Map->search_radius > 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_station_index(struct usr_arena *arena, struct usr_station_index *index, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Creates a spatial index of the stations: a regular grid of latitudes and longitudes over the
+        extent of the stations with about STATION_INDEX_FILL stations per cell. The stations of every
+        cell are stored one after the other (index->stations), the first entry of every cell is
+        given by index->cell_start.
+        
+        INPUT:
+        struct usr_arena *arena			...	pointer to the arena
+        struct usr_station_index *index		...	pointer to the object of the index
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
     
         OUTPUT:(error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
-        
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
     */
 
-
-    int idx, jdx;
+    int idx, cell;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
-
-        // check for rows greater then 0:
-        if (Map->rows <= 0){
+    
+        int num_cells;
+        int *fill;
+        double maxLat, maxLon, height, width;
+        struct usr_arena_mark scratch;
+        
+        if (input_data->length <= 0){
             longjmp(env, 1);
         }
         
-        // check for columns greater then 0:
-        if (Map->cols <= 0){
-            longjmp(env, 2);
+        // extent of the stations:
+        index->minLat = maxLat = input_data->data[0].lat;
+        index->minLon = maxLon = input_data->data[0].lon;
+        index->maxAbsLat = 0;
+        
+        for (idx=0; idx<input_data->length; idx++){
+        
+            if ((isnan(input_data->data[idx].lat)) || (isinf(input_data->data[idx].lat)) ||
+                (isnan(input_data->data[idx].lon)) || (isinf(input_data->data[idx].lon))){
+                longjmp(env, 3);
+            }
+            
+            index->minLat = (input_data->data[idx].lat < index->minLat) ? input_data->data[idx].lat : index->minLat;
+            index->minLon = (input_data->data[idx].lon < index->minLon) ? input_data->data[idx].lon : index->minLon;
+            maxLat = (input_data->data[idx].lat > maxLat) ? input_data->data[idx].lat : maxLat;
+            maxLon = (input_data->data[idx].lon > maxLon) ? input_data->data[idx].lon : maxLon;
+            index->maxAbsLat = (fabs(input_data->data[idx].lat) > index->maxAbsLat) ? fabs(input_data->data[idx].lat) : index->maxAbsLat;
         }
         
-        // check for lonRes greater then 0: 
-        if (Map->lonRes <= 0){
-            longjmp(env, 3);
+        // number of rows and columns, so that the cells are about square (km):
+        num_cells = (input_data->length / STATION_INDEX_FILL > 1) ? input_data->length / STATION_INDEX_FILL : 1;
+        height = maxLat - index->minLat;
+        width = (maxLon - index->minLon) * cos(((index->minLat + maxLat) / 360.0) * M_PI);
+        
+        if ((height > 0) && (width > 0)){
+            index->rows = (int)round(sqrt(num_cells * height / width));
+            index->rows = (index->rows < 1) ? 1 : ((index->rows > num_cells) ? num_cells : index->rows);
+            index->cols = num_cells / index->rows;
+        }
+        else{
+            index->rows = (height > 0) ? num_cells : 1;
+            index->cols = (width > 0) ? num_cells : 1;
         }
         
-        // check for latRes greater then 0: 
-        if (Map->latRes <= 0){
-            longjmp(env, 4);
-        }        
+        index->cellLat = (height > 0) ? height / index->rows : 1.0;
+        index->cellLon = (maxLon > index->minLon) ? (maxLon - index->minLon) / index->cols : 1.0;
         
-        // fill any point of the raster with default data.
-        for (idx=0; idx<Map->rows; idx++){
-    
-            for (jdx=0; jdx<Map->cols; jdx++){
+        index->cell_start = (int *) arena_alloc(arena, (index->rows * index->cols + 1) * sizeof(int));
+        index->stations = (int *) arena_alloc(arena, input_data->length * sizeof(int));
+        scratch = arena_mark(arena);
+        fill = (int *) arena_alloc(arena, index->rows * index->cols * sizeof(int));
+        if ((index->cell_start == NULL) || (index->stations == NULL) || (fill == NULL)){
+            longjmp(env, 2);
+        }
         
-                // set the indices:
-                Map->raster[idx][jdx].row_idx = idx;
-                Map->raster[idx][jdx].col_idx = jdx;
-            
-                // set the coordinates:
-                Map->raster[idx][jdx].lon = (Map->minLon) + jdx*(Map->lonRes);
-                Map->raster[idx][jdx].lat = (Map->maxLat) - idx*(Map->latRes);            
-            
-                // set the default values:
-                Map->raster[idx][jdx].value = NO_VALUE;
-            }
+        // count the stations of every cell, then sort them into the cells:
+        for (idx=0; idx<input_data->length; idx++){
+            cell = station_index_cell(index, input_data->data[idx].lat, input_data->data[idx].lon);
+            index->cell_start[cell+1]++;
         }
+        for (cell=0; cell<index->rows * index->cols; cell++){
+            index->cell_start[cell+1] += index->cell_start[cell];
+        }
+        for (idx=0; idx<input_data->length; idx++){
+            cell = station_index_cell(index, input_data->data[idx].lat, input_data->data[idx].lon);
+            index->stations[index->cell_start[cell] + fill[cell]++] = idx;
+        }
+        
+        arena_rewind(arena, scratch);
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The resolution of longitude must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The resolution of latitude must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;                            
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
-        } 
-    }   
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> One of the coordinates of the stations is equal to \"NAN\" or \"INF\"\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
 }
 
 
@@ -297,163 +473,132 @@ int fill_raster_with_default_data(struct usr_map *Map){
 // ##################################################################################################
 
 
-int input_csv_data(struct usr_map *Map, char *input_datafile){
+int station_index_cell(struct usr_station_index *index, double lat, double lon){
 
     /*
         DESCRIPTION:
-        Reads the input dataset provided by the csv-file in the input directory.
+        Returns the cell of the station index of a point. Points outside the index are assigned to the nearest cell of the border.
+    */
+
+    int row, col;
     
-        INPUT:
-        struct usr_map *Map	...	pointer to map object
-        char *input_datafile	...	filename of the input datafile in the input directory
+    row = (int)floor((lat - index->minLat) / index->cellLat);
+    col = (int)floor((lon - index->minLon) / index->cellLon);
     
-        OUTPUT:(error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+    row = (row < 0) ? 0 : ((row >= index->rows) ? index->rows - 1 : row);
+    col = (col < 0) ? 0 : ((col >= index->cols) ? index->cols - 1 : col);
+    
+    return row * index->cols + col;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int find_nearest_stations(struct usr_station_index *index, struct usr_dataset *input_data, double lat, double lon,
+                          int k, double radius, struct usr_neighbourhood *nb){
+
+    /*
+        DESCRIPTION:
+        Finds the k nearest stations of a point (optional within a radius) by the station index.
+        
+        The cells of the index are searched ring by ring around the cell of the point. After every ring
+        a lower limit of the distance to all stations outside of the searched rings is calculated:
+        in direction of the latitude by the width of the rings, in direction of the longitude by
+        sin(d/2R) >= cos(lat_max) * sin(dlon/2) (haversine formula). The search stops, as soon as this
+        limit exceeds the distance of the k-th station or the radius.
         
+        The stations are sorted by their distance, stations with the same distance by their index.
+        So the result does not depend on the order of the search.
+        
+        INPUT:
+        struct usr_station_index *index		...	pointer to the station index
+        struct usr_dataset *input_data		...	pointer to the input dataset (stations)
+        double lat, lon				...	coordinates of the point
+        int k					...	number of stations (at most nb->max_neighbours)
+        double radius				...	search radius in km (0 => unlimited)
+        struct usr_neighbourhood *nb		...	nearest stations and their distances
+    
+        OUTPUT:
+        number of stations found
     */
-      
-    jmp_buf env;
 
-    FILE *fp;
-    int rows = 0;
-    int idx, jdx;
-    int excno;
+    int ring, max_ring, row, col, step, row0, col0;
+    int idx, pos, sidx, cell;
+    double distance, bound_lat, bound_lon, cos_lat_max;
     
-    double sum = 0; 
-    double *values_array;
+    k = (k < nb->max_neighbours) ? k : nb->max_neighbours;
+    nb->num_neighbours = 0;
     
-    char inputRow[255];
-    char inputDecimal[20];
-    char path[100];
+    cell = station_index_cell(index, lat, lon);
+    row0 = cell / index->cols;
+    col0 = cell % index->cols;
     
+    max_ring = (index->rows > index->cols) ? index->rows : index->cols;
+    cos_lat_max = cos((((fabs(lat) > index->maxAbsLat) ? fabs(lat) : index->maxAbsLat) / 180.0) * M_PI);
     
+    for (ring=0; ring<=max_ring; ring++){
     
-    if ((excno = setjmp(env)) == 0){
+        // the cells of the ring:
+        for (row=row0-ring; row<=row0+ring; row++){
         
-        // open input file:
-        fp = fopen(strcat(strcpy(path,Map->config.input_dir), input_datafile), "r");
-        if (fp == NULL){
-            longjmp(env, 1);
-        }
-        else{
-            // determine the length of the dataset (number of values)
-            while (fgets(inputRow, 255, fp) != NULL){
-                rows++;
-            }
-            
-            // check for rows ist greater then 0:
-            if (rows <= 0){
-                longjmp(env, 2);
-            }
-            else{
-                // Länge des Input_Datensatzes übergeben:
-                Map->input_data.length = rows-1;
-            }
-        
-            /* 
-            allocate memory of type usr_data_point.
-            contains:
-               - stationname
-               - geogr. latitude
-               - geogr. longitude
-               - value
-            */
-            Map->input_data.data = (struct usr_data_point*) malloc(rows * sizeof(struct usr_data_point));
-            if (Map->input_data.data == NULL){
-                longjmp(env, 3);
+            if ((row < 0) || (row >= index->rows)){
+                continue;
             }
             
-            idx = 0;
-            // set the pointer to the start of the file:
-            fseek(fp, 0, SEEK_SET);
-            
-            // read the data row by row:
-            while (fgets(inputRow, 255, fp) != NULL){
+            // within the ring only the first and the last column:
+            step = ((row == row0-ring) || (row == row0+ring) || (ring == 0)) ? 1 : 2*ring;
             
-                if (idx > 0){
-                    // Einlesen des Stationsnamens:
-                    strcpy(Map->input_data.data[idx-1].name, strtok(inputRow, ";"));
+            for (col=col0-ring; col<=col0+ring; col+=step){
             
-                    // Einlesen der geogr. Breite:
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
-            
-                        if (inputDecimal[jdx] == ','){
+                if ((col < 0) || (col >= index->cols)){
+                    continue;
+                }
                 
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
-                    }
-                    Map->input_data.data[idx-1].lat = atof(inputDecimal);
-            
-                    // Einlesen der geogr. Länge:            
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
-            
-                        if (inputDecimal[jdx] == ','){
+                cell = row * index->cols + col;
+                for (idx=index->cell_start[cell]; idx<index->cell_start[cell+1]; idx++){
                 
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
+                    sidx = index->stations[idx];
+                    distance = calc_distance(lat, lon, input_data->data[sidx].lat, input_data->data[sidx].lon);
+                    
+                    if ((radius > 0) && (distance > radius)){
+                        continue;
                     }
-                    Map->input_data.data[idx-1].lon = atof(inputDecimal);  
-            
-                    // Einlesen des Messwerts:         
-                    strcpy(inputDecimal, strtok(NULL, ";"));
-                    for (jdx=0; jdx<(int)strlen(inputDecimal); jdx++){
-            
-                        if (inputDecimal[jdx] == ','){
-                
-                            inputDecimal[jdx] = '.';
-                            break;
-                        }
+                    
+                    // insert the station into the sorted list of the nearest stations:
+                    pos = nb->num_neighbours;
+                    while ((pos > 0) && ((distance < nb->distances[pos-1]) ||
+                                         ((distance == nb->distances[pos-1]) && (sidx < nb->station_idx[pos-1])))){
+                        pos--;
                     }
-                    Map->input_data.data[idx-1].value = atof(inputDecimal);             
-                    idx++;
-                }
-                else{
-                    idx++;
-                    continue;
-                }
-            }
-        
-        
-            // determine statistical metadata over the input datasets.
-            Map->input_data.minimum = Map->input_data.data[0].value;
-            Map->input_data.maximum = Map->input_data.data[0].value;
-            Map->input_data.average = Map->input_data.data[0].value;
-                
-            for (idx=0; idx<Map->input_data.length; idx++){
-        
-                sum += Map->input_data.data[idx].value;
-        
-                if (Map->input_data.data[idx].value < Map->input_data.minimum){
-            
-                    Map->input_data.minimum = Map->input_data.data[idx].value;
-                }
-            
-                if (Map->input_data.data[idx].value > Map->input_data.maximum){
-            
-                    Map->input_data.maximum = Map->input_data.data[idx].value;
+                    if (pos >= k){
+                        continue;
+                    }
+                    if (nb->num_neighbours < k){
+                        nb->num_neighbours++;
+                    }
+                    memmove(&(nb->distances[pos+1]), &(nb->distances[pos]), (nb->num_neighbours - 1 - pos) * sizeof(double));
+                    memmove(&(nb->station_idx[pos+1]), &(nb->station_idx[pos]), (nb->num_neighbours - 1 - pos) * sizeof(int));
+                    nb->distances[pos] = distance;
+                    nb->station_idx[pos] = sidx;
                 }
             }
+        }
         
-            Map->input_data.average = (double)(sum / Map->input_data.length);
+        // lower limit of the distance to the stations outside of the searched rings:
+        bound_lat = RADIUS_EARTH * ((ring * index->cellLat) / 180.0) * M_PI;
+        bound_lon = 2 * RADIUS_EARTH * asin(cos_lat_max * sin(((((ring * index->cellLon) < 180.0) ? ring * index->cellLon : 180.0) / 360.0) * M_PI));
         
-            fclose(fp);
-            return EXIT_SUCCESS;
+        if ((nb->num_neighbours == k) && (fmin(bound_lat, bound_lon) >= nb->distances[k-1])){
+            break;
         }
-    }
-    // ##############################################################################################
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure when opening the csv-file:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The counted number of datapoints is 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 3: fprintf(stderr, "ERROR: %s --> %d:\n Failure when allocating the memory for the input dataset:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        if ((radius > 0) && (fmin(bound_lat, bound_lon) > radius)){
+            break;
         }
-    }    
+    }
+    
+    return nb->num_neighbours;
 }
 
 
@@ -461,59 +606,26 @@ int input_csv_data(struct usr_map *Map, char *input_datafile){
 // ##################################################################################################
 
 
-
-
-double **create_fmatrix(int rows, int cols){
+int create_neighbourhood(struct usr_arena *arena, struct usr_neighbourhood *nb, int max_neighbours){
 
     /*
         DESCRIPTION:
-        Allocates memory for a matrix of type double with the dimensions of rows x cols.
-        
-        INPUT:
-        int rows	...	number of rows.
-        int cols	...	number of columns.
-        
-        OUTPUT:
-        on success	...	pointer of type double to this matrix.
-        on failure	...	NULL       
+        Allocates the buffers for the nearest stations of a raster point out of the arena.
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
     */
 
-    int idx, jdx;
-    int excno;
-    jmp_buf env;
-    
-    if ((excno = setjmp(env)) == 0){   
+    nb->max_neighbours = max_neighbours;
+    nb->num_neighbours = 0;
+    nb->station_idx = (int *) arena_alloc(arena, max_neighbours * sizeof(int));
+    nb->distances = (double *) arena_alloc(arena, max_neighbours * sizeof(double));
     
-    
-        double **zgr;
-    
-        zgr = (double **) calloc(rows, sizeof(double*));
-        if (zgr == NULL){
-            longjmp(env, 1);
-        }  
-        for (idx=0; idx<rows; idx++){
-        
-            zgr[idx] = (double *) calloc(cols, sizeof(double));
-            if (zgr[idx] == NULL){
-            
-                // clean up
-                for (jdx=0; jdx<idx; jdx++){
-                    free(zgr[jdx]);
-                }
-                free(zgr);
-                
-                longjmp(env, 1);
-            }
-        }
-        return zgr;
+    if ((nb->station_idx == NULL) || (nb->distances == NULL)){
+        return EXIT_FAILURE;
     }
-    // ##############################################################################################
-
-    switch(excno){
-        case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-        default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-    }     
-    
+    return EXIT_SUCCESS;
 }
 
 
@@ -521,91 +633,178 @@ double **create_fmatrix(int rows, int cols){
 // ##################################################################################################
 
 
-double *create_fvector(int length){
+int create_local_system(struct usr_arena *arena, struct usr_local_system *local, int max_stations){
 
     /*
         DESCRIPTION:
-        Allocates memory for a vector of datatype double and length. 
-        
-        INPUT:
-        int length	...	length of the vector you want to allocate.
-        
-        OUTPUT:
-        on success	...	pointer to this vector
-        on failure	...	NULL
-              
+        Allocates the buffers for the kriging system of at most max_stations stations (local kriging)
+        out of the arena. Only the LU decomposition is allocated separately (see free_local_system).
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
     */
 
-    jmp_buf env;
-    int idx;
-    int excno;
-
-    
-    if ((excno = setjmp(env)) == 0){
-    
-        double *zgr;
-        
-        zgr = (double *) calloc(length, sizeof(double));
-        if (zgr == NULL){
-            longjmp(env, 1);
-        }
-        else{
-            return zgr;
-        }   
-    }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n>>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-        }
+    local->num_stations = 0;
+    local->num_factorizations = 0;
+    local->factor.lu = NULL;
+    local->factor.pivot = NULL;
+    local->factor.capacity = 0;
+    local->station_idx = (int *) arena_alloc(arena, max_stations * sizeof(int));
+    local->coefficients = create_fvector(arena, max_stations+1);
+    
+    if ((local->station_idx == NULL) || (local->coefficients == NULL) || 
+        (create_matrix(arena, &(local->matrix), max_stations+1, max_stations+1, true) == EXIT_FAILURE)){
+        return EXIT_FAILURE;
     }
+    return EXIT_SUCCESS;
 }
 
 
-
-
 // ##################################################################################################
 // ##################################################################################################
 
 
-int *create_vector(int length){
+int set_config(struct usr_map *Map, int argc, char **argv){
 
     /*
         DESCRIPTION:
-        Allocates memory for a vector of datatype int and length. 
-        
+        Reads the given arguments and performs some calculations to complete the intern configuration.
+    
         INPUT:
-        int length	...	length of the vector you want to allocate.
-        
-        OUTPUT:
-        on success	...	pointer to this vector
-        on failure	...	NULL
-              
+        struct usr_map *zgr	...	pointer to the "map" object of datatype "struct usr_map".
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+       
     */
 
-    jmp_buf env;
     int idx;
     int excno;
-
+    jmp_buf env;
+    double cols;
+    
     
-    if ((excno = setjmp(env)) == 0){
     
-        int *zgr;
+    if ((excno = setjmp(env)) == 0){
+
+        // read the arguments:
+        for (idx=0; idx<argc; idx++){
+        
+            // correct negative weights?
+            if (!strcmp(argv[idx],"-c")){
+                Map->weights_correction = true;
+            }
+            
+            // show output during calculations?
+            if (!strcmp(argv[idx],"-o")){
+                Map->show_output = true;
+            }
+            
+            // output csv files instead of one binary file?
+            if (!strcmp(argv[idx],"-csv")){
+                Map->output_csv = true;
+            }
+            
+            if ((!strcmp(argv[idx],"-co")) || (!strcmp(argv[idx],"-oc"))){
+                Map->show_output = true;
+                Map->weights_correction = true;
+            }
+            
+            // calculate the kriging variance?
+            if (!strcmp(argv[idx],"-v")){
+                Map->kriging_variance = true;
+            }
+            
+            // variogram model:
+            if (!strcmp(argv[idx],"-m")){
+                if ((idx+1 >= argc) || (variogram_model_by_name(argv[idx+1]) < VARIO_MODEL_AUTO)){
+                    longjmp(env, 6);
+                }
+                Map->variogram.model = variogram_model_by_name(argv[++idx]);
+            }
+            
+            // local kriging with the n nearest stations:
+            if (!strcmp(argv[idx],"-k")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 7);
+                }
+                Map->num_neighbours = atoi(argv[++idx]);
+            }
+            
+            // local kriging with the stations within a radius (km):
+            if (!strcmp(argv[idx],"-r")){
+                if ((idx+1 >= argc) || (atof(argv[idx+1]) <= 0)){
+                    longjmp(env, 8);
+                }
+                Map->search_radius = atof(argv[++idx]);
+            }
+            
+            // number of threads to interpolate the raster:
+            if (!strcmp(argv[idx],"-t")){
+                if ((idx+1 >= argc) || (atoi(argv[idx+1]) <= 0)){
+                    longjmp(env, 5);
+                }
+                Map->num_threads = atoi(argv[++idx]);
+            }
+        }
         
-        zgr = (int *) calloc(length, sizeof(int));
-        if (zgr == NULL){
+        // use all available processors if the number of threads is not given:
+        if (Map->num_threads == 0){
+            Map->num_threads = (sysconf(_SC_NPROCESSORS_ONLN) > 0) ? (unsigned int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+        }
+    
+        // check rows to be greater then 1 (resolution);
+        if (Map->rows <= 1){
             longjmp(env, 1);
         }
+        // check maxLon & minLon to be greater then 0;        
+        if ((Map->maxLon <= 0) || (Map->minLon <= 0)){
+            longjmp(env, 2);
+        }
+        // check maxLat & minLat to be greater then 0;        
+        if ((Map->maxLat <= 0) || (Map->minLat <= 0)){
+            longjmp(env, 3);
+        }        
+        // check the raster to lie within the valid coordinates (no further checks of the coordinates during the interpolation):
+        if ((Map->minLat >= Map->maxLat) || (Map->maxLat > 90) || (Map->minLon >= Map->maxLon) || (Map->maxLon > 180)){
+            longjmp(env, 9);
+        }
+        
+        // calculate the number of columns:
+        cols = ceil(Map->rows * (double)(Map->maxLon - Map->minLon) / (double)(Map->maxLat - Map->minLat));
+        
+        if (!(isnan(cols)) || (!(isinf(cols)))){
+            Map->cols = (int)cols;
+        }
         else{
-            return zgr;
+            longjmp(env, 4);
         }
         
+        // Calculate the resolution of the matrix in decimal degree:
+        Map->lonRes = (Map->maxLon - Map->minLon) / (Map->cols-1);
+        Map->latRes= (Map->maxLat - Map->minLat) / (Map->rows-1);
+    
+        // Calculate the resolution of the matrix in kilometer:
+        Map->latMetRes = calc_distance(0.0, 0.0, Map->latRes, 0);		// Distance to the origin of the coordinates (y)
+        Map->lonMetRes = calc_distance(0.0, 0.0, 0.0, Map->lonRes);		// Distance to the origin of the coordinates (x)
+        
+        return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n>>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NULL;
-        }   
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows must be greater then 1!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of maxLon and minLon must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The number of maxLat and minLat must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The calculated number of columns of the output raster is \"NAN\" or \"INF\"!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;        
+            case 9: fprintf(stderr, "ERROR: %s --> %d:\n minLat must be less then maxLat (max. 90) and minLon less then maxLon (max. 180)!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n The argument \"-t\" requires a number of threads greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "ERROR: %s --> %d:\n The argument \"-k\" requires a number of stations greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "ERROR: %s --> %d:\n The argument \"-r\" requires a search radius (km) greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n The argument \"-m\" requires a variogram model (exponential, spherical, gaussian, matern or auto)!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
+        }
     }
 }
 
@@ -614,103 +813,85 @@ int *create_vector(int length){
 // ##################################################################################################
 
 
-
-int fill_raster_with_input_data(struct usr_map *Map){
+int fill_raster_with_default_data(struct usr_map *Map){
 
     /*
         DESCRIPTION:
-        writes the input dataset into the raster points of the map raster.
+        Fills any point of the raster with default data.
     
         INPUT:
         struct usr_map *Map	...	pointer to map object
+        int rows		...	number of rows
+        int cols		...	number of cols
     
         OUTPUT:(error code)
         on success		...	EXIT_SUCCESS
         on failure		...	EXIT_FAILURE
         
-    */ 
+    */
 
-    
-    int idx, jdx, kdx;
+
+    int idx;
     int excno;
     jmp_buf env;
     
-    
-    if ((excno = setjmp(env)) == 0){ 
-    
-        int min_row_idx, min_col_idx;
-        double mlat, mlon, distance;
-        double rlat, rlat_rad, rlon, rlon_rad;
-        double min_distance, min_mlat, min_mlon, min_rlat, min_rlon;
-        
-    
-        // output?
-        if (Map->show_output){
-            printf("Assign points to raster ... ");
-            fflush(stdout);
+    if ((excno = setjmp(env)) == 0){
+
+        // check for rows greater then 0:
+        if (Map->rows <= 0){
+            longjmp(env, 1);
         }
         
-        
-    
-        if (Map->input_data.length <= 0){
-            longjmp(env, 1);
+        // check for columns greater then 0:
+        if (Map->cols <= 0){
+            longjmp(env, 2);
         }
-    
-        for (idx=0; idx<Map->input_data.length; idx++){
-    
-            // the default distance is the highest distance between 2 points on earth 
-            min_distance = 44000.00;
         
-            // latitude and longitude of the station:
-            mlat = Map->input_data.data[idx].lat;
-            mlon = Map->input_data.data[idx].lon;
+        // check for lonRes greater then 0: 
+        if (Map->lonRes <= 0){
+            longjmp(env, 3);
+        }
         
-            // find the shortest distance between the station and a raster point
-            for (jdx=0; jdx<Map->rows; jdx++){
-                for (kdx=0; kdx<Map->cols; kdx++){
-            
-                    // latitude and longitude of the raster point:
-                    rlat = Map->raster[jdx][kdx].lat;
-                    rlon = Map->raster[jdx][kdx].lon;
-                            
-                    // Distance on a sphere with radius at 51°N.
-                    distance = calc_distance(mlat, mlon, rlat, rlon);
-                
-                    if (distance < min_distance){                  
-                        min_distance = distance;
-                        min_mlat = mlat;
-                        min_mlon = mlon;
-                        min_rlat = rlat;
-                        min_rlon = rlon;
-                        min_row_idx = Map->raster[jdx][kdx].row_idx;
-                        min_col_idx = Map->raster[jdx][kdx].col_idx;
-                    }
-                }
-            }
+        // check for latRes greater then 0: 
+        if (Map->latRes <= 0){
+            longjmp(env, 4);
+        }        
         
-            // give the raster point the name of the station
-            strcpy(Map->raster[min_row_idx][min_col_idx].name, Map->input_data.data[idx].name);
-            Map->raster[min_row_idx][min_col_idx].value = Map->input_data.data[idx].value;
+        // geometry of the raster, the coordinates of the raster points follow out of it:
+        Map->raster.maxLat = Map->maxLat;
+        Map->raster.minLon = Map->minLon;
+        Map->raster.latRes = Map->latRes;
+        Map->raster.lonRes = Map->lonRes;
         
-            // give the input data the corresponding index values of the raster point
-            Map->input_data.data[idx].row_idx = min_row_idx;
-            Map->input_data.data[idx].col_idx = min_col_idx;
+        // fill any point of the raster with the default value:
+        for (idx=0; idx<(int)(Map->rows * Map->cols); idx++){
+            Map->raster.value[idx] = NO_VALUE;
         }
         
-        // output:
-        if (Map->show_output){
-            printf(" ok.\n");
-        }
+        // the raster of the kriging variance has the same geometry:
+        if (Map->variance.value != NULL){
         
+            Map->variance.maxLat = Map->maxLat;
+            Map->variance.minLon = Map->minLon;
+            Map->variance.latRes = Map->latRes;
+            Map->variance.lonRes = Map->lonRes;
+            Map->variance.num_stations = 0;
+            
+            for (idx=0; idx<(int)(Map->rows * Map->cols); idx++){
+                Map->variance.value[idx] = NO_VALUE;
+            }
+        }
         return EXIT_SUCCESS;
-    }  
-    else{  
+    }
+    else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        }
-    }    
-
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The number of columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The resolution of longitude must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The resolution of latitude must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;                            
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;       
+        } 
+    }   
 }
 
 
@@ -718,267 +899,1775 @@ int fill_raster_with_input_data(struct usr_map *Map){
 // ##################################################################################################
 
 
-int create_distance_matrix(struct usr_map *Map){
+int input_csv_data(struct usr_map *Map, char *input_datafile){
 
     /*
         DESCRIPTION:
-        Determines the distance of all points to each other.
-        It creates a distance matrix of dimensions "length of input dataset" x "length of input dataset".
+        Reads the input dataset provided by the csv-file in the input directory.
+        The file is mapped into the memory and parsed in one pass. The first line (header) is skipped,
+        every further line has to contain: name;lat;lon;value
+        The numbers may have a decimal point or a decimal comma. Empty lines are ignored.
+        In batch mode (see set_batch_config) every line contains one value per field:
+        name;lat;lon;value_1;...;value_K, the number of fields K is given by the header. The values of
+        all fields are stored in "Map->input_data.fields", the first one in "value" as well.
+        The array of the stations grows as needed. A malformed line stops the reading with
+        its line number. The coordinates and values are checked here once, the kernels of the
+        interpolation (e.g. calc_distance) do not check them again.
     
         INPUT:
         struct usr_map *Map	...	pointer to map object
+        char *input_datafile	...	filename of the input datafile in the input directory
     
         OUTPUT:(error code)
         on success		...	EXIT_SUCCESS
         on failure		...	EXIT_FAILURE
         
     */
-    
+      
     jmp_buf env;
+
+    int idx, kdx;
     int excno;
-    int idx, jdx;
+    volatile int line_number = 0;
     
+    double sum = 0; 
     
+    char path[100];
     
-    if ((excno = setjmp(env)) == 0){    
     
-        // output ?
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int fd;
+        int capacity = 0;
+        size_t name_length;
+        struct stat file_info;
+        struct usr_data_point *data;
+        double *fields;
+        const char *text, *end, *line, *line_end, *field, *next;
+        
+        Map->input_data.length = 0;
+        Map->input_data.data = NULL;
+        Map->input_data.num_fields = 1;
+        Map->input_data.fields = NULL;
+        
+        // open input file and map it into the memory:
+        fd = open(strcat(strcpy(path,Map->config.input_dir), input_datafile), O_RDONLY);
+        if (fd < 0){
+            longjmp(env, 1);
+        }
+        if (fstat(fd, &file_info) != 0){
+            close(fd);
+            longjmp(env, 1);
+        }
+        if (file_info.st_size <= 0){
+            close(fd);
+            longjmp(env, 2);
+        }
+        
+        text = (const char *) mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (text == MAP_FAILED){
+            longjmp(env, 1);
+        }
+        end = text + file_info.st_size;
+        
+        // read the data line by line:
+        for (line=text; line<end; line=line_end+1){
+        
+            line_number++;
+            
+            line_end = (const char *) memchr(line, '\n', end - line);
+            if (line_end == NULL){
+                line_end = end;
+            }
+            
+            // batch: the number of fields follows out of the columns of the header (name;lat;lon;field_1;...):
+            if ((line_number == 1) && (Map->batch.enabled)){
+                Map->input_data.num_fields = -2;
+                for (field=line; (field=(const char *) memchr(field, ';', line_end - field)) != NULL; field++){
+                    Map->input_data.num_fields++;
+                }
+                if (Map->input_data.num_fields < 1){
+                    munmap((void *)text, file_info.st_size);
+                    longjmp(env, 11);
+                }
+            }
+            
+            // skip the header and empty lines:
+            if ((line_number == 1) || (skip_blanks(line, line_end) == line_end)){
+                continue;
+            }
+            
+            // grow the array of the stations:
+            if (Map->input_data.length == capacity){
+            
+                capacity = (capacity > 0) ? 2 * capacity : INPUT_DATA_CAPACITY;
+                data = (struct usr_data_point *) realloc(Map->input_data.data, capacity * sizeof(struct usr_data_point));
+                if (data == NULL){
+                    munmap((void *)text, file_info.st_size);
+                    longjmp(env, 3);
+                }
+                Map->input_data.data = data;
+                
+                if (Map->batch.enabled){
+                    fields = (double *) realloc(Map->input_data.fields, (size_t)capacity * Map->input_data.num_fields * sizeof(double));
+                    if (fields == NULL){
+                        munmap((void *)text, file_info.st_size);
+                        longjmp(env, 3);
+                    }
+                    Map->input_data.fields = fields;
+                }
+            }
+            data = &Map->input_data.data[Map->input_data.length];
+            
+            // Einlesen des Stationsnamens:
+            field = line;
+            next = (const char *) memchr(field, ';', line_end - field);
+            if (next == NULL){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            name_length = (size_t)(next - field);
+            if ((name_length == 0) || (name_length >= sizeof(data->name))){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 4);
+            }
+            memcpy(data->name, field, name_length);
+            data->name[name_length] = '\0';
+            
+            // Einlesen der geogr. Breite:
+            field = parse_decimal(next + 1, line_end, &(data->lat));
+            if ((field != NULL) && (skip_blanks(field, line_end) == line_end)){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            if ((field == NULL) || (*field != ';')){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 5);
+            }
+            
+            // Einlesen der geogr. Länge:
+            field = parse_decimal(field + 1, line_end, &(data->lon));
+            if ((field != NULL) && (skip_blanks(field, line_end) == line_end)){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 9);
+            }
+            if ((field == NULL) || (*field != ';')){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 6);
+            }
+            
+            // Einlesen des Messwerts:
+            field = parse_decimal(field + 1, line_end, &(data->value));
+            if (field == NULL){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 7);
+            }
+            
+            // batch: the further fields (the first one is the value):
+            if (Map->batch.enabled){
+            
+                fields = &Map->input_data.fields[(size_t)Map->input_data.length * Map->input_data.num_fields];
+                fields[0] = data->value;
+                
+                for (kdx=1; kdx<Map->input_data.num_fields; kdx++){
+                
+                    if ((skip_blanks(field, line_end) == line_end) || (*field != ';')){
+                        munmap((void *)text, file_info.st_size);
+                        longjmp(env, 12);
+                    }
+                    field = parse_decimal(field + 1, line_end, &(fields[kdx]));
+                    if (field == NULL){
+                        munmap((void *)text, file_info.st_size);
+                        longjmp(env, 7);
+                    }
+                    if (!isfinite(fields[kdx])){
+                        munmap((void *)text, file_info.st_size);
+                        longjmp(env, 10);
+                    }
+                }
+            }
+            
+            // nothing but blanks (e.g. '\r') may follow:
+            if (skip_blanks(field, line_end) != line_end){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 8);
+            }
+            
+            // valid coordinates and value (no further checks of the input data during the interpolation):
+            if ((!isfinite(data->lat)) || (fabs(data->lat) > 90) || (!isfinite(data->lon)) || (fabs(data->lon) > 180) || (!isfinite(data->value))){
+                munmap((void *)text, file_info.st_size);
+                longjmp(env, 10);
+            }
+            
+            Map->input_data.length++;
+        }
+        
+        munmap((void *)text, file_info.st_size);
+        
+        // check for rows ist greater then 0:
+        if (Map->input_data.length <= 0){
+            longjmp(env, 2);
+        }
+        
+        // determine statistical metadata over the input datasets.
+        Map->input_data.minimum = Map->input_data.data[0].value;
+        Map->input_data.maximum = Map->input_data.data[0].value;
+        Map->input_data.average = Map->input_data.data[0].value;
+            
+        for (idx=0; idx<Map->input_data.length; idx++){
+    
+            sum += Map->input_data.data[idx].value;
+    
+            if (Map->input_data.data[idx].value < Map->input_data.minimum){
+        
+                Map->input_data.minimum = Map->input_data.data[idx].value;
+            }
+        
+            if (Map->input_data.data[idx].value > Map->input_data.maximum){
+        
+                Map->input_data.maximum = Map->input_data.data[idx].value;
+            }
+        }
+    
+        Map->input_data.average = (double)(sum / Map->input_data.length);
+    
+        return EXIT_SUCCESS;
+    }
+    // ##############################################################################################
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure when opening the csv-file:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The counted number of datapoints is 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n Failure when allocating the memory for the input dataset:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The name of the station is missing or longer then %d characters!\n\n", __FILE__, __LINE__, path, line_number, (int)sizeof(Map->input_data.data[0].name)-1); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The latitude is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The longitude is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The value is missing or not a number!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Unexpected characters after the value (expected: name;lat;lon;value)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 9: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Too few fields (expected: name;lat;lon;value)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 10: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The coordinates are out of range (lat: -90 ... 90, lon: -180 ... 180) or a number is \"INF\"!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 11: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The header must name the columns of the batch (name;lat;lon;field_1;...;field_K)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 12: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Too few values (expected: %d fields)!\n\n", __FILE__, __LINE__, path, line_number, Map->input_data.num_fields); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }    
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+const char *parse_decimal(const char *text, const char *end, double *value){
+
+    /*
+        DESCRIPTION:
+        Parses a decimal number with a decimal point or a decimal comma (e.g. "-47,398429")
+        out of the text up to "end". Leading blanks are skipped.
+        Numbers of up to 15 significant digits are calculated as integer / 10^decimals, which is
+        exactly the correctly rounded result of strtod. Longer numbers and numbers with an
+        exponent are passed to strtod.
+        
+        INPUT:
+        const char *text	...	start of the number
+        const char *end		...	end of the text (the number must not reach beyond)
+        double *value		...	parsed number
+        
+        OUTPUT:
+        on success		...	pointer to the first character after the number
+        on failure		...	NULL (no digits)
+    */
+
+    static const double pow10[23] = {1.0E0, 1.0E1, 1.0E2, 1.0E3, 1.0E4, 1.0E5, 1.0E6, 1.0E7, 1.0E8, 1.0E9, 1.0E10, 1.0E11,
+                                     1.0E12, 1.0E13, 1.0E14, 1.0E15, 1.0E16, 1.0E17, 1.0E18, 1.0E19, 1.0E20, 1.0E21, 1.0E22};
+    const char *pos;
+    char number[64];
+    unsigned long long mantissa = 0;
+    int num_digits = 0;
+    int num_decimals = 0;
+    int num_significant = 0;
+    int idx;
+    bool negative = false;
+    bool separator = false;
+    
+    
+    text = skip_blanks(text, end);
+    pos = text;
+    
+    if ((pos < end) && ((*pos == '-') || (*pos == '+'))){
+        negative = (*pos == '-');
+        pos++;
+    }
+    
+    for (; pos<end; pos++){
+    
+        if ((*pos >= '0') && (*pos <= '9')){
+        
+            // leading zeros are no significant digits:
+            if ((mantissa > 0) || (*pos != '0')){
+                num_significant++;
+            }
+            if (num_significant <= 19){
+                mantissa = 10 * mantissa + (unsigned long long)(*pos - '0');
+            }
+            num_decimals += (separator) ? 1 : 0;
+            num_digits++;
+        }
+        else if (((*pos == '.') || (*pos == ',')) && (!separator)){
+            separator = true;
+        }
+        else{
+            break;
+        }
+    }
+    
+    if (num_digits == 0){
+        return NULL;
+    }
+    
+    // fast path:
+    if ((num_significant <= 15) && (num_decimals <= 22) && ((pos == end) || ((*pos != 'e') && (*pos != 'E')))){
+        *value = (double)mantissa / pow10[num_decimals];
+        *value = (negative) ? -(*value) : *value;
+        return pos;
+    }
+    
+    // rare cases: copy the number with a decimal point for strtod:
+    if ((pos < end) && ((*pos == 'e') || (*pos == 'E'))){
+        pos++;
+        if ((pos < end) && ((*pos == '-') || (*pos == '+'))){
+            pos++;
+        }
+        while ((pos < end) && (*pos >= '0') && (*pos <= '9')){
+            pos++;
+        }
+    }
+    if (pos - text >= (int)sizeof(number)){
+        return NULL;
+    }
+    for (idx=0; idx<pos-text; idx++){
+        number[idx] = (text[idx] == ',') ? '.' : text[idx];
+    }
+    number[idx] = '\0';
+    *value = strtod(number, NULL);
+    
+    return pos;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+const char *skip_blanks(const char *text, const char *end){
+
+    /*
+        DESCRIPTION:
+        Returns a pointer to the first character of the text, which is no blank (' ', '\t', '\r'),
+        or "end" if there is none.
+    */
+
+    while ((text < end) && ((*text == ' ') || (*text == '\t') || (*text == '\r'))){
+        text++;
+    }
+    
+    return text;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int fill_raster_with_input_data(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        writes the input dataset into the raster points of the map raster.
+        Every station is assigned to its nearest raster point (see snap_station_to_raster). These assignments
+        are kept as an overlay of the raster (Map->raster.stations), that is written over the interpolated values.
+        Stations outside the raster and stations that share a raster point are reported.
+    
+        INPUT:
+        struct usr_map *Map	...	pointer to map object
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */ 
+
+    
+    int idx;
+    int excno;
+    jmp_buf env;
+    
+    
+    if ((excno = setjmp(env)) == 0){ 
+    
+        int row_idx, col_idx;
+        int err;
+        
+    
+        // output?
         if (Map->show_output){
-            printf("Calculating distance matrix ... ");
+            printf("Assign points to raster ... ");
             fflush(stdout);
         }
+        
+        
     
-        // Allocate memory for a square distance matrix of "Map.input_data.length" x "Map.input_data.length"
-        Map->distance_matrix = create_fmatrix(Map->input_data.length, Map->input_data.length);
-        if (Map->distance_matrix == NULL){
-            longjmp(env, 1);    
+        if (Map->input_data.length <= 0){
+            longjmp(env, 1);
         }
-        else{
+        
+        // overlay of the raster with the assigned stations:
+        Map->raster.stations = (struct usr_raster_station *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(struct usr_raster_station));
+        if (Map->raster.stations == NULL){
+            longjmp(env, 2);
+        }
+        Map->raster.num_stations = 0;
     
-            for (idx=0; idx<Map->input_data.length; idx++){
-                for (jdx=0; jdx<Map->input_data.length; jdx++){
+        for (idx=0; idx<Map->input_data.length; idx++){
+    
+            err = snap_station_to_raster(&(Map->raster), 
+                                         Map->input_data.data[idx].lat, 
+                                         Map->input_data.data[idx].lon,
+                                         &row_idx, 
+                                         &col_idx);
             
-                    // Is the difference between the longitude and latitude value smaler then EPS, the distance must be 0:
-                    if ((fabs(Map->input_data.data[idx].lat - Map->input_data.data[jdx].lat) < EPS) && 
-                        (fabs(Map->input_data.data[idx].lon - Map->input_data.data[jdx].lon) < EPS)){
+            // the station is not used for the overlay, but still for the interpolation:
+            if (err == 2){
+                fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is not assigned to a raster point!\n", 
+                        __FILE__, __LINE__, Map->input_data.data[idx].name, Map->input_data.data[idx].lat, Map->input_data.data[idx].lon);
                 
-                        Map->distance_matrix[idx][jdx] = 0.0;
+                Map->input_data.data[idx].row_idx = -1;
+                Map->input_data.data[idx].col_idx = -1;
+                continue;
+            }
+            else if (err == 1){
+                fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is assigned to the border point (%d, %d)!\n", 
+                        __FILE__, __LINE__, Map->input_data.data[idx].name, Map->input_data.data[idx].lat, Map->input_data.data[idx].lon, row_idx, col_idx);
+            }
+        
+            // add the station to the overlay of the raster
+            Map->raster.stations[Map->raster.num_stations].row_idx = row_idx;
+            Map->raster.stations[Map->raster.num_stations].col_idx = col_idx;
+            Map->raster.stations[Map->raster.num_stations].station_idx = idx;
+            Map->raster.num_stations++;
+            
+            Map->raster.value[(size_t)row_idx * Map->cols + col_idx] = Map->input_data.data[idx].value;
+        
+            // give the input data the corresponding index values of the raster point
+            Map->input_data.data[idx].row_idx = row_idx;
+            Map->input_data.data[idx].col_idx = col_idx;
+        }
+        
+        // stations on the same raster point:
+        err = report_station_collisions(&(Map->raster), &(Map->input_data));
+        if (err == EXIT_FAILURE){
+            longjmp(env, 2);
+        }
+        
+        // output:
+        if (Map->show_output){
+            printf(" ok.\n");
+        }
+        
+        return EXIT_SUCCESS;
+    }  
+    else{  
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The length of the input dataset is 0\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }    
+
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int snap_station_to_raster(struct usr_raster *raster, double lat, double lon, int *row_idx, int *col_idx){
+
+    /*
+        DESCRIPTION:
+        Finds the nearest raster point of a station.
+        
+        The raster is a regular grid, so the row and the column of the nearest raster point follow
+        directly from the coordinates. Because the distance on the sphere differs slightly from the
+        distance in degrees, the 3 x 3 neighbourhood of this raster point is checked by calc_distance.
+        Of two raster points with the same distance the first one (row by row) is taken, just as by a
+        search over the whole raster.
+        
+        A station that is up to one raster point outside the raster is assigned to the nearest
+        point of the border, a station that is further away is not assigned.
+        
+        INPUT:
+        struct usr_raster *raster	...	pointer to the raster
+        double lat			...	latitude of the station
+        double lon			...	longitude of the station
+        int *row_idx			...	row of the nearest raster point
+        int *col_idx			...	column of the nearest raster point
+    
+        OUTPUT:
+        0				...	the station is within the raster
+        1				...	the station is outside the raster and has been assigned to the border
+        2				...	the station is outside the raster and has not been assigned
+    */
+
+    int row, col;
+    int row0, col0;
+    int status = 0;
+    double fidx;
+    double distance, min_distance;
+    
+    
+    // nearest row and column of the grid (not yet limited to the raster):
+    fidx = round((raster->maxLat - lat) / raster->latRes);
+    if ((isnan(fidx)) || (fidx < -1.0) || (fidx > (double)raster->rows)){
+        return 2;
+    }
+    row0 = (int)fidx;
+    
+    fidx = round((lon - raster->minLon) / raster->lonRes);
+    if ((isnan(fidx)) || (fidx < -1.0) || (fidx > (double)raster->cols)){
+        return 2;
+    }
+    col0 = (int)fidx;
+    
+    // limit to the raster:
+    if ((row0 < 0) || (row0 >= (int)raster->rows) || (col0 < 0) || (col0 >= (int)raster->cols)){
+        status = 1;
+        row0 = (row0 < 0) ? 0 : ((row0 >= (int)raster->rows) ? (int)raster->rows - 1 : row0);
+        col0 = (col0 < 0) ? 0 : ((col0 >= (int)raster->cols) ? (int)raster->cols - 1 : col0);
+    }
+    
+    // the default distance is the highest distance between 2 points on earth 
+    min_distance = 44000.00;
+    *row_idx = row0;
+    *col_idx = col0;
+    
+    // check the neighbourhood:
+    for (row=row0-1; row<=row0+1; row++){
+    
+        if ((row < 0) || (row >= (int)raster->rows)){
+            continue;
+        }
+        
+        for (col=col0-1; col<=col0+1; col++){
+        
+            if ((col < 0) || (col >= (int)raster->cols)){
+                continue;
+            }
+            
+            distance = calc_distance(lat, lon, raster_lat(raster, row), raster_lon(raster, col));
+            
+            if (distance < min_distance){
+                min_distance = distance;
+                *row_idx = row;
+                *col_idx = col;
+            }
+        }
+    }
+    
+    return status;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int compare_raster_stations(const void *a, const void *b){
+
+    /*
+        DESCRIPTION:
+        Compare function (qsort) of two stations of the overlay by their raster point (row by row).
+        Stations on the same raster point keep the order of the input dataset.
+    */
+
+    const struct usr_raster_station *sa = (const struct usr_raster_station *) a;
+    const struct usr_raster_station *sb = (const struct usr_raster_station *) b;
+    
+    if (sa->row_idx != sb->row_idx){
+        return (sa->row_idx < sb->row_idx) ? -1 : 1;
+    }
+    if (sa->col_idx != sb->col_idx){
+        return (sa->col_idx < sb->col_idx) ? -1 : 1;
+    }
+    return (sa->station_idx < sb->station_idx) ? -1 : ((sa->station_idx > sb->station_idx) ? 1 : 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int report_station_collisions(struct usr_raster *raster, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Reports all stations of the overlay that share their raster point with an earlier station of
+        the input dataset. The value of the later station remains (see apply_station_overlay).
+        The overlay itself stays untouched, a sorted copy is used.
+    
+        INPUT:
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset
+    
+        OUTPUT:(error code)
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
+    */
+
+    int idx;
+    int num_collisions = 0;
+    struct usr_raster_station *sorted;
+    
+    if (raster->num_stations < 2){
+        return EXIT_SUCCESS;
+    }
+    
+    sorted = (struct usr_raster_station *) malloc(raster->num_stations * sizeof(struct usr_raster_station));
+    if (sorted == NULL){
+        return EXIT_FAILURE;
+    }
+    memcpy(sorted, raster->stations, raster->num_stations * sizeof(struct usr_raster_station));
+    qsort(sorted, raster->num_stations, sizeof(struct usr_raster_station), compare_raster_stations);
+    
+    for (idx=1; idx<raster->num_stations; idx++){
+        if ((sorted[idx].row_idx == sorted[idx-1].row_idx) && (sorted[idx].col_idx == sorted[idx-1].col_idx)){
+            num_collisions++;
+        }
+    }
+    
+    if (num_collisions > 0){
+    
+        fprintf(stderr, "WARNING: %s --> %d:\n >>> %d station(s) share their raster point with another station, the value of the later one is used:\n", 
+                __FILE__, __LINE__, num_collisions);
+    
+        for (idx=1; idx<raster->num_stations; idx++){
+        
+            if ((sorted[idx].row_idx == sorted[idx-1].row_idx) && (sorted[idx].col_idx == sorted[idx-1].col_idx)){
+            
+                fprintf(stderr, "     (%4d, %4d): \"%s\" <-- \"%s\"\n", 
+                        sorted[idx].row_idx, sorted[idx].col_idx,
+                        input_data->data[sorted[idx-1].station_idx].name,
+                        input_data->data[sorted[idx].station_idx].name);
+            }
+        }
+    }
+    
+    free(sorted);
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void apply_station_overlay(struct usr_raster *raster, struct usr_dataset *input_data){
+
+    /*
+        DESCRIPTION:
+        Writes the values of the assigned stations over the interpolated values of the raster.
+        If two stations share the same raster point, the later one of the input dataset remains.
+    
+        INPUT:
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset
+    */
+
+    int idx;
+    
+    for (idx=0; idx<raster->num_stations; idx++){
+    
+        raster->value[(size_t)raster->stations[idx].row_idx * raster->cols + raster->stations[idx].col_idx] = 
+            input_data->data[raster->stations[idx].station_idx].value;
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void apply_field_overlay(struct usr_raster *raster, struct usr_dataset *input_data, int field){
+
+    /*
+        DESCRIPTION:
+        Batch: writes the values of one field of the assigned stations over the interpolated values
+        of the raster (see apply_station_overlay).
+    
+        INPUT:
+        struct usr_raster *raster		...	pointer to the raster
+        struct usr_dataset *input_data		...	pointer to the input dataset
+        int field				...	field (column of "input_data->fields")
+    */
+
+    int idx;
+    
+    for (idx=0; idx<raster->num_stations; idx++){
+    
+        raster->value[(size_t)raster->stations[idx].row_idx * raster->cols + raster->stations[idx].col_idx] = 
+            input_data->fields[(size_t)raster->stations[idx].station_idx * input_data->num_fields + field];
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_distance_matrix(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Determines the distance of all points to each other.
+        It creates a distance matrix of dimensions "length of input dataset" x "length of input dataset".
+        The matrix is symmetric, so only its upper triangle is calculated and stored (packed, see create_matrix).
+        For many stations the rows of the triangle are split among "Map->num_threads" threads
+        (see create_distance_matrix_worker).
+    
+        INPUT:
+        struct usr_map *Map	...	pointer to map object
+    
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+    
+    jmp_buf env;
+    int idx;
+    int excno;
+    
+    
+    
+    if ((excno = setjmp(env)) == 0){    
+    
+        int n = Map->input_data.length;
+        int num_threads;
+        int row;
+        long num_pairs, pairs_per_thread, pairs;
+        struct usr_distance_thread *threads;
+        struct usr_arena_mark scratch;
+    
+        // output ?
+        if (Map->show_output){
+            printf("Calculating distance matrix ... ");
+            fflush(stdout);
+        }
+    
+        // Allocate memory for the upper triangle of a square distance matrix of "Map.input_data.length" x "Map.input_data.length"
+        if (create_matrix(&(Map->arena), &(Map->distance_matrix), n, n, true) == EXIT_FAILURE){
+            longjmp(env, 1);    
+        }
+        
+        // number of threads: every thread should get at least DISTANCE_PAIRS_PER_THREAD pairs of stations.
+        num_pairs = ((long)n * (n + 1)) / 2;
+        num_threads = (Map->num_threads > 0) ? (int)Map->num_threads : 1;
+        if (num_threads > (num_pairs / DISTANCE_PAIRS_PER_THREAD)){
+            num_threads = (int)(num_pairs / DISTANCE_PAIRS_PER_THREAD);
+        }
+        if (num_threads < 1){
+            num_threads = 1;
+        }
+        
+        scratch = arena_mark(&(Map->arena));
+        threads = (struct usr_distance_thread *) arena_alloc(&(Map->arena), num_threads * sizeof(struct usr_distance_thread));
+        if (threads == NULL){
+            longjmp(env, 1);
+        }
+        
+        // split the rows of the upper triangle into ranges with about the same number of pairs:
+        pairs_per_thread = (num_pairs + num_threads - 1) / num_threads;
+        row = 0;
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].Map = Map;
+            threads[idx].first_row = row;
+            
+            pairs = 0;
+            while ((row < n) && ((pairs < pairs_per_thread) || (idx == num_threads-1))){
+                pairs += n - row;
+                row++;
+            }
+            threads[idx].last_row = row;
+        }
+        
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, create_distance_matrix_worker, &threads[idx]) != 0){
+            
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
+                }
+                longjmp(env, 2);
+            }
+        }
+        
+        create_distance_matrix_worker(&threads[0]);
+        
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
+        }
+        
+        arena_rewind(&(Map->arena), scratch);
+            
+        // output ?
+        if (Map->show_output){
+            printf("ok!\n");
+        }       
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when starting the threads of the distance matrix!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void *create_distance_matrix_worker(void *arg){
+
+    /*
+        DESCRIPTION:
+        Calculates the rows "first_row" ... "last_row"-1 of the upper triangle of the distance matrix
+        (diagonal included). Every pair of stations is calculated only once.
+        
+        INPUT:
+        void *arg		...	pointer to the thread object of type struct usr_distance_thread.
+        
+        OUTPUT:
+        always NULL
+    */
+
+    int idx, jdx;
+    double *row;
+    
+    struct usr_distance_thread *thread = (struct usr_distance_thread *) arg;
+    struct usr_map *Map = thread->Map;
+    struct usr_data_point *data = Map->input_data.data;
+    
+    for (idx=thread->first_row; idx<thread->last_row; idx++){
+    
+        row = matrix_upper_row(&(Map->distance_matrix), idx);
+        
+        for (jdx=idx; jdx<Map->input_data.length; jdx++){
+    
+            // Is the difference between the longitude and latitude value smaler then EPS, the distance must be 0:
+            if ((fabs(data[idx].lat - data[jdx].lat) < EPS) && 
+                (fabs(data[idx].lon - data[jdx].lon) < EPS)){
+        
+                row[jdx-idx] = 0.0;
+            }
+            else{
+                // calculate the distance between these points:                
+                row[jdx-idx] = calc_distance(data[idx].lat, data[idx].lon, data[jdx].lat, data[jdx].lon);
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+// ##################################################################################################
+
+
+
+int create_variogram(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        1. Defines classes of distance
+        -> maximum distance between two points in germany is 900 km.
+        -> categorization in distance-classes with a width of 50 km. -> 18 classes .
+        
+        2. Calculates the average distance of all point of a specific distance interval (class).
+        3. Calculates the average variance of these distance classes.
+        
+        The pairs of stations are taken in one pass over the upper triangle of the distance matrix
+        (see create_distance_matrix). Every pair is added to the sums of both stations of its class
+        (see get_variogram_class). For many stations the rows of the triangle are split among
+        "Map->num_threads" threads, each with its own sums, that are added afterwards.
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+        
+        OUTPUT: (errorcode)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+        
+    */
+    
+    jmp_buf env;
+    int idx, jdx, kdx;
+    int excno;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int n = Map->input_data.length;
+        int num_threads;
+        int row;
+        long num_pairs, pairs_per_thread, pairs;
+        double semiVarianz;
+        double avgDistance;
+        struct usr_vario_thread *threads;
+        struct usr_vario_accumulator *acc;
+        struct usr_arena_mark scratch;
+        
+        
+        if (Map->show_output){
+            printf("Create variogram ... ");
+            fflush(stdout);
+        }
+    
+        // Calculate the number of distance classes with given max. distance and the wanted interval width:
+        Map->variogram.numClasses = (int)(Map->variogram.maxDistance / Map->variogram.distInterval);
+        if (Map->variogram.numClasses <= 0){
+            longjmp(env, 1);
+        }
+        
+        if (Map->distance_matrix.value == NULL){
+            longjmp(env, 3);
+        }
+
+        // Allocate a matrix of type "usr_vario_class" to store all the relevant information to the variogram.
+        Map->variogram.classes = (struct usr_vario_class *) arena_alloc(&(Map->arena), Map->variogram.numClasses * sizeof(struct usr_vario_class));
+        if (Map->variogram.classes == NULL){
+            longjmp(env, 2);
+        }
+        
+        // Create the attributs of the variogram-classes (lowerLimit / upperLimit):
+        for (idx=1; idx<=(Map->variogram.numClasses); idx++){
+        
+            Map->variogram.classes[idx-1].lowerLimit = (int)((idx-1)*Map->variogram.distInterval);	// lower Limit of the distance class in km.
+            Map->variogram.classes[idx-1].upperLimit = (int)((idx)*Map->variogram.distInterval);	// upper limit of the distance class in km.
+            Map->variogram.classes[idx-1].num_variance_values = 0;					// set the start value to the number of variance value of a class 
+            Map->variogram.classes[idx-1].num_distance_values = 0;					// set the start value to the number of distance values of a class
+            Map->variogram.classes[idx-1].num_pairs = 0;						// set the start value to the number of pairs of stations of a class
+            Map->variogram.classes[idx-1].variance_sum = 0;						// set 0 as default value for the sum of the variances
+            Map->variogram.classes[idx-1].distance_sum = 0;						// set 0 as default value for the sum of the distances
+            Map->variogram.classes[idx-1].variance_avg = 0;						// set 0 as default value for average variance
+            Map->variogram.classes[idx-1].distance_avg = 0;						// set 0 as default value for average distance
+        
+        }
+        
+        // number of threads: every thread should get at least VARIO_PAIRS_PER_THREAD pairs of stations.
+        num_pairs = ((long)n * (n - 1)) / 2;
+        num_threads = (Map->num_threads > 0) ? (int)Map->num_threads : 1;
+        if (num_threads > (num_pairs / VARIO_PAIRS_PER_THREAD)){
+            num_threads = (int)(num_pairs / VARIO_PAIRS_PER_THREAD);
+        }
+        if (num_threads < 1){
+            num_threads = 1;
+        }
+        
+        // the sums of the threads are given back at the end:
+        scratch = arena_mark(&(Map->arena));
+        threads = (struct usr_vario_thread *) arena_alloc(&(Map->arena), num_threads * sizeof(struct usr_vario_thread));
+        if (threads == NULL){
+            longjmp(env, 2);
+        }
+        
+        // split the rows of the upper triangle into ranges with about the same number of pairs:
+        pairs_per_thread = (num_pairs + num_threads - 1) / num_threads;
+        row = 0;
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].Map = Map;
+            threads[idx].first_row = row;
+            
+            pairs = 0;
+            while ((row < n) && ((pairs < pairs_per_thread) || (idx == num_threads-1))){
+                pairs += n - 1 - row;
+                row++;
+            }
+            threads[idx].last_row = row;
+            
+            threads[idx].acc = (struct usr_vario_accumulator *) arena_alloc(&(Map->arena), (size_t)n * Map->variogram.numClasses * sizeof(struct usr_vario_accumulator));
+            threads[idx].num_pairs = (long *) arena_alloc(&(Map->arena), Map->variogram.numClasses * sizeof(long));
+            if ((threads[idx].acc == NULL) || (threads[idx].num_pairs == NULL)){
+                longjmp(env, 2);
+            }
+        }
+        
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, create_variogram_worker, &threads[idx]) != 0){
+            
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
+                }
+                longjmp(env, 4);
+            }
+        }
+        
+        create_variogram_worker(&threads[0]);
+        
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
+        }
+        
+        // reduction: add the sums of the other threads to the ones of the first thread:
+        acc = threads[0].acc;
+        for (idx=1; idx<num_threads; idx++){
+        
+            for (jdx=0; jdx<n * Map->variogram.numClasses; jdx++){
+                acc[jdx].sum_pow += threads[idx].acc[jdx].sum_pow;
+                acc[jdx].sum_distance += threads[idx].acc[jdx].sum_distance;
+                acc[jdx].num_values += threads[idx].acc[jdx].num_values;
+            }
+        }
+        for (idx=0; idx<num_threads; idx++){
+            for (jdx=0; jdx<Map->variogram.numClasses; jdx++){
+                Map->variogram.classes[jdx].num_pairs += threads[idx].num_pairs[jdx];
+            }
+        }
+        
+        // calculate the semivariance of each station and distance class and add it to the distance class if it is greater then 0:
+        for (idx=0; idx<n; idx++){
+        
+            for (jdx=0; jdx<Map->variogram.numClasses; jdx++){
+            
+                kdx = idx * Map->variogram.numClasses + jdx;
+                
+                // Check if the sum is greater then 0 to prevent division by 0:
+                if (acc[kdx].sum_pow > 0){
+                
+                    // 2. Calculate the semivariance
+                    semiVarianz = (double)(acc[kdx].sum_pow / (2*acc[kdx].num_values));
+                    
+                    // 3. calculate the average distance for this distance class for this station:
+                    avgDistance = (double)acc[kdx].sum_distance / acc[kdx].num_values;
+                    
+                    if ((semiVarianz > 0) && (avgDistance > 0)){
+                    
+                        Map->variogram.classes[jdx].variance_sum += semiVarianz;
+                        Map->variogram.classes[jdx].distance_sum += avgDistance;
+                        Map->variogram.classes[jdx].num_variance_values++;
+                        Map->variogram.classes[jdx].num_distance_values++;
+                    }
+                }
+            }
+        }
+        
+        arena_rewind(&(Map->arena), scratch);
+                    
+        // Now calculate the average of the distance and semivariance of each distance class (else it stays 0):
+        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        
+            if (Map->variogram.classes[idx].num_variance_values > 0){
+            
+                Map->variogram.classes[idx].variance_avg = Map->variogram.classes[idx].variance_sum / (double)(Map->variogram.classes[idx].num_variance_values);
+                Map->variogram.classes[idx].distance_avg = Map->variogram.classes[idx].distance_sum / (double)(Map->variogram.classes[idx].num_distance_values);
+            }
+        }
+        
+        if (Map->show_output){
+            printf("ok.\n");
+        }
+        
+        return EXIT_SUCCESS;
+        
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;        
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> The distance matrix has to be created first!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when starting the variogram threads!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void *create_variogram_worker(void *arg){
+
+    /*
+        DESCRIPTION:
+        Thread function of the variogram. Adds the pairs of stations of its rows of the upper triangle
+        of the distance matrix to its own sums of both stations.
+        The partners of a station are added in ascending order, just as by a loop over all stations.
+        
+        INPUT:
+        void *arg		...	pointer to the thread object of type struct usr_vario_thread.
+        
+        OUTPUT:
+        always NULL
+    */
+
+    int idx, jdx, cls;
+    double distance, diff;
+    const double *row;
+    
+    struct usr_vario_thread *thread = (struct usr_vario_thread *) arg;
+    struct usr_map *Map = thread->Map;
+    struct usr_vario_accumulator *acc_i, *acc_j;
+    
+    int numClasses = Map->variogram.numClasses;
+    
+    for (idx=thread->first_row; idx<thread->last_row; idx++){
+    
+        acc_i = &(thread->acc[(size_t)idx * numClasses]);
+        row = matrix_upper_row(&(Map->distance_matrix), idx);
+        
+        for (jdx=idx+1; jdx<Map->input_data.length; jdx++){
+        
+            distance = row[jdx-idx];
+            
+            cls = get_variogram_class(&(Map->variogram), distance);
+            if (cls < 0){
+                continue;
+            }
+            
+            diff = Map->input_data.data[idx].value - Map->input_data.data[jdx].value;
+            acc_j = &(thread->acc[(size_t)jdx * numClasses]);
+            
+            acc_i[cls].sum_pow += diff * diff;
+            acc_i[cls].sum_distance += distance;
+            acc_i[cls].num_values++;
+            
+            acc_j[cls].sum_pow += diff * diff;
+            acc_j[cls].sum_distance += distance;
+            acc_j[cls].num_values++;
+            
+            thread->num_pairs[cls]++;
+        }
+    }
+    return NULL;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int get_variogram_class(struct usr_variogram *variogram, double distance){
+
+    /*
+        DESCRIPTION:
+        Finds the distance class of a distance by index arithmetic (lowerLimit < distance <= upperLimit).
+        
+        INPUT:
+        struct usr_variogram *variogram		...	pointer to the variogram with its classes
+        double distance				...	distance in km
+        
+        OUTPUT:
+        index of the class or -1, if the distance is not within any class
+    */
+
+    int cls;
+    
+    if (!(distance > 0) || (distance > variogram->classes[variogram->numClasses-1].upperLimit)){
+        return -1;
+    }
+    
+    cls = (int)ceil(distance / variogram->distInterval) - 1;
+    
+    // the limits of the classes are rounded to km:
+    if (cls >= variogram->numClasses){
+        cls = variogram->numClasses - 1;
+    }
+    while ((cls > 0) && (distance <= variogram->classes[cls].lowerLimit)){
+        cls--;
+    }
+    while ((cls < variogram->numClasses-1) && (distance > variogram->classes[cls].upperLimit)){
+        cls++;
+    }
+    
+    if ((cls < 0) || (distance <= variogram->classes[cls].lowerLimit) || (distance > variogram->classes[cls].upperLimit)){
+        return -1;
+    }
+    return cls;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int get_variogram_model(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION:
+        Finds on the basis of the semivarince values of the variogram the appropriate model.
+        
+        1: Find a polynomic function of order 4 that fits best to the semivariance values of the variogram
+        2: Fit nugget, sill and range of the models up to the lag "model_adjust_index" (see fit_variogram_model).
+           The residuals of the lags are weighted by their number of pairs of stations.
+           If the model is VARIO_MODEL_AUTO, the model with the smallest weighted error is taken.
+       
+        prepare the following values
+           - distance_avg (x-Werte)
+           - variance_avg (y-Werte)
+        to perform a polynomic regression.
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object
+        
+        OUTPUT: (error code)
+        on success:		...	EXIT_SUCCESS
+        on failure:		...	EXIT_FAILURE        
+        
+    */
+    
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+    
+    
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int model, first_model, last_model;
+        int num_lags, max_lags;
+      
+        double nugget, sill, range, wrss;	// Lösung eines Modells
+        double wrss_min=-1;			// Minimum der gewichteten Fehlerquadratsumme
+        double y_max;				// Maximumwert der Semivarianzen der lags
+        double **input_data_poly_reg;		// Doppelzeiger auf Matrix mit Eingabedaten.
+        double *lag_distances;			// mittlere Distanzen der lags, an die das Modell angepasst wird
+        double *lag_variances;			// mittlere Semivarianzen der lags, an die das Modell angepasst wird
+        double *lag_weights;			// Gewichte der lags (Anzahl der Stationspaare)
+        double *variogram_variances;		// Semivarianzwerte der lags des Variogramms bis zum gesuchten Vergleichsindex.
+        double tmp;				// temporary variable, commonly used for checking purposes
+		
+    
+        if (Map->show_output){
+            printf("Get variogram model ... ");
+            fflush(stdout);
+        }
+    
+        // allocate memory for the input dataset for the polynomic regression
+        input_data_poly_reg = create_fmatrix(&(Map->arena), Map->variogram.numClasses, 2);
+        if (input_data_poly_reg == NULL){
+            longjmp(env, 1);
+        }
+    
+        // allocate memory for the variance values of the variogram
+        variogram_variances = create_fvector(&(Map->arena), Map->variogram.numClasses);
+        if (variogram_variances == NULL){
+            longjmp(env, 1);
+        }   
+
+        /*
+            prepare the following values
+                - distance_avg (x-Werte)
+                - variance_avg (y-Werte)
+            to perform a polynomic regression.
+        */
+        
+        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        
+            // transfer x-values:
+            input_data_poly_reg[idx][0] = Map->variogram.classes[idx].distance_avg;
+        
+            // transfer y-values:
+            input_data_poly_reg[idx][1] = Map->variogram.classes[idx].variance_avg; 
+        
+            // Übertrage y-Werte in Vektor:
+            variogram_variances[idx] = Map->variogram.classes[idx].variance_avg; 
+        }
+    
+
+
+        // Calculate the polynomic regression of 4th order.
+        /* Is successful it returns a pointer to an array of length order +2 with the solutions
+           Example:
+           Order(n): 4
+           
+           array[0] to array[n]		...	contains the weights of the polynomic function from b0 to bn
+           array[n+1] 			...	contains the coefficient of determination
+        */
+        Map->variogram.reg_function.solution = polynomial_regression(&(Map->arena),
+                                                                     input_data_poly_reg, 
+                                                                     Map->variogram.numClasses, 
+                                                                     Map->variogram.reg_function.order);
+        if (Map->variogram.reg_function.solution == NULL){
+            longjmp(env, 2);
+        }
+        
+        // Calculate on the basis of the regress function the predicted value for the semivariance 
+        // ... over the average distances of the semivariances
+        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        
+             
+            // start value is weight0 (b0):
+            if ((isnan(Map->variogram.reg_function.solution[0])) || (isinf(Map->variogram.reg_function.solution[0]))){
+                longjmp(env, 4);
+            }
+            else{
+                Map->variogram.classes[idx].variance_avg_reg = Map->variogram.reg_function.solution[0];
+            }
+            
+            // sum over the powers:
+            for (jdx=1; jdx<=Map->variogram.reg_function.order; jdx++){
+                    
+                // check for nan and inf values within the predicted variance data:
+                tmp = (Map->variogram.reg_function.solution[jdx] * pow(Map->variogram.classes[idx].distance_avg, jdx));
+                if ((isnan(tmp)) || (isinf(tmp))){
+                    longjmp(env, 3);
+                }
+                else{
+                    Map->variogram.classes[idx].variance_avg_reg += tmp;
+                }
+            }
+        }
+        
+        // Now found the part of the polynomic function you want to adjust the exponential model
+        find_model_adjust_index(Map, variogram_variances, Map->variogram.numClasses);
+
+        // lags to fit the model: all lags with values up to the model adjust index. If these are less then 3, all lags with values.
+        lag_distances = create_fvector(&(Map->arena), Map->variogram.numClasses);
+        lag_variances = create_fvector(&(Map->arena), Map->variogram.numClasses);
+        lag_weights = create_fvector(&(Map->arena), Map->variogram.numClasses);
+        if ((lag_distances == NULL) || (lag_variances == NULL) || (lag_weights == NULL)){
+            longjmp(env, 1);
+        }
+        
+        for (max_lags=Map->variogram.model_adjust_index; ; max_lags=Map->variogram.numClasses){
+        
+            num_lags = 0;
+            y_max = 0;
+            for (idx=0; (idx<max_lags) && (idx<Map->variogram.numClasses); idx++){
+            
+                if (Map->variogram.classes[idx].num_variance_values > 0){
+                    lag_distances[num_lags] = Map->variogram.classes[idx].distance_avg;
+                    lag_variances[num_lags] = Map->variogram.classes[idx].variance_avg;
+                    lag_weights[num_lags] = (double)Map->variogram.classes[idx].num_pairs;
+                    y_max = (lag_variances[num_lags] > y_max) ? lag_variances[num_lags] : y_max;
+                    num_lags++;
+                }
+            }
+            if ((num_lags >= 3) || (max_lags >= Map->variogram.numClasses)){
+                break;
+            }
+        }
+        if ((num_lags < 3) || !(y_max > 0)){
+            longjmp(env, 5);
+        }
+        
+        // fit the model(s):
+        first_model = (Map->variogram.model == VARIO_MODEL_AUTO) ? 0 : Map->variogram.model;
+        last_model = (Map->variogram.model == VARIO_MODEL_AUTO) ? VARIO_NUM_MODELS-1 : Map->variogram.model;
+        
+        for (model=first_model; model<=last_model; model++){
+        
+            // start values: nugget of the polynomic function, sill up to the maximum semivariance and 
+            // ... range at the first lag with 95 % of the maximum semivariance.
+            nugget = Map->variogram.reg_function.solution[0];
+            nugget = (nugget > 0) ? ((nugget < y_max) ? nugget : 0.5*y_max) : 0;
+            sill = y_max - nugget;
+            range = lag_distances[num_lags-1];
+            for (idx=0; idx<num_lags; idx++){
+                if (lag_variances[idx] >= 0.95*y_max){
+                    range = lag_distances[idx];
+                    break;
+                }
+            }
+            
+            if (fit_variogram_model(model, lag_distances, lag_variances, lag_weights, num_lags, &nugget, &sill, &range, &wrss) == EXIT_FAILURE){
+                continue;
+            }
+            
+            // take over the model with the smallest weighted error:
+            if ((wrss < wrss_min) || (wrss_min < 0)){
+            
+                wrss_min = wrss;
+                Map->variogram.model = model;
+                Map->variogram.nugget = nugget;
+                Map->variogram.sill = sill;
+                Map->variogram.range = range;
+                Map->variogram.wrss = wrss;
+            }
+        }
+        
+        if (wrss_min < 0){
+            longjmp(env, 6);
+        }
+        
+        // the nugget must not be 0:
+        if (Map->variogram.nugget <= 0){
+            Map->variogram.nugget = 0.001;
+        }
+        
+        
+        if (Map->show_output){
+            printf("ok\n");
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;                
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> The solution for the polynomic regression returns NULL!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> The vector of the predicted variances contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n >>> The value of the b0 weight is \"NAN\" or \"INF\"!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n >>> The variogram needs at least 3 lags with a semivariance greater then 0!\n", __FILE__, __LINE__); return EXIT_FAILURE;        
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n >>> None of the variogram models could be fitted!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int find_model_adjust_index(struct usr_map *Map, double *variogram_variances, int length){
+
+    /*
+        DESCRIPTION:
+        Finds the (lag)-index of the variogram we want to adjust the exponential model with.
+        
+        BACKGROUND:
+        any lag of the varigram is defined by a average distance and a average semivarianz.
+        The progress of the semivariance follows a exponential function defined by:
+        
+        nugget + sill * (1-exp(-|distance|/a)), mit a = range/3;
+        
+        Now we have to find the index of that lag until we want to adjust the expontential model.
+        
+        INPUT:
+        struct usr_map *Map		...	pointer to the map object
+        double *variogram_variances	...	pointer an array with a copy of the variogram variances
+        int length			...	lenght of that array.
+        
+    */
+
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+    
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int imax=0;
+        int *density_variances;
+        double y_max, interval;
+        struct usr_arena_mark scratch;
+    
+    
+        // vector of the destribution of the semivariances of the distance classes:
+        scratch = arena_mark(&(Map->arena));
+        density_variances = create_vector(&(Map->arena), Map->variogram.numClasses);
+        if (density_variances == NULL){
+            longjmp(env, 1);
+        }
+    
+        // gives you the maximum value of the semivariance vector
+        y_max = get_fvector_max(variogram_variances, Map->variogram.numClasses);
+    
+        // Calculates the width of an interval out of the maximum value and the number of intervals
+        interval = y_max/Map->variogram.numClasses;
+       
+        // Count the number of semivarinaces and assign them to the vecor desity_variances
+        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        
+            for (jdx=0; jdx<Map->variogram.numClasses-1; jdx++){
+            
+                if ((variogram_variances[idx] > jdx*interval) && (variogram_variances[idx] < (jdx+1)*interval)){
+                
+                    density_variances[jdx]++;
+                }
+            }
+        }
+        
+        // now find the maximum value within the density_variances vector
+        // take the first occurence
+        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        
+            if (density_variances[idx] == get_dvector_max(density_variances, Map->variogram.numClasses)){
+                
+                imax = idx;
+            }
+        }
+
+        // Now make the sum over the number of all semivariances until the the interval with the most values.
+        for (idx=0; idx<=imax; idx++){
+            Map->variogram.model_adjust_index += density_variances[idx];
+        
+        }
+        
+        arena_rewind(&(Map->arena), scratch);
+        
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;        
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }  
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_covariance_matrix(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        
+        Creates by using the determined semivariance model a covariance matrix.
+        The matrix is symmetric, so only its upper triangle is calculated and stored (packed).
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx, jdx;
+    int excno;
+    jmp_buf env;
+
+
+    if ((excno = setjmp(env)) == 0){  
+
+        int n = Map->input_data.length;
+        double tmp;	 		// temporary value for checking purposes
+        const double *distances;	// row of the distance matrix (upper triangle)
+        double *row;			// row of the covariance matrix (upper triangle)
+
+        if (Map->show_output){
+            printf("Calculate covariance matrix ... ");
+            fflush(stdout);
+        }
+
+        // Reservieren der Kovarianzmatrix (symmetrisch, nur das obere Dreieck), die Matrix eines weiteren Modells (Batch) ersetzt die vorige:
+        if ((Map->covariance_matrix.value == NULL) || (Map->covariance_matrix.rows != n+1)){
+            if (create_matrix(&(Map->arena), &(Map->covariance_matrix), n+1, n+1, true) == EXIT_FAILURE){
+                longjmp(env, 1);
+            }
+        }
+    
+        // Berechne die Kovarianzen des oberen Dreiecks:
+        for (idx=0; idx<n; idx++){
+        
+            distances = matrix_upper_row(&(Map->distance_matrix), idx);
+            row = matrix_upper_row(&(Map->covariance_matrix), idx);
+            
+            for (jdx=idx; jdx<n; jdx++){
+            
+                // Ist die Distanz 0 , dann entspricht die Kovarianz dem nugget-Wert:
+                if (distances[jdx-idx] < EPS){
+                    
+                    row[jdx-idx] = Map->variogram.nugget;
+                }
+                else{
+                    
+                    tmp = calc_covariance(distances[jdx-idx], 
+                                          Map->variogram.sill, 
+                                          Map->variogram.nugget,
+                                          Map->variogram.range,
+                                          Map->variogram.model);
+                    
+                    if ((isnan(tmp)) || (isinf(tmp))){
+                        longjmp(env, 2);
                     }
                     else{
-                        // calculate the distance between these points:                
-                        Map->distance_matrix[idx][jdx] = calc_distance(Map->input_data.data[idx].lat, 
-                                                                       Map->input_data.data[idx].lon, 
-                                                                       Map->input_data.data[jdx].lat, 
-                                                                       Map->input_data.data[jdx].lon);
+                        row[jdx-idx] = tmp;
                     }
                 }
             }
             
-            // output ?
-            if (Map->show_output){
-                printf("ok!\n");
-            }       
+            // Die letzte Spalte wird auf 1 gesetzt:
+            row[n-idx] = 1;
+        }
+        
+        // Der Wert der letzten Spalte und der letzten Zeile wird auf 0 gesetzt:
+        matrix_set(&(Map->covariance_matrix), n, n, 0);
+        
+        if (Map->show_output){
+            printf("ok!\n");
         }
         
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;                
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
 }
 
-// ##################################################################################################
 
+// ##################################################################################################
+// ##################################################################################################
 
 
-int create_variogram(struct usr_map *Map){
+int factorize_covariance_matrix(struct usr_map *Map){
 
     /*
-        DESCRIPTION:
-        1. Defines classes of distance
-        -> maximum distance between two points in germany is 900 km.
-        -> categorization in distance-classes with a width of 50 km. -> 18 classes .
-        
-        2. Calculates the average distance of all point of a specific distance interval (class).
-        3. Calculates the average variance of these distance classes.
+    
+        DESCRIPTION
+        Decomposes the covariance matrix by a blocked LU decomposition with partial pivoting.
+        The weights of every raster point are later on determined by solving the system
+        with this decomposition, the inverse of the covariance matrix is never formed.
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object.
+        struct usr_map *Map	...	pointer to the map object
         
-        OUTPUT: (errorcode)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+        OUTOUT:
+        on success:		...	EXIT_SUCCESS
+        on failure:		...	EXIT_FAILURE
         
     */
-    
-    jmp_buf env;
-    int idx, jdx, kdx;
+
     int excno;
+    jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
     
-        int numValue;
-        double semiVarianz;
-        double avgDistance;
-        double sumPowValue;		// Summe der quadratischen abweichungen pro Abstandsklasse.
-        double distance;
-        double sumDistance;
-        double sumClassVarianz;
-        double sumClassDistance;
-        double **input_data_poly_reg;
-        double *solution;    
-        
+        int err;
         
+        // local kriging decomposes the systems of the neighbourhoods:
+        if (is_local_kriging(Map)){
+            return EXIT_SUCCESS;
+        }
+
         if (Map->show_output){
-            printf("Create variogram ... ");
+            printf("Decomposing the covariance-matrix (LU) ... ");
             fflush(stdout);
         }
-    
-        // Calculate the number of distance classes with given max. distance and the wanted interval width:
-        Map->variogram.numClasses = (int)(Map->variogram.maxDistance / Map->variogram.distInterval);
-        if (Map->variogram.numClasses <= 0){
+
+        err = lu_factorize(&(Map->covariance_factor), &(Map->covariance_matrix));
+        if (err == EXIT_FAILURE){
             longjmp(env, 1);
         }
-
-        // Allocate a matrix of type "usr_vario_class" to store all the relevant information to the variogram.
-        Map->variogram.classes = (struct usr_vario_class *) malloc(Map->variogram.numClasses * sizeof(struct usr_vario_class));
-        if (Map->variogram.classes == NULL){
-            longjmp(env, 2);
+        
+        if (Map->show_output){
+            printf("ok\n");
         }
         
-        // Create the attributs of the variogram-classes (lowerLimit / upperLimit):
-        for (idx=1; idx<=(Map->variogram.numClasses); idx++){
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The decomposition of the covariance matrix failed!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_dual_coefficients(struct usr_map *Map){
+
+    /*
+    
+        DESCRIPTION
+        Dual kriging: without correction of negative weights the estimate of a raster point is
         
-            Map->variogram.classes[idx-1].lowerLimit = (int)((idx-1)*Map->variogram.distInterval);	// lower Limit of the distance class in km.
-            Map->variogram.classes[idx-1].upperLimit = (int)((idx)*Map->variogram.distInterval);	// upper limit of the distance class in km.
-            Map->variogram.classes[idx-1].num_variance_values = 0;					// set the start value to the number of variance value of a class 
-            Map->variogram.classes[idx-1].num_distance_values = 0;					// set the start value to the number of distance values of a class
-            Map->variogram.classes[idx-1].variance_avg = 0;						// set 0 as default value for average variance
-            Map->variogram.classes[idx-1].distance_avg = 0;						// set 0 as default value for average distance
+        c0^T * C^-1 * (z, 0)^T  =  c0^T * a,
+        
+        with c0 as the covariance vector of the raster point and z as the measured values.
+        The coefficient vector "a" is the same for every raster point, so it is determined once
+        by solving C * a = (z, 0)^T. Every raster point then requires just one dot product.
         
+        Does nothing if "Map->dual_kriging" is false, the negative weights are corrected,
+        the kriging variance is calculated (it requires the weights) or local kriging is used
+        (see setup_local_system).
+        
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object
+        
+        OUTOUT:
+        on success:		...	EXIT_SUCCESS
+        on failure:		...	EXIT_FAILURE
+        
+    */
+
+    int idx;
+    int excno;
+    jmp_buf env;
+    
+    if ((excno = setjmp(env)) == 0){
+    
+        int err;
+        double *values;			// right hand side: measured values and 0 for the lagrange multiplier
+        struct usr_arena_mark scratch;
+
+        // the weights of the raster points are required to correct them:
+        if ((!Map->dual_kriging) || (Map->weights_correction) || (Map->kriging_variance) || (is_local_kriging(Map))){
+            return EXIT_SUCCESS;
+        }
+
+        if (Map->show_output){
+            printf("Calculating the coefficients of the dual kriging ... ");
+            fflush(stdout);
         }
         
-        // Calculate now the average semivariance for any distance class over all datapoints:
-        // Take a station out of the input dataset.
-        for (idx=0; idx<Map->input_data.length; idx++){
-                        
-            
-            // check over the distance classes to what distance classes this station belongs to:
-            // Take a distance class:
-            for (jdx=0; jdx<Map->variogram.numClasses; jdx++){
-            
-                // Set the start values to 0:
-                sumPowValue = 0;	// sum of the powered differences
-                numValue = 0;		// number of the powered differences
-                semiVarianz = 0;	// Semivariance for this station of a specific distance class
-                sumDistance = 0;	// sum of all distances for this distance class
-            
-                // Now compare the value of the station with the other ones
-                // Take a station out of the input dataset to compare its value with the current one:
-                for (kdx=0; kdx<Map->input_data.length; kdx++){
-                
-                    // Dont compare a station with itself:
-                    if (idx != kdx){
-                
-                        // Calculate the distance between this station with a station we want to compare with
-                        distance = calc_distance(Map->input_data.data[idx].lat, 
-                                                 Map->input_data.data[idx].lon, 
-                                                 Map->input_data.data[kdx].lat,
-                                                 Map->input_data.data[kdx].lon);
-                        
-                        // Is the distance located in the current selected distance class;
-                        // ... add this station to the current distance and variance value of the distance class.
-                        if ((Map->variogram.classes[jdx].lowerLimit < distance) && (distance <= Map->variogram.classes[jdx].upperLimit)){
-                        
-                            sumPowValue += pow((Map->input_data.data[idx].value - Map->input_data.data[kdx].value),2);
-                            
-                            sumDistance += distance;
-                            
-                            numValue ++;
-                            continue;
-                            
-                        }
-                        else{
-                            // Is the distance not located in the curretn selected class than take another one.
-                            continue;
-                        }
-                
-                    }
-                    else{
-                        // take another station if it is the same station:
-                        continue;
-                    }
-                }
-               
-                // If all stations were compared with each other, calculate the semivariance of each distance class and add it to the distance class if it is greater then 0:
-                // Check if the sum is greater then 0 to prevent division by 0:
-                if (sumPowValue > 0){
-                
-                    // 2. Calculate the semivariance
-                    semiVarianz = (double)(sumPowValue / (2*numValue));
-                    
-                    // 3. calculate the average distance for this distance class for this station:
-                    avgDistance = (double)sumDistance / numValue;
-                    
-                    if ((semiVarianz > 0) && (avgDistance > 0)){
-                
-                        // Add the value of semivariance to the coresponding distance class:
-                        Map->variogram.classes[jdx].variance_values[Map->variogram.classes[jdx].num_variance_values++] = semiVarianz;
-                        
-                        // Füge die durchschnittl. Distanz dieser Klasse für diese Station hinzu: 
-                        Map->variogram.classes[jdx].distance_values[Map->variogram.classes[jdx].num_distance_values++] = avgDistance;                      
-                    }
-                    else{
-                        continue;
-                    }
-                }
-                // continue with the next class
-                continue; 
-            }
+        Map->dual_coefficients = create_fvector(&(Map->arena), Map->input_data.length+1);
+        if (Map->dual_coefficients == NULL){
+            longjmp(env, 1);
         }
-                    
-        // Now calculate the average of the distance and semivariance of each distance class:
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
         
-            sumClassVarianz = 0.0;
-            sumClassDistance = 0.0;
+        scratch = arena_mark(&(Map->arena));
+        values = create_fvector(&(Map->arena), Map->input_data.length+1);
+        if (values == NULL){
+            longjmp(env, 1);
+        }
         
-            // There must be at least one semivariance value
-            if ((Map->variogram.classes[idx].num_variance_values > 0) && (Map->variogram.classes[idx].num_variance_values > 0)){
+        for (idx=0; idx<Map->input_data.length; idx++){
+            values[idx] = Map->input_data.data[idx].value;
+        }
+        values[Map->input_data.length] = 0;
         
-                for (jdx=0; jdx<Map->variogram.classes[idx].num_variance_values; jdx++){
-            
-                    sumClassVarianz += Map->variogram.classes[idx].variance_values[jdx];
-                    sumClassDistance += Map->variogram.classes[idx].distance_values[jdx];
-                }
-                
-                Map->variogram.classes[idx].variance_avg = sumClassVarianz / (double)(Map->variogram.classes[idx].num_variance_values);
-                Map->variogram.classes[idx].distance_avg = sumClassDistance / (double)(Map->variogram.classes[idx].num_distance_values);
-            }
-            // else set it to 0  
-            else{
-            
-                Map->variogram.classes[jdx].variance_avg = sumClassVarianz;
-                Map->variogram.classes[jdx].distance_avg = sumClassDistance;                
-                continue;
-            }
+        err = lu_solve(&(Map->covariance_factor), values, Map->dual_coefficients);
+        arena_rewind(&(Map->arena), scratch);
+        if (err == EXIT_FAILURE){
+            longjmp(env, 2);
         }
         
         if (Map->show_output){
-            printf("ok.\n");
+            printf("ok\n");
         }
         
         return EXIT_SUCCESS;
-        
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;        
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Calculation of the dual kriging coefficients returned an error!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
 }
@@ -988,310 +2677,369 @@ int create_variogram(struct usr_map *Map){
 // ##################################################################################################
 
 
-
-int get_variogram_model(struct usr_map *Map){
+int interpolate_raster(struct usr_map *Map){
 
     /*
     
         DESCRIPTION:
-        Finds on the basis of the semivarince values of the variogram the appropriate model.
+        Calculates for any point of the raster an interpolated value. Afterwards the raster points
+        with an assigned station get the measured value (see apply_station_overlay).
         
-        1: Find a polynomic function of order 4 that fits best to the semivariance values of the variogram
-        2: Find with the help of this function the following values for a possible exponential model:
-           - sill
-           - range
-       
-        prepare the following values
-           - distance_avg (x-Werte)
-           - variance_avg (y-Werte)
-        to perform a polynomic regression.
+        The rows of the raster are handed out in blocks of ROW_BLOCK rows to "Map->num_threads" threads.
+        Every thread uses its own covariance and weights vector, so the result is identical
+        to the one of a single thread. The distances are calculated by the precomputed
+        tables of create_grid_distance.
+        
+        With local kriging (see is_local_kriging) every raster point is interpolated by its nearest
+        stations, that are found by the station index (see create_station_index).
+        
+        With "Map->kriging_variance" the kriging variance is written into the raster "Map->variance"
+        in the same pass. The weights of every point are required then (see create_dual_coefficients).
+        
+        During a pass of the batch ("Map->batch.num_pass" > 0, see interpolate_fields) the rasters of
+        all fields of the pass are interpolated at once (see interpolate_raster_point_fields) instead
+        of "Map->raster".
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object
+        struct usr_map *Map	...	pointer to the map object.
         
         OUTPUT: (error code)
-        on success:		...	EXIT_SUCCESS
-        on failure:		...	EXIT_FAILURE        
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
         
     */
     
-    int idx, jdx;
+
+    int idx;
     int excno;
+    volatile int failed_row = -1;
     jmp_buf env;
     
     
-    
     if ((excno = setjmp(env)) == 0){
     
-        int cnt_neg_slope;
-        int cnt_raising_slope;
-        int itemp;
-        int *density_variances;  
-      
-        double sill, range, RSME, interval;	//
-        double RSME_min=-1;			// Minimumwert des RSME
-        double y_max;				// Maximumwert der Vorhersagewerte der Semivarianzen
-        double **input_data_poly_reg;		// Doppelzeiger auf Matrix mit Eingabedaten.
-        double *diff_variance_avg_reg;		// abgeleitete Werte der Vorhersagewerte der Semivarianz mittels polyn. Regression
-        double *calc_variances;			// berechnete Werte der Semivarainz pro lag mit Hilfe der exponentiellen Funktion
-        double *variogram_variances;		// Semivarianzwerte der lags des Variogramms bis zum gesuchten Vergleichsindex.
-        double tmp;				// temporary variable, commonly used for checking purposes
-		
-    
-        if (Map->show_output){
-            printf("Get variogram model ... ");
-            fflush(stdout);
-        }
-    
-        // allocate memory for the input dataset for the polynomic regression
-        input_data_poly_reg = create_fmatrix(Map->variogram.numClasses, 2);
-        if (input_data_poly_reg == NULL){
-            longjmp(env, 1);
-        }
-    
-        // allocate memory for the variance values of the variogram
-        variogram_variances = create_fvector(Map->variogram.numClasses);
-        if (variogram_variances == NULL){
-            longjmp(env, 1);
-        }   
-
-        /*
-            prepare the following values
-                - distance_avg (x-Werte)
-                - variance_avg (y-Werte)
-            to perform a polynomic regression.
-        */
+        int num_threads;
+        int max_neighbours = 0;
+        int err = 0;
+        long num_factorizations = 0;
+        bool local = is_local_kriging(Map);
+        struct usr_thread_pool pool;
+        struct usr_interpol_thread *threads;
+        struct usr_arena_mark scratch = arena_mark(&(Map->arena));	// the tables and buffers of the threads are given back at the end
         
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        num_threads = (Map->num_threads > 0) ? (int)Map->num_threads : 1;
         
-            // transfer x-values:
-            input_data_poly_reg[idx][0] = Map->variogram.classes[idx].distance_avg;
+        // never start more threads than there are rows:
+        if (num_threads > (int)Map->rows){
+            num_threads = (int)Map->rows;
+        }
         
-            // transfer y-values:
-            input_data_poly_reg[idx][1] = Map->variogram.classes[idx].variance_avg; 
+        if (local){
         
-            // Übertrage y-Werte in Vektor:
-            variogram_variances[idx] = Map->variogram.classes[idx].variance_avg; 
+            // station index to find the nearest stations:
+            err = create_station_index(&(Map->arena), &(Map->station_index), &(Map->input_data));
+            if (err == EXIT_FAILURE){
+                longjmp(env, 8);
+            }
+            max_neighbours = ((Map->num_neighbours > 0) && (Map->num_neighbours < Map->input_data.length)) ? Map->num_neighbours : Map->input_data.length;
         }
-    
-
-
-        // Calculate the polynomic regression of 4th order.
-        /* Is successful it returns a pointer to an array of length order +2 with the solutions
-           Example:
-           Order(n): 4
-           
-           array[0] to array[n]		...	contains the weights of the polynomic function from b0 to bn
-           array[n+1] 			...	contains the coefficient of determination
-        */
-        Map->variogram.reg_function.solution = polynomial_regression(input_data_poly_reg, 
-                                                                     Map->variogram.numClasses, 
-                                                                     Map->variogram.reg_function.order);
-        if (Map->variogram.reg_function.solution == NULL){
-            longjmp(env, 2);
+        else{
+        
+            // precompute the trigonometric terms of the distances:
+            err = create_grid_distance(&(Map->arena), &(Map->grid_distance), &(Map->raster), &(Map->input_data));
+            if (err == EXIT_FAILURE){
+                longjmp(env, 7);
+            }
         }
         
-        // Calculate on the basis of the regress function the predicted value for the semivariance 
-        // ... over the average distances of the semivariances
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        threads = (struct usr_interpol_thread *) arena_alloc(&(Map->arena), num_threads * sizeof(struct usr_interpol_thread));
+        if (threads == NULL){
+            longjmp(env, 1);
+        }
         
-             
-            // start value is weight0 (b0):
-            if ((isnan(Map->variogram.reg_function.solution[0])) || (isinf(Map->variogram.reg_function.solution[0]))){
-                longjmp(env, 4);
-            }
-            else{
-                Map->variogram.classes[idx].variance_avg_reg = Map->variogram.reg_function.solution[0];
-            }
+        atomic_init(&pool.next_row, 0);
+        atomic_init(&pool.cells_done, 0);
+        atomic_init(&pool.last_permille, 0);
+        atomic_init(&pool.abort, 0);
+        
+        // every thread gets its own covariance- and weights vector:
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].Map = Map;
+            threads[idx].pool = &pool;
+            threads[idx].excno = 0;
+            threads[idx].failed_row = -1;
+            threads[idx].cov_vector = create_fvector(&(Map->arena), Map->input_data.length+1);
+            threads[idx].weights_vector = create_fvector(&(Map->arena), Map->input_data.length+1);
             
-            // sum over the powers:
-            for (jdx=1; jdx<=Map->variogram.reg_function.order; jdx++){
-                    
-                // check for nan and inf values within the predicted variance data:
-                tmp = (Map->variogram.reg_function.solution[jdx] * pow(Map->variogram.classes[idx].distance_avg, jdx));
-                if ((isnan(tmp)) || (isinf(tmp))){
-                    longjmp(env, 3);
-                }
-                else{
-                    Map->variogram.classes[idx].variance_avg_reg += tmp;
+            if ((threads[idx].cov_vector == NULL) || (threads[idx].weights_vector == NULL)){
+                free_interpol_threads(threads, num_threads);
+                longjmp(env, 1);
+            }
+            
+            // buffers of the nearest stations and of the local system:
+            if (local){
+                if ((create_neighbourhood(&(Map->arena), &(threads[idx].neighbourhood), max_neighbours) == EXIT_FAILURE) ||
+                    (create_local_system(&(Map->arena), &(threads[idx].local), max_neighbours) == EXIT_FAILURE)){
+                    free_interpol_threads(threads, num_threads);
+                    longjmp(env, 1);
                 }
             }
         }
         
-        // Now found the part of the polynomic function you want to adjust the exponential model
-        find_model_adjust_index(Map, variogram_variances, Map->variogram.numClasses);
-
-        // allocate memory for the calculated variances on basis of the exponential model:
-        calc_variances = create_fvector(Map->variogram.model_adjust_index);
-        if (calc_variances == NULL){
-            longjmp(env, 1);
+        if (Map->show_output){
+            printf("interpolating (%d threads) ...         ", num_threads);
+            fflush(stdout);
         }
-
-        // find sill and range for exponential model:
-        for (sill=0; sill<100; sill++){
         
-            for (range=0; range<=Map->variogram.classes[Map->variogram.model_adjust_index].distance_avg; range+=0.1){
-            
-                // Calculate the semivariance with the help of the exponential model:
-                for (idx=0; idx<Map->variogram.model_adjust_index; idx++){
-                
-                    calc_variances[idx] = calc_covariance(Map->variogram.classes[idx].distance_avg, 
-                                                          sill, 
-                                                          Map->variogram.nugget, 
-                                                          range);
-                }
-                
-                // get the error by calculating the rsme:
-                RSME = calc_RSME(calc_variances, variogram_variances, Map->variogram.model_adjust_index);                                 
-                if (isnan(RSME) || (isinf(RSME))){
-                    longjmp(env, 5);
-                }
-                   
-                // take over the values of sill and range as long as they are smaller then the prevoius ones.
-                if ((RSME < RSME_min) || (RSME_min < 0)){
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, interpolate_raster_worker, &threads[idx]) != 0){
             
-                    RSME_min = RSME;
-                    Map->variogram.sill = sill;
-                    Map->variogram.range = range;
-                    continue;
-                }
-                else{
-                    continue;
+                // stop and wait for the threads that are already running:
+                atomic_store(&pool.abort, 1);
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
                 }
+                free_interpol_threads(threads, num_threads);
+                longjmp(env, 6);
             }
         }
         
+        interpolate_raster_worker(&threads[0]);
         
-        // check previously if b0-weight is nan or inf:
-        if ((isnan(Map->variogram.reg_function.solution[0])) || (isinf(Map->variogram.reg_function.solution[0]))){
-            longjmp(env, 4);
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
         }
         
-        // pass the value of the nugget to the model:
-        if (Map->variogram.reg_function.solution[0] < 0){
-            Map->variogram.nugget = 0.001;
+        // take over the error of the first thread that failed:
+        for (idx=0; idx<num_threads; idx++){
+            if (threads[idx].excno != 0){
+                err = threads[idx].excno;
+                failed_row = threads[idx].failed_row;
+                break;
+            }
         }
-        else{
-            Map->variogram.nugget = Map->variogram.reg_function.solution[0];
+        for (idx=0; idx<num_threads; idx++){
+            num_factorizations += threads[idx].local.num_factorizations;
         }
         
+        free_interpol_threads(threads, num_threads);
+        arena_rewind(&(Map->arena), scratch);
         
-        // deallocate the memory
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
-            free(input_data_poly_reg[idx]);
+        if (err != 0){
+            longjmp(env, err);
+        }
+        
+        // the raster points with a station get the measured value:
+        if (Map->batch.num_pass > 0){
+            for (idx=0; idx<Map->batch.num_pass; idx++){
+                apply_field_overlay(&(Map->batch.rasters[idx]), &(Map->input_data), Map->batch.pass_fields[idx]);
+            }
+        }
+        else{
+            apply_station_overlay(&(Map->raster), &(Map->input_data));
         }
-
-        free(input_data_poly_reg);    
-        free(calc_variances);    
-        free(variogram_variances);
         
         if (Map->show_output){
             printf("ok\n");
+            
+            if (local){
+                printf("local kriging: %ld decompositions for %ld raster points\n", num_factorizations, (long)Map->rows * (long)Map->cols);
+            }
         }
         
         return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;                
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> The solution for the polynomic regression returns NULL!\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> The vector of the predicted variances contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 4: fprintf(stderr, "ERROR: %s --> %d:\n >>> The value of the b0 weight is \"NAN\" or \"INF\"!\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 5: fprintf(stderr, "ERROR: %s --> %d:\n >>> The calculated value of the RSME is \"NAN\" or \"INF\"!\n", __FILE__, __LINE__); return EXIT_FAILURE;        
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Row %d of the raster contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__, failed_row); return EXIT_FAILURE; 
+            case 4: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Calculation of weights returned an error (row %d)!\n", __FILE__, __LINE__, failed_row); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when starting the interpolation threads!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when creating the distance tables!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Failure when creating the station index!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
-}
+};        
 
 
 // ##################################################################################################
 // ##################################################################################################
 
 
-int find_model_adjust_index(struct usr_map *Map, double *variogram_variances, int length){
+void *interpolate_raster_worker(void *arg){
 
     /*
+    
         DESCRIPTION:
-        Finds the (lag)-index of the variogram we want to adjust the exponential model with.
-        
-        BACKGROUND:
-        any lag of the varigram is defined by a average distance and a average semivarianz.
-        The progress of the semivariance follows a exponential function defined by:
-        
-        nugget + sill * (1-exp(-|distance|/a)), mit a = range/3;
-        
-        Now we have to find the index of that lag until we want to adjust the expontential model.
+        Thread function of the interpolation. Takes blocks of ROW_BLOCK rows out of the shared
+        row counter until all rows of the raster are done or another thread has failed.
+        The kernels do not check their results, instead every finished row is checked once
+        for "NAN" or "INF" (see row_is_finite).
+        The progress is counted without any lock and shown in steps of 0.1 %.
         
         INPUT:
-        struct usr_map *Map		...	pointer to the map object
-        double *variogram_variances	...	pointer an array with a copy of the variogram variances
-        int length			...	lenght of that array.
+        void *arg		...	pointer to the thread object of type struct usr_interpol_thread.
+        
+        OUTPUT:
+        always NULL. An error is passed by the attribute "excno" of the thread object.
         
     */
 
-    int idx, jdx;
-    int excno;
-    jmp_buf env;
+    int row, first_row, last_row, col, field;
+    int permille, last_permille;
+    long cells_done;
+    bool finite;
     
+    struct usr_interpol_thread *thread = (struct usr_interpol_thread *) arg;
+    struct usr_thread_pool *pool = thread->pool;
+    struct usr_map *Map = thread->Map;
     
-    if ((excno = setjmp(env)) == 0){
+    long num_cells = (long)Map->rows * (long)Map->cols;
     
-        int imax=0;
-        int *density_variances;
-        double y_max, interval;
     
+    while (!atomic_load(&pool->abort)){
     
-        // vector of the destribution of the semivariances of the distance classes:
-        density_variances = create_vector(Map->variogram.numClasses);
-        if (density_variances == NULL){
-            longjmp(env, 1);
+        // take the next block of rows:
+        first_row = atomic_fetch_add(&pool->next_row, ROW_BLOCK);
+        if (first_row >= (int)Map->rows){
+            break;
         }
-    
-        // gives you the maximum value of the semivariance vector
-        y_max = get_fvector_max(variogram_variances, Map->variogram.numClasses);
-    
-        // Calculates the width of an interval out of the maximum value and the number of intervals
-        interval = y_max/Map->variogram.numClasses;
-       
-        // Count the number of semivarinaces and assign them to the vecor desity_variances
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        last_row = ((first_row + ROW_BLOCK) < (int)Map->rows) ? (first_row + ROW_BLOCK) : (int)Map->rows;
         
-            for (jdx=0; jdx<Map->variogram.numClasses-1; jdx++){
+        // interpolate every point, the points with a station are overwritten later on (overlay):
+        for (row=first_row; row<last_row; row++){
+            for (col=0; col<(int)Map->cols; col++){
             
-                if ((variogram_variances[idx] > jdx*interval) && (variogram_variances[idx] < (jdx+1)*interval)){
-                
-                    density_variances[jdx]++;
+                if (is_local_kriging(Map)){
+                    thread->excno = interpolate_raster_point_local(Map, thread, row, col);
+                }
+                else if (Map->batch.num_pass > 0){
+                    thread->excno = interpolate_raster_point_fields(Map, row, col, thread->cov_vector, thread->weights_vector);
+                }
+                else if (Map->dual_coefficients != NULL){
+                    thread->excno = interpolate_raster_point_dual(Map, row, col, thread->cov_vector);
+                }
+                else{
+                    thread->excno = interpolate_raster_point(Map, row, col, thread->cov_vector, thread->weights_vector);
+                }
+                if (thread->excno != 0){
+                    thread->failed_row = row;
+                    atomic_store(&pool->abort, 1);
+                    return NULL;
                 }
             }
+            
+            // status of the row (of every raster of a pass of the batch):
+            finite = (Map->batch.num_pass > 0) || (row_is_finite(&(Map->raster.value[(size_t)row * Map->cols]), Map->cols));
+            finite = (finite) && ((!Map->kriging_variance) || (row_is_finite(&(Map->variance.value[(size_t)row * Map->cols]), Map->cols)));
+            for (field=0; (finite) && (field<Map->batch.num_pass); field++){
+                finite = row_is_finite(&(Map->batch.rasters[field].value[(size_t)row * Map->cols]), Map->cols);
+            }
+            if (!finite){
+                thread->excno = 3;
+                thread->failed_row = row;
+                atomic_store(&pool->abort, 1);
+                return NULL;
+            }
         }
         
-        // now find the maximum value within the density_variances vector
-        // take the first occurence
-        for (idx=0; idx<Map->variogram.numClasses; idx++){
+        cells_done = atomic_fetch_add(&pool->cells_done, (long)(last_row - first_row) * Map->cols) + (long)(last_row - first_row) * Map->cols;
         
-            if (density_variances[idx] == get_dvector_max(density_variances, Map->variogram.numClasses)){
-                
-                imax = idx;
+        // show the progress, but only if no other thread has already shown a higher one:
+        if (Map->show_output){
+        
+            permille = (int)((cells_done * 1000) / num_cells);
+            last_permille = atomic_load(&pool->last_permille);
+            
+            while (permille > last_permille){
+                if (atomic_compare_exchange_weak(&pool->last_permille, &last_permille, permille)){
+                    printf("\b\b\b\b\b\b\b\b\b %5.1f %% ", permille / 10.0);
+                    fflush(stdout);
+                    break;
+                }
             }
         }
+    }
+    return NULL;
+}
 
-        // Now make the sum over the number of all semivariances until the the interval with the most values.
-        for (idx=0; idx<=imax; idx++){
-            Map->variogram.model_adjust_index += density_variances[idx];
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int interpolate_raster_point(struct usr_map *Map, int row, int col, double *cov_vector, double *weights_vector){
+
+    /*
+    
+        DESCRIPTION:
+        Calculates the interpolated value of one point of the raster.
+        With "Map->kriging_variance" the kriging variance of the point is calculated as well
+        (see calc_kriging_variance).
         
-        }
+        INPUT:
+        struct usr_map *Map		...	pointer to the map object.
+        int row				...	row index of the raster point.
+        int col				...	column index of the raster point.
+        double *cov_vector		...	covariance vector of length "Map->input_data.length+1" (scratch).
+        double *weights_vector		...	weights vector of length "Map->input_data.length+1" (scratch).
         
-        free(density_variances);
+        OUTPUT: (error number of interpolate_raster)
+        on success			...	0
+        on failure			...	4 (weights)
+        A "NAN" or "INF" is passed on to the value of the raster point (see row_is_finite).
         
-        return EXIT_SUCCESS;
+    */
+
+    int kdx;
+    int err;
+    double sum = 0;
+
+
+    // calculate for this point the distances to all stations (stored in the covariance vector):
+    grid_distances(&(Map->grid_distance), row, col, cov_vector);
+
+    // convert the distances into covariances, the last value is 1:
+    for (kdx=0; kdx<Map->input_data.length; kdx++){
+        cov_vector[kdx] = calc_covariance(cov_vector[kdx],
+                                          Map->variogram.sill, 
+                                          Map->variogram.nugget,
+                                          Map->variogram.range,
+                                          Map->variogram.model);
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;        
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        }
-    }  
+    cov_vector[Map->input_data.length] = 1;
+
+    // now solve the kriging system with the individual covariance vector as right hand side:
+    err = lu_solve(&(Map->covariance_factor), cov_vector, weights_vector);
+    if (err == EXIT_FAILURE){
+        return 4;
+    }
+    
+    // kriging variance (of the weights before any correction):
+    if (Map->kriging_variance){
+        Map->variance.value[(size_t)row * Map->cols + col] = calc_kriging_variance(weights_vector, cov_vector, Map->input_data.length);
+    }
+
+    if (Map->weights_correction){
+
+        // correct negative weights:
+        correct_negative_weights(weights_vector, cov_vector, Map->input_data.length);
+    }
+
+    // Calculate the interpolated value, as the sum of the weighted precipitation values.
+    for (kdx=0; kdx<Map->input_data.length; kdx++){
+
+        sum += (weights_vector[kdx] * Map->input_data.data[kdx].value);
+    }
+
+    // assign value to raster
+    Map->raster.value[(size_t)row * Map->cols + col] = sum;
+    
+    return 0;
 }
 
 
@@ -1299,98 +3047,290 @@ int find_model_adjust_index(struct usr_map *Map, double *variogram_variances, in
 // ##################################################################################################
 
 
-int create_covariance_matrix(struct usr_map *Map){
+int interpolate_raster_point_dual(struct usr_map *Map, int row, int col, double *cov_vector){
 
     /*
+    
         DESCRIPTION:
-        
-        Creates by using the determined semivariance model a covariance matrix.
+        Calculates the interpolated value of one point of the raster by dual kriging
+        (see create_dual_coefficients) as the dot product of its covariance vector and
+        the dual coefficients.
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object
-
-        OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+        struct usr_map *Map		...	pointer to the map object.
+        int row				...	row index of the raster point.
+        int col				...	column index of the raster point.
+        double *cov_vector		...	covariance vector of length "Map->input_data.length+1" (scratch).
+        
+        OUTPUT: (error number of interpolate_raster)
+        always 0, a "NAN" or "INF" is passed on to the value of the raster point (see row_is_finite).
+        
     */
 
-    int idx, jdx;
-    int excno;
-    jmp_buf env;
+    int kdx;
+    double sum;
+    
+    
+    // the last value of the covariance vector is 1:
+    sum = Map->dual_coefficients[Map->input_data.length];
 
+    // calculate for this point the distances to all stations:
+    grid_distances(&(Map->grid_distance), row, col, cov_vector);
 
-    if ((excno = setjmp(env)) == 0){  
+    for (kdx=0; kdx<Map->input_data.length; kdx++){
+        sum += calc_covariance(cov_vector[kdx],
+                               Map->variogram.sill, 
+                               Map->variogram.nugget,
+                               Map->variogram.range,
+                               Map->variogram.model) * Map->dual_coefficients[kdx];
+    }
 
-        double tmp;	 		// temporary value for checking purposes
+    // assign value to raster
+    Map->raster.value[(size_t)row * Map->cols + col] = sum;
+    
+    return 0;
+}
 
-        if (Map->show_output){
-            printf("Calculate covariance matrix ... ");
-            fflush(stdout);
-        }
 
-        // Reservieren der Kovarianzmatrix:   
-        Map->covariance_matrix = create_fmatrix(Map->input_data.length+1, Map->input_data.length+1);
-        if (Map->covariance_matrix == NULL){
-            longjmp(env, 1);
-        }
+// ##################################################################################################
+// ##################################################################################################
+
+
+int interpolate_raster_point_fields(struct usr_map *Map, int row, int col, double *cov_vector, double *weights_vector){
+
+    /*
     
-        // Berechne die Kovarianzen:
-        for (idx=0; idx<Map->input_data.length+1; idx++){
-            for (jdx=0; jdx<Map->input_data.length+1; jdx++){
+        DESCRIPTION:
+        Batch: calculates the interpolated values of one point of the raster for all fields of the
+        current pass (see interpolate_fields). The covariance vector of the point is the same for all
+        fields, so it is calculated once:
+        - dual kriging: the value of a field is the dot product of the covariance vector and the
+          coefficients of the field ("Map->batch.coefficients", (n+1) x num_pass)
+        - otherwise the weights are solved once (and corrected), the value of a field is the dot
+          product of the weights and the measured values of the field ("Map->batch.values", n x num_pass)
+        The values of a field are the same as the ones of interpolate_raster_point_dual and
+        interpolate_raster_point (same order of the operations).
+        
+        INPUT:
+        struct usr_map *Map		...	pointer to the map object.
+        int row				...	row index of the raster point.
+        int col				...	column index of the raster point.
+        double *cov_vector		...	covariance vector of length "Map->input_data.length+1" (scratch).
+        double *weights_vector		...	weights vector of length "Map->input_data.length+1" (scratch).
+        
+        OUTPUT: (error number of interpolate_raster)
+        on success			...	0
+        on failure			...	4 (weights)
+        A "NAN" or "INF" is passed on to the value of the raster point (see row_is_finite).
+        
+    */
+
+    int kdx, field;
+    int n = Map->input_data.length;
+    int num_pass = Map->batch.num_pass;
+    double factor;
+    double sums[BATCH_FIELDS_PER_PASS];
+    const double *values;
+
+
+    // calculate for this point the distances to all stations:
+    grid_distances(&(Map->grid_distance), row, col, cov_vector);
+
+    if (Map->batch.coefficients != NULL){
+    
+        // the last value of the covariance vector is 1:
+        values = &(Map->batch.coefficients[(size_t)n * num_pass]);
+        for (field=0; field<num_pass; field++){
+            sums[field] = values[field];
+        }
+        
+        for (kdx=0; kdx<n; kdx++){
+        
+            factor = calc_covariance(cov_vector[kdx],
+                                     Map->variogram.sill, 
+                                     Map->variogram.nugget,
+                                     Map->variogram.range,
+                                     Map->variogram.model);
             
-                // Ist der zu berechnende Wert gleich der letzten Spalte und der letzten Zeile,
-                // ... so setze ihn auf 0:
-                if ((idx == (Map->input_data.length)) && (jdx == (Map->input_data.length))){
-                
-                    Map->covariance_matrix[idx][jdx] = 0;
-                    continue;
-                    
-                }
-                
-                // Ist der zu berechnende Wert gleich der letzten Spalte, oder der letzten Zeile,
-                // ... so setze ihn auf 1:                
-                if ((idx == (Map->input_data.length)) || (jdx == (Map->input_data.length))){
-                
-                    Map->covariance_matrix[idx][jdx] = 1;
-                    continue;
-                }
-                else{
-                    // Ist die Distanz 0 , dann entspricht die Kovarianz dem nugget-Wert:
-                    if (Map->distance_matrix[idx][jdx] < EPS){
-                        
-                        Map->covariance_matrix[idx][jdx] = Map->variogram.nugget;
-                    }
-                    else{
-                        
-                        tmp = calc_covariance(Map->distance_matrix[idx][jdx], 
+            values = &(Map->batch.coefficients[(size_t)kdx * num_pass]);
+            for (field=0; field<num_pass; field++){
+                sums[field] += factor * values[field];
+            }
+        }
+    }
+    else{
+    
+        // convert the distances into covariances, the last value is 1:
+        for (kdx=0; kdx<n; kdx++){
+            cov_vector[kdx] = calc_covariance(cov_vector[kdx],
                                               Map->variogram.sill, 
                                               Map->variogram.nugget,
-                                              Map->variogram.range);
-                        
-                        if ((isnan(tmp)) || (isinf(tmp))){
-                            longjmp(env, 2);
-                        }
-                        else{
-                            Map->covariance_matrix[idx][jdx] = tmp;
-                        }
-                    }
-                }
+                                              Map->variogram.range,
+                                              Map->variogram.model);
+        }
+        cov_vector[n] = 1;
+        
+        if (lu_solve(&(Map->covariance_factor), cov_vector, weights_vector) == EXIT_FAILURE){
+            return 4;
+        }
+        
+        if (Map->weights_correction){
+            correct_negative_weights(weights_vector, cov_vector, n);
+        }
+        
+        for (field=0; field<num_pass; field++){
+            sums[field] = 0;
+        }
+        for (kdx=0; kdx<n; kdx++){
+        
+            factor = weights_vector[kdx];
+            values = &(Map->batch.values[(size_t)kdx * num_pass]);
+            for (field=0; field<num_pass; field++){
+                sums[field] += factor * values[field];
+            }
+        }
+    }
+    
+    // assign the values to the rasters of the fields:
+    for (field=0; field<num_pass; field++){
+        Map->batch.rasters[field].value[(size_t)row * Map->cols + col] = sums[field];
+    }
+    
+    return 0;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int interpolate_raster_point_local(struct usr_map *Map, struct usr_interpol_thread *thread, int row, int col){
+
+    /*
+    
+        DESCRIPTION:
+        Calculates the interpolated value of one point of the raster by local kriging with its
+        nearest stations (see find_nearest_stations). The kriging system of these stations is only
+        set up and decomposed, if the stations differ from the ones of the previous raster point
+        of this thread (see setup_local_system). Without correction of negative weights the
+        value is calculated by the dual coefficients of the system.
+        With "Map->kriging_variance" the kriging variance of the point is calculated as well.
+        Raster points without any station within the search radius get NO_VALUE.
+        
+        INPUT:
+        struct usr_map *Map			...	pointer to the map object.
+        struct usr_interpol_thread *thread	...	pointer to the thread object (buffers).
+        int row					...	row index of the raster point.
+        int col					...	column index of the raster point.
+        
+        OUTPUT: (error number of interpolate_raster)
+        on success				...	0
+        on failure				...	4 (weights)
+        A "NAN" or "INF" is passed on to the value of the raster point (see row_is_finite).
+        
+    */
+
+    int idx, jdx, sidx, num;
+    int err;
+    double sum = 0;
+    double check_tmp;			// just for check purposes
+    double *cov_vector = thread->cov_vector;
+    double *weights_vector = thread->weights_vector;
+    
+    struct usr_neighbourhood *nb = &(thread->neighbourhood);
+    struct usr_local_system *local = &(thread->local);
+    
+    
+    num = find_nearest_stations(&(Map->station_index), &(Map->input_data), 
+                                raster_lat(&(Map->raster), row), 
+                                raster_lon(&(Map->raster), col),
+                                (Map->num_neighbours > 0) ? Map->num_neighbours : Map->input_data.length, 
+                                Map->search_radius, 
+                                nb);
+    
+    if (num == 0){
+        Map->raster.value[(size_t)row * Map->cols + col] = NO_VALUE;
+        if (Map->kriging_variance){
+            Map->variance.value[(size_t)row * Map->cols + col] = NO_VALUE;
+        }
+        return 0;
+    }
+    
+    // sort the stations by their index (the order of the kriging system):
+    for (idx=1; idx<num; idx++){
+    
+        sidx = nb->station_idx[idx];
+        check_tmp = nb->distances[idx];
+        
+        for (jdx=idx; (jdx > 0) && (nb->station_idx[jdx-1] > sidx); jdx--){
+            nb->station_idx[jdx] = nb->station_idx[jdx-1];
+            nb->distances[jdx] = nb->distances[jdx-1];
+        }
+        nb->station_idx[jdx] = sidx;
+        nb->distances[jdx] = check_tmp;
+    }
+    
+    // set up a new system, if the stations differ from the previous raster point:
+    if ((local->num_stations != num) || (memcmp(local->station_idx, nb->station_idx, num * sizeof(int)) != 0)){
+    
+        err = setup_local_system(Map, local, nb, weights_vector);
+        if (err == EXIT_FAILURE){
+            return 4;
+        }
+    }
+    
+    // covariance vector of the raster point:
+    for (idx=0; idx<num; idx++){
+        cov_vector[idx] = calc_covariance(nb->distances[idx],
+                                          Map->variogram.sill, 
+                                          Map->variogram.nugget,
+                                          Map->variogram.range,
+                                          Map->variogram.model);
+    }
+    cov_vector[num] = 1;
+    
+    // kriging variance (of the weights before any correction):
+    if (Map->kriging_variance){
+    
+        err = lu_solve(&(local->factor), cov_vector, weights_vector);
+        if (err == EXIT_FAILURE){
+            return 4;
+        }
+        Map->variance.value[(size_t)row * Map->cols + col] = calc_kriging_variance(weights_vector, cov_vector, num);
+    }
+    
+    if ((Map->dual_kriging) && (!Map->weights_correction)){
+    
+        // dual kriging: the last value of the covariance vector is 1
+        sum = local->coefficients[num];
+        for (idx=0; idx<num; idx++){
+            sum += cov_vector[idx] * local->coefficients[idx];
+        }
+    }
+    else{
+    
+        if (!Map->kriging_variance){
+            err = lu_solve(&(local->factor), cov_vector, weights_vector);
+            if (err == EXIT_FAILURE){
+                return 4;
             }
         }
         
-        if (Map->show_output){
-            printf("ok!\n");
+        if (Map->weights_correction){
+        
+            // correct negative weights:
+            correct_negative_weights(weights_vector, cov_vector, num);
         }
         
-        return EXIT_SUCCESS;
-    }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> There must be at least one variogram class.\n", __FILE__, __LINE__); return EXIT_FAILURE;                
-            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        for (idx=0; idx<num; idx++){
+            sum += (weights_vector[idx] * Map->input_data.data[nb->station_idx[idx]].value);
         }
     }
+    
+    // assign value to raster
+    Map->raster.value[(size_t)row * Map->cols + col] = sum;
+    
+    return 0;
 }
 
 
@@ -1398,110 +3338,85 @@ int create_covariance_matrix(struct usr_map *Map){
 // ##################################################################################################
 
 
-int create_inverted_covariance_matrix(struct usr_map *Map){
+int setup_local_system(struct usr_map *Map, struct usr_local_system *local, struct usr_neighbourhood *nb, double *rhs){
 
     /*
     
-        DESCRIPTION
-        Calculates the inverse of a matrix of type double by using Gauß-Jordan method.
+        DESCRIPTION:
+        Sets up and decomposes the kriging system of the stations of a neighbourhood (local kriging),
+        just like create_covariance_matrix does for all stations. Without correction of negative weights
+        the dual coefficients of the system are calculated as well.
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object
+        struct usr_map *Map			...	pointer to the map object.
+        struct usr_local_system *local		...	pointer to the local system.
+        struct usr_neighbourhood *nb		...	stations of the system (sorted by their index).
+        double *rhs				...	vector of length num. stations + 1 (scratch).
         
-        OUTOUT:
-        on success:		...	EXIT_SUCCESS
-        on failure:		...	EXIT_FAILURE
+        OUTPUT: (error code)
+        on success				...	EXIT_SUCCESS
+        on failure				...	EXIT_FAILURE
         
     */
 
-    int idx, jdx, kdx;
-    int excno;
-    jmp_buf env;
+    int idx, jdx;
+    int num = nb->num_neighbours;
+    double distance;
+    double *row;
     
-    if ((excno = setjmp(env)) == 0){
+    // the system is invalid until it is decomposed:
+    local->num_stations = 0;
     
-        double temp;
-        double **matrix_temp;		// temporary matrix for calculation purposes.
-
-        if (Map->show_output){
-            printf("Calculating the inverted covariance-matrix ... ");
-            fflush(stdout);
-        }
-
-        Map->covariance_matrix_inv = create_fmatrix(Map->input_data.length+1, Map->input_data.length+1);
-        if (Map->covariance_matrix_inv == NULL){
-            longjmp(env, 1);
-        }
+    // the buffer holds the packed system of max. stations, it is used for the (smaller) one of this neighbourhood:
+    local->matrix.rows = num+1;
+    local->matrix.cols = num+1;
+    
+    // upper triangle (the matrix is symmetric):
+    for (idx=0; idx<num; idx++){
+    
+        row = matrix_upper_row(&(local->matrix), idx);
         
-        matrix_temp = create_fmatrix(Map->input_data.length+1, Map->input_data.length+1);
-        if (matrix_temp == NULL){
-            longjmp(env, 1);
-        }
-   
-        // Copy the content of the covariance matrix to the temporary matrix:
-        for(idx=0; idx<Map->input_data.length+1; idx++){
-            for(jdx=0; jdx<Map->input_data.length+1; jdx++){
-	        if ((isnan(Map->covariance_matrix[idx][jdx])) || (isinf(Map->covariance_matrix[idx][jdx]))){
-	            longjmp(env, 2);
-	        }
-	        else{
-	            matrix_temp[idx][jdx] = Map->covariance_matrix[idx][jdx];
-	        }
-	    }
-        }
-
-        
-        // Set the diagonal values of the inverted matrix to 1 else leave it at 0:
-        for(idx=0; idx<Map->input_data.length+1; idx++){
-            Map->covariance_matrix_inv[idx][idx] = 1;
-        }
-
-
-        // finally perform some calculations
-        for(kdx=0 ;kdx<Map->input_data.length+1; kdx++){
-    														
-	    temp=matrix_temp[kdx][kdx];
-											
-            for(jdx=0; jdx<Map->input_data.length+1; jdx++){
-        
-	        matrix_temp[kdx][jdx] /= temp;
-	        Map->covariance_matrix_inv[kdx][jdx] /= temp;
-	    }
-														
-	    for(idx=0; idx<Map->input_data.length+1; idx++){
-	
-	        temp=matrix_temp[idx][kdx];
-	    									
-	        for(jdx=0; jdx<Map->input_data.length+1; jdx++){
-	    												
-		    if(idx == kdx){
-		        break;
-		    }									
-		    matrix_temp[idx][jdx] -= matrix_temp[kdx][jdx] * temp;
-								
-		    Map->covariance_matrix_inv[idx][jdx] -= Map->covariance_matrix_inv[kdx][jdx] * temp;
-	        }
-	    }
-        }
-        
-        for(idx=0; idx<Map->input_data.length+1; idx++){
-            free(matrix_temp[idx]);
-        }
-        free(matrix_temp);
+        for (jdx=idx; jdx<num; jdx++){
         
-        if (Map->show_output){
-            printf("ok\n");
+            distance = matrix_get(&(Map->distance_matrix), nb->station_idx[idx], nb->station_idx[jdx]);
+            
+            if (distance < EPS){
+                row[jdx-idx] = Map->variogram.nugget;
+            }
+            else{
+                row[jdx-idx] = calc_covariance(distance, 
+                                               Map->variogram.sill, 
+                                               Map->variogram.nugget,
+                                               Map->variogram.range,
+                                               Map->variogram.model);
+            }
         }
-        
-        return EXIT_SUCCESS;
+        row[num-idx] = 1;
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The covarinace matrix contains \"NAN\" and \"INF\" values\n", __FILE__, __LINE__); return EXIT_FAILURE;                
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+    matrix_set(&(local->matrix), num, num, 0);
+    
+    if (lu_factorize(&(local->factor), &(local->matrix)) == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+    local->num_factorizations++;
+    
+    // dual coefficients: C * a = (z, 0)
+    if ((Map->dual_kriging) && (!Map->weights_correction)){
+    
+        for (idx=0; idx<num; idx++){
+            rhs[idx] = Map->input_data.data[nb->station_idx[idx]].value;
+        }
+        rhs[num] = 0;
+        
+        if (lu_solve(&(local->factor), rhs, local->coefficients) == EXIT_FAILURE){
+            return EXIT_FAILURE;
         }
     }
+    
+    memcpy(local->station_idx, nb->station_idx, num * sizeof(int));
+    local->num_stations = num;
+    
+    return EXIT_SUCCESS;
 }
 
 
@@ -1509,284 +3424,239 @@ int create_inverted_covariance_matrix(struct usr_map *Map){
 // ##################################################################################################
 
 
-int interpolate_raster(struct usr_map *Map){
+static inline void correct_negative_weights(double *weights_vector, double *cov_vector, int length){
 
     /*
     
         DESCRIPTION:
-        Calculates for any point of the raster who has no value an interpolated value.
+        Sets negative weights to 0.
+        Performs subsequently a restandardization to get the sum of all posiitive weights to 1.
+        Kernel of the interpolation without any checks (see row_is_finite).
         
         INPUT:
-        struct usr_map *Map	...	pointer to the map object.
-        
-        OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
-        
-    */
+        double *weights_vector		...	pointer to the weights vector to correctify.
+        double *cov_vector		...	pointer to the covariance vector.
+        int length			...	length of these vectors.
     
+    */
 
-    int idx, jdx, kdx;
-    int excno;
-    jmp_buf env;
-    int err = EXIT_FAILURE;
-    
-    
-    if ((excno = setjmp(env)) == 0){
-    
-        int value_cnt=1;
-        double *cov_vector, *weights_vector;
-        double sum;
-        double check_tmp;			// just for check purposes
+    int idx;
+    int cnt=0;
+    double sum_weights=0;					// sum of all weights
+    double sum_cov=0;					// sum of all covariances
+    double absAvg_negWeights=0;				// absolute average of negative weights
+    double avgCov_negWeights=0;				// average of neg. covariances
     
-        cov_vector = create_fvector(Map->input_data.length+1);
-        if (cov_vector == NULL){
-            longjmp(env, 1);
-        }
+
+    for (idx=0; idx<length; idx++){
+
+        // if the weight is negative...
+        if (weights_vector[idx] < 0){
         
-        weights_vector = create_fvector(Map->input_data.length+1);
-        if (weights_vector == NULL){
-            longjmp(env, 1);
-        }
+            // Calculate the absolute sum of these negative weights:
+            sum_weights += fabs(weights_vector[idx]);
         
+            // calculate the sum of the corresponding covariances
+            sum_cov += cov_vector[idx];
         
-        if (Map->show_output){
-            printf("interpolating ...         ");
-            fflush(stdout);
+            // raise the counter for the number of negative weights
+            cnt++;
         }
+    }
+    
+    // end this function if there are no negative weights.   
+    if (cnt == 0){
+        return;
+    }
+    
+    // Calculate the average of the sum of neg. weights and covariances
+    absAvg_negWeights = (sum_weights/cnt);
+    avgCov_negWeights = (sum_cov/cnt);
+    
+    sum_weights = 0;
+
+    for (idx=0; idx<length; idx++){
+
+        // is the weight < 0, so set it to 0:
+        if (weights_vector[idx] < 0){
+            weights_vector[idx] = 0;
+        }
+        // is the weight > 0 and the covariance < avgCov_negWeights and the weight < absAvg_negWeights ...
+        else if ((weights_vector[idx] > 0) && 
+                 (cov_vector[idx] < avgCov_negWeights) && 
+                 (weights_vector[idx] < absAvg_negWeights)){
         
-        // Now go to every point of the raster step by step:
-        for (idx=0; idx<(Map->rows); idx++){
-            for (jdx=0; jdx<(Map->cols); jdx++){
-        
-                if (Map->show_output){
-                    printf("\b\b\b\b\b\b\b\b\b");
-                    fflush(stdout);                   
-                    printf(" %5.1f %% ", ((value_cnt*1.0)/(Map->rows*Map->cols*1.0)*100.0));               
-                    fflush(stdout);
-                } 
-                
-                value_cnt++;
-                
-                // If there is no value at the raster then interpolate:
-                // default value for no value is -1
-                if (Map->raster[idx][jdx].value < 0){
-            
-                    sum = 0;
-            
-                    // calculate for this point the distance and then the covariance to any other point with a value on the raster.
-                    for (kdx=0; kdx<Map->input_data.length+1; kdx++){
-                
-                        if (kdx != Map->input_data.length){
-                        
-                            // calculate the distance:
-                            check_tmp = calc_distance(Map->raster[idx][jdx].lat,
-                                                      Map->raster[idx][jdx].lon, 
-                                                      Map->input_data.data[kdx].lat,
-                                                      Map->input_data.data[kdx].lon);
-                                                   
-                            // just check if the distance is nan or inf:                                                      
-                            if ((isnan(check_tmp)) || (isinf(check_tmp))){
-                                longjmp(env, 2);
-                            }
-                            else{
-                                // calculate the covariance
-                                check_tmp = calc_covariance(check_tmp,
-                                                            Map->variogram.sill, 
-                                                            Map->variogram.nugget,
-                                                            Map->variogram.range);
-                                                            
-                                // just check if the covariance is nan or inf:
-                                if ((isnan(check_tmp)) || (isinf(check_tmp))){
-                                    longjmp(env, 3);
-                                }
-                                else{
-                                    cov_vector[kdx] = check_tmp;
-                                }                  
-                            }  
-                        }
-                        else{
-                            // set the last value to 1:
-                            cov_vector[kdx] = 1;
-                        }
-                    }
-                    
-                    // now multiply the individual covarinance vector with the inverted covariance matrix:
-                    err = multiplyMatrixVector(Map->covariance_matrix_inv, 
-                                               cov_vector,
-                                               weights_vector,
-                                               Map->input_data.length+1, 
-                                               Map->input_data.length+1);
-                    (err == EXIT_FAILURE) ? longjmp(env, 4) : NULL;
-                      
-                                                          
-                    if (Map->weights_correction){
-                        
-                        // correct negative weights:
-                        err = correct_negative_weights(weights_vector, cov_vector, Map->input_data.length);
-                        (err == EXIT_FAILURE) ? longjmp(env, 5) : NULL;
-                    }
-                    
-                    // Wert des Rasterpunktes mit 0 initialisieren:
-                    Map->raster[idx][jdx].value = 0;
-                    
-                    // Calculate the interpolated value, as the sum of the weighted precipitation values.
-                    for (kdx=0; kdx<Map->input_data.length; kdx++){
-                    
-                        sum += (weights_vector[kdx] * Map->input_data.data[kdx].value);
-                    }
-                    
-                    // assign value to raster
-                    Map->raster[idx][jdx].value = sum;
-                    
-                }
-                else{
-                    // is there a value skip that point.
-                    continue;
-            
-                }   
-            }    
+            // set the weight to 0 ...
+            weights_vector[idx] = 0;            
         }
-        if (Map->show_output){
-            printf("ok\n");
+        else{
+            // is the weight not set to 0, than sum up this value
+            sum_weights += weights_vector[idx];
         }
-        
-        free(cov_vector);
-        free(weights_vector);
-        
-        return EXIT_SUCCESS;
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The calculated distance is \"NAN\" or \"INF\"\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The calculated covariance is \"NAN\" or \"INF\"\n", __FILE__, __LINE__); return EXIT_FAILURE; 
-            case 4: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Calculation of weights returned an error!\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 5: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Correction of negative weights returned an error!\n", __FILE__, __LINE__); return EXIT_FAILURE;                              
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+
+    // is the sum of weights > 0, ...
+    if (sum_weights > 0){
+
+        // ... restandardize the weights:
+        for (idx=0; idx<length; idx++){
+
+            // but only the positive weights.
+            // the rest remains at 0
+            if (weights_vector[idx] > 0){
+
+                weights_vector[idx] = weights_vector[idx] / sum_weights;
+            }
+            else{
+                weights_vector[idx] = 0;
+            }
         }
     }
-};        
+}
 
 
 // ##################################################################################################
 // ##################################################################################################
 
 
-int correct_negative_weights(double *weights_vector, double *cov_vector, int length){
+static inline double calc_distance(double latA, double lonA, double latB, double lonB){
 
     /*
-    
         DESCRIPTION:
-        Sets negative weights to 0.
-        Performs subsequently a restandardization to get the sum of all posiitive weights to 1.
+        Calculates the distance between 2 point on a sphere with the radius of the earth at 51°N.
+        Kernel of the hot paths without any checks: the coordinates are checked once, when the
+        input dataset and the configuration are read (see input_csv_data, set_config).
+        The cosine of the angle is clamped to [-1, 1], so rounding can not produce "NAN"
+        (e.g. for two identical points).
         
         INPUT:
-        double *weights_vector		...	pointer to the weights vector to correctify.
-        double *cov_vector		...	pointer to the covariance vector.
-        int length			...	length of these vectors.
+        double latA	...	latitude of point A in decimal degree.
+        double lonA	...	longitude of point A in decimal degree.
+        double latB	...	latitude of point B in decimal degree.
+        double lonB	...	longitude of point B in decimal degree.
         
-        OUTPUT: (error code)
-        on success			...	EXIT_SUCCESS
-        on failure			...	EXIT_FAILURE
+        OUTPUT:
+        distance between the two points in km
+    */ 
     
+    // point A: 
+    double latA_rad = (latA/180.0) * M_PI;
+    double lonA_rad = (lonA/180.0) * M_PI;
+
+    // point B:
+    double latB_rad = (latB/180.0) * M_PI;
+    double lonB_rad = (lonB/180.0) * M_PI;
+
+    return RADIUS_EARTH * acos( clamp_unit( (sin(latA_rad) * sin(latB_rad) ) + ( cos(latA_rad) * cos(latB_rad) * ( cos(lonB_rad - lonA_rad) ) ) ) );
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double clamp_unit(double value){
+
+    /*
+        DESCRIPTION:
+        Clamps a value to [-1, 1] (argument of acos). "NAN" stays "NAN".
     */
 
-    int idx;
-    int excno;
-    jmp_buf env;
+    return (value > 1.0) ? 1.0 : ((value < -1.0) ? -1.0 : value);
+}
 
 
-    if ((excno = setjmp(env)) == 0){
+// ##################################################################################################
+// ##################################################################################################
 
-        int cnt=0;
-        double sum_weights=0;					// sum of all weights
-        double sum_cov=0;					// sum of all covariances
-        double absAvg_negWeights=0;				// absolute average of negative weights
-        double avgCov_negWeights=0;				// average of neg. covariances
-    
 
- 
-        for (idx=0; idx<length; idx++){
+static inline bool row_is_finite(const double *values, int length){
+
+    /*
+        DESCRIPTION:
+        Status flag of a row of the raster: the kernels of the interpolation do not check their
+        results, a "NAN" or "INF" is passed on to the value of the raster point instead.
+        value - value is 0 for any finite value and "NAN" otherwise, so one comparison of the sum
+        per row is enough.
+        
+        INPUT:
+        const double *values	...	values of the row
+        int length		...	number of values
+        
+        OUTPUT:
+        true, if all values are finite
+    */
+
+    int idx;
+    double status = 0;
     
-            // if the weight is negative...
-            if (weights_vector[idx] < 0){
-            
-                // Calculate the absolute sum of these negative weights:
-                sum_weights += fabs(weights_vector[idx]);
-            
-                // calculate the sum of the corresponding covariances
-                sum_cov += cov_vector[idx];
-            
-                // raise the counter for the number of negative weights
-                cnt++;
-            }
-        }
-        // end this function if there are no negative weights.   
-        if (cnt == 0){
+    for (idx=0; idx<length; idx++){
+        status += values[idx] - values[idx];
+    }
     
-            return EXIT_SUCCESS;
-        }
-        else{
-            // Calculate the average of the sum of neg. weights and covariances
-            absAvg_negWeights = (sum_weights/cnt);
-            avgCov_negWeights = (sum_cov/cnt);
-            
-            if ((isnan(absAvg_negWeights)) || (isinf(absAvg_negWeights)) || 
-                (isnan(avgCov_negWeights)) || (isinf(avgCov_negWeights))){
-            
-                longjmp(env, 1);   
-            }      
+    return (status == 0);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double calc_kriging_variance(double *weights_vector, double *cov_vector, int length){
+
+    /*
+        DESCRIPTION:
+        Calculates the ordinary kriging variance of a raster point out of the solution of its
+        kriging system (weights and lagrange multiplier) and its covariance vector:
         
-            sum_weights = 0;
+        variance = sum(weights * covariances) + lagrange multiplier
         
-            for (idx=0; idx<length; idx++){
-    
-                // is the weight < 0, so set it to 0:
-                if (weights_vector[idx] < 0){
-                    weights_vector[idx] = 0;
-                }
-                // is the weight > 0 and the covariance < avgCov_negWeights and the weight < absAvg_negWeights ...
-                else if ((weights_vector[idx] > 0) && 
-                         (cov_vector[idx] < avgCov_negWeights) && 
-                         (weights_vector[idx] < absAvg_negWeights)){
-                
-                    // set the weight to 0 ...
-                    weights_vector[idx] = 0;            
-                }
-                else{
-                    // is the weight not set to 0, than sum up this value
-                    sum_weights += weights_vector[idx];
-                }
-            }
+        Because the last value of the covariance vector is 1, this is just the dot product of
+        both vectors. Negative values (rounding) are set to 0.
+        
+        INPUT:
+        double *weights_vector	...	weights and lagrange multiplier (length + 1)
+        double *cov_vector	...	covariance vector of the raster point (length + 1)
+        int length		...	number of stations
         
-            // is the sum of weights > 0, ...
-            if (sum_weights > 0){
+        OUTPUT:
+        kriging variance
+    */
+
+    int idx;
+    double sum = 0;
     
-                // ... restandardize the weights:
-                for (idx=0; idx<length; idx++){
+    for (idx=0; idx<=length; idx++){
+        sum += weights_vector[idx] * cov_vector[idx];
+    }
     
-                    // but only the positive weights.
-                    // the rest remains at 0
-                    if (weights_vector[idx] > 0){
+    return (sum > 0) ? sum : 0;
+}
 
-                        weights_vector[idx] = weights_vector[idx] / sum_weights;
-                    }
-                    else{
-                        weights_vector[idx] = 0;
-                    }
-                }
-            }
-        }
-        return EXIT_SUCCESS;
-    }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The averages of the negative weights or covariances are \"NAN\" or \"INF\"!\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;               
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
-        }
-    }    
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double calc_covariance(double distance, double sill, double nugget, double range, int model){
+
+    /*
+        DESCRIPTION:
+        Calculates the covariance of any point by unsing the determined variogram model,
+        the distance, sill, nugget and range (see variogram_model).
+        
+        INPUT:
+        double distance	...	distance between two points
+        double sill	...	sill of the variogram model
+        double nugget	...	nugget of the variogram model
+        double range	...	range of the variogram model
+        int model	...	type of the variogram model (VARIO_MODEL_...)
+        
+        OUTPUT:
+        covariance ("NAN" for an unknown model)
+    */
+    
+    return variogram_model(model, distance, sill, nugget, range);
 }
 
 
@@ -1794,52 +3664,48 @@ int correct_negative_weights(double *weights_vector, double *cov_vector, int len
 // ##################################################################################################
 
 
-double calc_distance(double latA, double lonA, double latB, double lonB){
+double get_fvector_max(double *values, int length){
 
     /*
+    
         DESCRIPTION:
-        Calculates the distance between 2 point on a sphere with the radius of the earth at 51°N.
+        Determines the maximum value of a vector of type double and length "length".
         
         INPUT:
-        double latA	...	latitude of point A in decimal degree.
-        double lonA	...	longitude of point A in decimal degree.
-        double latB	...	latitude of point B in decimal degree.
-        double lonB	...	longitude of point B in decimal degree.
+        double *values	...	pointer to the vector of doubles.
+        int length	...	length of the vector.
         
         OUTPUT:
-        on success	...	distance between the two points in km
+        on success	...	maximum value of that vector
         on failure	...	NAN
-    */ 
+        
+    */
+
     
-    jmp_buf env;
+    int idx;
     int excno;
+    jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
         
-        if ((isnan(latA)) || (isnan(lonA)) || (isnan(latB)) || (isnan(lonB)) ||
-            (isinf(latA)) || (isinf(lonA)) || (isinf(latB)) || (isinf(lonB))){
+        double maxValue = values[0];
+    
+    
+        for (idx=0; idx<length; idx++){
+    
+            if (values[idx] > maxValue){
         
-            longjmp(env, 1);
+                maxValue = values[idx];
+            }
         }
-        
-        
-        // point A: 
-        double latA_rad = (latA/180.0) * M_PI;
-        double lonA_rad = (lonA/180.0) * M_PI;
-
-        // point B:
-        double latB_rad = (latB/180.0) * M_PI;
-        double lonB_rad = (lonB/180.0) * M_PI;
-
-        return RADIUS_EARTH * acos( (sin(latA_rad) * sin(latB_rad) ) + ( cos(latA_rad) * cos(latB_rad) * ( cos(lonB_rad - lonA_rad) ) ) );
+        return maxValue;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> One of the coordinates is equal to \"NAN\" or \"INF\"\n", __FILE__, __LINE__); return NAN;                       
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return NAN;               
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); return NAN;
             default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
-        }  
-    }   
+        }
+    }
 }
 
 
@@ -1847,44 +3713,49 @@ double calc_distance(double latA, double lonA, double latB, double lonB){
 // ##################################################################################################
 
 
-double calc_covariance(double distance, double sill, double nugget, double range){
+int get_dvector_max(int *values, int length){
 
     /*
+    
         DESCRIPTION:
-        Calculates the covariance of any point by unsing the determined variogram model,
-        the distance, sill, nugget and range.
+        Determines the maximum value of a vector of type int and length "length".
         
         INPUT:
-        double distance	...	distance between two points
-        double sill	...	sill of the variogram model
-        double nugget	...	nugget of the variogram model
-        double range	...	range of the variogram model
+        int *values	...	pointer to the vector of integers.
+        int length	...	length of the vector.
         
         OUTPUT:
-        on success	...	covariance 
-        on failure	...	NAN
+        on success	...	maximum value of that vector
+        on failure	...	exit(errno)
+        
     */
     
-    jmp_buf env;
+    int idx;
     int excno;
+    jmp_buf env;
     
-    if ((excno = setjmp(env)) == 0){   
+    if ((excno = setjmp(env)) == 0){     
     
-        double z, n;
+        if (length <= 0){
+            longjmp(env, 1);
+        }
     
-        // exponetial model:
-        // nugget + sill *(1-exp(-|distance|/(range/3)))
+        int maxValue = values[0];
     
-        n = range / 3.0;		// 
-        z = -1 * fabs(distance);	// distance must be negative
+        for (idx=0; idx<length; idx++){
     
-        return nugget + sill * (1 - exp(z/n));
+            if (values[idx] > maxValue){
+        
+                maxValue = values[idx];
+            }
+        }
+        return maxValue;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return NAN;                
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
-        }
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); exit(errno);
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); exit(errno);
+        }  
     }
 }
 
@@ -1893,75 +3764,48 @@ double calc_covariance(double distance, double sill, double nugget, double range
 // ##################################################################################################
 
 
-
-int multiplyMatrixVector(double **matrix, double *vector_in, double *vector_out, int rows, int cols){
+double get_fvector_min(double *values, int length){
 
     /*
     
         DESCRIPTION:
-        Multiplies a matrix of type double with a vector of type double.
+        Determines the minimum value of a vector of type double and length "length".
         
         INPUT:
-        double **matrix		...	pointer to the matrix you want to multiply with a vector.
-        double *vector_in	...	pointer to the vector you want to multiply with a matrix.
-        double *weights_vector	...	pointer to the result vector.
-        int rows		...	number of rows of the matrix
-        int cols		...	number ot columns of the matrix.
+        double *values	...	pointer to the vector of doubles.
+        int length	...	length of the vector.
         
-        OUTPUT: (error code)
-        on success		...	EXIT_SUCCESS
-        on failure		...	EXIT_FAILURE
+        OUTPUT:
+        on success	...	minimum value of that vector
+        on failure	...	NAN
         
     */
 
-    int idx, jdx;
+    
+    int idx;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
-
-        double sum=0;
-
-        if (rows != cols){
-            longjmp(env, 1);
-        }
-   
-        // check for nan and inf in vector
-        for (idx=0; idx<rows; idx++){
-            if ((isnan(vector_in[idx])) || (isinf(vector_in[idx]))){
-                longjmp(env, 2);
-            }
-        }
         
-        // check for nan and inf in matrix
-        for (idx=0; idx<rows; idx++){
-            for (jdx=0; jdx<cols; jdx++){
-                if ((isnan(matrix[idx][jdx])) || (isinf(matrix[idx][jdx]))){
-                    longjmp(env, 3);
-                }
-            }
-        }
-   
-        // multipy:
-        for (idx=0; idx<rows; idx++){
-                    
-            vector_out[idx] = 0;
-                
-            for (jdx=0; jdx<cols; jdx++){
-                
-                vector_out[idx] += (matrix[idx][jdx] * vector_in[jdx]);
+        double minValue = values[0];
+    
+    
+        for (idx=0; idx<length; idx++){
+    
+            if (values[idx] < minValue){
+        
+                minValue = values[idx];
             }
         }
-        return EXIT_SUCCESS;       
+        return minValue;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The number of columns of the matrix must be equal to number of rows of the vector\n", __FILE__, __LINE__); return EXIT_FAILURE;
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Input vector contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__); return EXIT_FAILURE; 
-            case 3: fprintf(stderr, "\nERROR: %s --> %d:\n >>> Input matrix contains \"NAN\" or \"INF\" values!\n", __FILE__, __LINE__); return EXIT_FAILURE;                                
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); return NAN;
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
         }
-    }       
+    }
 }
 
 
@@ -1969,50 +3813,50 @@ int multiplyMatrixVector(double **matrix, double *vector_in, double *vector_out,
 // ##################################################################################################
 
 
-double calc_RSME(double *values1, double *values2, int length){
-
+int get_dvector_min(int *values, int length){
 
     /*
-        DESCRIPTION
-        Calculates the rsme error between two datasets of type double.
+    
+        DESCRIPTION:
+        Determines the minimum value of a vector of type int and length "length".
+        
+        INPUT:
+        int *values	...	pointer to the vector of integers.
+        int length	...	length of the vector.
+        
+        OUTPUT:
+        on success	...	minimum value of that vector
+        on failure	...	NAN
         
-        Input:
-        values1		...	Datenreihe 1
-        values2		...	Datenreihe 2
     */
-
+    
     int idx;
     int excno;
     jmp_buf env;
     
-    if ((excno = setjmp(env)) == 0){
-    
-        double qsum=0;		// sum of the powered differences.
+    if ((excno = setjmp(env)) == 0){     
     
         if (length <= 0){
             longjmp(env, 1);
         }
-        
-        for (idx=0; idx<=length; idx++){
     
-            if (((isnan(values1[idx])) || (isinf(values1[idx]))) ||
-               ((isnan(values2[idx])) || (isinf(values2[idx])))){
-               
-                   longjmp(env, 2);
+        int minValue = values[0];
+    
+        for (idx=0; idx<length; idx++){
+    
+            if (values[idx] < minValue){
+        
+                minValue = values[idx];
             }
-            else{
-                qsum += pow((values1[idx] - values2[idx]),2);
-            } 
         }
-        return sqrt(qsum/length);
+        return minValue;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); return NAN;
-            case 2: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The datasets contains NAN or INF values!\n", __FILE__, __LINE__); return NAN;        
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
+            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); exit(errno);
+            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); exit(errno);
         }
-    }
+    }     
 }
 
 
@@ -2020,46 +3864,201 @@ double calc_RSME(double *values1, double *values2, int length){
 // ##################################################################################################
 
 
-double get_fvector_max(double *values, int length){
+int outputRasterCSV(struct usr_raster *raster, char *output_dir, char *filename, char decimal_separator, char field_separator, int max_threads, bool show_output){
 
     /*
     
         DESCRIPTION:
-        Determines the maximum value of a vector of type double and length "length".
+        This function outputs 3 csv-files.
+        1.	csv-file with the values of the raster in dimensions of rows x cols.
+        2.	csv-file with the latitude values of the values in dimensions of Map.rows x Map.cols.
+        3.	csv-file with the longitude values of thevalues in dimensions of Map.rows x Map.cols.
+        
+        The rows of the raster are split into "num_threads" blocks. Every thread renders the lines of
+        its rows into its own buffers (see output_raster_csv_worker). Afterwards the buffers are written
+        in the order of the rows, each with one call of fwrite.
         
         INPUT:
-        double *values	...	pointer to the vector of doubles.
-        int length	...	length of the vector.
+        struct usr_raster *raster	...	pointer to the raster you want to output.
+        char *output_dir		...	directory you want to output the data
+        char *filename			...	filename of the csv-file (without extension)
+        char decimal_separator		...	decimal separator of the numbers (e.g. '.' or ',')
+        char field_separator		...	separator of the fields of a line (e.g. ';')
+        int max_threads			...	number of threads to render the lines
+        bool show_output		...	show output?
         
-        OUTPUT:
-        on success	...	maximum value of that vector
-        on failure	...	NAN
+        OUTPUT:(error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
         
     */
 
-    
-    int idx;
+
+
+    int idx, jdx;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
-        
-        double maxValue = values[0];
     
+        int rows = raster->rows;
+        int cols = raster->cols;
+        int num_threads = (max_threads < rows) ? max_threads : rows;
+        int rows_per_thread;
+        char path[100];
+        struct usr_csv_buffer lon_line = {.text = NULL, .length = 0, .capacity = 0};
+        struct usr_csv_thread *threads;
     
-        for (idx=0; idx<length; idx++){
+        FILE *fp_values, *fp_lat, *fp_lon;
     
-            if (values[idx] > maxValue){
+    
+        if ((rows<=0) || (cols<=0)){
+            longjmp(env, 1);        
+        }
+        
+        // the number separator and the field separator must differ:
+        if ((decimal_separator == field_separator) || (field_separator == '-') || ((field_separator >= '0') && (field_separator <= '9'))){
+            longjmp(env, 5);
+        }
+        
+        if (num_threads < 1){
+            num_threads = 1;
+        }
+        
+        // show output?
+        if (show_output){
+            printf("\nwriting csv files to:\n");
+            printf(">>> %s\n", output_dir);
+            
+            printf("writing ... ");
+            fflush(stdout);
+        }
+        
+        // the line of the longitudes is the same for all rows, so it is rendered only once:
+        for (jdx=0; jdx<cols; jdx++){
+        
+            if (csv_buffer_reserve(&lon_line, CSV_FIELD_MAX + 2) == EXIT_FAILURE){
+                free(lon_line.text);
+                longjmp(env, 3);
+            }
+            lon_line.length += format_fixed(&lon_line.text[lon_line.length], raster_lon(raster, jdx), CSV_COORD_DECIMALS, decimal_separator);
+            lon_line.text[lon_line.length++] = (jdx != (cols-1)) ? field_separator : '\n';
+        }
+        
+        threads = (struct usr_csv_thread *) calloc(num_threads, sizeof(struct usr_csv_thread));
+        if (threads == NULL){
+            free(lon_line.text);
+            longjmp(env, 3);
+        }
+        
+        // split the rows into blocks of about the same size:
+        rows_per_thread = (rows + num_threads - 1) / num_threads;
+        for (idx=0; idx<num_threads; idx++){
+        
+            threads[idx].raster = raster;
+            threads[idx].first_row = (idx * rows_per_thread < rows) ? idx * rows_per_thread : rows;
+            threads[idx].last_row = ((idx+1) * rows_per_thread < rows) ? (idx+1) * rows_per_thread : rows;
+            threads[idx].decimal_separator = decimal_separator;
+            threads[idx].field_separator = field_separator;
+            threads[idx].lon_line = &lon_line;
+            threads[idx].err = EXIT_SUCCESS;
+        }
+        
+        // start the additional threads, the first one runs within the calling thread:
+        for (idx=1; idx<num_threads; idx++){
+        
+            if (pthread_create(&(threads[idx].thread), NULL, output_raster_csv_worker, &threads[idx]) != 0){
+            
+                while (--idx > 0){
+                    pthread_join(threads[idx].thread, NULL);
+                }
+                free_csv_threads(threads, num_threads);
+                free(lon_line.text);
+                longjmp(env, 4);
+            }
+        }
+        
+        output_raster_csv_worker(&threads[0]);
+        
+        for (idx=1; idx<num_threads; idx++){
+            pthread_join(threads[idx].thread, NULL);
+        }
+        free(lon_line.text);
+        
+        for (idx=0; idx<num_threads; idx++){
+            if (threads[idx].err == EXIT_FAILURE){
+                free_csv_threads(threads, num_threads);
+                longjmp(env, 3);
+            }
+        }
+    
+        // file pointer to the values csv file:
+        fp_values = fopen(strcat(strcat(strcpy(path, output_dir), filename), RASTER_CSV_EXT),"w");
+        if (fp_values == NULL){
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+        
+        // file pointer to the latitude csv file:
+        fp_lat = fopen(strcat(strcpy(path, output_dir), "lat.csv"),"w");
+        if (fp_lat == NULL){
+            fclose(fp_values);
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+    
+        // file pointer to the csv file for the longitude values:  
+        fp_lon = fopen(strcat(strcpy(path, output_dir), "lon.csv"),"w");
+        if (fp_lon == NULL){
+            fclose(fp_values);
+            fclose(fp_lat);
+            free_csv_threads(threads, num_threads);
+            longjmp(env, 2);
+        }
+        
+        // write the buffers in the order of the rows:
+        excno = 0;
+        for (idx=0; idx<num_threads; idx++){
+        
+            if ((fwrite(threads[idx].values.text, 1, threads[idx].values.length, fp_values) != threads[idx].values.length) ||
+                (fwrite(threads[idx].lat.text, 1, threads[idx].lat.length, fp_lat) != threads[idx].lat.length) ||
+                (fwrite(threads[idx].lon.text, 1, threads[idx].lon.length, fp_lon) != threads[idx].lon.length)){
+                excno = 6;
+                break;
+            }
+        }
+        
+        free_csv_threads(threads, num_threads);
+        
+        // close all files:
+        if ((fclose(fp_values) != 0) || (excno != 0)){
+            excno = 6;
+        }
+        if (fclose(fp_lat) != 0){
+            excno = 6;
+        }
+        if (fclose(fp_lon) != 0){
+            excno = 6;
+        }
+        if (excno != 0){
+            longjmp(env, excno);
+        }
         
-                maxValue = values[idx];
-            }
+        if (show_output){
+            printf("ok\n");
         }
-        return maxValue;
+        
+        return EXIT_SUCCESS;
     }
     else{
         switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); return NAN;
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The filepointer returns an error!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n Failure when starting the csv threads!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n The decimal separator and the field separator of the csv files must differ (and must not be a digit or \"-\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n The csv files could not be written completely!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
 }
@@ -2069,50 +4068,63 @@ double get_fvector_max(double *values, int length){
 // ##################################################################################################
 
 
-int get_dvector_max(int *values, int length){
+void *output_raster_csv_worker(void *arg){
 
     /*
-    
         DESCRIPTION:
-        Determines the maximum value of a vector of type int and length "length".
+        Renders the lines of the rows first_row ... last_row-1 of the three csv files
+        (values, latitudes, longitudes) into the buffers of the thread.
+        The buffers grow as needed. On failure thread->err is set to EXIT_FAILURE.
         
         INPUT:
-        int *values	...	pointer to the vector of integers.
-        int length	...	length of the vector.
+        void *arg		...	pointer to an object of type "struct usr_csv_thread"
         
         OUTPUT:
-        on success	...	maximum value of that vector
-        on failure	...	exit(errno)
-        
+        NULL
     */
+
+    struct usr_csv_thread *thread = (struct usr_csv_thread *)arg;
+    struct usr_raster *raster = thread->raster;
+    int cols = raster->cols;
+    int row, col;
+    int lat_length;
+    char lat_text[CSV_FIELD_MAX];
+    const double *values;
     
-    int idx;
-    int excno;
-    jmp_buf env;
     
-    if ((excno = setjmp(env)) == 0){     
+    for (row=thread->first_row; row<thread->last_row; row++){
     
-        if (length <= 0){
-            longjmp(env, 1);
+        // make sure, that the whole line fits into the buffers:
+        if ((csv_buffer_reserve(&(thread->values), (size_t)cols * (CSV_FIELD_MAX + 1) + 1) == EXIT_FAILURE) ||
+            (csv_buffer_reserve(&(thread->lat), (size_t)cols * (CSV_FIELD_MAX + 1) + 1) == EXIT_FAILURE) ||
+            (csv_buffer_reserve(&(thread->lon), thread->lon_line->length) == EXIT_FAILURE)){
+            thread->err = EXIT_FAILURE;
+            return NULL;
         }
-    
-        int maxValue = values[0];
-    
-        for (idx=0; idx<length; idx++){
-    
-            if (values[idx] > maxValue){
         
-                maxValue = values[idx];
-            }
+        // the values:
+        values = &raster->value[(size_t)row * cols];
+        for (col=0; col<cols; col++){
+            thread->values.length += format_fixed(&thread->values.text[thread->values.length], values[col], CSV_VALUE_DECIMALS, thread->decimal_separator);
+            thread->values.text[thread->values.length++] = thread->field_separator;
         }
-        return maxValue;
-    }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); exit(errno);
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); exit(errno);
-        }  
+        thread->values.text[thread->values.length-1] = '\n';
+        
+        // the latitude is the same for the whole row:
+        lat_length = format_fixed(lat_text, raster_lat(raster, row), CSV_COORD_DECIMALS, thread->decimal_separator);
+        lat_text[lat_length++] = thread->field_separator;
+        for (col=0; col<cols; col++){
+            memcpy(&thread->lat.text[thread->lat.length], lat_text, lat_length);
+            thread->lat.length += lat_length;
+        }
+        thread->lat.text[thread->lat.length-1] = '\n';
+        
+        // the longitudes are the same for all rows:
+        memcpy(&thread->lon.text[thread->lon.length], thread->lon_line->text, thread->lon_line->length);
+        thread->lon.length += thread->lon_line->length;
     }
+    
+    return NULL;
 }
 
 
@@ -2120,48 +4132,79 @@ int get_dvector_max(int *values, int length){
 // ##################################################################################################
 
 
-double get_fvector_min(double *values, int length){
+int format_fixed(char *text, double value, int decimals, char decimal_separator){
 
     /*
-    
         DESCRIPTION:
-        Determines the minimum value of a vector of type double and length "length".
+        Writes a number with a fixed number of decimals into the text, like printf("%.*f") would do,
+        but with the given decimal separator. The text is not terminated by '\0'.
+        The digits are created out of the rounded integer value*10^decimals. Values which are
+        (nearly) exactly between two possible results, are large or "NAN"/"INF" are formatted by
+        snprintf, so the result is the same as the one of printf (numbers, that do not fit into
+        CSV_FIELD_MAX characters, are written in exponential notation).
         
         INPUT:
-        double *values	...	pointer to the vector of doubles.
-        int length	...	length of the vector.
+        char *text			...	text of at least CSV_FIELD_MAX characters
+        double value			...	number to format
+        int decimals			...	number of decimals (0 ... CSV_MAX_DECIMALS)
+        char decimal_separator		...	decimal separator
         
         OUTPUT:
-        on success	...	minimum value of that vector
-        on failure	...	NAN
-        
+        number of characters written into the text
     */
 
-    
+    static const double pow10[CSV_MAX_DECIMALS+1] = {1.0E0, 1.0E1, 1.0E2, 1.0E3, 1.0E4, 1.0E5, 1.0E6, 1.0E7, 1.0E8, 1.0E9};
+    char digits[24];
+    double scaled, fraction;
+    unsigned long long number;
+    int length = 0;
+    int num_digits = 0;
     int idx;
-    int excno;
-    jmp_buf env;
-    
-    if ((excno = setjmp(env)) == 0){
-        
-        double minValue = values[0];
     
     
-        for (idx=0; idx<length; idx++){
+    if ((decimals >= 0) && (decimals <= CSV_MAX_DECIMALS)){
     
-            if (values[idx] < minValue){
+        scaled = fabs(value) * pow10[decimals];
+        fraction = scaled - floor(scaled);
         
-                minValue = values[idx];
+        // not too large (precision of the fraction) and not (nearly) in the middle between two results:
+        if ((scaled < 1.0E9) && (fabs(fraction - 0.5) > 1.0E-6)){
+        
+            number = (unsigned long long)(scaled + 0.5);
+            
+            if (signbit(value)){
+                text[length++] = '-';
+            }
+            
+            // digits in reverse order (at least one digit before the decimal separator):
+            do{
+                digits[num_digits++] = (char)('0' + (number % 10));
+                number /= 10;
+            }while ((number > 0) || (num_digits <= decimals));
+            
+            for (idx=num_digits-1; idx>=0; idx--){
+                text[length++] = digits[idx];
+                if ((idx == decimals) && (decimals > 0)){
+                    text[length++] = decimal_separator;
+                }
             }
+            
+            return length;
         }
-        return minValue;
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); return NAN;
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return NAN;
+    
+    // rare cases:
+    length = snprintf(text, CSV_FIELD_MAX, "%.*f", decimals, value);
+    if ((length < 0) || (length >= CSV_FIELD_MAX)){
+        length = snprintf(text, CSV_FIELD_MAX, "%.*e", decimals, value);
+    }
+    for (idx=0; idx<length; idx++){
+        if (text[idx] == '.'){
+            text[idx] = decimal_separator;
         }
     }
+    
+    return length;
 }
 
 
@@ -2169,50 +4212,60 @@ double get_fvector_min(double *values, int length){
 // ##################################################################################################
 
 
-int get_dvector_min(int *values, int length){
+int csv_buffer_reserve(struct usr_csv_buffer *buffer, size_t size){
 
     /*
-    
         DESCRIPTION:
-        Determines the minimum value of a vector of type int and length "length".
+        Makes sure, that at least "size" further characters fit into the buffer.
+        The capacity of the buffer is at least doubled, if it has to grow.
         
         INPUT:
-        int *values	...	pointer to the vector of integers.
-        int length	...	length of the vector.
-        
-        OUTPUT:
-        on success	...	minimum value of that vector
-        on failure	...	NAN
+        struct usr_csv_buffer *buffer	...	pointer to the buffer
+        size_t size			...	number of characters, which will be added
         
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
     */
+
+    size_t capacity;
+    char *text;
     
-    int idx;
-    int excno;
-    jmp_buf env;
+    if (buffer->length + size <= buffer->capacity){
+        return EXIT_SUCCESS;
+    }
     
-    if ((excno = setjmp(env)) == 0){     
+    capacity = (buffer->capacity > 0) ? 2 * buffer->capacity : 4096;
+    while (capacity < buffer->length + size){
+        capacity *= 2;
+    }
     
-        if (length <= 0){
-            longjmp(env, 1);
-        }
+    text = (char *) realloc(buffer->text, capacity);
+    if (text == NULL){
+        return EXIT_FAILURE;
+    }
     
-        int minValue = values[0];
+    buffer->text = text;
+    buffer->capacity = capacity;
     
-        for (idx=0; idx<length; idx++){
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void free_csv_threads(struct usr_csv_thread *threads, int num_threads){
+
+    int idx;
     
-            if (values[idx] < minValue){
-        
-                minValue = values[idx];
-            }
-        }
-        return minValue;
+    for (idx=0; idx<num_threads; idx++){
+        free(threads[idx].values.text);
+        free(threads[idx].lat.text);
+        free(threads[idx].lon.text);
     }
-    else{
-        switch(excno){
-            case 1: fprintf(stderr, "\nERROR: %s --> %d:\n >>> The length must be greater then 0!\n", __FILE__, __LINE__); exit(errno);
-            default: fprintf(stderr, "\nERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); exit(errno);
-        }
-    }     
+    free(threads);
 }
 
 
@@ -2220,144 +4273,125 @@ int get_dvector_min(int *values, int length){
 // ##################################################################################################
 
 
-int outputRasterCSV(struct usr_data_point **raster, char *output_dir, char *filename, int rows, int cols, bool show_output){
+int outputRasterBinary(struct usr_raster *raster, char *output_dir, char *filename, bool show_output){
 
     /*
     
         DESCRIPTION:
-        This function outputs 3 csv-files.
-        1.	csv-file with the values of the raster in dimensions of rows x cols.
-        2.	csv-file with the latitude values of the values in dimensions of Map.rows x Map.cols.
-        3.	csv-file with the longitude values of thevalues in dimensions of Map.rows x Map.cols.
+        This function outputs the raster into one binary file (extension RASTER_BIN_EXT).
+        The file starts with a header of RASTER_HEADER_SIZE bytes which describes the geometry
+        of the raster once, followed by the values of the raster (float32, row by row).
+        The latitude and longitude of every raster point can be calculated out of the header:
+        lat = maxLat - row * latRes, lon = minLon + col * lonRes
+        
+        Header (little endian, as written by x86/arm):
+        offset  0	char[4]		magic number RASTER_MAGIC
+        offset  4	uint32		version of the format (RASTER_VERSION)
+        offset  8	uint32		size of the header in bytes
+        offset 12	uint32		number of rows
+        offset 16	uint32		number of columns
+        offset 20	uint32		datatype of the values (1 => float32)
+        offset 24	float64		maxLat (latitude of the first row)
+        offset 32	float64		minLon (longitude of the first column)
+        offset 40	float64		latRes (resolution between two rows)
+        offset 48	float64		lonRes (resolution between two columns)
+        offset 56	float32		value of the raster points without a value (NO_VALUE)
+        offset 60	uint32		reserved (0)
         
         INPUT:
-        struct usr_data_point **raster	...	pointer to the matrix you want to output of type struct usr_data_point.
+        struct usr_raster *raster	...	pointer to the raster you want to output.
         char *output_dir		...	directory you want to output the data
-        char *filename			...	filename of the csv-file
-        int rows			...	number of rows of the raster
-        int cols			...	number of columns of the raster
+        char *filename			...	filename of the binary file (without extension)
+        bool show_output		...	show output?
+        
+        OUTPUT:(error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
         
     */
 
 
 
-    int idx, jdx, kdx;
+    int idx, jdx;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
     
-        char valueText[20], latText[20], lonText[20];
+        int rows = raster->rows;
+        int cols = raster->cols;
+        unsigned char header[RASTER_HEADER_SIZE];
+        uint32_t header_int[5] = {RASTER_VERSION, RASTER_HEADER_SIZE, raster->rows, raster->cols, 1};
+        uint32_t reserved = 0;
+        float no_value = (float)NO_VALUE;
+        float *row_values;
         char path[100];
     
-        FILE *fp_values, *fp_lat, *fp_lon;
+        FILE *fp_values;
     
     
         if ((rows<=0) || (cols<=0)){
             longjmp(env, 1);        
         }
     
-        // file pointer to the values csv file:
-        fp_values = fopen(strcat(strcpy(path, output_dir), filename),"w");
-        if (fp_values == NULL){
-            longjmp(env, 2);
-        }
-        
-        // file pointer to the latitude csv file:
-        fp_lat = fopen(strcat(strcpy(path, output_dir), "lat.csv"),"w");
-        if (fp_lat == NULL){
+        // buffer for one row of the raster:
+        row_values = (float *) malloc(cols * sizeof(float));
+        if (row_values == NULL){
             longjmp(env, 3);
         }
     
-        // file pointer to the csv file for the longitude values:  
-        fp_lon = fopen(strcat(strcpy(path, output_dir), "lon.csv"),"w");
-        if (fp_lon == NULL){
+        // file pointer to the binary file:
+        fp_values = fopen(strcat(strcat(strcpy(path, output_dir), filename), RASTER_BIN_EXT),"wb");
+        if (fp_values == NULL){
+            free(row_values);
             longjmp(env, 2);
         }
 
         // show output?
         if (show_output){
-            printf("\nwriting csv files to:\n");
-            printf(">>> %s\n", output_dir);
+            printf("\nwriting binary file to:\n");
+            printf(">>> %s\n", path);
             
             printf("writing ... ");
             fflush(stdout);
         }
-    
         
+        // the header:
+        memset(header, 0, RASTER_HEADER_SIZE);
+        memcpy(&header[0], RASTER_MAGIC, 4);
+        memcpy(&header[4], header_int, 5 * sizeof(uint32_t));
+        memcpy(&header[24], &(raster->maxLat), sizeof(double));
+        memcpy(&header[32], &(raster->minLon), sizeof(double));
+        memcpy(&header[40], &(raster->latRes), sizeof(double));
+        memcpy(&header[48], &(raster->lonRes), sizeof(double));
+        memcpy(&header[56], &no_value, sizeof(float));
+        memcpy(&header[60], &reserved, sizeof(uint32_t));
+        
+        if (fwrite(header, 1, RASTER_HEADER_SIZE, fp_values) != RASTER_HEADER_SIZE){
+            free(row_values);
+            fclose(fp_values);
+            longjmp(env, 4);
+        }
+        
+        // the values, row by row:
         for (idx=0; idx<rows; idx++){
+        
             for (jdx=0; jdx<cols; jdx++){
+                row_values[jdx] = (float)raster->value[(size_t)idx*cols + jdx];
+            }
             
-                // pass the value to a field of type char:
-                sprintf(valueText,"%.3f", raster[idx][jdx].value);
-                
-                // pass the latitude to a field of type char:
-                sprintf(latText, "%.4f", raster[idx][jdx].lat);
-                
-                // pass the longitude to a field of type char:
-                sprintf(lonText, "%.4f", raster[idx][jdx].lon);
-                
-                
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(valueText); kdx++){
-                
-                    if (valueText[kdx] == ','){
-                    
-                        valueText[kdx] = '.';
-                        break;
-                    }
-                
-                }
-                // write that value into the file
-                fprintf(fp_values,"%s",valueText);
-
-
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(latText); kdx++){
-                
-                    if (latText[kdx] == ','){
-                    
-                        latText[kdx] = '.';
-                        break;
-                    }
-                }
-                // write that latitude into the file               
-                fprintf(fp_lat,"%s",latText);
-
-                // check for points and change them to comma
-                for (kdx=0; kdx<(int)strlen(lonText); kdx++){
-                
-                    if (lonText[kdx] == ','){
-                    
-                        lonText[kdx] = '.';
-                        break;
-                    }
-                }
-                // write that longitude into the file                
-                fprintf(fp_lon,"%s",lonText);
-                
-                // add a semicolon to the line until ... 
-                if (jdx != (cols-1)){
-                
-                    fprintf(fp_values,"%s",";");
-                    fprintf(fp_lat,"%s",";");    
-                    fprintf(fp_lon,"%s",";");
-                    
-                }
-                else{
-                    // ... we finish that line, than add a newline sign:
-                    fprintf(fp_values, "%s", "\n");
-                    fprintf(fp_lat, "%s", "\n");    
-                    fprintf(fp_lon, "%s", "\n");                
-                
-                }
+            if (fwrite(row_values, sizeof(float), cols, fp_values) != (size_t)cols){
+                free(row_values);
+                fclose(fp_values);
+                longjmp(env, 4);
             }
         }
         
-        // close all files:
-        fclose(fp_values);
-        fclose(fp_lat);
-        fclose(fp_lon);
+        free(row_values);
+        
+        if (fclose(fp_values) != 0){
+            longjmp(env, 4);
+        }
         
         if (show_output){
             printf("ok\n");
@@ -2370,6 +4404,7 @@ int outputRasterCSV(struct usr_data_point **raster, char *output_dir, char *file
             case 1: fprintf(stderr, "ERROR: %s --> %d:\n The number of rows and columns must be greater then 0!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
             case 2: fprintf(stderr, "ERROR: %s --> %d:\n The filepointer returns an error!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
             case 3: fprintf(stderr, "ERROR: %s --> %d:\n %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The raster could not be written completely!\n>>> %s\n\n", __FILE__, __LINE__,strerror(errno)); return EXIT_FAILURE;
             default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
         }
     }
@@ -2385,7 +4420,8 @@ int get_output_information(struct usr_map *Map){
     /*
     
         DESCRIPTION:
-        Calculates/determines additional information to the output raster.
+        Calculates/determines additional information to the output raster. The raster points
+        without a value (NO_VALUE) are left out.
         
         INPUT:
         struct usr_map *Map	...	pointer to the map object
@@ -2396,41 +4432,46 @@ int get_output_information(struct usr_map *Map){
         
     */
     
-    int idx, jdx;
+    size_t idx;
     int excno;
     jmp_buf env;
     
     if ((excno = setjmp(env)) == 0){
     
         double sum=0;
-    
-        // determine the maximum and minimum value of the raster:
-        Map->output_data.maximum = Map->raster[0][0].value;
-        Map->output_data.minimum = Map->raster[0][0].value; 
-        Map->output_data.average = Map->raster[0][0].value; 
+        double value;
+        size_t num_cells = (size_t)Map->rows * Map->cols;
+        size_t num_values = 0;
+    
+        // determine the maximum and minimum value of the raster (without the raster points of NO_VALUE):
+        Map->output_data.maximum = NO_VALUE;
+        Map->output_data.minimum = NO_VALUE; 
+        Map->output_data.average = NO_VALUE; 
        
-        for (idx=0; idx<Map->rows; idx++){
-    
-            for (jdx=0; jdx<Map->cols; jdx++){
+        for (idx=0; idx<num_cells; idx++){
         
-                if (Map->raster[idx][jdx].value > Map->output_data.maximum){
-            
-                    Map->output_data.maximum = Map->raster[idx][jdx].value;
-                }
+            value = Map->raster.value[idx];
             
-                if (Map->raster[idx][jdx].value < Map->output_data.minimum){
+            if (value == NO_VALUE){
+                continue;
+            }
+        
+            if ((num_values == 0) || (value > Map->output_data.maximum)){
+                Map->output_data.maximum = value;
+            }
             
-                    Map->output_data.minimum = Map->raster[idx][jdx].value;
-                
-                }
+            if ((num_values == 0) || (value < Map->output_data.minimum)){
+                Map->output_data.minimum = value;
+            }
             
-                sum += Map->raster[idx][jdx].value;
-                  
-           }
-    
+            sum += value;
+            num_values++;
         }
     
-        Map->output_data.average = sum / (double)(Map->rows * Map->cols);
+        // all raster points without a value => NO_VALUE:
+        if (num_values > 0){
+            Map->output_data.average = sum / (double)(num_values);
+        }
         
         return EXIT_SUCCESS;
     }
@@ -2447,7 +4488,7 @@ int get_output_information(struct usr_map *Map){
 // ##################################################################################################
 
 
-int check_matrix(double **matrix, int rows, int cols, bool show_output){
+int check_matrix(struct usr_matrix *matrix, bool show_output){
 
     /*
         DESCRIPTION:
@@ -2456,9 +4497,7 @@ int check_matrix(double **matrix, int rows, int cols, bool show_output){
         only show results if nan- or inf values are included.
     
         INPUT:
-        double **matrix		...	pointer to the matrix
-        int rows		...	number of rows of that matrix
-        int cols		...	number of cols of that matrix
+        struct usr_matrix *matrix	...	pointer to the matrix (full or packed)
         bool show_output	...	show results after the checks?
     
         OUTPUT:(error code)
@@ -2480,58 +4519,61 @@ int check_matrix(double **matrix, int rows, int cols, bool show_output){
         unsigned int cnt_pos = 0;
     
         double max, min;
+        double value;
     
         if (show_output){
             printf("Check matrix:\n");
             printf("-----------------------\n");
         }
         
-        max=matrix[0][0];
-        min=matrix[0][0];        
+        max=matrix_get(matrix, 0, 0);
+        min=matrix_get(matrix, 0, 0);        
         
-        for (idx=0; idx<rows; idx++){
-            for (jdx=0; jdx<cols; jdx++){
+        for (idx=0; idx<matrix->rows; idx++){
+            for (jdx=0; jdx<matrix->cols; jdx++){
         
-                if (isnan(matrix[idx][jdx])){
+                value = matrix_get(matrix, idx, jdx);
+        
+                if (isnan(value)){
             
                     cnt_nan++;
                     continue;
                 }
-                else if (isinf(matrix[idx][jdx])){
+                else if (isinf(value)){
                 
                     cnt_inf++;
                     continue;
                 }
-                else if (matrix[idx][jdx] < 0){
+                else if (value < 0){
                     
                     // count the neg. value
                     cnt_neg++;
                     
                     // check if the current value is higher then the current maximum
-                    if (matrix[idx][jdx] > max){
-                        max=matrix[idx][jdx];
+                    if (value > max){
+                        max=value;
                     }
                     
                     // check if the current value is lower then the current minimum                  
-                    if (matrix[idx][jdx] < min){
-                        min=matrix[idx][jdx];
+                    if (value < min){
+                        min=value;
                     }
                     
                     continue;
                 }
-                else if (matrix[idx][jdx] >= 0){
+                else if (value >= 0){
                 
                     // count the pos. value
                     cnt_pos++;
                     
                     // check if the current value is higher then the current maximum
-                    if (matrix[idx][jdx] > max){
-                        max=matrix[idx][jdx];
+                    if (value > max){
+                        max=value;
                     }
                     
                     // check if the current value is lower then the current minimum                  
-                    if (matrix[idx][jdx] < min){
-                        min=matrix[idx][jdx];
+                    if (value < min){
+                        min=value;
                     }                    
                     continue;
                 }
@@ -2627,9 +4669,11 @@ int show_variogram_data(struct usr_map *Map){
             printf("--------------------------------------\n");
             printf("Model - fit-index: %d\n\n", Map->variogram.model_adjust_index);
             printf("Solution of the semivariance-model:\n");    
+            printf("model: %s\n", variogram_model_name(Map->variogram.model));
             printf("nugget: %.3f\n", Map->variogram.nugget);
             printf("sill: %.3f\n", Map->variogram.sill);
             printf("range: %.3f\n", Map->variogram.range);
+            printf("WRSS: %.3f\n", Map->variogram.wrss);
             printf("--------------------------------------\n\n");
             printf("########################################################################################\n");
             printf("########################################################################################\n\n");
@@ -2715,7 +4759,7 @@ int show_map_info(struct usr_map *Map){
 // ##################################################################################################
 
 
-int show_matrix(char *name, double **matrix, int rows, int cols, bool show_output){
+int show_matrix(char *name, struct usr_matrix *matrix, int rows, int cols, bool show_output){
 
     /*
     
@@ -2724,9 +4768,10 @@ int show_matrix(char *name, double **matrix, int rows, int cols, bool show_outpu
         
         
         INPUT:
-        double **matrix		...	pointer to the matrix to show
-        int rows		...	rows to show
-        int cols		...	columns to show
+        char *name			...	name of the matrix
+        struct usr_matrix *matrix	...	pointer to the matrix to show (full or packed)
+        int rows			...	rows to show (at most the rows of the matrix)
+        int cols			...	columns to show (at most the columns of the matrix)
         
         OUTPUT: (error code)
         on success		...	EXIT_SUCCESS
@@ -2744,6 +4789,9 @@ int show_matrix(char *name, double **matrix, int rows, int cols, bool show_outpu
     
     if ((excno = setjmp(env)) == 0){
     
+        int show_rows = (rows < matrix->rows) ? rows : matrix->rows;
+        int show_cols = (cols < matrix->cols) ? cols : matrix->cols;
+    
         if ((rows <= 0) || (cols <= 0)){
             longjmp(env, 1);
         }
@@ -2751,11 +4799,11 @@ int show_matrix(char *name, double **matrix, int rows, int cols, bool show_outpu
         if (show_output){
             printf("%s\n", name);
     
-            for (idx=0; idx<rows; idx++){
+            for (idx=0; idx<show_rows; idx++){
     
-                for (jdx=0; jdx<cols; jdx++){
+                for (jdx=0; jdx<show_cols; jdx++){
         
-                    printf("%8.3f", matrix[idx][jdx]);   
+                    printf("%8.3f", matrix_get(matrix, idx, jdx));   
         
                 }
         
@@ -2832,61 +4880,56 @@ int show_input_data(struct usr_map *Map){
 
 void free_raster(struct usr_map *Map){
 
-    int idx;
-    
     printf("\n");
     
-    // check if the raster exists
-    if (Map->raster != NULL){
-        for (idx=0; idx<(Map->rows); idx++){
-    
-            free(Map->raster[idx]);
-        }
+    // check if the decomposition of the covariance matrix exists:
+    if (Map->covariance_factor.lu != NULL){
+        free_factorization(&(Map->covariance_factor));
+        
         if (Map->show_output){
-            free(Map->raster);
-            printf("%-40s %s\n","raster:","deallocate memory successful!");
+            printf("%-40s %s\n","decomposed covariance matrix:","deallocate memory successful!");
         }
     }
     
     //--------------------------------------------------------------------------------
-       
-    // check if distance matrix exists:
-    if (Map->distance_matrix != NULL){
-        for (idx=0; idx<Map->input_data.length; idx++){
-    
-            free(Map->distance_matrix[idx]);
-        }
-        if (Map->show_output){        
-            free(Map->distance_matrix);
-            printf("%-40s %s\n","distance matrix:","deallocate memory successful!");
-        }
-    }   
-     
-    //--------------------------------------------------------------------------------
-          
-    // check if covariance matrix exists:
-    if (Map->covariance_matrix != NULL){
-        for (idx=0; idx<Map->input_data.length+1; idx++){
     
-            free(Map->covariance_matrix[idx]);
-        }
-        if (Map->show_output){                
-            free(Map->covariance_matrix);
-            printf("%-40s %s\n","covariance matrix:","deallocate memory successful!");
+    // the mapped model cache (the distance matrix lies within it, see read_model_cache):
+    if (Map->model_cache.map != NULL){
+        munmap(Map->model_cache.map, Map->model_cache.map_size);
+        Map->model_cache.map = NULL;
+        Map->distance_matrix.value = NULL;
+        
+        if (Map->show_output){
+            printf("%-40s %s\n","model cache:","unmap memory successful!");
         }
     }
-     
+    
     //--------------------------------------------------------------------------------
-           
-    // check if inverted covariance matrix exists:
-    if (Map->covariance_matrix_inv != NULL){    
-        for (idx=0; idx<Map->input_data.length+1; idx++){
     
-            free(Map->covariance_matrix_inv[idx]);
-        }
-        if (Map->show_output){                        
-            free(Map->covariance_matrix_inv);
-            printf("%-40s %s\n","inverted covariance matrix:","deallocate memory successful!");   
+    // the rasters, matrices, tables, the variogram and the coefficients (batch as well) are released at once with the arena:
+    if (Map->arena.blocks != NULL){
+    
+        if (Map->show_output){
+            show_arena_info(&(Map->arena));
+        }
+        free_arena(&(Map->arena));
+        
+        Map->raster.value = NULL;
+        Map->raster.stations = NULL;
+        Map->variance.value = NULL;
+        Map->distance_matrix.value = NULL;
+        Map->covariance_matrix.value = NULL;
+        Map->variogram.classes = NULL;
+        Map->variogram.reg_function.solution = NULL;
+        Map->dual_coefficients = NULL;
+        Map->batch.models = NULL;
+        Map->batch.pass_fields = NULL;
+        Map->batch.rasters = NULL;
+        Map->batch.values = NULL;
+        Map->batch.coefficients = NULL;
+        
+        if (Map->show_output){
+            printf("%-40s %s\n","memory arena:","deallocate memory successful!");
         }
     }
 }
@@ -2900,39 +4943,64 @@ void free_vector(struct usr_map *Map){
 
     printf("\n");
     
-    // check if input dataset exists
+    // check if input dataset exists (it grows while reading, so it is not part of the arena)
     if (Map->input_data.data != NULL){
         free(Map->input_data.data);
+        Map->input_data.data = NULL;
         
         if (Map->show_output){
             printf("%-40s %s\n","input dataset:","deallocate memory successful!");
         }
     }
-
-    
-    //--------------------------------------------------------------------------------
     
-    // check if the variogram classes exists    
-    if (Map->variogram.classes != NULL){
-        free(Map->variogram.classes);
+    // the values of the fields of the batch:
+    if (Map->input_data.fields != NULL){
+        free(Map->input_data.fields);
+        Map->input_data.fields = NULL;
         
-        if (Map->show_output){    
-            printf("%-40s %s\n","variogram classes:","deallocate memory successful!");
+        if (Map->show_output){
+            printf("%-40s %s\n","input dataset (fields):","deallocate memory successful!");
         }
     }
-
-    //--------------------------------------------------------------------------------    
     
-    // check if the vector for the solution of the polynomic function exists?
-    if (Map->variogram.reg_function.solution != NULL){
-        free(Map->variogram.reg_function.solution);
+    // the rows of the updated system (late reports, see update_stations):
+    if (Map->update.rows != NULL){
+        free(Map->update.rows);
+        free(Map->update.station_rows);
+        Map->update.rows = NULL;
+        Map->update.station_rows = NULL;
         
-        if (Map->show_output){    
-            printf("%-40s %s\n","solution of polynomic function:", "deallocate memory successful!");
+        if (Map->show_output){
+            printf("%-40s %s\n","updated system (rows):","deallocate memory successful!");
         }
     }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void free_interpol_threads(struct usr_interpol_thread *threads, int num_threads){
+
+    int idx;
     
+    // the buffers of the threads belong to the arena, only the decompositions of the local systems are freed:
+    if (threads != NULL){
+        for (idx=0; idx<num_threads; idx++){
+            free_local_system(&(threads[idx].local));
+        }
+    }
 }
 
 
+// ##################################################################################################
+// ##################################################################################################
+
 
+void free_local_system(struct usr_local_system *local){
+
+    // the buffers of the system belong to the arena (see create_local_system):
+    free_factorization(&(local->factor));
+    local->num_stations = 0;
+}
@@ -16,6 +16,8 @@ struct usr_variogram{
     double sill;			// Schwelle: Grenzwert ab dem sich nur noch zufällige Schwankungen der Semivarianz ergeben.
     double nugget;			// Grundrauschen der Semivarianz
     double range;			// Reichweite: Ist die Distanz ab der der Grenzwert (sill) erreicht wird.
+    int model;				// Variogrammmodell (VARIO_MODEL_...), VARIO_MODEL_AUTO => Modell mit dem kleinsten Fehler
+    double wrss;			// gewichtete Fehlerquadratsumme des angepassten Modells
     struct usr_function reg_function;	// polynomiale Regressionsfunktion zur Ermittlung des Variogrammmodells.
 
 };
@@ -27,13 +29,154 @@ struct usr_vario_class{
     int upperLimit;			// Obere Grenze der Abstandsklasse
     int num_variance_values;		// Anzahl der Semivarianzwerte in dieser Abstandsklasse
     int num_distance_values;		// Anzahl der Distanzen in der Abstanzklasse
-    double variance_values[1000];	// Feld an Semivarianzen der Abstandsklasse
-    double distance_values[1000];	// Feld der Distanzen der Abstandsklasse
+    long num_pairs;			// Anzahl der Stationspaare in dieser Abstandsklasse
+    double variance_sum;		// Summe der Semivarianzen (je Station) der Abstandsklasse
+    double distance_sum;		// Summe der mittleren Distanzen (je Station) der Abstandsklasse
     double variance_avg;		// Mittelwert der Semivarianzwerte dieser Abstandsklasse
     double variance_avg_reg;		// Vorhersagewert der Semivarianz mittels polynomialer Regression dieser Abstandsklasse (lag)
     double distance_avg; 		// gemittelte Distanz dieser Abstandsklasse (lag)
 };
 
+struct usr_arena_block{
+
+    struct usr_arena_block *next;	// zuvor angelegter Block der Arena
+    size_t size;			// Größe des Blocks (Bytes, ohne Kopf)
+    size_t used;			// bereits vergebene Bytes des Blocks
+    unsigned char *data;		// Beginn der Daten (ARENA_ALIGN Bytes ausgerichtet)
+
+};
+
+struct usr_arena{
+
+    struct usr_arena_block *blocks;	// zuletzt angelegter Block (Anfang der Liste)
+    size_t block_size;			// Mindestgröße eines Blocks (Bytes)
+    size_t in_use;			// vergebene Bytes
+    size_t peak;			// Höchststand der vergebenen Bytes
+    size_t reserved;			// Bytes aller Blöcke
+    int num_blocks;			// Anzahl der Blöcke
+    long num_allocations;		// Anzahl der Anforderungen
+
+};
+
+struct usr_arena_mark{
+
+    struct usr_arena_block *block;	// Block, der zum Zeitpunkt der Marke der aktuelle war
+    size_t used;			// vergebene Bytes dieses Blocks
+    size_t in_use;			// vergebene Bytes der Arena
+
+};
+
+struct usr_matrix{
+
+    int rows;				// Anzahl der Zeilen
+    int cols;				// Anzahl der Spalten
+    bool packed;			// symmetrisch, nur das obere Dreieck (inkl. Diagonale) wird zeilenweise gespeichert
+    double *value;			// Werte der Matrix (zusammenhängend, aus der Arena, ARENA_ALIGN Bytes ausgerichtet)
+
+};
+
+struct usr_factorization{
+
+    int n;				// Dimension des Gleichungssystems
+    int capacity;			// Dimension, für die die Puffer reserviert sind (werden wiederverwendet)
+    double *lu;				// LU-Zerlegung (n x n, zeilenweise, zusammenhängend): L unterhalb, U ab der Diagonale
+    int *pivot;				// Zeilenvertauschungen der Pivotisierung
+
+};
+
+struct usr_raster_station{
+
+    int row_idx;			// Zeile des Rasterpunktes
+    int col_idx;			// Spalte des Rasterpunktes
+    int station_idx;			// Index der Station im Eingabedatensatz
+
+};
+
+struct usr_raster{
+
+    unsigned int rows;			// Anzahl der Zeilen
+    unsigned int cols;			// Anzahl der Spalten
+    double maxLat;			// geogr. Breite der ersten Zeile
+    double minLon;			// geogr. Länge der ersten Spalte
+    double latRes;			// Auflösung (Dezimalgrad) zwischen zwei Zeilen
+    double lonRes;			// Auflösung (Dezimalgrad) zwischen zwei Spalten
+    double *value;			// Werte der Rasterpunkte (zeilenweise, zusammenhängend, aus der Arena, ARENA_ALIGN Bytes ausgerichtet)
+    int num_stations;			// Anzahl der zugeordneten Stationen
+    struct usr_raster_station *stations;	// zugeordnete Stationen (überlagern die interpolierten Werte)
+
+};
+
+struct usr_csv_buffer{
+
+    char *text;				// Text (ohne abschließendes '\0')
+    size_t length;			// Anzahl der Zeichen im Text
+    size_t capacity;			// Größe des reservierten Speichers
+
+};
+
+struct usr_csv_thread{
+
+    struct usr_raster *raster;		// Zeiger auf das auszugebende Raster
+    pthread_t thread;			// Thread-Handle
+    int first_row;			// erste Zeile des Rasters dieses Threads
+    int last_row;			// erste Zeile nach dem Bereich dieses Threads
+    char decimal_separator;		// Dezimaltrennzeichen
+    char field_separator;		// Trennzeichen der Felder einer Zeile
+    struct usr_csv_buffer *lon_line;	// Zeile der Längengrade (für alle Zeilen gleich)
+    struct usr_csv_buffer values;	// Zeilen der Werte dieses Threads
+    struct usr_csv_buffer lat;		// Zeilen der Breitengrade dieses Threads
+    struct usr_csv_buffer lon;		// Zeilen der Längengrade dieses Threads
+    int err;				// EXIT_FAILURE, falls der Speicher nicht reserviert werden konnte
+
+};
+
+struct usr_grid_distance{
+
+    int rows;				// Anzahl der Zeilen des Rasters
+    int cols;				// Anzahl der Spalten des Rasters
+    int num_stations;			// Anzahl der Stationen
+    double *row_sin;			// sin(geogr. Breite) jeder Zeile des Rasters
+    double *row_cos;			// cos(geogr. Breite) jeder Zeile des Rasters
+    double *station_sin;		// sin(geogr. Breite) jeder Station
+    double *station_cos;		// cos(geogr. Breite) jeder Station
+    double *col_cos_dlon;		// cos(Längendifferenz) zwischen Spalte und Station (cols x num_stations)
+
+};
+
+struct usr_station_index{
+
+    int rows;				// Anzahl der Zeilen des Index-Gitters
+    int cols;				// Anzahl der Spalten des Index-Gitters
+    double minLat;			// geogr. Breite der unteren Kante des Index-Gitters
+    double minLon;			// geogr. Länge der linken Kante des Index-Gitters
+    double cellLat;			// Ausdehnung einer Zelle (Dezimalgrad, Breite)
+    double cellLon;			// Ausdehnung einer Zelle (Dezimalgrad, Länge)
+    double maxAbsLat;			// größter Betrag der geogr. Breite der Stationen
+    int *cell_start;			// erster Eintrag jeder Zelle in "stations" (rows x cols + 1)
+    int *stations;			// Indizes der Stationen, nach Zellen sortiert
+
+};
+
+struct usr_neighbourhood{
+
+    int max_neighbours;			// maximale Anzahl der Stationen (Größe der Puffer)
+    int num_neighbours;			// Anzahl der gefundenen Stationen
+    int *station_idx;			// Indizes der nächsten Stationen
+    double *distances;			// Distanzen (km) zu den nächsten Stationen
+
+};
+
+struct usr_local_system{
+
+    int num_stations;			// Anzahl der Stationen des gespeicherten Systems (0 => kein System)
+    int *station_idx;			// Indizes der Stationen des Systems (aufsteigend)
+    struct usr_matrix matrix;		// Kovarianzmatrix des Systems ((k+1) x (k+1), gepackt)
+    struct usr_factorization factor;	// LU-Zerlegung der Kovarianzmatrix des Systems
+    double *coefficients;		// duale Koeffizienten des Systems (nur ohne Korrektur der Gewichte)
+    long num_factorizations;		// Anzahl der Zerlegungen (Statistik)
+
+};
+
 struct usr_dataset{
 
     int length;
@@ -41,6 +184,8 @@ struct usr_dataset{
     double minimum;
     double average;
     struct usr_data_point *data;
+    int num_fields;			// Anzahl der Messwerte (Felder) je Station (Batch, sonst 1)
+    double *fields;			// Messwerte aller Felder (Station für Station, length x num_fields, nur im Batch)
 
 };
 
@@ -59,13 +204,77 @@ struct usr_data_point{
 
 };
 
+struct usr_field_model{
+
+    int model;				// Variogrammmodell (VARIO_MODEL_...)
+    double nugget;			// Grundrauschen der Semivarianz
+    double sill;			// Schwelle der Semivarianz
+    double range;			// Reichweite (km)
+    double wrss;			// gewichtete Fehlerquadratsumme des angepassten Modells
+
+};
+
+struct usr_batch{
+
+    bool enabled;			// Batch: alle Wertespalten (Felder) der Eingabedatei interpolieren ("-b")
+    bool field_variograms;		// eigenes Variogramm je Feld ("-bv"), sonst das Variogramm des ersten Feldes
+    int model;				// angegebenes Variogrammmodell (VARIO_MODEL_..., vor der Anpassung)
+    struct usr_field_model *models;	// Kovarianzmodell jedes Feldes
+    int num_pass;			// Anzahl der Felder des aktuellen Durchgangs (0 => kein Batch-Durchgang)
+    int *pass_fields;			// Felder (Spalten) des aktuellen Durchgangs
+    struct usr_raster *rasters;		// Raster der Felder des aktuellen Durchgangs
+    double *values;			// Messwerte der Felder des Durchgangs (Stationen x num_pass, zeilenweise)
+    double *coefficients;		// duale Koeffizienten der Felder des Durchgangs ((n+1) x num_pass, zeilenweise)
+    int num_factorizations;		// Anzahl der Zerlegungen der Kovarianzmatrix (Statistik)
+
+};
+
+struct usr_system_row{
+
+    int kind;				// Art der Zeile (UPDATE_ROW_...): Station, Lagrange-Zeile oder Sperre einer entfernten Station
+    double lat;				// geogr. Breite der Station (nur UPDATE_ROW_STATION)
+    double lon;				// geogr. Länge der Station (nur UPDATE_ROW_STATION)
+
+};
+
+struct usr_update{
+
+    int capacity;			// Anzahl der Zeilen, für die "rows" reserviert ist
+    struct usr_system_row *rows;	// Bedeutung jeder Zeile des fortgeschriebenen Gleichungssystems (covariance_factor.n Zeilen)
+    int station_capacity;		// Anzahl der Stationen, für die "station_rows" reserviert ist
+    int *station_rows;			// Zeile jeder Station des Eingabedatensatzes im Gleichungssystem
+    int lagrange_row;			// Zeile des Lagrange-Multiplikators
+    int num_locks;			// Anzahl der Sperrzeilen entfernter Stationen (seit der letzten Zerlegung)
+    int num_added;			// Anzahl der hinzugefügten Stationen (Statistik)
+    int num_removed;			// Anzahl der entfernten Stationen (Statistik)
+    int num_revised;			// Anzahl der korrigierten Messwerte (Statistik)
+    int num_factorizations;		// Anzahl der vollständigen Zerlegungen (Statistik)
+
+};
+
+struct usr_model_cache{
+
+    bool enabled;			// Modell-Cache verwenden ("-mc")
+    bool loaded;			// Distanzmatrix, Variogramm und Zerlegung wurden aus dem Cache gelesen
+    unsigned long long key;		// Schlüssel: Hash der Koordinaten der Stationen, der Variogramm- und der Rasterparameter
+    char path[300];			// Cache-Datei des Schlüssels im Ausgabeverzeichnis
+    void *map;				// in den Speicher abgebildete Cache-Datei (die Distanzmatrix liegt darin)
+    size_t map_size;			// Größe der abgebildeten Cache-Datei (Bytes)
+
+};
+
 struct usr_config{
 
     char output_dir[100];
     char input_dir[100];
     char input_datafile[100];
     char output_datafile[100];
+    char csv_decimal_separator;		// Dezimaltrennzeichen der csv-Dateien
+    char csv_field_separator;		// Trennzeichen der Felder der csv-Dateien
     char output_datafile_cor[100];
+    char output_variancefile[100];
+    char update_datafile[100];		// nachgemeldete und zurückgewiesene Stationen ("-u", leer => keine)
+    char output_datafile_upd[100];	// Ausgabedatei nach der Fortschreibung der Stationen
 
 };
 
@@ -96,12 +305,31 @@ struct usr_map{
     // Nachträgliche Korrektur der Gewichte beim Interpolieren?
     bool weights_correction;
     
+    // Duales Kriging (nur ohne Korrektur der Gewichte): Schätzwert = Kovarianzvektor * (C^-1 * Messwerte)
+    bool dual_kriging;
+    
     // show output during calculations on console:
     bool show_output;
     
+    // Ausgabe der Raster als csv-Dateien (Werte, Breiten- und Längengrade) anstatt einer Binärdatei?
+    bool output_csv;
+    
+    // Kriging-Varianz jedes Rasterpunktes berechnen (Raster "variance")?
+    bool kriging_variance;
+    
+    // Anzahl der Threads beim Interpolieren (0 => Anzahl der verfügbaren Prozessoren):
+    unsigned int num_threads;
+    
+    // Lokales Kriging: Anzahl der nächsten Stationen je Rasterpunkt (0 => alle) und Suchradius in km (0 => unbegrenzt):
+    int num_neighbours;
+    double search_radius;
+    
     // Konfiguration:
     struct usr_config config;
     
+    // Arena, aus der die Puffer für die Dauer eines Laufs reserviert werden (freigegeben in free_raster):
+    struct usr_arena arena;
+    
     // Eingabe-Daten:
     struct usr_dataset input_data;
     
@@ -109,17 +337,93 @@ struct usr_map{
     struct usr_dataset output_data;
     
     // Eingabe-Raster:
-    struct usr_data_point **raster;
+    struct usr_raster raster;
+    
+    // Raster der Kriging-Varianz (nur mit "kriging_variance"):
+    struct usr_raster variance;
+    
+    // Tabellen zur Berechnung der Distanzen zwischen Rasterpunkten und Stationen:
+    struct usr_grid_distance grid_distance;
+    
+    // Räumlicher Index der Stationen (lokales Kriging):
+    struct usr_station_index station_index;
     
     // Variogramm:
     struct usr_variogram variogram;
     
-    // Distanzmatrix (Distanz eines jeden Messpunktes zum anderen Messpunkt):
-    double **distance_matrix;
+    // Distanzmatrix (Distanz eines jeden Messpunktes zum anderen Messpunkt, gepackt):
+    struct usr_matrix distance_matrix;
+    
+    // Kovarianzmatrix (Kovarianzen eines jeden Messpunktes zum anderen Messpunkt, gepackt):
+    struct usr_matrix covariance_matrix;
     
-    // Kovarianzmatrix (Kovarianzen eines jeden Messpunktes zum anderen Messpunkt):
-    double **covariance_matrix; 
+    // LU-Zerlegung der Kovarianzmatrix (ersetzt die Inverse):
+    struct usr_factorization covariance_factor;
     
-    // Inverse der Kovarianzmatrix:
-    double **covariance_matrix_inv;  
+    // Koeffizienten des dualen Krigings (Lösung von C * a = (Messwerte, 0)):
+    double *dual_coefficients;
+    
+    // Batch mehrerer Felder auf denselben Stationen (eine Zerlegung je Kovarianzmodell):
+    struct usr_batch batch;
+    
+    // Nachgemeldete und zurückgewiesene Stationen (Fortschreibung der LU-Zerlegung, "-u"):
+    struct usr_update update;
+    
+    // Cache des Modells (Distanzmatrix, Variogramm, Zerlegung) für ein unverändertes Stationsnetz ("-mc"):
+    struct usr_model_cache model_cache;
+};
+
+
+struct usr_thread_pool{
+
+    atomic_int next_row;		// erste Zeile des Rasters, die noch keinem Thread zugeteilt wurde
+    atomic_long cells_done;		// Anzahl der bereits bearbeiteten Rasterpunkte (Fortschritt)
+    atomic_int last_permille;		// zuletzt ausgegebener Fortschritt in Promille
+    atomic_int abort;			// wird von einem Thread gesetzt, sobald ein Fehler auftritt
+
+};
+
+
+struct usr_interpol_thread{
+
+    struct usr_map *Map;		// Zeiger auf das Kartenobjekt
+    struct usr_thread_pool *pool;	// Zeiger auf den gemeinsamen Zustand aller Threads
+    pthread_t thread;			// Thread-Handle
+    double *cov_vector;			// eigener Kovarianzvektor des Threads
+    double *weights_vector;		// eigener Gewichtsvektor des Threads
+    struct usr_neighbourhood neighbourhood;	// nächste Stationen des aktuellen Rasterpunktes (lokales Kriging)
+    struct usr_local_system local;	// zuletzt verwendetes Gleichungssystem (lokales Kriging)
+    int excno;				// Fehlernummer des Threads (0 => kein Fehler)
+    int failed_row;			// Zeile des Rasters, in der der Fehler aufgetreten ist
+
+};
+
+
+struct usr_distance_thread{
+
+    struct usr_map *Map;		// Zeiger auf das Kartenobjekt
+    pthread_t thread;			// Thread-Handle
+    int first_row;			// erste Zeile der Distanzmatrix (oberes Dreieck) dieses Threads
+    int last_row;			// erste Zeile nach dem Bereich dieses Threads
+
+};
+
+struct usr_vario_accumulator{
+
+    double sum_pow;			// Summe der quadratischen Abweichungen einer Station in einer Abstandsklasse
+    double sum_distance;		// Summe der Distanzen einer Station in einer Abstandsklasse
+    int num_values;			// Anzahl der Stationspaare einer Station in einer Abstandsklasse
+
+};
+
+
+struct usr_vario_thread{
+
+    struct usr_map *Map;		// Zeiger auf das Kartenobjekt
+    pthread_t thread;			// Thread-Handle
+    int first_row;			// erste Zeile der Distanzmatrix (oberes Dreieck) dieses Threads
+    int last_row;			// erste Zeile nach dem Bereich dieses Threads
+    struct usr_vario_accumulator *acc;	// Summen je Station und Abstandsklasse (num. Stationen x num. Klassen)
+    long *num_pairs;			// Anzahl der Stationspaare je Abstandsklasse
+
 };
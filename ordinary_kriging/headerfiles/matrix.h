@@ -0,0 +1,167 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdbool.h>
+    #include <setjmp.h>
+    #include <errno.h>
+#endif
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int create_matrix(struct usr_arena *arena, struct usr_matrix *matrix, int rows, int cols, bool packed);
+
+// accessors (no checks, see create_matrix):
+static inline size_t matrix_num_values(const struct usr_matrix *matrix);
+static inline size_t matrix_index(const struct usr_matrix *matrix, int row, int col);
+static inline double matrix_get(const struct usr_matrix *matrix, int row, int col);
+static inline void matrix_set(struct usr_matrix *matrix, int row, int col, double value);
+static inline double *matrix_upper_row(struct usr_matrix *matrix, int row);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int create_matrix(struct usr_arena *arena, struct usr_matrix *matrix, int rows, int cols, bool packed){
+
+    /*
+        DESCRIPTION:
+        Allocates a matrix of type double with the dimensions of rows x cols out of the arena. All values
+        are stored within one contiguous block of memory, aligned to ARENA_ALIGN bytes, and set to 0.
+
+        A symmetric (square) matrix can be stored packed: only the upper triangle (diagonal
+        included) is stored row by row, so row "idx" holds the columns idx ... cols-1
+        (see matrix_index). This needs about half the memory of the full matrix.
+
+        INPUT:
+        struct usr_arena *arena	...	pointer to the arena
+        struct usr_matrix *matrix	...	pointer to the matrix object
+        int rows			...	number of rows
+        int cols			...	number of columns
+        bool packed			...	store only the upper triangle of a symmetric matrix?
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+    */
+
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        matrix->value = NULL;
+
+        if ((rows <= 0) || (cols <= 0)){
+            longjmp(env, 1);
+        }
+        if ((packed) && (rows != cols)){
+            longjmp(env, 2);
+        }
+
+        matrix->rows = rows;
+        matrix->cols = cols;
+        matrix->packed = packed;
+
+        matrix->value = (double *) arena_alloc(arena, matrix_num_values(matrix) * sizeof(double));
+        if (matrix->value == NULL){
+            longjmp(env, 3);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> The number of rows and columns must be greater then 0!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> Only a square matrix can be stored packed!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline size_t matrix_num_values(const struct usr_matrix *matrix){
+
+    /*
+        DESCRIPTION:
+        Returns the number of values that are stored for the matrix.
+    */
+
+    if (matrix->packed){
+        return ((size_t)matrix->rows * (matrix->rows + 1)) / 2;
+    }
+    return (size_t)matrix->rows * matrix->cols;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline size_t matrix_index(const struct usr_matrix *matrix, int row, int col){
+
+    /*
+        DESCRIPTION:
+        Returns the position of the value (row, col) within the buffer of the matrix.
+        For a packed matrix the values of the lower triangle are taken out of the upper one.
+        Row "idx" of the upper triangle starts behind the idx previous rows of the lengths
+        n, n-1, ... n-idx+1, so at idx*n - idx*(idx-1)/2.
+    */
+
+    int tmp;
+
+    if (matrix->packed){
+        if (row > col){
+            tmp = row;
+            row = col;
+            col = tmp;
+        }
+        return (size_t)row * matrix->cols - ((size_t)row * (row - 1)) / 2 + (col - row);
+    }
+    return (size_t)row * matrix->cols + col;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double matrix_get(const struct usr_matrix *matrix, int row, int col){
+
+    return matrix->value[matrix_index(matrix, row, col)];
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline void matrix_set(struct usr_matrix *matrix, int row, int col, double value){
+
+    matrix->value[matrix_index(matrix, row, col)] = value;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double *matrix_upper_row(struct usr_matrix *matrix, int row){
+
+    /*
+        DESCRIPTION:
+        Returns a pointer to the value on the diagonal of a row. The values of the columns
+        row ... cols-1 follow one after another (packed and full matrix).
+    */
+
+    return &(matrix->value[matrix_index(matrix, row, row)]);
+}
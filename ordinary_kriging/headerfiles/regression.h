@@ -7,7 +7,7 @@
 
 // --------------------------- Funktionsdeklaration ---------------------------
 // ----------------------------------------------------------------------------
-double *polynomial_regression(double **input_data, const int length, const int n);
+double *polynomial_regression(struct usr_arena *arena, double **input_data, const int length, const int n);
 
 
 
@@ -18,11 +18,13 @@ double *polynomial_regression(double **input_data, const int length, const int n
 // ----------------------------------------------------------------------------
 
 
-double *polynomial_regression(double **input_data, const int length, const int n){
+double *polynomial_regression(struct usr_arena *arena, double **input_data, const int length, const int n){
 
     
     /*
         Input:
+        arena		...	Arena, aus der der Speicher reserviert wird. Die Zwischenergebnisse werden
+                                am Ende wieder freigegeben, nur der Ergebnisvektor bleibt bestehen.
         input_data	...	Doppelzeiger vom Typ "double" mit den Eingabedaten.
                                 In der Form:
                                 x-Werte: input_data[0 bis n][0]
@@ -65,6 +67,7 @@ double *polynomial_regression(double **input_data, const int length, const int n
     double **temp_data_powers_CORMatrix;	// temporäre Intrakorrelationsmatrix der Prädiktoren von x^1 ... x^n (x-Werte) zur Berechnung der Inversen
     double **LowMatrix;				// Lower-Diagonalmatrize
     double **UppMatrix;				// Upper-Diagonalmatrize    
+    struct usr_arena_mark scratch;		// Stand der Arena nach dem Ergebnisvektor (Beginn der Zwischenergebnisse)
     
     
     
@@ -89,20 +92,21 @@ double *polynomial_regression(double **input_data, const int length, const int n
     
     
 
-    // Reservieren des Speichers:
-    data_powers = (double**) calloc(length , sizeof(double*));			// Matrix für die Potenzen der Eingabedaten (x-Werte) & y-Werten
-    data_powers_MW_SD = (double**) calloc(2, sizeof(double*));			// Matrix mit den Mittelwerten und Standardabweichungen der Eingabedaten (x & y-Werte)
-    data_powers_COVMatrix = (double**) calloc(n, sizeof(double*));		// Matrix mit den Intrakovarianzen der Prädiktoren COV(x,x), COV(x,x^2), ... , COV(x^n, x^n)
-    data_powers_CORMatrix = (double**) calloc(n, sizeof(double*));		// Matrix mit den Intrakorrelationen der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
-    temp_data_powers_CORMatrix = (double**) calloc(n, sizeof(double*));		// temporäre Matrix mit den Intrakorrelationen der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
-    data_powers_CORMatrix_inverse = (double**) calloc(n, sizeof(double*));	// inverse Intrakorrelationsmatrix der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
-    data_powers_CORCriteria = (double*) calloc(n, sizeof(double*));		// Vektor mit den Intrakriteriumskorrelationen (COR(x,y), COR(x^2,y), ... ,COR(x^n, y))
-    data_powers_COVCriteria = (double*) calloc(n, sizeof(double*));		// Vektor mit den Intrakriteriumskovarianzen (COV(x,y), COV(x^2,y), ... ,COV(x^n, y))
-    beta_weights = (double*) calloc(n, sizeof(double*));			// Vektor mit den beta-Gewichten zur Berechnung des b-Gewichte
-    b_weights = (double*) calloc(n+2, sizeof(double*));				// Vektor mit den b-Gewichten (b0, b1, ..., bn) und dem Bestimmtheitsmaß.
-    values_pred = (double*) calloc(length, sizeof(double*));			// Vektor mit den laut Modell berechneten bzw. vorhergesagten Werten.
-    LowMatrix = (double**) calloc(n, sizeof(double*));				// Lower-Diagonalmatrize
-    UppMatrix = (double**) calloc(n, sizeof(double*));				// Upper-Diagonalmatrize
+    // Reservieren des Speichers (Ergebnisvektor vor der Marke, Zwischenergebnisse danach):
+    b_weights = create_fvector(arena, n+2);							// Vektor mit den b-Gewichten (b0, b1, ..., bn) und dem Bestimmtheitsmaß.
+    scratch = arena_mark(arena);
+    data_powers = create_fmatrix(arena, length, n+1);					// Matrix für die Potenzen der Eingabedaten (x-Werte) & y-Werten
+    data_powers_MW_SD = create_fmatrix(arena, 2, n+2);					// Matrix mit den Mittelwerten und Standardabweichungen der Eingabedaten (x & y-Werte)
+    data_powers_COVMatrix = create_fmatrix(arena, n, n);				// Matrix mit den Intrakovarianzen der Prädiktoren COV(x,x), COV(x,x^2), ... , COV(x^n, x^n)
+    data_powers_CORMatrix = create_fmatrix(arena, n, n);				// Matrix mit den Intrakorrelationen der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
+    temp_data_powers_CORMatrix = create_fmatrix(arena, n, n);				// temporäre Matrix mit den Intrakorrelationen der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
+    data_powers_CORMatrix_inverse = create_fmatrix(arena, n, n);			// inverse Intrakorrelationsmatrix der Prädiktoren COR(x,x), COR(x,x^2), ... , COR(x^n, x^n)
+    data_powers_CORCriteria = create_fvector(arena, n);					// Vektor mit den Intrakriteriumskorrelationen (COR(x,y), COR(x^2,y), ... ,COR(x^n, y))
+    data_powers_COVCriteria = create_fvector(arena, n);					// Vektor mit den Intrakriteriumskovarianzen (COV(x,y), COV(x^2,y), ... ,COV(x^n, y))
+    beta_weights = create_fvector(arena, n);						// Vektor mit den beta-Gewichten zur Berechnung des b-Gewichte
+    values_pred = create_fvector(arena, length);					// Vektor mit den laut Modell berechneten bzw. vorhergesagten Werten.
+    LowMatrix = create_fmatrix(arena, n, n);						// Lower-Diagonalmatrize
+    UppMatrix = create_fmatrix(arena, n, n);						// Upper-Diagonalmatrize
     
     if ((data_powers == NULL) || 
         (data_powers_MW_SD == NULL) || 
@@ -114,86 +118,14 @@ double *polynomial_regression(double **input_data, const int length, const int n
         (data_powers_COVCriteria == NULL) ||
         (beta_weights == NULL) ||
         (b_weights == NULL) ||
-        (values_pred == NULL)){
+        (values_pred == NULL) ||
+        (LowMatrix == NULL) ||
+        (UppMatrix == NULL)){
         
         printf("Speicherfehler!");
+        arena_rewind(arena, scratch);
         return NULL;
     }
-    else{
-    
-        // Spalten der Matrix für die Potenzen der Eingabedaten
-        for(idx=0; idx<length; idx++){
-        
-           data_powers[idx] = (double*) calloc((n+1) , sizeof(double));
-           if (data_powers[idx] == NULL){
-               printf("Speicherfehler!\n");
-               return NULL;
-           }
-        }
-        // Spalten der Matrix mit den Mittelwerten und Standardabweichungen der Eingabedaten
-        for(idx=0; idx<2; idx++){
-        
-           data_powers_MW_SD[idx] = (double*) calloc((n+2) , sizeof(double));
-           if (data_powers_MW_SD[idx] == NULL){
-               printf("Speicherfehler!\n");
-               return NULL;
-           }
-        }  
-        //  Spalten der Matrix mit den Intrakovarianzen der Prädiktoren:
-        for(idx=0; idx<n; idx++){
-        
-            data_powers_COVMatrix[idx] = (double*) calloc(n , sizeof(double));
-            if (data_powers_COVMatrix[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        } 
-        //  Spalten der Matrix mit den Intrakorrelationen der Prädiktoren:       
-        for(idx=0; idx<n; idx++){
-        
-            data_powers_CORMatrix[idx] = (double*) calloc(n , sizeof(double));
-            if (data_powers_CORMatrix[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        }
-        //  Spalten der temporären Matrix mit den Intrakorrelationen der Prädiktoren:       
-        for(idx=0; idx<n; idx++){
-        
-            temp_data_powers_CORMatrix[idx] = (double*) calloc(n , sizeof(double));
-            if (temp_data_powers_CORMatrix[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        } 
-        //  Spalten der temporären Matrix mit den Intrakorrelationen der Prädiktoren:       
-        for(idx=0; idx<n; idx++){
-        
-            data_powers_CORMatrix_inverse[idx] = (double*) calloc(n , sizeof(double));
-            if (data_powers_CORMatrix_inverse[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        }
-        // Spalten der Lower-Diagonalmatrize zum Berechnen der Determinanten
-        for(idx=0; idx<n; idx++){
-        
-            LowMatrix[idx] = (double*) calloc(n , sizeof(double));
-            if (LowMatrix[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        }
-        // Spalten der Upper-Diagonalmatrize zum Berechnen der Determinanten
-        for(idx=0; idx<n; idx++){
-        
-            UppMatrix[idx] = (double*) calloc(n , sizeof(double));
-            if (UppMatrix[idx] == NULL){
-                printf("Speicherfehler!\n");
-                return NULL;
-            }
-        }                              
-    }
     
     /*#########################################################################################################
     #                                                                                                         #
@@ -203,36 +135,8 @@ double *polynomial_regression(double **input_data, const int length, const int n
     
     void free_memory(){
     
-    
-        for (idx=0; idx<length; idx++){
-            free(data_powers[idx]);
-        }
-    
-        for (idx=0; idx<2; idx++){
-            free(data_powers_MW_SD[idx]);
-        }
-        
-        for (idx=0; idx<n; idx++){
-            free(data_powers_COVMatrix[idx]);
-            free(data_powers_CORMatrix[idx]);
-            free(temp_data_powers_CORMatrix[idx]);
-            free(data_powers_CORMatrix_inverse[idx]);
-            free(LowMatrix[idx]);
-            free(UppMatrix[idx]);
-        }
-    
-        free(data_powers);
-        free(data_powers_MW_SD);
-        free(data_powers_COVMatrix);
-        free(data_powers_CORMatrix); 
-        free(temp_data_powers_CORMatrix);
-        free(data_powers_CORMatrix_inverse);
-        free(data_powers_COVCriteria);
-        free(data_powers_CORCriteria);
-        free(beta_weights);
-        free(values_pred);
-        free(LowMatrix);
-        free(UppMatrix);        
+        // gibt alle Zwischenergebnisse auf einmal frei (der Ergebnisvektor bleibt bestehen):
+        arena_rewind(arena, scratch);
     }
     
     
@@ -0,0 +1,885 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <stdbool.h>
+    #include <setjmp.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define UPDATE_ROW_STATION 0					// row of a station (a removed station keeps its row, see remove_station)
+#define UPDATE_ROW_LAGRANGE 1					// row of the lagrange multiplier
+#define UPDATE_ROW_LOCK 2					// row that locks the coefficient of a removed station to 0
+#define UPDATE_MAX_LOCKS 64					// number of removed stations, after which the system is decomposed again
+#define UPDATE_ROW_CAPACITY 64					// initial number of rows of the updated system (grows as needed)
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+int set_update_config(struct usr_map *Map, int argc, char **argv);
+int update_stations(struct usr_map *Map);
+int add_station(struct usr_map *Map, struct usr_data_point *station);
+int remove_station(struct usr_map *Map, int station_idx);
+int refactorize_stations(struct usr_map *Map);
+int update_dual_coefficients(struct usr_map *Map);
+int update_station_overlay(struct usr_map *Map);
+int reset_system_rows(struct usr_map *Map);
+int reserve_system_rows(struct usr_update *update, int num_rows, int num_stations);
+int find_station(struct usr_dataset *input_data, const char *name);
+
+static inline double station_distance(double latA, double lonA, double latB, double lonB);
+static inline double station_covariance(struct usr_map *Map, double distance);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int set_update_config(struct usr_map *Map, int argc, char **argv){
+
+    /*
+        DESCRIPTION:
+        Reads the arguments of the update of the stations (see kriging.c). The general arguments are
+        handled by set_config:
+        -u <file>	...	late reports and rejected stations (file in the input directory, see update_stations)
+        The update changes the dual coefficients of the global system (see create_dual_coefficients):
+        the correction of negative weights ("-c"), the kriging variance ("-v"), local kriging ("-k", "-r")
+        and the batch ("-b", "-bv") can not be combined with it.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the "map" object of datatype "struct usr_map".
+
+        OUTPUT:(error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        for (idx=0; idx<argc; idx++){
+
+            // late reports and rejected stations:
+            if (!strcmp(argv[idx],"-u")){
+                if ((idx+1 >= argc) || (strlen(argv[idx+1]) == 0) || (strlen(argv[idx+1]) >= sizeof(Map->config.update_datafile))){
+                    longjmp(env, 1);
+                }
+                strcpy(Map->config.update_datafile, argv[++idx]);
+            }
+        }
+
+        if (Map->config.update_datafile[0] == '\0'){
+            return EXIT_SUCCESS;
+        }
+
+        if ((!Map->dual_kriging) || (Map->weights_correction) || (Map->kriging_variance)){
+            longjmp(env, 2);
+        }
+        if (is_local_kriging(Map)){
+            longjmp(env, 3);
+        }
+        if (Map->batch.enabled){
+            longjmp(env, 4);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n The argument \"-u\" requires the name of the update file (max. %d characters)!\n\n", __FILE__, __LINE__, (int)sizeof(Map->config.update_datafile)-1); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The update (\"-u\") requires dual kriging, it can not be combined with \"-c\" or \"-v\"!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The update (\"-u\") can not be combined with local kriging (\"-k\", \"-r\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n The update (\"-u\") can not be combined with the batch (\"-b\", \"-bv\")!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int update_stations(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Applies the late reports and the rejected stations of the update file ("-u") to the analysis
+        and writes the corrected raster to "Map->config.output_datafile_upd". The first line (header)
+        is skipped, every further line contains either
+        name;lat;lon;value	...	a late report: the station is added. If there is already a station
+					of this name, its value is revised (same location) or it is replaced.
+        name			...	a rejected station: it is removed.
+
+        The decomposition of the system is not calculated again, every station is added or removed by
+        bordering it (see add_station, remove_station) in O(n^2). Afterwards the dual coefficients are
+        solved once (see update_dual_coefficients) and the raster is interpolated again.
+        The variogram of the analysis is kept, a new analysis fits it to the changed stations.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int excno;
+    volatile int line_number = 0;
+    const char * volatile text = NULL;
+    volatile size_t text_size = 0;
+    char path[sizeof(Map->config.input_dir) + sizeof(Map->config.update_datafile)];
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int fd;
+        int err;
+        double sum = 0;
+        size_t name_length;
+        struct stat file_info;
+        struct usr_data_point station;
+        const char *end, *line, *line_end, *field, *next, *name_end;
+
+        if (Map->config.update_datafile[0] == '\0'){
+            return EXIT_SUCCESS;
+        }
+
+        if (Map->show_output){
+            printf("\nUpdate of the stations (%s):\n", Map->config.update_datafile);
+        }
+
+        // the rows of the decomposed system are the stations and the lagrange multiplier:
+        if (reset_system_rows(Map) == EXIT_FAILURE){
+            longjmp(env, 3);
+        }
+
+        // open the update file and map it into the memory:
+        fd = open(strcat(strcpy(path, Map->config.input_dir), Map->config.update_datafile), O_RDONLY);
+        if (fd < 0){
+            longjmp(env, 1);
+        }
+        if (fstat(fd, &file_info) != 0){
+            close(fd);
+            longjmp(env, 1);
+        }
+        if (file_info.st_size <= 0){
+            close(fd);
+            longjmp(env, 2);
+        }
+
+        text = (const char *) mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (text == MAP_FAILED){
+            text = NULL;
+            longjmp(env, 1);
+        }
+        text_size = file_info.st_size;
+        end = text + text_size;
+
+        for (line=text; line<end; line=line_end+1){
+
+            line_number++;
+
+            line_end = (const char *) memchr(line, '\n', end - line);
+            if (line_end == NULL){
+                line_end = end;
+            }
+
+            // skip the header and empty lines:
+            if ((line_number == 1) || (skip_blanks(line, line_end) == line_end)){
+                continue;
+            }
+
+            // name of the station (a line without ';' contains nothing else):
+            next = (const char *) memchr(line, ';', line_end - line);
+            name_end = (next != NULL) ? next : line_end;
+            while ((name_end > line) && ((name_end[-1] == ' ') || (name_end[-1] == '\t') || (name_end[-1] == '\r'))){
+                name_end--;
+            }
+            name_length = (size_t)(name_end - line);
+            if ((name_length == 0) || (name_length >= sizeof(station.name))){
+                longjmp(env, 4);
+            }
+            memcpy(station.name, line, name_length);
+            station.name[name_length] = '\0';
+
+            idx = find_station(&(Map->input_data), station.name);
+
+            // rejected station:
+            if (next == NULL){
+
+                if (idx < 0){
+                    fprintf(stderr, "WARNING: %s --> %d:\n >>> %s, line %d: The station \"%s\" is not part of the dataset, the line is ignored!\n",
+                            __FILE__, __LINE__, path, line_number, station.name);
+                    continue;
+                }
+                if (remove_station(Map, idx) == EXIT_FAILURE){
+                    longjmp(env, 6);
+                }
+                continue;
+            }
+
+            // late report:
+            field = parse_decimal(next + 1, line_end, &(station.lat));
+            if ((field == NULL) || (field >= line_end) || (*field != ';')){
+                longjmp(env, 5);
+            }
+            field = parse_decimal(field + 1, line_end, &(station.lon));
+            if ((field == NULL) || (field >= line_end) || (*field != ';')){
+                longjmp(env, 5);
+            }
+            field = parse_decimal(field + 1, line_end, &(station.value));
+            if ((field == NULL) || (skip_blanks(field, line_end) != line_end)){
+                longjmp(env, 5);
+            }
+            if ((!isfinite(station.lat)) || (fabs(station.lat) > 90) || (!isfinite(station.lon)) || (fabs(station.lon) > 180) || (!isfinite(station.value))){
+                longjmp(env, 7);
+            }
+
+            if (idx >= 0){
+
+                // revised value, the system stays the same:
+                if ((fabs(station.lat - Map->input_data.data[idx].lat) < EPS) && (fabs(station.lon - Map->input_data.data[idx].lon) < EPS)){
+                    Map->input_data.data[idx].value = station.value;
+                    Map->update.num_revised++;
+                    continue;
+                }
+
+                // the station has moved:
+                if (remove_station(Map, idx) == EXIT_FAILURE){
+                    longjmp(env, 6);
+                }
+            }
+
+            err = add_station(Map, &station);
+            if (err == EXIT_FAILURE){
+                longjmp(env, 6);
+            }
+        }
+
+        munmap((void *)text, text_size);
+        text = NULL;
+
+        // statistical metadata of the changed dataset:
+        Map->input_data.minimum = Map->input_data.data[0].value;
+        Map->input_data.maximum = Map->input_data.data[0].value;
+
+        for (idx=0; idx<Map->input_data.length; idx++){
+
+            sum += Map->input_data.data[idx].value;
+            Map->input_data.minimum = (Map->input_data.data[idx].value < Map->input_data.minimum) ? Map->input_data.data[idx].value : Map->input_data.minimum;
+            Map->input_data.maximum = (Map->input_data.data[idx].value > Map->input_data.maximum) ? Map->input_data.data[idx].value : Map->input_data.maximum;
+        }
+        Map->input_data.average = sum / Map->input_data.length;
+
+        if (update_station_overlay(Map) == EXIT_FAILURE){
+            longjmp(env, 8);
+        }
+
+        if (update_dual_coefficients(Map) == EXIT_FAILURE){
+            longjmp(env, 9);
+        }
+
+        if (interpolate_raster(Map) == EXIT_FAILURE){
+            longjmp(env, 10);
+        }
+
+        if (Map->show_output){
+            printf("update: %d added, %d removed, %d revised, %d stations, %d decompositions of the covariance matrix\n",
+                   Map->update.num_added, Map->update.num_removed, Map->update.num_revised, Map->input_data.length, Map->update.num_factorizations);
+        }
+
+        err = (Map->output_csv) ? outputRasterCSV(&(Map->raster), Map->config.output_dir, Map->config.output_datafile_upd, Map->config.csv_decimal_separator, Map->config.csv_field_separator, Map->num_threads, Map->show_output)
+                                : outputRasterBinary(&(Map->raster), Map->config.output_dir, Map->config.output_datafile_upd, Map->show_output);
+        if (err == EXIT_FAILURE){
+            longjmp(env, 11);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        if (text != NULL){
+            munmap((void *)text, text_size);
+        }
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n Failure when opening the update file:\n>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n The update file \"%s\" is empty!\n\n", __FILE__, __LINE__, path); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n The covariance matrix of the analysis has not been decomposed!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The name of the station is missing or longer then %d characters!\n\n", __FILE__, __LINE__, path, line_number, (int)sizeof(Map->input_data.data[0].name)-1); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Malformed line (expected: name;lat;lon;value or name)!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 6: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: Failure when updating the system of the stations!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 7: fprintf(stderr, "ERROR: %s --> %d:\n %s, line %d: The coordinates are out of range (lat: -90 ... 90, lon: -180 ... 180) or a number is \"INF\"!\n\n", __FILE__, __LINE__, path, line_number); return EXIT_FAILURE;
+            case 8: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 9: fprintf(stderr, "ERROR: %s --> %d:\n Calculation of the dual kriging coefficients of the updated stations returned an error!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 10: fprintf(stderr, "ERROR: %s --> %d:\n Failure when interpolating the raster of the updated stations!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 11: fprintf(stderr, "ERROR: %s --> %d:\n Failure when writing the raster of the updated stations!\n\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int add_station(struct usr_map *Map, struct usr_data_point *station){
+
+    /*
+        DESCRIPTION:
+        Adds a station to the input dataset. The decomposition of the system is bordered by the
+        covariances of the station to all rows of the system (see lu_border) in O(n^2), the new row
+        follows the rows of the system (behind the lagrange multiplier, see reset_system_rows).
+        If the new pivot is (nearly) 0, the system is decomposed again (see refactorize_stations).
+        The station is assigned to its nearest raster point (see snap_station_to_raster).
+
+        A station at the location of another station would make the system singular, it is ignored.
+
+        INPUT:
+        struct usr_map *Map		...	pointer to the map object.
+        struct usr_data_point *station	...	the new station (name, lat, lon and value).
+
+        OUTPUT: (error code)
+        on success			...	EXIT_SUCCESS
+        on failure			...	EXIT_FAILURE
+        station ignored			...	2
+    */
+
+    int idx;
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int n = Map->covariance_factor.n;
+        int err, bordered;
+        int row_idx, col_idx;
+        double *border;
+        struct usr_data_point *data;
+        struct usr_system_row *row;
+        struct usr_arena_mark scratch;
+
+        // a second station at the same location:
+        for (idx=0; idx<Map->input_data.length; idx++){
+
+            if (station_distance(station->lat, station->lon, Map->input_data.data[idx].lat, Map->input_data.data[idx].lon) < EPS){
+                fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) has the location of the station \"%s\" and is ignored!\n",
+                        __FILE__, __LINE__, station->name, station->lat, station->lon, Map->input_data.data[idx].name);
+                return 2;
+            }
+        }
+
+        data = (struct usr_data_point *) realloc(Map->input_data.data, (Map->input_data.length + 1) * sizeof(struct usr_data_point));
+        if (data == NULL){
+            longjmp(env, 1);
+        }
+        Map->input_data.data = data;
+
+        if (reserve_system_rows(&(Map->update), n + 1, Map->input_data.length + 1) == EXIT_FAILURE){
+            longjmp(env, 1);
+        }
+
+        // covariances of the station to all rows of the system:
+        scratch = arena_mark(&(Map->arena));
+        border = create_fvector(&(Map->arena), n);
+        if (border == NULL){
+            longjmp(env, 1);
+        }
+
+        for (idx=0; idx<n; idx++){
+
+            row = &(Map->update.rows[idx]);
+            if (row->kind == UPDATE_ROW_STATION){
+                border[idx] = station_covariance(Map, station_distance(station->lat, station->lon, row->lat, row->lon));
+            }
+            else{
+                border[idx] = (row->kind == UPDATE_ROW_LAGRANGE) ? 1 : 0;
+            }
+        }
+
+        bordered = lu_border(&(Map->covariance_factor), border, border, Map->variogram.nugget);
+        arena_rewind(&(Map->arena), scratch);
+        if (bordered == EXIT_FAILURE){
+            longjmp(env, 2);
+        }
+
+        // the station and its raster point:
+        data = &(Map->input_data.data[Map->input_data.length]);
+        *data = *station;
+
+        err = snap_station_to_raster(&(Map->raster), data->lat, data->lon, &row_idx, &col_idx);
+        if (err == 2){
+            fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is not assigned to a raster point!\n",
+                    __FILE__, __LINE__, data->name, data->lat, data->lon);
+            row_idx = -1;
+            col_idx = -1;
+        }
+        else if (err == 1){
+            fprintf(stderr, "WARNING: %s --> %d:\n >>> The station \"%s\" (%.3f, %.3f) is outside the raster and is assigned to the border point (%d, %d)!\n",
+                    __FILE__, __LINE__, data->name, data->lat, data->lon, row_idx, col_idx);
+        }
+        data->row_idx = row_idx;
+        data->col_idx = col_idx;
+
+        Map->update.station_rows[Map->input_data.length] = n;
+        Map->input_data.length++;
+        Map->update.num_added++;
+
+        // the bordered system is unstable, the new station is part of the decomposition of all stations:
+        if (bordered == 2){
+            if (refactorize_stations(Map) == EXIT_FAILURE){
+                longjmp(env, 3);
+            }
+        }
+        else{
+            Map->update.rows[n].kind = UPDATE_ROW_STATION;
+            Map->update.rows[n].lat = data->lat;
+            Map->update.rows[n].lon = data->lon;
+        }
+
+        if (Map->show_output){
+            printf("station \"%s\" added (%d rows)\n", data->name, Map->covariance_factor.n);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when bordering the decomposition by the station \"%s\"!\n", __FILE__, __LINE__, station->name); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when decomposing the system with the station \"%s\"!\n", __FILE__, __LINE__, station->name); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int remove_station(struct usr_map *Map, int station_idx){
+
+    /*
+        DESCRIPTION:
+        Removes a station out of the input dataset. The system keeps the row k of the station, the
+        covariances of later stations still refer to it. Instead the decomposition is bordered (see
+        lu_border) in O(n^2) by a row and a column e_k with 0 on the diagonal:
+
+            | C      e_k |   | a  |   | z |
+            | e_k^T  0   | * | mu | = | 0 |
+
+        The last row locks the coefficient a_k to 0, the additional unknown mu takes over the row k,
+        so that the other coefficients are the ones of the system without the station.
+        The system is decomposed again without the removed stations (see refactorize_stations), if
+        the new pivot is (nearly) 0 or there are more than UPDATE_MAX_LOCKS locked rows.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+        int station_idx		...	index of the station in the input dataset.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int excno;
+    jmp_buf env;
+
+    if ((excno = setjmp(env)) == 0){
+
+        int n = Map->covariance_factor.n;
+        int length = Map->input_data.length;
+        int bordered;
+        double *border;
+        char name[sizeof(Map->input_data.data[0].name)];
+        struct usr_arena_mark scratch;
+
+        if ((station_idx < 0) || (station_idx >= length)){
+            longjmp(env, 1);
+        }
+        if (length <= 1){
+            longjmp(env, 2);
+        }
+        strcpy(name, Map->input_data.data[station_idx].name);
+
+        if (reserve_system_rows(&(Map->update), n + 1, length) == EXIT_FAILURE){
+            longjmp(env, 3);
+        }
+
+        // the unit vector of the row of the station:
+        scratch = arena_mark(&(Map->arena));
+        border = create_fvector(&(Map->arena), n);
+        if (border == NULL){
+            longjmp(env, 3);
+        }
+        border[Map->update.station_rows[station_idx]] = 1;
+
+        bordered = lu_border(&(Map->covariance_factor), border, border, 0);
+        arena_rewind(&(Map->arena), scratch);
+        if (bordered == EXIT_FAILURE){
+            longjmp(env, 4);
+        }
+        if (bordered == EXIT_SUCCESS){
+            Map->update.rows[n].kind = UPDATE_ROW_LOCK;
+            Map->update.num_locks++;
+        }
+
+        // the following stations move forward:
+        memmove(&(Map->input_data.data[station_idx]), &(Map->input_data.data[station_idx+1]), (length - station_idx - 1) * sizeof(struct usr_data_point));
+        memmove(&(Map->update.station_rows[station_idx]), &(Map->update.station_rows[station_idx+1]), (length - station_idx - 1) * sizeof(int));
+        Map->input_data.length--;
+        Map->update.num_removed++;
+
+        // decompose the system of the remaining stations:
+        if ((bordered == 2) || (Map->update.num_locks > UPDATE_MAX_LOCKS)){
+            if (refactorize_stations(Map) == EXIT_FAILURE){
+                longjmp(env, 5);
+            }
+        }
+
+        if (Map->show_output){
+            printf("station \"%s\" removed (%d rows)\n", name, Map->covariance_factor.n);
+        }
+
+        return EXIT_SUCCESS;
+    }
+    else{
+        switch(excno){
+            case 1: fprintf(stderr, "ERROR: %s --> %d:\n >>> There is no station %d in the input dataset!\n", __FILE__, __LINE__, station_idx); return EXIT_FAILURE;
+            case 2: fprintf(stderr, "ERROR: %s --> %d:\n >>> The last station of the input dataset can not be removed!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 3: fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+            case 4: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when bordering the decomposition by the removed station!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            case 5: fprintf(stderr, "ERROR: %s --> %d:\n >>> Failure when decomposing the system of the remaining stations!\n", __FILE__, __LINE__); return EXIT_FAILURE;
+            default: fprintf(stderr, "ERROR: %s --> %d:\n Woops! Somethings nasty has happend!\n%s\n", __FILE__, __LINE__, strerror(errno)); return EXIT_FAILURE;
+        }
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int refactorize_stations(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Sets up and decomposes the system of the current stations again, just like create_covariance_matrix
+        and factorize_covariance_matrix do (O(n^3)). The locked rows of the removed stations are dropped,
+        the rows are the stations of the input dataset and the lagrange multiplier (see reset_system_rows).
+        The matrix is only needed for the decomposition, it is given back to the arena afterwards.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx, jdx;
+    int n = Map->input_data.length;
+    int err;
+    double *row;
+    struct usr_data_point *data = Map->input_data.data;
+    struct usr_matrix matrix;
+    struct usr_arena_mark scratch = arena_mark(&(Map->arena));
+
+    if (create_matrix(&(Map->arena), &matrix, n+1, n+1, true) == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+
+    // upper triangle (the matrix is symmetric):
+    for (idx=0; idx<n; idx++){
+
+        row = matrix_upper_row(&matrix, idx);
+        for (jdx=idx; jdx<n; jdx++){
+            row[jdx-idx] = station_covariance(Map, station_distance(data[idx].lat, data[idx].lon, data[jdx].lat, data[jdx].lon));
+        }
+        row[n-idx] = 1;
+    }
+    matrix_set(&matrix, n, n, 0);
+
+    err = lu_factorize(&(Map->covariance_factor), &matrix);
+    arena_rewind(&(Map->arena), scratch);
+    if (err == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+    Map->update.num_factorizations++;
+
+    return reset_system_rows(Map);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int update_dual_coefficients(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Calculates the dual coefficients (see create_dual_coefficients) of the updated stations by
+        one solution of the bordered system in O(n^2). The right hand side holds the values of the
+        stations in their rows, all other rows (lagrange multiplier, removed stations and their locks)
+        are 0. The coefficients are stored in the order of the input dataset with the one of the
+        lagrange multiplier at the end, as interpolate_raster_point_dual expects them.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int n = Map->input_data.length;
+    int err;
+    double *rhs, *solution;
+    struct usr_arena_mark scratch;
+
+    Map->dual_coefficients = create_fvector(&(Map->arena), n+1);
+    if (Map->dual_coefficients == NULL){
+        return EXIT_FAILURE;
+    }
+
+    scratch = arena_mark(&(Map->arena));
+    rhs = create_fvector(&(Map->arena), Map->covariance_factor.n);
+    solution = create_fvector(&(Map->arena), Map->covariance_factor.n);
+    if ((rhs == NULL) || (solution == NULL)){
+        arena_rewind(&(Map->arena), scratch);
+        return EXIT_FAILURE;
+    }
+
+    for (idx=0; idx<n; idx++){
+        rhs[Map->update.station_rows[idx]] = Map->input_data.data[idx].value;
+    }
+
+    err = lu_solve(&(Map->covariance_factor), rhs, solution);
+    if (err == EXIT_SUCCESS){
+
+        for (idx=0; idx<n; idx++){
+            Map->dual_coefficients[idx] = solution[Map->update.station_rows[idx]];
+        }
+        Map->dual_coefficients[n] = solution[Map->update.lagrange_row];
+    }
+
+    arena_rewind(&(Map->arena), scratch);
+    return err;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int update_station_overlay(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Assigns the updated stations to the raster again (see fill_raster_with_input_data). The raster
+        points of the stations were determined when they were read or added, the overlay keeps the order
+        of the input dataset, so that the later one of two stations on the same raster point remains.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+
+    Map->raster.stations = (struct usr_raster_station *) arena_alloc(&(Map->arena), Map->input_data.length * sizeof(struct usr_raster_station));
+    if (Map->raster.stations == NULL){
+        return EXIT_FAILURE;
+    }
+    Map->raster.num_stations = 0;
+
+    for (idx=0; idx<Map->input_data.length; idx++){
+
+        if (Map->input_data.data[idx].row_idx < 0){
+            continue;
+        }
+        Map->raster.stations[Map->raster.num_stations].row_idx = Map->input_data.data[idx].row_idx;
+        Map->raster.stations[Map->raster.num_stations].col_idx = Map->input_data.data[idx].col_idx;
+        Map->raster.stations[Map->raster.num_stations].station_idx = idx;
+        Map->raster.num_stations++;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int reset_system_rows(struct usr_map *Map){
+
+    /*
+        DESCRIPTION:
+        Describes the rows of a system, that is decomposed as a whole (see create_covariance_matrix and
+        refactorize_stations): the stations of the input dataset and the lagrange multiplier at the end.
+        add_station and remove_station append further rows behind.
+
+        INPUT:
+        struct usr_map *Map	...	pointer to the map object.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx;
+    int n = Map->input_data.length;
+
+    if ((Map->covariance_factor.lu == NULL) || (Map->covariance_factor.n != n+1)){
+        fprintf(stderr, "ERROR: %s --> %d:\n >>> The decomposition does not belong to the stations of the input dataset!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+    if (reserve_system_rows(&(Map->update), n+1, n) == EXIT_FAILURE){
+        fprintf(stderr, "ERROR: %s --> %d:\n >>> %s\n", __FILE__, __LINE__, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    for (idx=0; idx<n; idx++){
+        Map->update.rows[idx].kind = UPDATE_ROW_STATION;
+        Map->update.rows[idx].lat = Map->input_data.data[idx].lat;
+        Map->update.rows[idx].lon = Map->input_data.data[idx].lon;
+        Map->update.station_rows[idx] = idx;
+    }
+    Map->update.rows[n].kind = UPDATE_ROW_LAGRANGE;
+    Map->update.lagrange_row = n;
+    Map->update.num_locks = 0;
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int reserve_system_rows(struct usr_update *update, int num_rows, int num_stations){
+
+    /*
+        DESCRIPTION:
+        Makes sure that the description of the rows holds at least "num_rows" rows and the rows of the
+        stations at least "num_stations" stations. The arrays grow by doubling their capacity.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE (errno is set, the arrays stay valid)
+    */
+
+    int capacity;
+    int *station_rows;
+    struct usr_system_row *rows;
+
+    if ((update->rows == NULL) || (update->capacity < num_rows)){
+
+        capacity = (update->capacity > 0) ? update->capacity : UPDATE_ROW_CAPACITY;
+        while (capacity < num_rows){
+            capacity *= 2;
+        }
+        rows = (struct usr_system_row *) realloc(update->rows, capacity * sizeof(struct usr_system_row));
+        if (rows == NULL){
+            return EXIT_FAILURE;
+        }
+        update->rows = rows;
+        update->capacity = capacity;
+    }
+
+    if ((update->station_rows == NULL) || (update->station_capacity < num_stations)){
+
+        capacity = (update->station_capacity > 0) ? update->station_capacity : UPDATE_ROW_CAPACITY;
+        while (capacity < num_stations){
+            capacity *= 2;
+        }
+        station_rows = (int *) realloc(update->station_rows, capacity * sizeof(int));
+        if (station_rows == NULL){
+            return EXIT_FAILURE;
+        }
+        update->station_rows = station_rows;
+        update->station_capacity = capacity;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int find_station(struct usr_dataset *input_data, const char *name){
+
+    /*
+        DESCRIPTION:
+        Returns the index of the station with the given name in the input dataset or -1.
+    */
+
+    int idx;
+
+    for (idx=0; idx<input_data->length; idx++){
+        if (!strcmp(input_data->data[idx].name, name)){
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double station_distance(double latA, double lonA, double latB, double lonB){
+
+    /*
+        DESCRIPTION:
+        Distance between two stations exactly as in the distance matrix (see create_distance_matrix_worker):
+        stations that differ by less then EPS in both coordinates have the distance 0.
+    */
+
+    if ((fabs(latA - latB) < EPS) && (fabs(lonA - lonB) < EPS)){
+        return 0.0;
+    }
+    return calc_distance(latA, lonA, latB, lonB);
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double station_covariance(struct usr_map *Map, double distance){
+
+    /*
+        DESCRIPTION:
+        Covariance of two stations exactly as in the covariance matrix (see create_covariance_matrix):
+        the covariance of the distance 0 is the nugget value.
+    */
+
+    if (distance < EPS){
+        return Map->variogram.nugget;
+    }
+    return calc_covariance(distance, Map->variogram.sill, Map->variogram.nugget, Map->variogram.range, Map->variogram.model);
+}
@@ -0,0 +1,444 @@
+#ifdef __unix__
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <float.h>
+#endif
+
+#define VARIO_MODEL_AUTO -1					// choose the model with the smallest weighted error
+#define VARIO_MODEL_EXPONENTIAL 0
+#define VARIO_MODEL_SPHERICAL 1
+#define VARIO_MODEL_GAUSSIAN 2
+#define VARIO_MODEL_MATERN 3					// Matérn model with smoothness 3/2
+#define VARIO_NUM_MODELS 4
+
+#define MATERN_RANGE_FACTOR 4.743864518			// (1+x)*exp(-x) = 0.05 => practical range of the Matérn model
+#define LM_MAX_ITER 200						// maximum number of iterations of the Levenberg-Marquardt fit
+#define LM_MAX_LAMBDA 1.0E12					// the fit stops, if the damping gets larger
+#define LM_TOL 1.0E-12						// relative change of the error to stop the fit
+
+
+// Deklaration: Funktion
+// ###########################################################################
+// ###########################################################################
+
+static inline double variogram_model(int model, double distance, double sill, double nugget, double range);
+void variogram_model_shape(int model, double distance, double range, double *shape, double *dshape_drange);
+double variogram_wrss(int model, const double *distance, const double *variance, const double *weight, int length,
+                      double nugget, double sill, double range);
+int fit_variogram_model(int model, const double *distance, const double *variance, const double *weight, int length,
+                        double *nugget, double *sill, double *range, double *wrss);
+int solve_3x3(double A[3][3], double b[3], double x[3]);
+
+const char *variogram_model_name(int model);
+int variogram_model_by_name(const char *name);
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+static inline double variogram_model(int model, double distance, double sill, double nugget, double range){
+
+    /*
+        DESCRIPTION:
+        Calculates the semivariance of a distance by the given variogram model.
+        The range is always the practical range, where 95 % of the sill are reached
+        (the spherical model reaches the sill exactly at the range).
+
+        exponential:	nugget + sill * (1 - exp(-|h|/(range/3)))
+        spherical:	nugget + sill * (1.5*h/range - 0.5*(h/range)^3), h < range
+        gaussian:	nugget + sill * (1 - exp(-3*h^2/range^2))
+        matern (3/2):	nugget + sill * (1 - (1+u)*exp(-u)), u = MATERN_RANGE_FACTOR*h/range
+
+        INPUT:
+        int model		...	type of the model (VARIO_MODEL_...)
+        double distance		...	distance between two points
+        double sill		...	sill of the variogram model
+        double nugget		...	nugget of the variogram model
+        double range		...	range of the variogram model
+
+        OUTPUT:
+        on success		...	semivariance
+        on failure		...	NAN
+    */
+
+    double h = fabs(distance);
+    double u;
+
+    switch(model){
+
+        case VARIO_MODEL_EXPONENTIAL:
+            return nugget + sill * (1 - exp((-1 * h)/(range / 3.0)));
+
+        case VARIO_MODEL_SPHERICAL:
+            if (h >= range){
+                return nugget + sill;
+            }
+            u = h / range;
+            return nugget + sill * (1.5*u - 0.5*u*u*u);
+
+        case VARIO_MODEL_GAUSSIAN:
+            u = h / range;
+            return nugget + sill * (1 - exp(-3.0*u*u));
+
+        case VARIO_MODEL_MATERN:
+            u = MATERN_RANGE_FACTOR * h / range;
+            return nugget + sill * (1 - (1 + u) * exp(-u));
+
+        default:
+            return NAN;
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+void variogram_model_shape(int model, double distance, double range, double *shape, double *dshape_drange){
+
+    /*
+        DESCRIPTION:
+        Calculates the shape f(h) of a variogram model (semivariance = nugget + sill * f(h))
+        and its analytic derivative by the range (Jacobian of the fit).
+
+        INPUT:
+        int model		...	type of the model (VARIO_MODEL_...)
+        double distance		...	distance between two points
+        double range		...	range of the variogram model
+        double *shape		...	f(h)
+        double *dshape_drange	...	df/drange
+    */
+
+    double h = fabs(distance);
+    double u, e;
+
+    switch(model){
+
+        case VARIO_MODEL_EXPONENTIAL:
+            u = 3.0 * h / range;
+            e = exp(-u);
+            *shape = 1 - e;
+            *dshape_drange = -u * e / range;
+            break;
+
+        case VARIO_MODEL_SPHERICAL:
+            if (h >= range){
+                *shape = 1;
+                *dshape_drange = 0;
+                break;
+            }
+            u = h / range;
+            *shape = 1.5*u - 0.5*u*u*u;
+            *dshape_drange = (-1.5*u + 1.5*u*u*u) / range;
+            break;
+
+        case VARIO_MODEL_GAUSSIAN:
+            u = h / range;
+            e = exp(-3.0*u*u);
+            *shape = 1 - e;
+            *dshape_drange = -6.0 * u * u * e / range;
+            break;
+
+        case VARIO_MODEL_MATERN:
+            u = MATERN_RANGE_FACTOR * h / range;
+            e = exp(-u);
+            *shape = 1 - (1 + u) * e;
+            *dshape_drange = -u * u * e / range;
+            break;
+
+        default:
+            *shape = NAN;
+            *dshape_drange = NAN;
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+double variogram_wrss(int model, const double *distance, const double *variance, const double *weight, int length,
+                      double nugget, double sill, double range){
+
+    /*
+        DESCRIPTION:
+        Calculates the weighted residual sum of squares of a variogram model.
+
+        INPUT:
+        int model		...	type of the model (VARIO_MODEL_...)
+        const double *distance	...	average distances of the lags
+        const double *variance	...	average semivariances of the lags
+        const double *weight	...	weights of the lags (e.g. number of pairs of stations)
+        int length		...	number of lags
+        double nugget, sill, range	parameters of the model
+
+        OUTPUT:
+        weighted residual sum of squares
+    */
+
+    int idx;
+    double r;
+    double sum = 0;
+
+    for (idx=0; idx<length; idx++){
+        r = variance[idx] - variogram_model(model, distance[idx], sill, nugget, range);
+        sum += weight[idx] * r * r;
+    }
+    return sum;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int fit_variogram_model(int model, const double *distance, const double *variance, const double *weight, int length,
+                        double *nugget, double *sill, double *range, double *wrss){
+
+    /*
+        DESCRIPTION:
+        Fits nugget, sill and range of a variogram model to the lags of the empirical variogram
+        by a Levenberg-Marquardt method with analytic Jacobians. The residuals are weighted
+        (e.g. by the number of pairs of stations of a lag).
+        The damping is scaled by the diagonal of J'WJ, so the fit does not depend on the scale of the values.
+        The parameters are kept within nugget >= 0, sill >= 0 and range > 0.
+
+        INPUT:
+        int model		...	type of the model (VARIO_MODEL_...)
+        const double *distance	...	average distances of the lags
+        const double *variance	...	average semivariances of the lags
+        const double *weight	...	weights of the lags
+        int length		...	number of lags (at least 3)
+        double *nugget		...	start value / solution of the nugget
+        double *sill		...	start value / solution of the sill
+        double *range		...	start value / solution of the range
+        double *wrss		...	weighted residual sum of squares of the solution
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE
+    */
+
+    int idx, jdx, kdx, iter;
+    double p[3], p_new[3] = {0, 0, 0}, delta[3], J[3];
+    double JTJ[3][3], JTr[3], A[3][3], b[3];
+    double f, df, r;
+    double lambda = 1.0E-3;
+    double cost, cost_new = 0;
+    double range_min;
+
+    if ((length < 3) || (model < 0) || (model >= VARIO_NUM_MODELS)){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The variogram model needs at least 3 lags!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    // the smallest range is a fraction of the smallest distance:
+    range_min = DBL_MAX;
+    for (idx=0; idx<length; idx++){
+        if ((distance[idx] > 0) && (distance[idx] < range_min)){
+            range_min = distance[idx];
+        }
+    }
+    range_min *= 1.0E-3;
+
+    p[0] = (*nugget > 0) ? *nugget : 0;
+    p[1] = (*sill > 0) ? *sill : 0;
+    p[2] = (*range > range_min) ? *range : range_min;
+
+    cost = variogram_wrss(model, distance, variance, weight, length, p[0], p[1], p[2]);
+    if ((isnan(cost)) || (isinf(cost))){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The start values of the variogram model are invalid!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    for (iter=0; iter<LM_MAX_ITER; iter++){
+
+        // normal equations J'WJ and J'Wr:
+        memset(JTJ, 0, sizeof(JTJ));
+        memset(JTr, 0, sizeof(JTr));
+
+        for (idx=0; idx<length; idx++){
+
+            variogram_model_shape(model, distance[idx], p[2], &f, &df);
+
+            r = variance[idx] - (p[0] + p[1] * f);
+            J[0] = 1;
+            J[1] = f;
+            J[2] = p[1] * df;
+
+            for (jdx=0; jdx<3; jdx++){
+                JTr[jdx] += weight[idx] * J[jdx] * r;
+                for (kdx=0; kdx<3; kdx++){
+                    JTJ[jdx][kdx] += weight[idx] * J[jdx] * J[kdx];
+                }
+            }
+        }
+
+        // find a step that reduces the error:
+        while (lambda < LM_MAX_LAMBDA){
+
+            for (jdx=0; jdx<3; jdx++){
+                for (kdx=0; kdx<3; kdx++){
+                    A[jdx][kdx] = JTJ[jdx][kdx];
+                }
+                A[jdx][jdx] += lambda * ((JTJ[jdx][jdx] > 0) ? JTJ[jdx][jdx] : 1.0);
+                b[jdx] = JTr[jdx];
+            }
+
+            if (solve_3x3(A, b, delta) == EXIT_FAILURE){
+                lambda *= 10;
+                continue;
+            }
+
+            p_new[0] = ((p[0] + delta[0]) > 0) ? (p[0] + delta[0]) : 0;
+            p_new[1] = ((p[1] + delta[1]) > 0) ? (p[1] + delta[1]) : 0;
+            p_new[2] = ((p[2] + delta[2]) > range_min) ? (p[2] + delta[2]) : range_min;
+
+            cost_new = variogram_wrss(model, distance, variance, weight, length, p_new[0], p_new[1], p_new[2]);
+
+            if (cost_new < cost){
+                break;
+            }
+            lambda *= 10;
+        }
+
+        // no further improvement:
+        if (lambda >= LM_MAX_LAMBDA){
+            break;
+        }
+
+        memcpy(p, p_new, sizeof(p));
+        lambda = (lambda > 1.0E-12) ? lambda / 10 : lambda;
+
+        if ((cost - cost_new) <= LM_TOL * cost){
+            cost = cost_new;
+            break;
+        }
+        cost = cost_new;
+    }
+
+    if ((isnan(cost)) || (isinf(cost))){
+        fprintf(stderr, "\nERROR: %s --> %d:\n >>> The fit of the variogram model failed!\n", __FILE__, __LINE__);
+        return EXIT_FAILURE;
+    }
+
+    *nugget = p[0];
+    *sill = p[1];
+    *range = p[2];
+    *wrss = cost;
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int solve_3x3(double A[3][3], double b[3], double x[3]){
+
+    /*
+        DESCRIPTION:
+        Solves a linear system of 3 equations by Gaussian elimination with partial pivoting.
+        A and b are overwritten.
+
+        OUTPUT: (error code)
+        on success		...	EXIT_SUCCESS
+        on failure		...	EXIT_FAILURE (singular)
+    */
+
+    int idx, jdx, kdx, pidx;
+    double tmp, amax = 0;
+
+    for (idx=0; idx<3; idx++){
+        for (jdx=0; jdx<3; jdx++){
+            if (fabs(A[idx][jdx]) > amax){
+                amax = fabs(A[idx][jdx]);
+            }
+        }
+    }
+
+    for (kdx=0; kdx<3; kdx++){
+
+        pidx = kdx;
+        for (idx=kdx+1; idx<3; idx++){
+            if (fabs(A[idx][kdx]) > fabs(A[pidx][kdx])){
+                pidx = idx;
+            }
+        }
+        if (!(fabs(A[pidx][kdx]) > 3 * DBL_EPSILON * amax)){
+            return EXIT_FAILURE;
+        }
+
+        if (pidx != kdx){
+            for (jdx=0; jdx<3; jdx++){
+                tmp = A[kdx][jdx]; A[kdx][jdx] = A[pidx][jdx]; A[pidx][jdx] = tmp;
+            }
+            tmp = b[kdx]; b[kdx] = b[pidx]; b[pidx] = tmp;
+        }
+
+        for (idx=kdx+1; idx<3; idx++){
+            tmp = A[idx][kdx] / A[kdx][kdx];
+            for (jdx=kdx; jdx<3; jdx++){
+                A[idx][jdx] -= tmp * A[kdx][jdx];
+            }
+            b[idx] -= tmp * b[kdx];
+        }
+    }
+
+    for (idx=2; idx>=0; idx--){
+        tmp = b[idx];
+        for (jdx=idx+1; jdx<3; jdx++){
+            tmp -= A[idx][jdx] * x[jdx];
+        }
+        x[idx] = tmp / A[idx][idx];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+const char *variogram_model_name(int model){
+
+    switch(model){
+        case VARIO_MODEL_AUTO: return "auto";
+        case VARIO_MODEL_EXPONENTIAL: return "exponential";
+        case VARIO_MODEL_SPHERICAL: return "spherical";
+        case VARIO_MODEL_GAUSSIAN: return "gaussian";
+        case VARIO_MODEL_MATERN: return "matern";
+        default: return "unknown";
+    }
+}
+
+
+// ##################################################################################################
+// ##################################################################################################
+
+
+int variogram_model_by_name(const char *name){
+
+    /*
+        DESCRIPTION:
+        Returns the type of a variogram model by its name (or the first 3 letters of it).
+
+        OUTPUT:
+        on success		...	VARIO_MODEL_...
+        on failure		...	-2
+    */
+
+    int model;
+
+    for (model=VARIO_MODEL_AUTO; model<VARIO_NUM_MODELS; model++){
+        if ((strlen(name) >= 3) && (!strncmp(name, variogram_model_name(model), strlen(name)))){
+            return model;
+        }
+    }
+    return -2;
+}
@@ -5,8 +5,13 @@
     #include <math.h>
     #include <string.h>
     #include <stdbool.h>
+    #include <pthread.h>
+    #include <stdatomic.h>
     #include "./headerfiles/kriging_structs.h"
     #include "./headerfiles/kriging.h"
+    #include "./headerfiles/batch.h"
+    #include "./headerfiles/update.h"
+    #include "./headerfiles/cache.h"
 #endif
 
 
@@ -29,6 +34,32 @@ to call this function with:
 		Basically it is recommended to call this argument.
 -o	...	basically this function shows no output during its calculations.
 		You can enable an extensive output by using this parameter
+-t <n>	...	number of threads used to interpolate the raster.
+		By default all available processors are used.
+-m <model>	...	variogram model: exponential, spherical, gaussian, matern (3/2) or auto.
+		By default (auto) the model with the smallest weighted error is used.
+-k <n>	...	local kriging: every raster point is interpolated by its n nearest stations.
+-r <km>	...	local kriging: only stations within this search radius are used.
+-v	...	the kriging variance of every raster point is calculated and written
+		to "krigingVariance.bin".
+-csv	...	the rasters are written to csv files (values, "lat.csv" and "lon.csv")
+		instead of one binary file (header with the geometry + float32 values).
+-b	...	batch: every value column (field) of the input file is interpolated on the same
+		stations (name;lat;lon;field_1;...;field_K) and written to "<output file>_field<k>".
+		All fields share the variogram of the first field, the covariance matrix is
+		decomposed once.
+-bv	...	batch with its own variogram for every field (one decomposition per distinct model).
+-u <file>	...	late reports and rejected stations (file in the input directory):
+		"name;lat;lon;value" adds a station (or revises/replaces the one of this name),
+		"name" removes it. After the analysis the stations are updated without decomposing
+		the covariance matrix again and the raster is written to "interpolRaster_u".
+-mc	...	model cache: the distance matrix, the fitted variogram and the decomposition of the
+		covariance matrix are written to "<output dir>/modelCache_<key>.cache". The key is a hash
+		of the coordinates of the stations, the variogram and the raster parameters. A later run
+		with the same key reads them instead of calculating them, only the values are new
+		(the variogram is the one of the run, that has written the cache).
+		
+Compile with:	gcc kriging.c -o kriging -lm -lpthread
 		
 ###########################################################################################*/
 
@@ -54,7 +85,13 @@ int main(int argc, char **argv){
                           .latMetRes = 0,						// resolution between two points (geogr. latitude)
                           .lonMetRes = 0,						// resolution between two points (geogr. longitude)
                           .weights_correction = false,					// subsequently correction of negative weights
+                          .dual_kriging = true,						// dual kriging, if there is no correction of negative weights
                           .show_output = false,						// show output during calculations
+                          .output_csv = false,						// output csv files instead of one binary file
+                          .kriging_variance = false,					// calculate the kriging variance of every raster point
+                          .num_threads = 0,						// number of threads to interpolate (0 => all available processors)
+                          .num_neighbours = 0,						// local kriging: number of nearest stations (0 => all stations)
+                          .search_radius = 0,						// local kriging: search radius in km (0 => unlimited)
                           .rows = 900,							// 900 => resolution of 1 km in horizontal direction
                           .cols = 0,							// will be subsequently calculated 
                           .variogram = {.distInterval = 50,				// width of each distance-interval of the variogram
@@ -62,21 +99,36 @@ int main(int argc, char **argv){
                                         .nugget = 0.001,
                                         .sill = 0,
                                         .range = 0,
+                                        .model = VARIO_MODEL_AUTO,			// variogram model (best fit of all models)
+                                        .wrss = 0,
                                         .model_adjust_index = 0,
                                         .reg_function = {.order = 4}			// order of regression function
                                         },						
                           .config = {.output_dir = {"./output/"},			// output directory 
-                                     .output_datafile = {"interpolRaster.csv"}, 	// outputfile without correction
-                                     .output_datafile_cor = {"interpolRaster_c.csv"},	// ouputtfile with correction
+                                     .output_datafile = {"interpolRaster"}, 		// outputfile without correction (without extension)
+                                     .output_datafile_cor = {"interpolRaster_c"},	// ouputtfile with correction (without extension)
+                                     .output_variancefile = {"krigingVariance"},	// outputfile of the kriging variance (without extension)
+                                     .output_datafile_upd = {"interpolRaster_u"},	// outputfile after the update of the stations (without extension)
+                                     .update_datafile = {""},				// late reports and rejected stations ("-u", empty => none)
+                                     .csv_decimal_separator = '.',			// decimal separator of the csv files
+                                     .csv_field_separator = ';',			// field separator of the csv files
                                      .input_dir = {"./input/"},				// input directory 			
                                      .input_datafile = {"tagessummen_452.csv"}},	// dataset of the sums of daily precipiation
+                         .arena = {.blocks = NULL, .block_size = ARENA_BLOCK_SIZE},	// buffers of the run (released at once in free_raster)
                          .input_data.data = NULL,
                          .variogram.classes = NULL,
                          .variogram.reg_function.solution = NULL,
-                         .raster = NULL,
-                         .distance_matrix = NULL,
-                         .covariance_matrix = NULL,
-                         .covariance_matrix_inv = NULL,
+                         .raster = {.value = NULL, .stations = NULL},
+                         .variance = {.value = NULL, .stations = NULL},
+                         .grid_distance = {.row_sin = NULL, .row_cos = NULL, .station_sin = NULL, .station_cos = NULL, .col_cos_dlon = NULL},
+                         .station_index = {.cell_start = NULL, .stations = NULL},
+                         .distance_matrix = {.value = NULL},
+                         .covariance_matrix = {.value = NULL},
+                         .covariance_factor = {.lu = NULL, .pivot = NULL, .capacity = 0},
+                         .dual_coefficients = NULL,
+                         .batch = {.enabled = false, .field_variograms = false, .num_pass = 0},	// batch of several fields ("-b", "-bv")
+                         .update = {.rows = NULL, .station_rows = NULL, .capacity = 0, .station_capacity = 0},	// update of the stations ("-u")
+                         .model_cache = {.enabled = false, .loaded = false, .map = NULL},	// model cache of the station network ("-mc")
                          };
     
     
@@ -91,17 +143,49 @@ int main(int argc, char **argv){
         exit(err);
     }) : NULL;
     
+    // arguments of the batch of several fields:
+    err = set_batch_config(&Map, argc, argv);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // arguments of the update of the stations:
+    err = set_update_config(&Map, argc, argv);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // argument of the model cache:
+    err = set_cache_config(&Map, argc, argv);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
     // initialize the raster of the map:
-    err = create_maps_raster(&(Map.raster), Map.rows, Map.cols);
+    err = create_maps_raster(&(Map.arena), &(Map.raster), Map.rows, Map.cols);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // initialize the raster of the kriging variance:
+    err = (Map.kriging_variance) ? create_maps_raster(&(Map.arena), &(Map.variance), Map.rows, Map.cols) : EXIT_SUCCESS;
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
         exit(err);
     }) : NULL;
 
-    // fill the raster points with information:
-    // - coordinates
-    // - index
+    // fill the raster with information:
+    // - geometry (coordinates of the raster points)
+    // - default values
     err = fill_raster_with_default_data(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
@@ -133,8 +217,16 @@ int main(int argc, char **argv){
         exit(err);
     }) : NULL;
     
-    // Erstelle eine Abstandsmatrix:
-    err = create_distance_matrix(&Map);
+    // Lies das Modell eines unveränderten Stationsnetzes aus dem Cache (nur mit "-mc"):
+    err = read_model_cache(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // Erstelle eine Abstandsmatrix (außer sie stammt aus dem Cache):
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : create_distance_matrix(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -142,7 +234,7 @@ int main(int argc, char **argv){
     }) : NULL;
     
     // show the distance matrix if Map.show_output is set to true
-    err = show_matrix("distance matrix", Map.distance_matrix, 20, 20, Map.show_output);
+    err = show_matrix("distance matrix", &(Map.distance_matrix), 20, 20, Map.show_output);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -150,7 +242,7 @@ int main(int argc, char **argv){
     }) : NULL;
     
     //check the matrix for nan and inf value and get the max and min value:
-    err = check_matrix(Map.distance_matrix, Map.input_data.length, Map.input_data.length, Map.show_output);
+    err = check_matrix(&(Map.distance_matrix), Map.show_output);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -158,7 +250,7 @@ int main(int argc, char **argv){
     }) : NULL;
                 
     // Erstelle aus den Messwerten ein Variogramm:
-    err = create_variogram(&Map);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : create_variogram(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -166,7 +258,7 @@ int main(int argc, char **argv){
     }) : NULL;
 
     // Determine out of the semivariances the covariance model:
-    err = get_variogram_model(&Map);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : get_variogram_model(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -174,7 +266,7 @@ int main(int argc, char **argv){
     }) : NULL;
                        
     // Zeige Informationen zu Variogramm:
-    show_variogram_data(&Map);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : show_variogram_data(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -182,7 +274,7 @@ int main(int argc, char **argv){
     }) : NULL; 
     
     // Erstelle die Kovarianzmatrix:
-    err = create_covariance_matrix(&Map);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : create_covariance_matrix(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -190,7 +282,7 @@ int main(int argc, char **argv){
     }) : NULL;
 
     // check the matrix for nan and inf value and get the max and min value:                                                     
-    err = check_matrix(Map.covariance_matrix, Map.input_data.length+1, Map.input_data.length+1, Map.show_output);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : check_matrix(&(Map.covariance_matrix), Map.show_output);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -198,31 +290,39 @@ int main(int argc, char **argv){
     }) : NULL;
 
     // show the covariance matrix if Map.show_output is set to true
-    err = show_matrix("covariance matrix", Map.covariance_matrix, 20, 20, Map.show_output);
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : show_matrix("covariance matrix", &(Map.covariance_matrix), 20, 20, Map.show_output);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
         exit(err);
     }) : NULL; 
           
-    // Berechne die Inverse der Kovarianzmatrix:
-    err = create_inverted_covariance_matrix(&Map);
+    // Zerlege die Kovarianzmatrix (LU):
+    err = (Map.model_cache.loaded) ? EXIT_SUCCESS : factorize_covariance_matrix(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
         exit(err);
     }) : NULL;
     
-    // check the matrix for nan and inf value and get the max and min value:  
-    check_matrix(Map.covariance_matrix_inv, Map.input_data.length+1, Map.input_data.length+1, Map.show_output);
+    // Schreibe das Modell in den Cache (nur mit "-mc"):
+    err = write_model_cache(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
         exit(err);
     }) : NULL;
-    
-    // show the inverted covariance matrix if Map.show_output is set to true    
-    show_matrix("inverted covariance matrix", Map.covariance_matrix_inv, 20, 20, Map.show_output);
+
+    // Batch: interpoliere alle Felder und gib ihre Raster aus (ersetzt die folgenden Schritte):
+    if (Map.batch.enabled){
+        err = interpolate_fields(&Map);
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }
+
+    // Berechne die Koeffizienten des dualen Krigings (nur ohne Korrektur der Gewichte):
+    err = create_dual_coefficients(&Map);
     (err == EXIT_FAILURE) ? ({
         free_raster(&Map);
         free_vector(&Map);
@@ -255,13 +355,33 @@ int main(int argc, char **argv){
     
        
     // the output depends on if correction of negative weights was selected or not:
-    if (Map.weights_correction){        
-        outputRasterCSV(Map.raster, Map.config.output_dir, Map.config.output_datafile_cor, Map.rows, Map.cols, Map.show_output);
-    }
-    else{
-        outputRasterCSV(Map.raster, Map.config.output_dir, Map.config.output_datafile, Map.rows, Map.cols, Map.show_output);
+    err = (Map.output_csv) ? outputRasterCSV(&(Map.raster), Map.config.output_dir, (Map.weights_correction) ? Map.config.output_datafile_cor : Map.config.output_datafile, Map.config.csv_decimal_separator, Map.config.csv_field_separator, Map.num_threads, Map.show_output)
+                           : outputRasterBinary(&(Map.raster), Map.config.output_dir, (Map.weights_correction) ? Map.config.output_datafile_cor : Map.config.output_datafile, Map.show_output);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
+    // the kriging variance:
+    if (Map.kriging_variance){
+        err = (Map.output_csv) ? outputRasterCSV(&(Map.variance), Map.config.output_dir, Map.config.output_variancefile, Map.config.csv_decimal_separator, Map.config.csv_field_separator, Map.num_threads, Map.show_output)
+                               : outputRasterBinary(&(Map.variance), Map.config.output_dir, Map.config.output_variancefile, Map.show_output);
+        (err == EXIT_FAILURE) ? ({
+            free_raster(&Map);
+            free_vector(&Map);
+            exit(err);
+        }) : NULL;
     }
     
+    // late reports and rejected stations: update the system and write the corrected raster:
+    err = update_stations(&Map);
+    (err == EXIT_FAILURE) ? ({
+        free_raster(&Map);
+        free_vector(&Map);
+        exit(err);
+    }) : NULL;
+    
     // clean up:
     free_raster(&Map);
     free_vector(&Map);               